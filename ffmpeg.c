@@ -59,6 +59,7 @@
 #include "libavutil/bprint.h"
 #include "libavutil/time.h"
 #include "libavutil/threadmessage.h"
+#include "libavutil/scene_score.h"
 #include "libavcodec/mathops.h"
 #include "libavformat/os_support.h"
 
@@ -117,6 +118,7 @@ const char *const forced_keyframes_const_names[] = {
     "prev_forced_n",
     "prev_forced_t",
     "t",
+    "scene",
     NULL
 };
 
@@ -529,6 +531,9 @@ static void ffmpeg_cleanup(int ret)
 
         av_dict_free(&ost->sws_dict);
 
+        av_freep(&ost->latency_pending);
+        av_freep(&ost->latency_hist);
+
         avcodec_free_context(&ost->enc_ctx);
 
         av_freep(&output_streams[i]);
@@ -563,6 +568,7 @@ static void ffmpeg_cleanup(int ret)
                    av_err2str(AVERROR(errno)));
     }
     av_freep(&vstats_filename);
+    av_freep(&filter_profile_filename);
 
     av_freep(&input_streams);
     av_freep(&input_files);
@@ -623,6 +629,246 @@ static void update_benchmark(const char *fmt, ...)
     }
 }
 
+static AVLatencyRecord *latency_packet_record(AVPacket *pkt)
+{
+    int size;
+    uint8_t *sd = av_packet_get_side_data(pkt, AV_PKT_DATA_LATENCY, &size);
+
+    return sd && size >= sizeof(AVLatencyRecord) ? (AVLatencyRecord *)sd : NULL;
+}
+
+static void latency_mark_demux(AVPacket *pkt)
+{
+    AVLatencyRecord *rec;
+
+    if (!stats_latency)
+        return;
+    rec = (AVLatencyRecord *)av_packet_new_side_data(pkt, AV_PKT_DATA_LATENCY,
+                                                     sizeof(*rec));
+    if (rec) {
+        memset(rec, 0, sizeof(*rec));
+        rec->stage[AV_LATENCY_STAGE_DEMUX] = av_gettime_relative();
+    }
+}
+
+static void latency_mark_packet(AVPacket *pkt, enum AVLatencyStage stage)
+{
+    AVLatencyRecord *rec;
+
+    if (stats_latency && (rec = latency_packet_record(pkt)) && !rec->stage[stage])
+        rec->stage[stage] = av_gettime_relative();
+}
+
+static void latency_mark_frame(AVFrame *frame, enum AVLatencyStage stage)
+{
+    AVLatencyRecord *rec;
+
+    if (stats_latency && (rec = av_latency_record_get_writable(frame)))
+        rec->stage[stage] = av_gettime_relative();
+}
+
+/* remember the record of a frame sent to the encoder, the encoder may
+ * reorder or delay it so it is matched to its packet by pts */
+static void latency_encoder_in(OutputStream *ost, AVFrame *frame)
+{
+    AVLatencyRecord *rec;
+    LatencyPending *p;
+
+    if (!stats_latency || !(rec = av_latency_record_get_writable(frame)))
+        return;
+    rec->stage[AV_LATENCY_STAGE_ENCODER_IN] = av_gettime_relative();
+
+    if (!ost->latency_pending) {
+        ost->latency_pending = av_malloc_array(LATENCY_MAX_PENDING, sizeof(*ost->latency_pending));
+        if (!ost->latency_pending)
+            return;
+    }
+    if (ost->nb_latency_pending == LATENCY_MAX_PENDING) {
+        memmove(ost->latency_pending, ost->latency_pending + 1,
+                (LATENCY_MAX_PENDING - 1) * sizeof(*ost->latency_pending));
+        ost->nb_latency_pending--;
+    }
+    p = &ost->latency_pending[ost->nb_latency_pending++];
+    p->pts = frame->pts;
+    p->rec = *rec;
+}
+
+static void latency_encoder_out(OutputStream *ost, AVPacket *pkt)
+{
+    AVLatencyRecord *rec;
+    int i;
+
+    if (!ost->nb_latency_pending)
+        return;
+
+    for (i = 0; i < ost->nb_latency_pending; i++)
+        if (ost->latency_pending[i].pts == pkt->pts)
+            break;
+    /* encoders with a delay may shift timestamps, use the oldest frame */
+    if (i == ost->nb_latency_pending)
+        i = 0;
+
+    rec = (AVLatencyRecord *)av_packet_new_side_data(pkt, AV_PKT_DATA_LATENCY,
+                                                     sizeof(*rec));
+    if (rec) {
+        *rec = ost->latency_pending[i].rec;
+        rec->stage[AV_LATENCY_STAGE_ENCODER_OUT] = av_gettime_relative();
+    }
+
+    ost->nb_latency_pending--;
+    memmove(ost->latency_pending + i, ost->latency_pending + i + 1,
+            (ost->nb_latency_pending - i) * sizeof(*ost->latency_pending));
+}
+
+static void latency_hist_add(FFLogHistogram *h, int64_t from, int64_t to)
+{
+    if (from && to)
+        ff_log_hist_add(h, to - from);
+}
+
+static void latency_update(OutputStream *ost, const AVLatencyRecord *rec)
+{
+    FFLogHistogram *h;
+    const int64_t *st = rec->stage;
+    int64_t first;
+    int i;
+
+    if (!ost->latency_hist) {
+        ost->latency_hist = av_mallocz_array(LATENCY_NB, sizeof(*ost->latency_hist));
+        if (!ost->latency_hist)
+            return;
+    }
+    h = ost->latency_hist;
+
+    latency_hist_add(&h[LATENCY_DEMUX],  st[AV_LATENCY_STAGE_DEMUX],       st[AV_LATENCY_STAGE_DECODER_IN]);
+    latency_hist_add(&h[LATENCY_DECODE], st[AV_LATENCY_STAGE_DECODER_IN],  st[AV_LATENCY_STAGE_DECODER_OUT]);
+    if (rec->nb_filters) {
+        latency_hist_add(&h[LATENCY_FILTER_QUEUE], st[AV_LATENCY_STAGE_DECODER_OUT], rec->filter_in[0]);
+        for (i = 0; i + 1 < rec->nb_filters; i++)
+            latency_hist_add(&h[LATENCY_FILTER + i], rec->filter_in[i], rec->filter_in[i + 1]);
+        latency_hist_add(&h[LATENCY_FILTER_SINK], rec->filter_in[rec->nb_filters - 1],
+                         st[AV_LATENCY_STAGE_ENCODER_IN]);
+    }
+    latency_hist_add(&h[LATENCY_ENCODE], st[AV_LATENCY_STAGE_ENCODER_IN],  st[AV_LATENCY_STAGE_ENCODER_OUT]);
+    latency_hist_add(&h[LATENCY_MUX],    st[AV_LATENCY_STAGE_ENCODER_OUT], st[AV_LATENCY_STAGE_MUX]);
+
+    first = st[AV_LATENCY_STAGE_DEMUX]       ? st[AV_LATENCY_STAGE_DEMUX]      :
+            st[AV_LATENCY_STAGE_DECODER_IN]  ? st[AV_LATENCY_STAGE_DECODER_IN] :
+            st[AV_LATENCY_STAGE_DECODER_OUT] ? st[AV_LATENCY_STAGE_DECODER_OUT] :
+            rec->nb_filters                  ? rec->filter_in[0]               :
+                                               st[AV_LATENCY_STAGE_ENCODER_IN];
+    latency_hist_add(&h[LATENCY_TOTAL], first, st[AV_LATENCY_STAGE_MUX]);
+}
+
+/* take the latency record off a packet before it reaches the muxer */
+static void latency_mark_mux(OutputStream *ost, AVPacket *pkt)
+{
+    int i;
+
+    for (i = 0; i < pkt->side_data_elems; i++) {
+        AVPacketSideData *sd = &pkt->side_data[i];
+
+        if (sd->type != AV_PKT_DATA_LATENCY)
+            continue;
+        if (stats_latency && sd->size >= sizeof(AVLatencyRecord)) {
+            AVLatencyRecord *rec = (AVLatencyRecord *)sd->data;
+            rec->stage[AV_LATENCY_STAGE_MUX] = av_gettime_relative();
+            latency_update(ost, rec);
+        }
+        av_freep(&sd->data);
+        *sd = pkt->side_data[--pkt->side_data_elems];
+        break;
+    }
+}
+
+static void print_latency_stats(void)
+{
+    static const struct {
+        enum LatencyInterval idx;
+        const char *name;
+    } intervals[] = {
+        { LATENCY_DEMUX,        "demux"          },
+        { LATENCY_DECODE,       "decode"         },
+        { LATENCY_FILTER_QUEUE, "decode->filter" },
+        { LATENCY_FILTER,       NULL             },
+        { LATENCY_FILTER_SINK,  "filter->encode" },
+        { LATENCY_ENCODE,       "encode"         },
+        { LATENCY_MUX,          "encode->mux"    },
+        { LATENCY_TOTAL,        "total"          },
+    };
+    int i, j, k;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        AVFilterContext *chain[AV_LATENCY_MAX_FILTERS];
+        AVFilterContext *f = ost->filter ? ost->filter->filter : NULL;
+        int nb_chain = 0;
+
+        if (!ost->latency_hist)
+            continue;
+
+        /* name the filters along the path through their first input */
+        while (f && f->nb_inputs && nb_chain < AV_LATENCY_MAX_FILTERS) {
+            chain[nb_chain++] = f;
+            f = f->inputs[0]->src;
+        }
+
+        av_log(NULL, AV_LOG_INFO, "Latency of output stream #%d:%d in microseconds:\n",
+               ost->file_index, ost->index);
+        av_log(NULL, AV_LOG_INFO, "  %-32.32s %10s %9s %9s %9s %9s\n",
+               "stage", "count", "p50", "p90", "p99", "max");
+
+        for (j = 0; j < FF_ARRAY_ELEMS(intervals); j++) {
+            int nb = intervals[j].idx == LATENCY_FILTER ? AV_LATENCY_MAX_FILTERS - 1 : 1;
+
+            for (k = 0; k < nb; k++) {
+                const FFLogHistogram *h = &ost->latency_hist[intervals[j].idx + k];
+                char name[64];
+
+                if (!h->count)
+                    continue;
+                if (intervals[j].name)
+                    av_strlcpy(name, intervals[j].name, sizeof(name));
+                else if (k < nb_chain)
+                    snprintf(name, sizeof(name), "filter %s", chain[nb_chain - 1 - k]->name);
+                else
+                    snprintf(name, sizeof(name), "filter #%d", k);
+
+                av_log(NULL, AV_LOG_INFO, "  %-32.32s %10"PRIu64" %9"PRId64" %9"PRId64" %9"PRId64" %9"PRId64"\n",
+                       name, h->count,
+                       ff_log_hist_percentile(h, 0.50), ff_log_hist_percentile(h, 0.90),
+                       ff_log_hist_percentile(h, 0.99), h->max);
+            }
+        }
+    }
+}
+
+/* write the profile of all filtergraphs as one JSON object; a file is
+ * overwritten with the latest data, stderr gets one line per dump */
+static void dump_filter_profile(int64_t elapsed)
+{
+    FILE *f = strcmp(filter_profile_filename, "-") ? fopen(filter_profile_filename, "w") : stderr;
+    int i;
+
+    if (!f) {
+        av_log(NULL, AV_LOG_ERROR, "Could not open filter profile file %s: %s\n",
+               filter_profile_filename, strerror(errno));
+        return;
+    }
+
+    fprintf(f, "{\"time\":%.3f,\"filtergraphs\":[", elapsed / 1000000.0);
+    for (i = 0; i < nb_filtergraphs; i++) {
+        char *dump = filtergraphs[i]->graph ?
+                     avfilter_graph_profile_dump(filtergraphs[i]->graph) : NULL;
+        fprintf(f, "%s%s", i ? "," : "", dump ? dump : "null");
+        av_free(dump);
+    }
+    fprintf(f, "]}\n");
+
+    if (f != stderr)
+        fclose(f);
+}
+
 static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream, OSTFinished others)
 {
     int i;
@@ -759,6 +1005,8 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
               );
     }
 
+    latency_mark_mux(ost, pkt);
+
     ret = av_interleaved_write_frame(s, pkt);
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
@@ -821,6 +1069,8 @@ static void do_audio_out(AVFormatContext *s, OutputStream *ost,
                enc->time_base.num, enc->time_base.den);
     }
 
+    latency_encoder_in(ost, frame);
+
     if (avcodec_encode_audio2(enc, &pkt, frame, &got_packet) < 0) {
         av_log(NULL, AV_LOG_FATAL, "Audio encoding failed (avcodec_encode_audio2)\n");
         exit_program(1);
@@ -828,6 +1078,7 @@ static void do_audio_out(AVFormatContext *s, OutputStream *ost,
     update_benchmark("encode_audio %d.%d", ost->file_index, ost->index);
 
     if (got_packet) {
+        latency_encoder_out(ost, &pkt);
         av_packet_rescale_ts(&pkt, enc->time_base, ost->st->time_base);
 
         if (debug_ts) {
@@ -1131,8 +1382,11 @@ static void do_video_out(AVFormatContext *s,
             ost->forced_kf_index++;
             forced_keyframe = 1;
         } else if (ost->forced_keyframes_pexpr) {
+            AVFrameSideData *sd = av_frame_get_side_data(in_picture, AV_FRAME_DATA_SCENE_SCORE);
             double res;
             ost->forced_keyframes_expr_const_values[FKF_T] = pts_time;
+            ost->forced_keyframes_expr_const_values[FKF_SCENE] =
+                sd ? ((AVSceneScore *)sd->data)->score : NAN;
             res = av_expr_eval(ost->forced_keyframes_pexpr,
                                ost->forced_keyframes_expr_const_values, NULL);
             ff_dlog(NULL, "force_key_frame: n:%f n_forced:%f prev_forced_n:%f t:%f prev_forced_t:%f -> res:%f\n",
@@ -1173,6 +1427,8 @@ static void do_video_out(AVFormatContext *s,
 
         ost->frames_encoded++;
 
+        latency_encoder_in(ost, in_picture);
+
         ret = avcodec_encode_video2(enc, &pkt, in_picture, &got_packet);
         update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
         if (ret < 0) {
@@ -1191,6 +1447,8 @@ static void do_video_out(AVFormatContext *s,
             if (pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & AV_CODEC_CAP_DELAY))
                 pkt.pts = ost->sync_opts;
 
+            latency_encoder_out(ost, &pkt);
+
             av_packet_rescale_ts(&pkt, enc->time_base, ost->st->time_base);
 
             if (debug_ts) {
@@ -1761,6 +2019,7 @@ static void flush_encoders(void)
                     av_packet_unref(&pkt);
                     continue;
                 }
+                latency_encoder_out(ost, &pkt);
                 av_packet_rescale_ts(&pkt, enc->time_base, ost->st->time_base);
                 pkt_size = pkt.size;
                 write_frame(os, &pkt, ost);
@@ -1957,9 +2216,12 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
         return AVERROR(ENOMEM);
     decoded_frame = ist->decoded_frame;
 
+    latency_mark_packet(pkt, AV_LATENCY_STAGE_DECODER_IN);
     update_benchmark(NULL);
     ret = avcodec_decode_audio4(avctx, decoded_frame, got_output, pkt);
     update_benchmark("decode_audio %d.%d", ist->file_index, ist->st->index);
+    if (*got_output)
+        latency_mark_frame(decoded_frame, AV_LATENCY_STAGE_DECODER_OUT);
 
     if (ret >= 0 && avctx->sample_rate <= 0) {
         av_log(avctx, AV_LOG_ERROR, "Sample rate %d invalid\n", avctx->sample_rate);
@@ -2083,10 +2345,13 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
     decoded_frame = ist->decoded_frame;
     pkt->dts  = av_rescale_q(ist->dts, AV_TIME_BASE_Q, ist->st->time_base);
 
+    latency_mark_packet(pkt, AV_LATENCY_STAGE_DECODER_IN);
     update_benchmark(NULL);
     ret = avcodec_decode_video2(ist->dec_ctx,
                                 decoded_frame, got_output, pkt);
     update_benchmark("decode_video %d.%d", ist->file_index, ist->st->index);
+    if (*got_output)
+        latency_mark_frame(decoded_frame, AV_LATENCY_STAGE_DECODER_OUT);
 
     // The following line may be required in some cases where there is no parser
     // or the parser does not has_b_frames correctly
@@ -3580,6 +3845,7 @@ static void *input_thread(void *arg)
             av_thread_message_queue_set_err_recv(f->in_thread_queue, ret);
             break;
         }
+        latency_mark_demux(&pkt);
         ret = av_thread_message_queue_send(f->in_thread_queue, &pkt, flags);
         if (flags && ret == AVERROR(EAGAIN)) {
             flags = 0;
@@ -3660,6 +3926,8 @@ static int get_input_packet_mt(InputFile *f, AVPacket *pkt)
 
 static int get_input_packet(InputFile *f, AVPacket *pkt)
 {
+    int ret;
+
     if (f->rate_emu) {
         int i;
         for (i = 0; i < f->nb_streams; i++) {
@@ -3675,7 +3943,10 @@ static int get_input_packet(InputFile *f, AVPacket *pkt)
     if (nb_input_files > 1)
         return get_input_packet_mt(f, pkt);
 #endif
-    return av_read_frame(f->ctx, pkt);
+    ret = av_read_frame(f->ctx, pkt);
+    if (ret >= 0)
+        latency_mark_demux(pkt);
+    return ret;
 }
 
 static int got_eagain(void)
@@ -4127,7 +4398,7 @@ static int transcode(void)
     AVFormatContext *os;
     OutputStream *ost;
     InputStream *ist;
-    int64_t timer_start;
+    int64_t timer_start, last_profile_time;
     int64_t total_packets_written = 0;
 
     ret = transcode_init();
@@ -4138,7 +4409,7 @@ static int transcode(void)
         av_log(NULL, AV_LOG_INFO, "Press [q] to stop, [?] for help\n");
     }
 
-    timer_start = av_gettime_relative();
+    timer_start = last_profile_time = av_gettime_relative();
 
 #if HAVE_PTHREADS
     if ((ret = init_input_threads()) < 0)
@@ -4170,6 +4441,12 @@ static int transcode(void)
 
         /* dump report by using the output first video and audio streams */
         print_report(0, timer_start, cur_time);
+
+        if (filter_profile_filename && filter_profile_interval > 0 &&
+            cur_time - last_profile_time >= filter_profile_interval * 1000000) {
+            dump_filter_profile(cur_time - timer_start);
+            last_profile_time = cur_time;
+        }
     }
 #if HAVE_PTHREADS
     free_input_threads();
@@ -4199,6 +4476,11 @@ static int transcode(void)
     /* dump report by using the first video and audio streams */
     print_report(1, timer_start, av_gettime_relative());
 
+    if (stats_latency)
+        print_latency_stats();
+    if (filter_profile_filename)
+        dump_filter_profile(av_gettime_relative() - timer_start);
+
     /* close each encoder */
     for (i = 0; i < nb_output_streams; i++) {
         ost = output_streams[i];
@@ -42,6 +42,8 @@
 #include "libavutil/dict.h"
 #include "libavutil/eval.h"
 #include "libavutil/fifo.h"
+#include "libavutil/latency.h"
+#include "libavutil/log_hist.h"
 #include "libavutil/pixfmt.h"
 #include "libavutil/rational.h"
 #include "libavutil/threadmessage.h"
@@ -388,6 +390,7 @@ enum forced_keyframes_const {
     FKF_PREV_FORCED_N,
     FKF_PREV_FORCED_T,
     FKF_T,
+    FKF_SCENE,
     FKF_NB
 };
 
@@ -400,6 +403,25 @@ typedef enum {
     MUXER_FINISHED = 2,
 } OSTFinished ;
 
+enum LatencyInterval {
+    LATENCY_DEMUX,          ///< demuxer -> decoder
+    LATENCY_DECODE,         ///< decoder in -> out
+    LATENCY_FILTER_QUEUE,   ///< decoder -> first filter
+    LATENCY_FILTER_SINK,    ///< buffersink -> encoder
+    LATENCY_ENCODE,         ///< encoder in -> out
+    LATENCY_MUX,            ///< encoder -> muxer
+    LATENCY_TOTAL,          ///< first stage -> muxer
+    LATENCY_FILTER,         ///< one entry per filter, AV_LATENCY_MAX_FILTERS - 1
+    LATENCY_NB = LATENCY_FILTER + AV_LATENCY_MAX_FILTERS - 1
+};
+
+typedef struct LatencyPending {
+    int64_t pts;
+    AVLatencyRecord rec;
+} LatencyPending;
+
+#define LATENCY_MAX_PENDING 64
+
 typedef struct OutputStream {
     int file_index;          /* file index */
     int index;               /* stream index in the output file */
@@ -490,6 +512,11 @@ typedef struct OutputStream {
 
     /* frame encode sum of squared error values */
     int64_t error[4];
+
+    /* -stats_latency: records of frames inside the encoder, and histograms */
+    LatencyPending *latency_pending;
+    int nb_latency_pending;
+    FFLogHistogram *latency_hist;   ///< latencies in microseconds, LATENCY_NB entries
 } OutputStream;
 
 typedef struct OutputFile {
@@ -539,6 +566,9 @@ extern int debug_ts;
 extern int exit_on_error;
 extern int abort_on_flags;
 extern int print_stats;
+extern int stats_latency;
+extern char *filter_profile_filename;
+extern float filter_profile_interval;
 extern int qp_hist;
 extern int stdin_interaction;
 extern int frame_bits_per_raw_sample;
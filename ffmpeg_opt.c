@@ -115,6 +115,9 @@ int debug_ts          = 0;
 int exit_on_error     = 0;
 int abort_on_flags    = 0;
 int print_stats       = -1;
+int stats_latency     = 0;
+char *filter_profile_filename = NULL;
+float filter_profile_interval = 0;
 int qp_hist           = 0;
 int stdin_interaction = 1;
 int frame_bits_per_raw_sample = 0;
@@ -3275,6 +3278,12 @@ const OptionDef options[] = {
         "read complex filtergraph description from a file", "filename" },
     { "stats",          OPT_BOOL,                                    { &print_stats },
         "print progress report during encoding", },
+    { "stats_latency",  OPT_BOOL | OPT_EXPERT,                       { &stats_latency },
+        "print per-stage latency percentiles at the end of processing" },
+    { "filter_profile", HAS_ARG | OPT_STRING | OPT_EXPERT,           { &filter_profile_filename },
+        "write per-filter profiling data as JSON to file", "filename" },
+    { "filter_profile_interval", HAS_ARG | OPT_FLOAT | OPT_EXPERT,   { &filter_profile_interval },
+        "also write the profiling data every given number of seconds", "seconds" },
     { "attach",         HAS_ARG | OPT_PERFILE | OPT_EXPERT |
                         OPT_OUTPUT,                                  { .func_arg = opt_attach },
         "add an attachment to the output file", "filename" },
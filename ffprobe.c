@@ -33,6 +33,7 @@
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/bprint.h"
+#include "libavutil/cpu.h"
 #include "libavutil/display.h"
 #include "libavutil/hash.h"
 #include "libavutil/opt.h"
@@ -49,10 +50,23 @@
 #include "libpostproc/postprocess.h"
 #include "cmdutils.h"
 
+#if HAVE_THREADS
+#include "libavutil/thread.h"
+#endif
+
 typedef struct InputStream {
     AVStream *st;
 
     AVCodecContext *dec_ctx;
+
+    /* -parse_frames */
+    AVCodecParserContext *parser;
+    AVCodecContext *parser_ctx;
+    AVBSFContext *bsf;          ///< converts length prefixed HEVC to Annex B for the parser
+
+    int selected;               ///< matches -select_streams
+    uint64_t nb_packets;        ///< number of packets read
+    uint64_t nb_frames;         ///< number of frames read
 } InputStream;
 
 typedef struct InputFile {
@@ -70,6 +84,7 @@ static int do_count_frames = 0;
 static int do_count_packets = 0;
 static int do_read_frames  = 0;
 static int do_read_packets = 0;
+static int do_parse_frames = 0;
 static int do_show_chapters = 0;
 static int do_show_error   = 0;
 static int do_show_format  = 0;
@@ -101,6 +116,8 @@ static int show_private_data            = 1;
 static char *print_format;
 static char *stream_specifier;
 static char *show_data_hash;
+static char *batch_list;
+static int batch_threads = 0;
 
 typedef struct ReadInterval {
     int id;             ///< identifier
@@ -250,11 +267,6 @@ static const char unit_hertz_str[]          = "Hz"   ;
 static const char unit_byte_str[]           = "byte" ;
 static const char unit_bit_per_second_str[] = "bit/s";
 
-static int nb_streams;
-static uint64_t *nb_streams_packets;
-static uint64_t *nb_streams_frames;
-static int *selected_streams;
-
 static void ffprobe_cleanup(int ret)
 {
     int i;
@@ -378,6 +390,9 @@ struct WriterContext {
     int string_validation;
     char *string_validation_replacement;
     unsigned int string_validation_utf8_flags;
+
+    AVBPrint *outbuf;               ///< if set, the output is appended there instead of being written to stdout
+    struct AVHashContext *hash;     ///< hash context used for -show_data_hash, owned by the caller
 };
 
 static const char *writer_get_name(void *p)
@@ -745,13 +760,13 @@ static void writer_print_data_hash(WriterContext *wctx, const char *name,
 {
     char *p, buf[AV_HASH_MAX_SIZE * 2 + 64] = { 0 };
 
-    if (!hash)
+    if (!wctx->hash)
         return;
-    av_hash_init(hash);
-    av_hash_update(hash, data, size);
-    snprintf(buf, sizeof(buf), "%s:", av_hash_get_name(hash));
+    av_hash_init(wctx->hash);
+    av_hash_update(wctx->hash, data, size);
+    snprintf(buf, sizeof(buf), "%s:", av_hash_get_name(wctx->hash));
     p = buf + strlen(buf);
-    av_hash_final_hex(hash, p, buf + sizeof(buf) - p);
+    av_hash_final_hex(wctx->hash, p, buf + sizeof(buf) - p);
     writer_print_string(wctx, name, buf, 0);
 }
 
@@ -807,6 +822,18 @@ static const Writer *writer_get_by_name(const char *name)
     return NULL;
 }
 
+static void av_printf_format(2, 3) writer_printf(WriterContext *wctx, const char *fmt, ...)
+{
+    va_list vl;
+
+    va_start(vl, fmt);
+    if (wctx->outbuf)
+        av_vbprintf(wctx->outbuf, fmt, vl);
+    else
+        vprintf(fmt, vl);
+    va_end(vl);
+}
+
 
 /* WRITERS */
 
@@ -875,7 +902,7 @@ static void default_print_section_header(WriterContext *wctx)
         return;
 
     if (!(section->flags & (SECTION_FLAG_IS_WRAPPER|SECTION_FLAG_IS_ARRAY)))
-        printf("[%s]\n", upcase_string(buf, sizeof(buf), section->name));
+        writer_printf(wctx, "[%s]\n", upcase_string(buf, sizeof(buf), section->name));
 }
 
 static void default_print_section_footer(WriterContext *wctx)
@@ -888,7 +915,7 @@ static void default_print_section_footer(WriterContext *wctx)
         return;
 
     if (!(section->flags & (SECTION_FLAG_IS_WRAPPER|SECTION_FLAG_IS_ARRAY)))
-        printf("[/%s]\n", upcase_string(buf, sizeof(buf), section->name));
+        writer_printf(wctx, "[/%s]\n", upcase_string(buf, sizeof(buf), section->name));
 }
 
 static void default_print_str(WriterContext *wctx, const char *key, const char *value)
@@ -896,8 +923,8 @@ static void default_print_str(WriterContext *wctx, const char *key, const char *
     DefaultContext *def = wctx->priv;
 
     if (!def->nokey)
-        printf("%s%s=", wctx->section_pbuf[wctx->level].str, key);
-    printf("%s\n", value);
+        writer_printf(wctx, "%s%s=", wctx->section_pbuf[wctx->level].str, key);
+    writer_printf(wctx, "%s\n", value);
 }
 
 static void default_print_int(WriterContext *wctx, const char *key, long long int value)
@@ -905,8 +932,8 @@ static void default_print_int(WriterContext *wctx, const char *key, long long in
     DefaultContext *def = wctx->priv;
 
     if (!def->nokey)
-        printf("%s%s=", wctx->section_pbuf[wctx->level].str, key);
-    printf("%lld\n", value);
+        writer_printf(wctx, "%s%s=", wctx->section_pbuf[wctx->level].str, key);
+    writer_printf(wctx, "%lld\n", value);
 }
 
 static const Writer default_writer = {
@@ -1045,11 +1072,11 @@ static void compact_print_section_header(WriterContext *wctx)
         if (parent_section && compact->has_nested_elems[wctx->level-1] &&
             (section->flags & SECTION_FLAG_IS_ARRAY)) {
             compact->terminate_line[wctx->level-1] = 0;
-            printf("\n");
+            writer_printf(wctx, "\n");
         }
         if (compact->print_section &&
             !(section->flags & (SECTION_FLAG_IS_WRAPPER|SECTION_FLAG_IS_ARRAY)))
-            printf("%s%c", section->name, compact->item_sep);
+            writer_printf(wctx, "%s%c", section->name, compact->item_sep);
     }
 }
 
@@ -1060,7 +1087,7 @@ static void compact_print_section_footer(WriterContext *wctx)
     if (!compact->nested_section[wctx->level] &&
         compact->terminate_line[wctx->level] &&
         !(wctx->section[wctx->level]->flags & (SECTION_FLAG_IS_WRAPPER|SECTION_FLAG_IS_ARRAY)))
-        printf("\n");
+        writer_printf(wctx, "\n");
 }
 
 static void compact_print_str(WriterContext *wctx, const char *key, const char *value)
@@ -1068,11 +1095,11 @@ static void compact_print_str(WriterContext *wctx, const char *key, const char *
     CompactContext *compact = wctx->priv;
     AVBPrint buf;
 
-    if (wctx->nb_item[wctx->level]) printf("%c", compact->item_sep);
+    if (wctx->nb_item[wctx->level]) writer_printf(wctx, "%c", compact->item_sep);
     if (!compact->nokey)
-        printf("%s%s=", wctx->section_pbuf[wctx->level].str, key);
+        writer_printf(wctx, "%s%s=", wctx->section_pbuf[wctx->level].str, key);
     av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
-    printf("%s", compact->escape_str(&buf, value, compact->item_sep, wctx));
+    writer_printf(wctx, "%s", compact->escape_str(&buf, value, compact->item_sep, wctx));
     av_bprint_finalize(&buf, NULL);
 }
 
@@ -1080,10 +1107,10 @@ static void compact_print_int(WriterContext *wctx, const char *key, long long in
 {
     CompactContext *compact = wctx->priv;
 
-    if (wctx->nb_item[wctx->level]) printf("%c", compact->item_sep);
+    if (wctx->nb_item[wctx->level]) writer_printf(wctx, "%c", compact->item_sep);
     if (!compact->nokey)
-        printf("%s%s=", wctx->section_pbuf[wctx->level].str, key);
-    printf("%lld", value);
+        writer_printf(wctx, "%s%s=", wctx->section_pbuf[wctx->level].str, key);
+    writer_printf(wctx, "%lld", value);
 }
 
 static const Writer compact_writer = {
@@ -1226,7 +1253,7 @@ static void flat_print_section_header(WriterContext *wctx)
 
 static void flat_print_int(WriterContext *wctx, const char *key, long long int value)
 {
-    printf("%s%s=%lld\n", wctx->section_pbuf[wctx->level].str, key, value);
+    writer_printf(wctx, "%s%s=%lld\n", wctx->section_pbuf[wctx->level].str, key, value);
 }
 
 static void flat_print_str(WriterContext *wctx, const char *key, const char *value)
@@ -1234,11 +1261,11 @@ static void flat_print_str(WriterContext *wctx, const char *key, const char *val
     FlatContext *flat = wctx->priv;
     AVBPrint buf;
 
-    printf("%s", wctx->section_pbuf[wctx->level].str);
+    writer_printf(wctx, "%s", wctx->section_pbuf[wctx->level].str);
     av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
-    printf("%s=", flat_escape_key_str(&buf, key, flat->sep));
+    writer_printf(wctx, "%s=", flat_escape_key_str(&buf, key, flat->sep));
     av_bprint_clear(&buf);
-    printf("\"%s\"\n", flat_escape_value_str(&buf, value));
+    writer_printf(wctx, "\"%s\"\n", flat_escape_value_str(&buf, value));
     av_bprint_finalize(&buf, NULL);
 }
 
@@ -1308,12 +1335,12 @@ static void ini_print_section_header(WriterContext *wctx)
 
     av_bprint_clear(buf);
     if (!parent_section) {
-        printf("# ffprobe output\n\n");
+        writer_printf(wctx, "# ffprobe output\n\n");
         return;
     }
 
     if (wctx->nb_item[wctx->level-1])
-        printf("\n");
+        writer_printf(wctx, "\n");
 
     av_bprintf(buf, "%s", wctx->section_pbuf[wctx->level-1].str);
     if (ini->hierarchical ||
@@ -1328,7 +1355,7 @@ static void ini_print_section_header(WriterContext *wctx)
     }
 
     if (!(section->flags & (SECTION_FLAG_IS_ARRAY|SECTION_FLAG_IS_WRAPPER)))
-        printf("[%s]\n", buf->str);
+        writer_printf(wctx, "[%s]\n", buf->str);
 }
 
 static void ini_print_str(WriterContext *wctx, const char *key, const char *value)
@@ -1336,15 +1363,15 @@ static void ini_print_str(WriterContext *wctx, const char *key, const char *valu
     AVBPrint buf;
 
     av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
-    printf("%s=", ini_escape_str(&buf, key));
+    writer_printf(wctx, "%s=", ini_escape_str(&buf, key));
     av_bprint_clear(&buf);
-    printf("%s\n", ini_escape_str(&buf, value));
+    writer_printf(wctx, "%s\n", ini_escape_str(&buf, value));
     av_bprint_finalize(&buf, NULL);
 }
 
 static void ini_print_int(WriterContext *wctx, const char *key, long long int value)
 {
-    printf("%s=%lld\n", key, value);
+    writer_printf(wctx, "%s=%lld\n", key, value);
 }
 
 static const Writer ini_writer = {
@@ -1363,7 +1390,8 @@ typedef struct JSONContext {
     const AVClass *class;
     int indent_level;
     int compact;
-    const char *item_sep, *item_start_end;
+    int single_line;
+    const char *item_sep, *item_start_end, *eol;
 } JSONContext;
 
 #undef OFFSET
@@ -1372,6 +1400,7 @@ typedef struct JSONContext {
 static const AVOption json_options[]= {
     { "compact", "enable compact output", OFFSET(compact), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1 },
     { "c",       "enable compact output", OFFSET(compact), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1 },
+    { "single_line", "print each document on a single line", OFFSET(single_line), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1 },
     { NULL }
 };
 
@@ -1381,8 +1410,11 @@ static av_cold int json_init(WriterContext *wctx)
 {
     JSONContext *json = wctx->priv;
 
+    if (json->single_line)
+        json->compact = 1;
     json->item_sep       = json->compact ? ", " : ",\n";
     json->item_start_end = json->compact ? " "  : "\n";
+    json->eol            = json->single_line ? "" : "\n";
 
     return 0;
 }
@@ -1407,7 +1439,10 @@ static const char *json_escape_str(AVBPrint *dst, const char *src, void *log_ctx
     return dst->str;
 }
 
-#define JSON_INDENT() printf("%*c", json->indent_level * 4, ' ')
+#define JSON_INDENT() do {                                              \
+        if (!json->single_line)                                         \
+            writer_printf(wctx, "%*c", json->indent_level * 4, ' ');    \
+    } while (0)
 
 static void json_print_section_header(WriterContext *wctx)
 {
@@ -1418,10 +1453,10 @@ static void json_print_section_header(WriterContext *wctx)
         wctx->section[wctx->level-1] : NULL;
 
     if (wctx->level && wctx->nb_item[wctx->level-1])
-        printf(",\n");
+        writer_printf(wctx, ",%s", json->eol);
 
     if (section->flags & SECTION_FLAG_IS_WRAPPER) {
-        printf("{\n");
+        writer_printf(wctx, "{%s", json->eol);
         json->indent_level++;
     } else {
         av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
@@ -1430,17 +1465,17 @@ static void json_print_section_header(WriterContext *wctx)
 
         json->indent_level++;
         if (section->flags & SECTION_FLAG_IS_ARRAY) {
-            printf("\"%s\": [\n", buf.str);
+            writer_printf(wctx, "\"%s\": [%s", buf.str, json->eol);
         } else if (parent_section && !(parent_section->flags & SECTION_FLAG_IS_ARRAY)) {
-            printf("\"%s\": {%s", buf.str, json->item_start_end);
+            writer_printf(wctx, "\"%s\": {%s", buf.str, json->item_start_end);
         } else {
-            printf("{%s", json->item_start_end);
+            writer_printf(wctx, "{%s", json->item_start_end);
 
             /* this is required so the parser can distinguish between packets and frames */
             if (parent_section && parent_section->id == SECTION_ID_PACKETS_AND_FRAMES) {
                 if (!json->compact)
                     JSON_INDENT();
-                printf("\"type\": \"%s\"%s", section->name, json->item_sep);
+                writer_printf(wctx, "\"type\": \"%s\"%s", section->name, json->item_sep);
             }
         }
         av_bprint_finalize(&buf, NULL);
@@ -1454,18 +1489,18 @@ static void json_print_section_footer(WriterContext *wctx)
 
     if (wctx->level == 0) {
         json->indent_level--;
-        printf("\n}\n");
+        writer_printf(wctx, "%s}\n", json->eol);
     } else if (section->flags & SECTION_FLAG_IS_ARRAY) {
-        printf("\n");
+        writer_printf(wctx, "%s", json->eol);
         json->indent_level--;
         JSON_INDENT();
-        printf("]");
+        writer_printf(wctx, "]");
     } else {
-        printf("%s", json->item_start_end);
+        writer_printf(wctx, "%s", json->item_start_end);
         json->indent_level--;
         if (!json->compact)
             JSON_INDENT();
-        printf("}");
+        writer_printf(wctx, "}");
     }
 }
 
@@ -1475,9 +1510,9 @@ static inline void json_print_item_str(WriterContext *wctx,
     AVBPrint buf;
 
     av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
-    printf("\"%s\":", json_escape_str(&buf, key,   wctx));
+    writer_printf(wctx, "\"%s\":", json_escape_str(&buf, key,   wctx));
     av_bprint_clear(&buf);
-    printf(" \"%s\"", json_escape_str(&buf, value, wctx));
+    writer_printf(wctx, " \"%s\"", json_escape_str(&buf, value, wctx));
     av_bprint_finalize(&buf, NULL);
 }
 
@@ -1486,7 +1521,7 @@ static void json_print_str(WriterContext *wctx, const char *key, const char *val
     JSONContext *json = wctx->priv;
 
     if (wctx->nb_item[wctx->level])
-        printf("%s", json->item_sep);
+        writer_printf(wctx, "%s", json->item_sep);
     if (!json->compact)
         JSON_INDENT();
     json_print_item_str(wctx, key, value);
@@ -1498,12 +1533,12 @@ static void json_print_int(WriterContext *wctx, const char *key, long long int v
     AVBPrint buf;
 
     if (wctx->nb_item[wctx->level])
-        printf("%s", json->item_sep);
+        writer_printf(wctx, "%s", json->item_sep);
     if (!json->compact)
         JSON_INDENT();
 
     av_bprint_init(&buf, 1, AV_BPRINT_SIZE_UNLIMITED);
-    printf("\"%s\": %lld", json_escape_str(&buf, key, wctx), value);
+    writer_printf(wctx, "\"%s\": %lld", json_escape_str(&buf, key, wctx), value);
     av_bprint_finalize(&buf, NULL);
 }
 
@@ -1588,7 +1623,7 @@ static const char *xml_escape_str(AVBPrint *dst, const char *src, void *log_ctx)
     return dst->str;
 }
 
-#define XML_INDENT() printf("%*c", xml->indent_level * 4, ' ')
+#define XML_INDENT() writer_printf(wctx, "%*c", xml->indent_level * 4, ' ')
 
 static void xml_print_section_header(WriterContext *wctx)
 {
@@ -1602,8 +1637,8 @@ static void xml_print_section_header(WriterContext *wctx)
             "xmlns:ffprobe='http://www.ffmpeg.org/schema/ffprobe' "
             "xsi:schemaLocation='http://www.ffmpeg.org/schema/ffprobe ffprobe.xsd'";
 
-        printf("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
-        printf("<%sffprobe%s>\n",
+        writer_printf(wctx, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+        writer_printf(wctx, "<%sffprobe%s>\n",
                xml->fully_qualified ? "ffprobe:" : "",
                xml->fully_qualified ? qual : "");
         return;
@@ -1611,20 +1646,20 @@ static void xml_print_section_header(WriterContext *wctx)
 
     if (xml->within_tag) {
         xml->within_tag = 0;
-        printf(">\n");
+        writer_printf(wctx, ">\n");
     }
     if (section->flags & SECTION_FLAG_HAS_VARIABLE_FIELDS) {
         xml->indent_level++;
     } else {
         if (parent_section && (parent_section->flags & SECTION_FLAG_IS_WRAPPER) &&
             wctx->level && wctx->nb_item[wctx->level-1])
-            printf("\n");
+            writer_printf(wctx, "\n");
         xml->indent_level++;
 
         if (section->flags & SECTION_FLAG_IS_ARRAY) {
-            XML_INDENT(); printf("<%s>\n", section->name);
+            XML_INDENT(); writer_printf(wctx, "<%s>\n", section->name);
         } else {
-            XML_INDENT(); printf("<%s ", section->name);
+            XML_INDENT(); writer_printf(wctx, "<%s ", section->name);
             xml->within_tag = 1;
         }
     }
@@ -1636,15 +1671,15 @@ static void xml_print_section_footer(WriterContext *wctx)
     const struct section *section = wctx->section[wctx->level];
 
     if (wctx->level == 0) {
-        printf("</%sffprobe>\n", xml->fully_qualified ? "ffprobe:" : "");
+        writer_printf(wctx, "</%sffprobe>\n", xml->fully_qualified ? "ffprobe:" : "");
     } else if (xml->within_tag) {
         xml->within_tag = 0;
-        printf("/>\n");
+        writer_printf(wctx, "/>\n");
         xml->indent_level--;
     } else if (section->flags & SECTION_FLAG_HAS_VARIABLE_FIELDS) {
         xml->indent_level--;
     } else {
-        XML_INDENT(); printf("</%s>\n", section->name);
+        XML_INDENT(); writer_printf(wctx, "</%s>\n", section->name);
         xml->indent_level--;
     }
 }
@@ -1659,14 +1694,14 @@ static void xml_print_str(WriterContext *wctx, const char *key, const char *valu
 
     if (section->flags & SECTION_FLAG_HAS_VARIABLE_FIELDS) {
         XML_INDENT();
-        printf("<%s key=\"%s\"",
+        writer_printf(wctx, "<%s key=\"%s\"",
                section->element_name, xml_escape_str(&buf, key, wctx));
         av_bprint_clear(&buf);
-        printf(" value=\"%s\"/>\n", xml_escape_str(&buf, value, wctx));
+        writer_printf(wctx, " value=\"%s\"/>\n", xml_escape_str(&buf, value, wctx));
     } else {
         if (wctx->nb_item[wctx->level])
-            printf(" ");
-        printf("%s=\"%s\"", key, xml_escape_str(&buf, value, wctx));
+            writer_printf(wctx, " ");
+        writer_printf(wctx, "%s=\"%s\"", key, xml_escape_str(&buf, value, wctx));
     }
 
     av_bprint_finalize(&buf, NULL);
@@ -1675,8 +1710,8 @@ static void xml_print_str(WriterContext *wctx, const char *key, const char *valu
 static void xml_print_int(WriterContext *wctx, const char *key, long long int value)
 {
     if (wctx->nb_item[wctx->level])
-        printf(" ");
-    printf("%s=\"%lld\"", key, value);
+        writer_printf(wctx, " ");
+    writer_printf(wctx, "%s=\"%lld\"", key, value);
 }
 
 static Writer xml_writer = {
@@ -1733,14 +1768,6 @@ static void writer_register_all(void)
 #define print_section_header(s) writer_print_section_header(w, s)
 #define print_section_footer(s) writer_print_section_footer(w, s)
 
-#define REALLOCZ_ARRAY_STREAM(ptr, cur_n, new_n)                        \
-{                                                                       \
-    ret = av_reallocp_array(&(ptr), (new_n), sizeof(*(ptr)));           \
-    if (ret < 0)                                                        \
-        goto end;                                                       \
-    memset( (ptr) + (cur_n), 0, ((new_n) - (cur_n)) * sizeof(*(ptr)) ); \
-}
-
 static inline int show_tags(WriterContext *w, AVDictionary *tags, int section_id)
 {
     AVDictionaryEntry *tag = NULL;
@@ -1979,7 +2006,7 @@ static av_always_inline int process_frame(WriterContext *w,
     pkt->size -= ret;
     if (got_frame) {
         int is_sub = (par->codec_type == AVMEDIA_TYPE_SUBTITLE);
-        nb_streams_frames[pkt->stream_index]++;
+        ifile->streams[pkt->stream_index].nb_frames++;
         if (do_show_frames)
             if (is_sub)
                 show_subtitle(w, &sub, ifile->streams[pkt->stream_index].st, fmt_ctx);
@@ -1991,6 +2018,144 @@ static av_always_inline int process_frame(WriterContext *w,
     return got_frame;
 }
 
+static void show_parsed_frame(WriterContext *w, InputStream *ist, AVPacket *pkt,
+                              int size, AVFormatContext *fmt_ctx)
+{
+    AVCodecParserContext *pc = ist->parser;
+    AVCodecParameters *par = ist->st->codecpar;
+    AVStream *stream = ist->st;
+    AVBPrint pbuf;
+    char val_str[128];
+    const char *s;
+    int64_t pts = pc ? pc->pts : pkt->pts;
+    int64_t dts = pc ? pc->dts : pkt->dts;
+    int64_t pos = pc ? pc->pos : pkt->pos;
+    int key_frame = pc && pc->key_frame >= 0 ? pc->key_frame : !!(pkt->flags & AV_PKT_FLAG_KEY);
+    int format, nb_samples;
+
+    av_bprint_init(&pbuf, 1, AV_BPRINT_SIZE_UNLIMITED);
+
+    writer_print_section_header(w, SECTION_ID_FRAME);
+
+    s = av_get_media_type_string(par->codec_type);
+    if (s) print_str    ("media_type", s);
+    else   print_str_opt("media_type", "unknown");
+    print_int("stream_index",           stream->index);
+    print_int("key_frame",              key_frame);
+    print_ts  ("pkt_pts",               pts);
+    print_time("pkt_pts_time",          pts, &stream->time_base);
+    print_ts  ("pkt_dts",               dts);
+    print_time("pkt_dts_time",          dts, &stream->time_base);
+    print_duration_ts  ("pkt_duration",      pkt->duration);
+    print_duration_time("pkt_duration_time", pkt->duration, &stream->time_base);
+    if (pos != -1) print_fmt    ("pkt_pos", "%"PRId64, pos);
+    else           print_str_opt("pkt_pos", "N/A");
+    print_val("pkt_size", size, unit_byte_str);
+
+    format = pc && pc->format >= 0 ? pc->format : par->format;
+    switch (par->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+        print_int("width",                  pc && pc->width  > 0 ? pc->width  : par->width);
+        print_int("height",                 pc && pc->height > 0 ? pc->height : par->height);
+        s = av_get_pix_fmt_name(format);
+        if (s) print_str    ("pix_fmt", s);
+        else   print_str_opt("pix_fmt", "unknown");
+        if (pc) {
+            print_fmt("pict_type",              "%c", av_get_picture_type_char(pc->pict_type));
+            print_int("coded_picture_number",   ist->nb_frames - 1);
+            print_int("display_picture_number", pc->output_picture_number);
+            print_int("interlaced_frame",       pc->field_order > AV_FIELD_PROGRESSIVE);
+            print_int("top_field_first",        pc->field_order == AV_FIELD_TT ||
+                                                pc->field_order == AV_FIELD_TB);
+            /* the parsers count the fields, minus one */
+            print_int("repeat_pict",            FFMAX(pc->repeat_pict - 1, 0));
+        }
+        break;
+
+    case AVMEDIA_TYPE_AUDIO:
+        s = av_get_sample_fmt_name(format);
+        if (s) print_str    ("sample_fmt", s);
+        else   print_str_opt("sample_fmt", "unknown");
+        nb_samples = av_get_audio_frame_duration2(par, size);
+        if (nb_samples > 0) print_int    ("nb_samples", nb_samples);
+        else                print_str_opt("nb_samples", "N/A");
+        print_int("channels", par->channels);
+        if (par->channel_layout) {
+            av_bprint_clear(&pbuf);
+            av_bprint_channel_layout(&pbuf, par->channels, par->channel_layout);
+            print_str    ("channel_layout", pbuf.str);
+        } else
+            print_str_opt("channel_layout", "unknown");
+        break;
+    }
+
+    writer_print_section_footer(w);
+
+    av_bprint_finalize(&pbuf, NULL);
+    fflush(stdout);
+}
+
+static int parse_packet_data(WriterContext *w, InputFile *ifile,
+                             InputStream *ist, AVPacket *pkt)
+{
+    const uint8_t *data = pkt->data;
+    int size = pkt->size;
+
+    while (size > 0) {
+        uint8_t *out;
+        int out_size;
+        int ret = av_parser_parse2(ist->parser, ist->parser_ctx, &out, &out_size,
+                                   data, size, pkt->pts, pkt->dts, pkt->pos);
+        if (ret < 0)
+            return ret;
+        data += ret;
+        size -= ret;
+        if (out_size) {
+            ist->nb_frames++;
+            if (do_show_frames)
+                show_parsed_frame(w, ist, pkt, out_size, ifile->fmt_ctx);
+        } else if (!ret) {
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Report the frames of a packet from what the codec parser extracts,
+ * without decoding them, in decoding order. Streams without parser have
+ * one frame per packet.
+ */
+static int parse_packet(WriterContext *w, InputFile *ifile, AVPacket *pkt)
+{
+    InputStream *ist = &ifile->streams[pkt->stream_index];
+    AVPacket filtered;
+    int ret;
+
+    if (!ist->parser) {
+        ist->nb_frames++;
+        if (do_show_frames)
+            show_parsed_frame(w, ist, pkt, pkt->size, ifile->fmt_ctx);
+        return 0;
+    }
+    if (!ist->bsf)
+        return parse_packet_data(w, ifile, ist, pkt);
+
+    av_init_packet(&filtered);
+    if ((ret = av_packet_ref(&filtered, pkt)) < 0 ||
+        (ret = av_bsf_send_packet(ist->bsf, &filtered)) < 0) {
+        av_packet_unref(&filtered);
+        return ret;
+    }
+    while ((ret = av_bsf_receive_packet(ist->bsf, &filtered)) >= 0) {
+        ret = parse_packet_data(w, ifile, ist, &filtered);
+        av_packet_unref(&filtered);
+        if (ret < 0)
+            return ret;
+    }
+    return ret == AVERROR(EAGAIN) ? 0 : ret;
+}
+
 static void log_read_interval(const ReadInterval *interval, void *log_ctx, int log_level)
 {
     av_log(log_ctx, log_level, "id:%d", interval->id);
@@ -2060,13 +2225,9 @@ static int read_interval_packets(WriterContext *w, InputFile *ifile,
         goto end;
     }
     while (!av_read_frame(fmt_ctx, &pkt)) {
-        if (ifile->nb_streams > nb_streams) {
-            REALLOCZ_ARRAY_STREAM(nb_streams_frames,  nb_streams, fmt_ctx->nb_streams);
-            REALLOCZ_ARRAY_STREAM(nb_streams_packets, nb_streams, fmt_ctx->nb_streams);
-            REALLOCZ_ARRAY_STREAM(selected_streams,   nb_streams, fmt_ctx->nb_streams);
-            nb_streams = ifile->nb_streams;
-        }
-        if (selected_streams[pkt.stream_index]) {
+        /* streams added after the header was read are not probed */
+        if (pkt.stream_index < ifile->nb_streams &&
+            ifile->streams[pkt.stream_index].selected) {
             AVRational tb = ifile->streams[pkt.stream_index].st->time_base;
 
             if (pkt.pts != AV_NOPTS_VALUE)
@@ -2093,9 +2254,16 @@ static int read_interval_packets(WriterContext *w, InputFile *ifile,
             if (do_read_packets) {
                 if (do_show_packets)
                     show_packet(w, ifile, &pkt, i++);
-                nb_streams_packets[pkt.stream_index]++;
+                ifile->streams[pkt.stream_index].nb_packets++;
             }
-            if (do_read_frames) {
+            if (do_read_frames && do_parse_frames) {
+                ret = parse_packet(w, ifile, &pkt);
+                if (ret < 0) {
+                    av_log(NULL, AV_LOG_WARNING, "Could not parse packet of stream %d: %s\n",
+                           pkt.stream_index, av_err2str(ret));
+                    ret = 0;
+                }
+            } else if (do_read_frames) {
                 pkt1 = pkt;
                 while (pkt1.size && process_frame(w, ifile, frame, &pkt1) > 0);
             }
@@ -2108,7 +2276,7 @@ static int read_interval_packets(WriterContext *w, InputFile *ifile,
     //Flush remaining frames that are cached in the decoder
     for (i = 0; i < fmt_ctx->nb_streams; i++) {
         pkt.stream_index = i;
-        if (do_read_frames)
+        if (do_read_frames && !do_parse_frames)
             while (process_frame(w, ifile, frame, &pkt) > 0);
     }
 
@@ -2322,9 +2490,9 @@ static int show_stream(WriterContext *w, AVFormatContext *fmt_ctx, int stream_id
     else                                             print_str_opt("bits_per_raw_sample", "N/A");
     if (stream->nb_frames) print_fmt    ("nb_frames", "%"PRId64, stream->nb_frames);
     else                   print_str_opt("nb_frames", "N/A");
-    if (nb_streams_frames[stream_idx])  print_fmt    ("nb_read_frames", "%"PRIu64, nb_streams_frames[stream_idx]);
+    if (ist->nb_frames)  print_fmt    ("nb_read_frames", "%"PRIu64, ist->nb_frames);
     else                                print_str_opt("nb_read_frames", "N/A");
-    if (nb_streams_packets[stream_idx]) print_fmt    ("nb_read_packets", "%"PRIu64, nb_streams_packets[stream_idx]);
+    if (ist->nb_packets) print_fmt    ("nb_read_packets", "%"PRIu64, ist->nb_packets);
     else                                print_str_opt("nb_read_packets", "N/A");
     if (do_show_data)
         writer_print_data(w, "extradata", par->extradata,
@@ -2389,7 +2557,7 @@ static int show_streams(WriterContext *w, InputFile *ifile)
 
     writer_print_section_header(w, SECTION_ID_STREAMS);
     for (i = 0; i < ifile->nb_streams; i++)
-        if (selected_streams[i]) {
+        if (ifile->streams[i].selected) {
             ret = show_stream(w, fmt_ctx, i, &ifile->streams[i], 0);
             if (ret < 0)
                 break;
@@ -2421,7 +2589,7 @@ static int show_program(WriterContext *w, InputFile *ifile, AVProgram *program)
 
     writer_print_section_header(w, SECTION_ID_PROGRAM_STREAMS);
     for (i = 0; i < program->nb_stream_indexes; i++) {
-        if (selected_streams[program->stream_index[i]]) {
+        if (ifile->streams[program->stream_index[i]].selected) {
             ret = show_stream(w, fmt_ctx, program->stream_index[i], &ifile->streams[program->stream_index[i]], 1);
             if (ret < 0)
                 break;
@@ -2522,30 +2690,80 @@ static void show_error(WriterContext *w, int err)
     writer_print_section_footer(w);
 }
 
+static int open_parser(InputStream *ist)
+{
+    AVCodecParameters *par = ist->st->codecpar;
+    int ret;
+
+    /* audio and subtitle packets are already complete frames, and some
+     * audio parsers only handle a specific framing */
+    if (par->codec_type != AVMEDIA_TYPE_VIDEO)
+        return 0;
+
+    ist->parser = av_parser_init(par->codec_id);
+    if (!ist->parser)
+        return 0;
+    /* the demuxer (or its own parser) already splits the frames */
+    ist->parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+
+    /* the HEVC parser only handles Annex B bitstreams */
+    if (par->codec_id == AV_CODEC_ID_HEVC && par->extradata_size > 3 &&
+        (par->extradata[0] || par->extradata[1] || par->extradata[2] > 1)) {
+        const AVBitStreamFilter *filter = av_bsf_get_by_name("hevc_mp4toannexb");
+
+        if (!filter) {
+            av_log(NULL, AV_LOG_WARNING, "hevc_mp4toannexb bitstream filter "
+                   "not available, stream %d will not be parsed\n", ist->st->index);
+            av_parser_close(ist->parser);
+            ist->parser = NULL;
+            return 0;
+        }
+        if ((ret = av_bsf_alloc(filter, &ist->bsf)) < 0 ||
+            (ret = avcodec_parameters_copy(ist->bsf->par_in, par)) < 0)
+            return ret;
+        ist->bsf->time_base_in = ist->st->time_base;
+        if ((ret = av_bsf_init(ist->bsf)) < 0)
+            return ret;
+        par = ist->bsf->par_out;
+    }
+
+    ist->parser_ctx = avcodec_alloc_context3(NULL);
+    if (!ist->parser_ctx)
+        return AVERROR(ENOMEM);
+    return avcodec_parameters_to_context(ist->parser_ctx, par);
+}
+
 static int open_input_file(InputFile *ifile, const char *filename)
 {
     int err, i, orig_nb_streams;
     AVFormatContext *fmt_ctx = NULL;
     AVDictionaryEntry *t;
     AVDictionary **opts;
+    AVDictionary *fmt_opts = NULL;
     int scan_all_pmts_set = 0;
 
-    if (!av_dict_get(format_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE)) {
-        av_dict_set(&format_opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
+    /* work on a copy, the global options are shared by all -batch inputs */
+    if ((err = av_dict_copy(&fmt_opts, format_opts, 0)) < 0)
+        return err;
+    if (!av_dict_get(fmt_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE)) {
+        av_dict_set(&fmt_opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
         scan_all_pmts_set = 1;
     }
     if ((err = avformat_open_input(&fmt_ctx, filename,
-                                   iformat, &format_opts)) < 0) {
+                                   iformat, &fmt_opts)) < 0) {
+        av_dict_free(&fmt_opts);
         print_error(filename, err);
         return err;
     }
     ifile->fmt_ctx = fmt_ctx;
     if (scan_all_pmts_set)
-        av_dict_set(&format_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE);
-    if ((t = av_dict_get(format_opts, "", NULL, AV_DICT_IGNORE_SUFFIX))) {
+        av_dict_set(&fmt_opts, "scan_all_pmts", NULL, AV_DICT_MATCH_CASE);
+    t = av_dict_get(fmt_opts, "", NULL, AV_DICT_IGNORE_SUFFIX);
+    if (t)
         av_log(NULL, AV_LOG_ERROR, "Option %s not found.\n", t->key);
+    av_dict_free(&fmt_opts);
+    if (t)
         return AVERROR_OPTION_NOT_FOUND;
-    }
 
     /* fill the streams in the format context */
     opts = setup_find_stream_info_opts(fmt_ctx, codec_opts);
@@ -2585,6 +2803,15 @@ static int open_input_file(InputFile *ifile, const char *filename)
             continue;
         }
 
+        if (do_read_frames && do_parse_frames) {
+            err = open_parser(ist);
+            if (err < 0) {
+                av_log(NULL, AV_LOG_ERROR, "Could not open parser for input stream %d\n",
+                       stream->index);
+                return err;
+            }
+        }
+
         codec = avcodec_find_decoder(stream->codecpar->codec_id);
         if (!codec) {
             av_log(NULL, AV_LOG_WARNING,
@@ -2633,9 +2860,16 @@ static void close_input_file(InputFile *ifile)
     int i;
 
     /* close decoder for each stream */
-    for (i = 0; i < ifile->nb_streams; i++)
-        if (ifile->streams[i].st->codecpar->codec_id != AV_CODEC_ID_NONE)
-            avcodec_free_context(&ifile->streams[i].dec_ctx);
+    for (i = 0; i < ifile->nb_streams; i++) {
+        InputStream *ist = &ifile->streams[i];
+
+        if (ist->st->codecpar->codec_id != AV_CODEC_ID_NONE)
+            avcodec_free_context(&ist->dec_ctx);
+        if (ist->parser)
+            av_parser_close(ist->parser);
+        avcodec_free_context(&ist->parser_ctx);
+        av_bsf_free(&ist->bsf);
+    }
 
     av_freep(&ifile->streams);
     ifile->nb_streams = 0;
@@ -2649,20 +2883,12 @@ static int probe_file(WriterContext *wctx, const char *filename)
     int ret, i;
     int section_id;
 
-    do_read_frames = do_show_frames || do_count_frames;
-    do_read_packets = do_show_packets || do_count_packets;
-
     ret = open_input_file(&ifile, filename);
     if (ret < 0)
         goto end;
 
 #define CHECK_END if (ret < 0) goto end
 
-    nb_streams = ifile.fmt_ctx->nb_streams;
-    REALLOCZ_ARRAY_STREAM(nb_streams_frames,0,ifile.fmt_ctx->nb_streams);
-    REALLOCZ_ARRAY_STREAM(nb_streams_packets,0,ifile.fmt_ctx->nb_streams);
-    REALLOCZ_ARRAY_STREAM(selected_streams,0,ifile.fmt_ctx->nb_streams);
-
     for (i = 0; i < ifile.fmt_ctx->nb_streams; i++) {
         if (stream_specifier) {
             ret = avformat_match_stream_specifier(ifile.fmt_ctx,
@@ -2670,10 +2896,10 @@ static int probe_file(WriterContext *wctx, const char *filename)
                                                   stream_specifier);
             CHECK_END;
             else
-                selected_streams[i] = ret;
+                ifile.streams[i].selected = ret;
             ret = 0;
         } else {
-            selected_streams[i] = 1;
+            ifile.streams[i].selected = 1;
         }
     }
 
@@ -2714,13 +2940,243 @@ static int probe_file(WriterContext *wctx, const char *filename)
 end:
     if (ifile.fmt_ctx)
         close_input_file(&ifile);
-    av_freep(&nb_streams_frames);
-    av_freep(&nb_streams_packets);
-    av_freep(&selected_streams);
 
     return ret;
 }
 
+typedef struct BatchRecord {
+    AVBPrint buf;               ///< output of the writer for this input
+    int done;
+} BatchRecord;
+
+typedef struct BatchContext {
+    const Writer *writer;
+    const char *writer_args;
+    FILE *list;
+    int eof;
+    int ret;                    ///< error reading the list
+    int nb_failed;              ///< number of inputs which could not be probed
+
+    uint64_t next_input;        ///< index of the next input read from the list
+    uint64_t next_output;       ///< index of the next record to write
+    BatchRecord *records;       ///< pending records, indexed by input index modulo nb_records
+    int nb_records;
+
+#if HAVE_THREADS
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+#endif
+} BatchContext;
+
+static int read_batch_line(FILE *f, AVBPrint *bp)
+{
+    int c;
+
+    av_bprint_clear(bp);
+    while ((c = getc(f)) != EOF) {
+        if (c == '\n') {
+            if (bp->len)
+                break;
+        } else if (c != '\r') {
+            av_bprint_chars(bp, c, 1);
+        }
+    }
+    if (!av_bprint_is_complete(bp))
+        return AVERROR(ENOMEM);
+    if (!bp->len)
+        return ferror(f) ? AVERROR(EIO) : AVERROR_EOF;
+    return 0;
+}
+
+/**
+ * Get the next input file name from the list. Block while the window of
+ * pending records is full, so that memory use does not depend on the
+ * list length nor on how long a single input takes.
+ */
+static int batch_next_input(BatchContext *b, AVBPrint *filename, uint64_t *idx)
+{
+    int ret = AVERROR_EOF;
+
+#if HAVE_THREADS
+    pthread_mutex_lock(&b->lock);
+    while (!b->eof && b->next_input - b->next_output >= b->nb_records)
+        pthread_cond_wait(&b->cond, &b->lock);
+#endif
+    if (!b->eof) {
+        ret = read_batch_line(b->list, filename);
+        if (ret < 0) {
+            b->eof = 1;
+            if (ret != AVERROR_EOF)
+                b->ret = ret;
+        } else {
+            *idx = b->next_input++;
+        }
+    }
+#if HAVE_THREADS
+    if (b->eof)
+        pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->lock);
+#endif
+    return ret;
+}
+
+/**
+ * Mark the record of input idx as complete, and write all the complete
+ * records following the last written one, in the order of the list.
+ */
+static void batch_output(BatchContext *b, uint64_t idx, int ret)
+{
+    BatchRecord *rec;
+
+#if HAVE_THREADS
+    pthread_mutex_lock(&b->lock);
+#endif
+    b->records[idx % b->nb_records].done = 1;
+    if (ret < 0)
+        b->nb_failed++;
+    while ((rec = &b->records[b->next_output % b->nb_records])->done) {
+        fwrite(rec->buf.str, 1, rec->buf.len, stdout);
+        rec->done = 0;
+        b->next_output++;
+    }
+#if HAVE_THREADS
+    pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->lock);
+#endif
+}
+
+static int probe_batch_input(BatchContext *b, const char *filename, AVBPrint *out)
+{
+    WriterContext *wctx;
+    int ret;
+
+    if ((ret = writer_open(&wctx, b->writer, b->writer_args,
+                           sections, FF_ARRAY_ELEMS(sections))) < 0)
+        return ret;
+    if (b->writer == &xml_writer)
+        wctx->string_validation_utf8_flags |= AV_UTF8_FLAG_EXCLUDE_XML_INVALID_CONTROL_CODES;
+    wctx->outbuf = out;
+    if (show_data_hash && (ret = av_hash_alloc(&wctx->hash, show_data_hash)) < 0)
+        goto end;
+
+    writer_print_section_header(wctx, SECTION_ID_ROOT);
+    ret = probe_file(wctx, filename);
+    if (ret < 0 && do_show_error)
+        show_error(wctx, ret);
+    writer_print_section_footer(wctx);
+
+    if (!av_bprint_is_complete(out))
+        ret = AVERROR(ENOMEM);
+end:
+    av_hash_freep(&wctx->hash);
+    writer_close(&wctx);
+    return ret;
+}
+
+static void *batch_worker(void *arg)
+{
+    BatchContext *b = arg;
+    AVBPrint filename;
+    uint64_t idx;
+
+    av_bprint_init(&filename, 0, AV_BPRINT_SIZE_UNLIMITED);
+    while (batch_next_input(b, &filename, &idx) >= 0) {
+        BatchRecord *rec = &b->records[idx % b->nb_records];
+        int ret;
+
+        av_bprint_clear(&rec->buf);
+        ret = probe_batch_input(b, filename.str, &rec->buf);
+        batch_output(b, idx, ret);
+    }
+    av_bprint_finalize(&filename, NULL);
+    return NULL;
+}
+
+/**
+ * Probe each input of the -batch list with the given writer. Inputs are
+ * probed by a pool of worker threads, and the output for each of them is
+ * written as a separate document, in the order of the list.
+ */
+static int probe_batch(const Writer *w, const char *w_args)
+{
+    BatchContext b = { 0 };
+    int i, nb_threads = 1, ret = 0;
+#if HAVE_THREADS
+    pthread_t *threads = NULL;
+
+    nb_threads = batch_threads > 0 ? batch_threads : av_cpu_count();
+#endif
+
+    b.writer      = w;
+    b.writer_args = w_args;
+    b.list = strcmp(batch_list, "-") ? fopen(batch_list, "r") : stdin;
+    if (!b.list) {
+        ret = AVERROR(errno);
+        av_log(NULL, AV_LOG_ERROR, "Could not open batch list '%s': %s\n",
+               batch_list, av_err2str(ret));
+        return ret;
+    }
+#if HAVE_THREADS
+    pthread_mutex_init(&b.lock, NULL);
+    pthread_cond_init(&b.cond, NULL);
+#endif
+
+    b.nb_records = 2 * nb_threads;
+    b.records = av_mallocz_array(b.nb_records, sizeof(*b.records));
+    if (!b.records) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (i = 0; i < b.nb_records; i++)
+        av_bprint_init(&b.records[i].buf, 0, AV_BPRINT_SIZE_UNLIMITED);
+
+#if HAVE_THREADS
+    if (nb_threads > 1) {
+        threads = av_mallocz_array(nb_threads, sizeof(*threads));
+        if (!threads) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        for (i = 0; i < nb_threads; i++) {
+            if ((ret = pthread_create(&threads[i], NULL, batch_worker, &b))) {
+                av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+                ret = AVERROR(ret);
+                /* the threads already running will still go through the list */
+                break;
+            }
+        }
+        nb_threads = i;
+        for (i = 0; i < nb_threads; i++)
+            pthread_join(threads[i], NULL);
+        if (!nb_threads)
+            goto end;
+    } else
+#endif
+        batch_worker(&b);
+
+    if (!ret)
+        ret = b.ret;
+    if (!ret && b.nb_failed) {
+        av_log(NULL, AV_LOG_WARNING, "%d of %"PRIu64" inputs could not be probed\n",
+               b.nb_failed, b.next_input);
+        ret = AVERROR_INVALIDDATA;
+    }
+
+end:
+    if (b.records)
+        for (i = 0; i < b.nb_records; i++)
+            av_bprint_finalize(&b.records[i].buf, NULL);
+    av_freep(&b.records);
+#if HAVE_THREADS
+    av_freep(&threads);
+    pthread_cond_destroy(&b.cond);
+    pthread_mutex_destroy(&b.lock);
+#endif
+    if (b.list != stdin)
+        fclose(b.list);
+    return ret;
+}
+
 static void show_usage(void)
 {
     av_log(NULL, AV_LOG_INFO, "Simple multimedia streams analyzer\n");
@@ -3197,6 +3653,7 @@ static const OptionDef real_options[] = {
     { "show_chapters", 0, {(void*)&opt_show_chapters}, "show chapters info" },
     { "count_frames", OPT_BOOL, {(void*)&do_count_frames}, "count the number of frames per stream" },
     { "count_packets", OPT_BOOL, {(void*)&do_count_packets}, "count the number of packets per stream" },
+    { "parse_frames", OPT_BOOL, {(void*)&do_parse_frames}, "read frames with the codec parsers instead of decoding them" },
     { "show_program_version",  0, {(void*)&opt_show_program_version},  "show ffprobe version" },
     { "show_library_versions", 0, {(void*)&opt_show_library_versions}, "show library versions" },
     { "show_versions",         0, {(void*)&opt_show_versions}, "show program and library versions" },
@@ -3207,6 +3664,8 @@ static const OptionDef real_options[] = {
     { "read_intervals", HAS_ARG, {.func_arg = opt_read_intervals}, "set read intervals", "read_intervals" },
     { "default", HAS_ARG | OPT_AUDIO | OPT_VIDEO | OPT_EXPERT, {.func_arg = opt_default}, "generic catch all option", "" },
     { "i", HAS_ARG, {.func_arg = opt_input_file_i}, "read specified file", "input_file"},
+    { "batch", OPT_STRING | HAS_ARG, {(void*)&batch_list}, "probe each of the files listed in the given file, one per line", "list_file" },
+    { "batch_threads", OPT_INT | HAS_ARG, {(void*)&batch_threads}, "set the number of threads used to probe the -batch inputs", "number" },
     { NULL, },
 };
 
@@ -3273,6 +3732,9 @@ int main(int argc, char **argv)
     SET_DO_SHOW(STREAM_TAGS, stream_tags);
     SET_DO_SHOW(PACKET_TAGS, packet_tags);
 
+    do_read_frames = do_show_frames || do_count_frames;
+    do_read_packets = do_show_packets || do_count_packets;
+
     if (do_bitexact && (do_show_program_version || do_show_library_versions)) {
         av_log(NULL, AV_LOG_ERROR,
                "-bitexact and -show_program_version or -show_library_versions "
@@ -3281,10 +3743,19 @@ int main(int argc, char **argv)
         goto end;
     }
 
+    if (batch_list && (input_filename || do_show_program_version ||
+                       do_show_library_versions || do_show_pixel_formats)) {
+        av_log(NULL, AV_LOG_ERROR,
+               "-batch cannot be used with an input file, -show_program_version, "
+               "-show_library_versions or -show_pixel_formats\n");
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+
     writer_register_all();
 
     if (!print_format)
-        print_format = av_strdup("default");
+        print_format = av_strdup(batch_list ? "json=single_line=1" : "default");
     if (!print_format) {
         ret = AVERROR(ENOMEM);
         goto end;
@@ -3314,10 +3785,13 @@ int main(int argc, char **argv)
         goto end;
     }
 
-    if ((ret = writer_open(&wctx, w, w_args,
-                           sections, FF_ARRAY_ELEMS(sections))) >= 0) {
+    if (batch_list) {
+        ret = probe_batch(w, w_args);
+    } else if ((ret = writer_open(&wctx, w, w_args,
+                                  sections, FF_ARRAY_ELEMS(sections))) >= 0) {
         if (w == &xml_writer)
             wctx->string_validation_utf8_flags |= AV_UTF8_FLAG_EXCLUDE_XML_INVALID_CONTROL_CODES;
+        wctx->hash = hash;
 
         writer_print_section_header(wctx, SECTION_ID_ROOT);
 
@@ -3347,6 +3821,7 @@ int main(int argc, char **argv)
 
 end:
     av_freep(&print_format);
+    av_freep(&batch_list);
     av_freep(&read_intervals);
     av_hash_freep(&hash);
 
@@ -47,11 +47,13 @@
 #include "libavutil/avstring.h"
 #include "libavutil/lfg.h"
 #include "libavutil/dict.h"
+#include "libavutil/fifo.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/random_seed.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 
 #include <stdarg.h>
@@ -117,6 +119,10 @@ static const char * const http_state[] = {
 
 #define SYNC_TIMEOUT (10 * 1000)
 
+/* how long the packets of a feed are kept in memory in addition to the
+ * largest prebuffer of the streams using it, in ms */
+#define FEED_CACHE_MARGIN (10 * 1000)
+
 typedef struct RTSPActionServerSetup {
     uint32_t ipaddr;
     char transport_option[512];
@@ -190,6 +196,14 @@ typedef struct HTTPContext {
     /* RTP/TCP specific */
     struct HTTPContext *rtsp_c;
     uint8_t *packet_buffer, *packet_buffer_ptr, *packet_buffer_end;
+
+    /* live feed specific */
+    struct FFServerFeedCache *feed_cache; /* if set, packets are read from it
+                                             instead of fmt_in */
+    int64_t feed_seq;             /* sequence number of the next packet to send */
+    int feed_close_count;         /* close_count of the feed cache at opening */
+    struct HTTPWorker *worker;    /* thread serving the connection, NULL for
+                                     the main thread */
 } HTTPContext;
 
 typedef struct FeedData {
@@ -197,8 +211,81 @@ typedef struct FeedData {
     float avg_frame_size;   /* frame size averaged over last frames with exponential mean */
 } FeedData;
 
+/* packet read from a feed, see FFServerFeedCache */
+typedef struct FeedCacheEntry {
+    AVPacket pkt;
+    AVRational time_base;         /* time base of pkt */
+    enum AVMediaType codec_type;
+    int64_t dts;                  /* in AV_TIME_BASE units */
+    int64_t key_seq;              /* sequence number of the last keyframe up
+                                     to this packet, -1 if none */
+} FeedCacheEntry;
+
+/* Packets of a live feed. They are read once by the main thread, from the
+ * feed file or directly from the received data for in-memory feeds, and
+ * shared by all the HTTP connections streaming from the feed, so that the
+ * connections do not have to read the feed file themselves. */
+typedef struct FFServerFeedCache {
+    AVFormatContext *fmt_in;      /* reader of the feed file */
+    AVIOContext *pb;              /* I/O context of fmt_in for in-memory feeds */
+    AVFifoBuffer *input;          /* FFM data of in-memory feeds not read yet */
+    int64_t prebuffer;            /* largest prebuffer of the streams using
+                                     the feed, in us */
+    int64_t duration;             /* duration of the kept packets, in us */
+    int has_video;                /* keyframes are only taken from video */
+    int64_t last_key_seq;         /* sequence number of the last keyframe */
+    AVMutex lock;                 /* protects the fields below */
+    FeedCacheEntry *entries;      /* ring buffer, indexed by sequence number */
+    int nb_entries_max;
+    int64_t first_seq;            /* sequence number of the oldest packet */
+    int64_t next_seq;             /* sequence number of the next packet */
+    int64_t last_dts;             /* dts of the newest packet */
+    int closed;                   /* true if the feeder disconnected */
+    int close_count;              /* number of feeder disconnections */
+} FFServerFeedCache;
+
+/* row of the status page, copied from a HTTPContext */
+typedef struct ConnectionStatus {
+    FFServerStream *stream;
+    enum HTTPState state;
+    struct in_addr addr;
+    char protocol[16];
+    int feed_streams[FFSERVER_MAX_STREAMS];
+    DataRateData datarate;
+    int64_t data_count;
+} ConnectionStatus;
+
+/* thread serving HTTP connections which stream live feeds */
+typedef struct HTTPWorker {
+    int index;
+    HTTPContext *first_http_ctx;  /* connections served by the thread */
+    unsigned int nb_connections;  /* protected by stats_lock */
+    int64_t cur_time;
+#if HAVE_THREADS
+    pthread_t thread;
+#endif
+    struct pollfd *poll_table;
+    int wakeup_fds[2];            /* pipe used to interrupt poll() */
+    AVMutex lock;                 /* protects the fields below */
+    HTTPContext *new_connections; /* handed over by the main thread */
+    int wakeup_pending;           /* new feed data or new connections */
+    int quit;                     /* the thread must exit */
+    ConnectionStatus *status;     /* connections served by the thread, for */
+    int nb_status;                /* the status page */
+} HTTPWorker;
+
 static HTTPContext *first_http_ctx;
 
+static HTTPWorker *workers;
+static int nb_workers;
+
+/* protects nb_connections, current_bandwidth, the bytes_served fields of
+ * the streams and the nb_connections fields of the workers. The workers
+ * only decrease the counters, so the main thread can check them against
+ * the limits without taking the lock. */
+static AVMutex stats_lock;
+static AVMutex log_lock;
+
 static FFServerConfig config = {
     .nb_max_http_connections = 2000,
     .nb_max_connections = 5,
@@ -208,10 +295,12 @@ static FFServerConfig config = {
 
 static void new_connection(int server_fd, int is_rtsp);
 static void close_connection(HTTPContext *c);
+static void feed_cache_close(FFServerStream *feed);
 
 /* HTTP handling */
 static int handle_connection(HTTPContext *c);
 static inline void print_stream_params(AVIOContext *pb, FFServerStream *stream);
+static void get_connection_status(ConnectionStatus *cs, const HTTPContext *c);
 static void compute_status(HTTPContext *c);
 static int open_input_stream(HTTPContext *c, const char *info);
 static int http_parse_request(HTTPContext *c);
@@ -252,6 +341,7 @@ static const char *my_program_name;
 
 static int no_launch;
 static int need_to_start_children;
+static volatile int received_sigterm;
 
 /* maximum number of simultaneous HTTP connections */
 static unsigned int nb_connections;
@@ -395,7 +485,8 @@ static char *ctime1(char *buf2, size_t buf_size)
     return buf2;
 }
 
-static void http_vlog(const char *fmt, va_list vargs)
+/* must be called with log_lock held */
+static void http_vlog_unlocked(const char *fmt, va_list vargs)
 {
     static int print_prefix = 1;
     char buf[32];
@@ -412,6 +503,13 @@ static void http_vlog(const char *fmt, va_list vargs)
     fflush(logfile);
 }
 
+static void http_vlog(const char *fmt, va_list vargs)
+{
+    ff_mutex_lock(&log_lock);
+    http_vlog_unlocked(fmt, vargs);
+    ff_mutex_unlock(&log_lock);
+}
+
 #ifdef __GNUC__
 __attribute__ ((format (printf, 1, 2)))
 #endif
@@ -423,16 +521,29 @@ static void http_log(const char *fmt, ...)
     va_end(vargs);
 }
 
+#ifdef __GNUC__
+__attribute__ ((format (printf, 1, 2)))
+#endif
+static void http_log_unlocked(const char *fmt, ...)
+{
+    va_list vargs;
+    va_start(vargs, fmt);
+    http_vlog_unlocked(fmt, vargs);
+    va_end(vargs);
+}
+
 static void http_av_log(void *ptr, int level, const char *fmt, va_list vargs)
 {
     static int print_prefix = 1;
     AVClass *avc = ptr ? *(AVClass**)ptr : NULL;
     if (level > av_log_get_level())
         return;
+    ff_mutex_lock(&log_lock);
     if (print_prefix && avc)
-        http_log("[%s @ %p]", avc->item_name(ptr), ptr);
+        http_log_unlocked("[%s @ %p]", avc->item_name(ptr), ptr);
     print_prefix = strstr(fmt, "\n") != NULL;
-    http_vlog(fmt, vargs);
+    http_vlog_unlocked(fmt, vargs);
+    ff_mutex_unlock(&log_lock);
 }
 
 static void log_connection(HTTPContext *c)
@@ -445,15 +556,30 @@ static void log_connection(HTTPContext *c)
              c->protocol, (c->http_error ? c->http_error : 200), c->data_count);
 }
 
-static void update_datarate(DataRateData *drd, int64_t count)
+/* time of the thread serving the connection, in ms */
+static int64_t connection_time(HTTPContext *c)
+{
+    return c->worker ? c->worker->cur_time : cur_time;
+}
+
+static void add_bytes_served(HTTPContext *c, int len)
+{
+    if (!c->stream)
+        return;
+    ff_mutex_lock(&stats_lock);
+    c->stream->bytes_served += len;
+    ff_mutex_unlock(&stats_lock);
+}
+
+static void update_datarate(DataRateData *drd, int64_t count, int64_t now)
 {
     if (!drd->time1 && !drd->count1) {
-        drd->time1 = drd->time2 = cur_time;
+        drd->time1 = drd->time2 = now;
         drd->count1 = drd->count2 = count;
-    } else if (cur_time - drd->time2 > 5000) {
+    } else if (now - drd->time2 > 5000) {
         drd->time1 = drd->time2;
         drd->count1 = drd->count2;
-        drd->time2 = cur_time;
+        drd->time2 = now;
         drd->count2 = count;
     }
 }
@@ -650,6 +776,227 @@ static void start_multicast(void)
     }
 }
 
+static void wake_up_worker(HTTPWorker *w)
+{
+    ff_mutex_lock(&w->lock);
+    if (!w->wakeup_pending) {
+        w->wakeup_pending = 1;
+        if (write(w->wakeup_fds[1], "", 1) < 0)
+            http_log("Could not wake up worker thread %d: %s\n",
+                     w->index, strerror(errno));
+    }
+    ff_mutex_unlock(&w->lock);
+}
+
+/* tell the workers that new feed data is available */
+static void wake_up_workers(void)
+{
+    int i;
+
+    for (i = 0; i < nb_workers; i++)
+        wake_up_worker(&workers[i]);
+}
+
+/* move a connection from the main thread to the least loaded worker */
+static void hand_over_connection(HTTPContext *c)
+{
+    HTTPWorker *w = &workers[0];
+    HTTPContext **cp;
+    int i;
+
+    ff_mutex_lock(&stats_lock);
+    for (i = 1; i < nb_workers; i++)
+        if (workers[i].nb_connections < w->nb_connections)
+            w = &workers[i];
+    w->nb_connections++;
+    ff_mutex_unlock(&stats_lock);
+
+    for (cp = &first_http_ctx; *cp != c; cp = &(*cp)->next)
+        ;
+    *cp = c->next;
+    c->poll_entry = NULL;
+    c->worker = w;
+
+    ff_mutex_lock(&w->lock);
+    c->next = w->new_connections;
+    w->new_connections = c;
+    ff_mutex_unlock(&w->lock);
+    wake_up_worker(w);
+}
+
+#if HAVE_THREADS
+/* main loop of the worker threads, which only serve HTTP connections
+ * reading from a feed cache, after the header has been sent */
+static void *worker_thread(void *arg)
+{
+    HTTPWorker *w = arg;
+    struct pollfd *poll_entry;
+    HTTPContext *c, *c_next;
+    char buf[64];
+    int ret, wakeup, quit;
+
+    for(;;) {
+        poll_entry = w->poll_table;
+        poll_entry->fd = w->wakeup_fds[0];
+        poll_entry->events = POLLIN;
+        poll_entry++;
+        for (c = w->first_http_ctx; c; c = c->next) {
+            c->poll_entry = poll_entry;
+            poll_entry->fd = c->fd;
+            /* waiting connections are only polled to catch errors */
+            poll_entry->events = c->state == HTTPSTATE_WAIT_FEED ? POLLIN
+                                                                 : POLLOUT;
+            poll_entry++;
+        }
+
+        do {
+            ret = poll(w->poll_table, poll_entry - w->poll_table, 1000);
+            if (ret < 0 && ff_neterrno() != AVERROR(EAGAIN) &&
+                ff_neterrno() != AVERROR(EINTR)) {
+                http_log("Worker thread %d failed: %s\n",
+                         w->index, strerror(errno));
+                return NULL;
+            }
+        } while (ret < 0);
+
+        w->cur_time = av_gettime() / 1000;
+
+        /* empty the pipe before clearing wakeup_pending, so that no
+         * wakeup is lost */
+        if (w->poll_table[0].revents & POLLIN)
+            while (read(w->wakeup_fds[0], buf, sizeof(buf)) > 0)
+                ;
+
+        for (c = w->first_http_ctx; c; c = c_next) {
+            c_next = c->next;
+            if (handle_connection(c) < 0) {
+                log_connection(c);
+                close_connection(c);
+            }
+        }
+
+        ff_mutex_lock(&w->lock);
+        wakeup = w->wakeup_pending;
+        w->wakeup_pending = 0;
+        quit = w->quit;
+        while ((c = w->new_connections)) {
+            w->new_connections = c->next;
+            c->next = w->first_http_ctx;
+            w->first_http_ctx = c;
+        }
+        w->nb_status = 0;
+        for (c = w->first_http_ctx; c && w->nb_status < config.nb_max_http_connections;
+             c = c->next)
+            get_connection_status(&w->status[w->nb_status++], c);
+        ff_mutex_unlock(&w->lock);
+
+        if (quit)
+            break;
+
+        if (wakeup) {
+            for (c = w->first_http_ctx; c; c = c->next)
+                if (c->state == HTTPSTATE_WAIT_FEED)
+                    c->state = HTTPSTATE_SEND_DATA;
+        }
+    }
+    return NULL;
+}
+#endif
+
+#if HAVE_THREADS
+static void free_worker(HTTPWorker *w)
+{
+    close(w->wakeup_fds[0]);
+    close(w->wakeup_fds[1]);
+    ff_mutex_destroy(&w->lock);
+    av_freep(&w->poll_table);
+    av_freep(&w->status);
+}
+#endif
+
+static int start_workers(void)
+{
+#if HAVE_THREADS
+    int i, ret;
+
+    if (!config.nb_workers)
+        return 0;
+
+    workers = av_mallocz_array(config.nb_workers, sizeof(*workers));
+    if (!workers)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < config.nb_workers; i++) {
+        HTTPWorker *w = &workers[i];
+
+        w->index = i;
+        w->cur_time = av_gettime() / 1000;
+        if (pipe(w->wakeup_fds) < 0) {
+            ret = AVERROR(errno);
+            http_log("Could not create pipe: %s\n", strerror(errno));
+            return ret;
+        }
+        fcntl(w->wakeup_fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(w->wakeup_fds[1], F_SETFL, O_NONBLOCK);
+        ff_mutex_init(&w->lock, NULL);
+        w->poll_table = av_mallocz_array(config.nb_max_http_connections + 1,
+                                         sizeof(*w->poll_table));
+        w->status     = av_mallocz_array(config.nb_max_http_connections,
+                                         sizeof(*w->status));
+        if (!w->poll_table || !w->status) {
+            free_worker(w);
+            return AVERROR(ENOMEM);
+        }
+
+        ret = pthread_create(&w->thread, NULL, worker_thread, w);
+        if (ret) {
+            http_log("Could not create worker thread: %s\n", strerror(ret));
+            free_worker(w);
+            return AVERROR(ret);
+        }
+        nb_workers++;
+    }
+#else
+    if (config.nb_workers)
+        http_log("Thread support is disabled, ignoring WorkerThreads\n");
+#endif
+    return 0;
+}
+
+/* make the worker threads exit, then close the connections they served */
+static void stop_workers(void)
+{
+#if HAVE_THREADS
+    HTTPContext *c;
+    int i;
+
+    for (i = 0; i < nb_workers; i++) {
+        ff_mutex_lock(&workers[i].lock);
+        workers[i].quit = 1;
+        ff_mutex_unlock(&workers[i].lock);
+        wake_up_worker(&workers[i]);
+    }
+
+    for (i = 0; i < nb_workers; i++) {
+        HTTPWorker *w = &workers[i];
+
+        pthread_join(w->thread, NULL);
+        while ((c = w->new_connections)) {
+            w->new_connections = c->next;
+            c->next = w->first_http_ctx;
+            w->first_http_ctx = c;
+        }
+        while (w->first_http_ctx)
+            close_connection(w->first_http_ctx);
+    }
+
+    for (i = 0; i < nb_workers; i++)
+        free_worker(&workers[i]);
+    nb_workers = 0;
+    av_freep(&workers);
+#endif
+}
+
 /* main loop of the HTTP server */
 static int http_server(void)
 {
@@ -674,10 +1021,8 @@ static int http_server(void)
 
     if (config.rtsp_addr.sin_port) {
         rtsp_server_fd = socket_open_listen(&config.rtsp_addr);
-        if (rtsp_server_fd < 0) {
-            closesocket(server_fd);
+        if (rtsp_server_fd < 0)
             goto quit;
-        }
     }
 
     if (!rtsp_server_fd && !server_fd) {
@@ -685,6 +1030,11 @@ static int http_server(void)
         goto quit;
     }
 
+    if (start_workers() < 0) {
+        http_log("Could not start worker threads.\n");
+        goto quit;
+    }
+
     http_log("FFserver started.\n");
 
     start_children(config.first_feed);
@@ -762,7 +1112,12 @@ static int http_server(void)
                 ff_neterrno() != AVERROR(EINTR)) {
                 goto quit;
             }
-        } while (ret < 0);
+        } while (ret < 0 && !received_sigterm);
+
+        if (received_sigterm) {
+            http_log("Received signal %d, exiting.\n", received_sigterm);
+            goto quit;
+        }
 
         cur_time = av_gettime() / 1000;
 
@@ -778,6 +1133,12 @@ static int http_server(void)
                 log_connection(c);
                 /* close and free the connection */
                 close_connection(c);
+            } else if (nb_workers && c->feed_cache && !c->wmp_client_id &&
+                       (c->state == HTTPSTATE_SEND_DATA ||
+                        c->state == HTTPSTATE_WAIT_FEED)) {
+                /* the header has been sent, let a worker stream the
+                 * packets of the feed */
+                hand_over_connection(c);
             }
         }
 
@@ -796,8 +1157,15 @@ static int http_server(void)
     }
 
 quit:
+    stop_workers();
+    while (first_http_ctx)
+        close_connection(first_http_ctx);
+    if (server_fd > 0)
+        closesocket(server_fd);
+    if (rtsp_server_fd > 0)
+        closesocket(rtsp_server_fd);
     av_free(poll_table);
-    return -1;
+    return received_sigterm ? 0 : -1;
 }
 
 /* start waiting for a new HTTP/RTSP request */
@@ -870,7 +1238,9 @@ static void new_connection(int server_fd, int is_rtsp)
 
     c->next = first_http_ctx;
     first_http_ctx = c;
+    ff_mutex_lock(&stats_lock);
     nb_connections++;
+    ff_mutex_unlock(&stats_lock);
 
     start_wait_request(c, is_rtsp);
 
@@ -892,7 +1262,7 @@ static void close_connection(HTTPContext *c)
     AVStream *st;
 
     /* remove connection from list */
-    cp = &first_http_ctx;
+    cp = c->worker ? &c->worker->first_http_ctx : &first_http_ctx;
     while (*cp) {
         c1 = *cp;
         if (c1 == c)
@@ -902,9 +1272,11 @@ static void close_connection(HTTPContext *c)
     }
 
     /* remove references, if any (XXX: do it faster) */
-    for(c1 = first_http_ctx; c1; c1 = c1->next) {
-        if (c1->rtsp_c == c)
-            c1->rtsp_c = NULL;
+    if (!c->worker) {
+        for(c1 = first_http_ctx; c1; c1 = c1->next) {
+            if (c1->rtsp_c == c)
+                c1->rtsp_c = NULL;
+        }
     }
 
     /* remove connection associated resources */
@@ -947,25 +1319,41 @@ static void close_connection(HTTPContext *c)
         }
     }
 
-    for(i=0; i<ctx->nb_streams; i++)
+    for(i=0; i<ctx->nb_streams; i++) {
+        st = ctx->streams[i];
+        /* http_prepare_data() may have failed before allocating it */
+        if (st->internal)
+            avcodec_free_context(&st->internal->avctx);
+        av_freep(&st->internal);
+        av_freep(&st->priv_pts);
         av_freep(&ctx->streams[i]);
+    }
     av_freep(&ctx->streams);
     av_freep(&ctx->priv_data);
 
+    ff_mutex_lock(&stats_lock);
     if (c->stream && !c->post && c->stream->stream_type == STREAM_TYPE_LIVE)
         current_bandwidth -= c->stream->bandwidth;
+    if (c->worker)
+        c->worker->nb_connections--;
+    nb_connections--;
+    ff_mutex_unlock(&stats_lock);
 
     /* signal that there is no feed if we are the feeder socket */
     if (c->state == HTTPSTATE_RECEIVE_DATA && c->stream) {
+        if (c->stream->feed_opened && c->stream->cache) {
+            feed_cache_close(c->stream);
+            wake_up_workers();
+        }
         c->stream->feed_opened = 0;
-        close(c->feed_fd);
+        if (c->feed_fd >= 0)
+            close(c->feed_fd);
     }
 
     av_freep(&c->pb_buffer);
     av_freep(&c->packet_buffer);
     av_freep(&c->buffer);
     av_free(c);
-    nb_connections--;
 }
 
 static int handle_connection(HTTPContext *c)
@@ -1032,8 +1420,7 @@ static int handle_connection(HTTPContext *c)
             break;
         }
         c->buffer_ptr += len;
-        if (c->stream)
-            c->stream->bytes_served += len;
+        add_bytes_served(c, len);
         c->data_count += len;
         if (c->buffer_ptr >= c->buffer_end) {
             av_freep(&c->pb_buffer);
@@ -1067,9 +1454,8 @@ static int handle_connection(HTTPContext *c)
         if (c->state == HTTPSTATE_SEND_DATA_TRAILER)
             return -1;
         /* Check if it is a single jpeg frame 123 */
-        if (c->stream->single_frame && c->data_count > c->cur_frame_bytes && c->cur_frame_bytes > 0) {
-            close_connection(c);
-        }
+        if (c->stream->single_frame && c->data_count > c->cur_frame_bytes && c->cur_frame_bytes > 0)
+            return -1;
         break;
     case HTTPSTATE_RECEIVE_DATA:
         /* no need to read if no events */
@@ -1551,8 +1937,11 @@ static int http_parse_request(HTTPContext *c)
         }
     }
 
-    if (c->post == 0 && stream->stream_type == STREAM_TYPE_LIVE)
+    if (c->post == 0 && stream->stream_type == STREAM_TYPE_LIVE) {
+        ff_mutex_lock(&stats_lock);
         current_bandwidth += stream->bandwidth;
+        ff_mutex_unlock(&stats_lock);
+    }
 
     /* If already streaming this feed, do not let another feeder start */
     if (stream->feed_opened) {
@@ -1913,13 +2302,54 @@ static inline void print_stream_params(AVIOContext *pb, FFServerStream *stream)
      avio_printf(pb, "</table>\n");
 }
 
+/* may be called by the worker serving the connection */
+static void get_connection_status(ConnectionStatus *cs, const HTTPContext *c)
+{
+    cs->stream     = c->stream;
+    cs->state      = c->state;
+    cs->addr       = c->from_addr.sin_addr;
+    av_strlcpy(cs->protocol, c->protocol, sizeof(cs->protocol));
+    memcpy(cs->feed_streams, c->feed_streams, sizeof(cs->feed_streams));
+    cs->datarate   = c->datarate;
+    cs->data_count = c->data_count;
+}
+
+static void print_connection_status(AVIOContext *pb, int index,
+                                    ConnectionStatus *cs)
+{
+    int bitrate = 0;
+    int j;
+
+    if (cs->stream) {
+        for (j = 0; j < cs->stream->nb_streams; j++) {
+            if (!cs->stream->feed)
+                bitrate += cs->stream->streams[j]->codec->bit_rate;
+            else if (cs->feed_streams[j] >= 0)
+                bitrate += cs->stream->feed->streams[cs->feed_streams[j]]->codec->bit_rate;
+        }
+    }
+
+    avio_printf(pb, "<tr><td><b>%d</b><td>%s%s<td>%s<td>%s<td>%s"
+                    "<td align=right>",
+                index, cs->stream ? cs->stream->filename : "",
+                cs->state == HTTPSTATE_RECEIVE_DATA ? "(input)" : "",
+                inet_ntoa(cs->addr), cs->protocol, http_state[cs->state]);
+    fmt_bytecount(pb, bitrate);
+    avio_printf(pb, "<td align=right>");
+    fmt_bytecount(pb, compute_datarate(&cs->datarate, cs->data_count) * 8);
+    avio_printf(pb, "<td align=right>");
+    fmt_bytecount(pb, cs->data_count);
+    avio_printf(pb, "\n");
+}
+
 static void compute_status(HTTPContext *c)
 {
     HTTPContext *c1;
     FFServerStream *stream;
+    ConnectionStatus cs;
     char *p;
     time_t ti;
-    int i, len;
+    int i, j, k, len;
     AVIOContext *pb;
 
     if (avio_open_dyn_buf(&pb) < 0) {
@@ -1949,6 +2379,7 @@ static void compute_status(HTTPContext *c)
     while (stream) {
         char sfilename[1024];
         char *eosf;
+        int64_t bytes_served;
 
         if (stream->feed == stream) {
             stream = stream->next;
@@ -1980,7 +2411,10 @@ static void compute_status(HTTPContext *c)
                     sfilename, stream->filename);
         avio_printf(pb, "<td align=right> %d <td align=right> ",
                     stream->conns_served);
-        fmt_bytecount(pb, stream->bytes_served);
+        ff_mutex_lock(&stats_lock);
+        bytes_served = stream->bytes_served;
+        ff_mutex_unlock(&stats_lock);
+        fmt_bytecount(pb, bytes_served);
 
         switch(stream->stream_type) {
         case STREAM_TYPE_LIVE: {
@@ -2091,45 +2525,42 @@ static void compute_status(HTTPContext *c)
     /* connection status */
     avio_printf(pb, "<h2>Connection Status</h2>\n");
 
+    ff_mutex_lock(&stats_lock);
     avio_printf(pb, "Number of connections: %d / %d<br>\n",
                 nb_connections, config.nb_max_connections);
 
     avio_printf(pb, "Bandwidth in use: %"PRIu64"k / %"PRIu64"k<br>\n",
                 current_bandwidth, config.max_bandwidth);
 
+    if (nb_workers) {
+        avio_printf(pb, "Connections served by the worker threads:");
+        for (i = 0; i < nb_workers; i++)
+            avio_printf(pb, " %u", workers[i].nb_connections);
+        avio_printf(pb, "<br>\n");
+    }
+    ff_mutex_unlock(&stats_lock);
+
     avio_printf(pb, "<table>\n");
     avio_printf(pb, "<tr><th>#<th>File<th>IP<th>Proto<th>State<th>Target "
                     "bit/s<th>Actual bit/s<th>Bytes transferred\n");
-    c1 = first_http_ctx;
     i = 0;
-    while (c1) {
-        int bitrate;
-        int j;
-
-        bitrate = 0;
-        if (c1->stream) {
-            for (j = 0; j < c1->stream->nb_streams; j++) {
-                if (!c1->stream->feed)
-                    bitrate += c1->stream->streams[j]->codec->bit_rate;
-                else if (c1->feed_streams[j] >= 0)
-                    bitrate += c1->stream->feed->streams[c1->feed_streams[j]]->codec->bit_rate;
-            }
+    for (c1 = first_http_ctx; c1; c1 = c1->next) {
+        get_connection_status(&cs, c1);
+        print_connection_status(pb, ++i, &cs);
+    }
+    /* the connections of the workers are listed as of the last iteration
+     * of their loop, or as handed over if they did not pick them yet */
+    for (j = 0; j < nb_workers; j++) {
+        HTTPWorker *w = &workers[j];
+
+        ff_mutex_lock(&w->lock);
+        for (k = 0; k < w->nb_status; k++)
+            print_connection_status(pb, ++i, &w->status[k]);
+        for (c1 = w->new_connections; c1; c1 = c1->next) {
+            get_connection_status(&cs, c1);
+            print_connection_status(pb, ++i, &cs);
         }
-
-        i++;
-        p = inet_ntoa(c1->from_addr.sin_addr);
-        avio_printf(pb, "<tr><td><b>%d</b><td>%s%s<td>%s<td>%s<td>%s"
-                        "<td align=right>",
-                    i, c1->stream ? c1->stream->filename : "",
-                    c1->state == HTTPSTATE_RECEIVE_DATA ? "(input)" : "", p,
-                    c1->protocol, http_state[c1->state]);
-        fmt_bytecount(pb, bitrate);
-        avio_printf(pb, "<td align=right>");
-        fmt_bytecount(pb, compute_datarate(&c1->datarate, c1->data_count) * 8);
-        avio_printf(pb, "<td align=right>");
-        fmt_bytecount(pb, c1->data_count);
-        avio_printf(pb, "\n");
-        c1 = c1->next;
+        ff_mutex_unlock(&w->lock);
     }
     avio_printf(pb, "</table>\n");
 
@@ -2144,13 +2575,308 @@ static void compute_status(HTTPContext *c)
     c->buffer_end = c->pb_buffer + len;
 }
 
+/* The fields of FFServerFeedCache are only written by the main thread, which
+ * takes the lock for this; the workers take the lock to read them. */
+
+static int feed_cache_init(FFServerStream *feed)
+{
+    FFServerFeedCache *cache;
+    FFServerStream *stream;
+    int i, prebuffer = 0;
+
+    cache = av_mallocz(sizeof(*cache));
+    if (!cache)
+        return AVERROR(ENOMEM);
+
+    if (feed->in_memory) {
+        cache->input = av_fifo_alloc(FFM_PACKET_SIZE);
+        if (!cache->input) {
+            av_free(cache);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    for (stream = config.first_stream; stream; stream = stream->next)
+        if (stream->feed == feed)
+            prebuffer = FFMAX(prebuffer, stream->prebuffer);
+    cache->prebuffer = prebuffer * (int64_t)1000;
+    cache->duration  = (prebuffer + FEED_CACHE_MARGIN) * (int64_t)1000;
+    for (i = 0; i < feed->nb_streams; i++)
+        if (feed->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+            cache->has_video = 1;
+    cache->last_key_seq = -1;
+    ff_mutex_init(&cache->lock, NULL);
+    feed->cache = cache;
+    return 0;
+}
+
+/* must be called with the lock held */
+static int feed_cache_add(FFServerFeedCache *cache, AVPacket *pkt,
+                          AVStream *st)
+{
+    FeedCacheEntry *e;
+    int ret;
+
+    if (cache->next_seq - cache->first_seq == cache->nb_entries_max) {
+        int nb_entries = FFMAX(2 * cache->nb_entries_max, 256);
+        FeedCacheEntry *entries = av_mallocz_array(nb_entries, sizeof(*entries));
+        int64_t seq;
+
+        if (!entries)
+            return AVERROR(ENOMEM);
+        for (seq = cache->first_seq; seq < cache->next_seq; seq++)
+            entries[seq % nb_entries] =
+                cache->entries[seq % cache->nb_entries_max];
+        av_free(cache->entries);
+        cache->entries        = entries;
+        cache->nb_entries_max = nb_entries;
+    }
+
+    e = &cache->entries[cache->next_seq % cache->nb_entries_max];
+    if ((ret = av_packet_ref(&e->pkt, pkt)) < 0)
+        return ret;
+    if (pkt->dts != AV_NOPTS_VALUE)
+        cache->last_dts = av_rescale_q(pkt->dts, st->time_base, AV_TIME_BASE_Q);
+    if (pkt->flags & AV_PKT_FLAG_KEY &&
+        (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO || !cache->has_video))
+        cache->last_key_seq = cache->next_seq;
+    e->dts        = cache->last_dts;
+    e->key_seq    = cache->last_key_seq;
+    e->time_base  = st->time_base;
+    e->codec_type = st->codecpar->codec_type;
+    cache->next_seq++;
+
+    /* drop the packets nobody should need anymore */
+    while (cache->next_seq - cache->first_seq > 1) {
+        e = &cache->entries[cache->first_seq % cache->nb_entries_max];
+        if (FFABS(cache->last_dts - e->dts) <= cache->duration)
+            break;
+        av_packet_unref(&e->pkt);
+        cache->first_seq++;
+    }
+    return 0;
+}
+
+static int feed_cache_read_input(void *opaque, uint8_t *buf, int buf_size)
+{
+    FFServerFeedCache *cache = opaque;
+    int size = FFMIN(av_fifo_size(cache->input), buf_size);
+
+    if (!size)
+        return AVERROR_EOF;
+    av_fifo_generic_read(cache->input, buf, size, NULL);
+    return size;
+}
+
+/* open the reader of an in-memory feed, the FFM header sent by the feeder
+ * must have been received */
+static int feed_cache_open_input(FFServerStream *feed)
+{
+    FFServerFeedCache *cache = feed->cache;
+    AVFormatContext *s;
+    uint8_t *buf;
+    int ret;
+
+    buf = av_malloc(FFM_PACKET_SIZE);
+    if (!buf)
+        return AVERROR(ENOMEM);
+    cache->pb = avio_alloc_context(buf, FFM_PACKET_SIZE, 0, cache,
+                                   feed_cache_read_input, NULL, NULL);
+    if (!cache->pb) {
+        av_free(buf);
+        return AVERROR(ENOMEM);
+    }
+    cache->pb->seekable = 0;
+
+    s = avformat_alloc_context();
+    if (!s) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    s->pb = cache->pb;
+    s->flags |= AVFMT_FLAG_GENPTS;
+    ret = avformat_open_input(&s, feed->filename,
+                              av_find_input_format("ffm"), NULL);
+    if (ret < 0)
+        goto fail;
+    cache->fmt_in = s;
+    return 0;
+fail:
+    av_freep(&cache->pb->buffer);
+    av_freep(&cache->pb);
+    return ret;
+}
+
+static void feed_cache_close_input(FFServerFeedCache *cache)
+{
+    avformat_close_input(&cache->fmt_in);
+    if (cache->pb)
+        av_freep(&cache->pb->buffer);
+    av_freep(&cache->pb);
+    if (cache->input)
+        av_fifo_reset(cache->input);
+}
+
+/* queue FFM data received for an in-memory feed */
+static int feed_cache_write_input(FFServerStream *feed, uint8_t *buf, int size)
+{
+    FFServerFeedCache *cache = feed->cache;
+    int ret;
+
+    if (av_fifo_space(cache->input) < size &&
+        (ret = av_fifo_grow(cache->input, size)) < 0)
+        return ret;
+    av_fifo_generic_write(cache->input, buf, size, NULL);
+    feed->feed_write_index += size;
+    feed->feed_size = feed->feed_write_index;
+    return 0;
+}
+
+/* read the packets written to the feed since the last call, return the
+ * number of new packets */
+static int feed_cache_fill(FFServerStream *feed)
+{
+    FFServerFeedCache *cache = feed->cache;
+    AVFormatContext *s = cache->fmt_in;
+    AVPacket pkt;
+    int ret, nb_packets = 0;
+
+    if (!s && feed->in_memory) {
+        ret = feed_cache_open_input(feed);
+        if (ret < 0) {
+            http_log("Could not read the data of feed '%s': %s\n",
+                     feed->filename, av_err2str(ret));
+            return ret;
+        }
+        s = cache->fmt_in;
+    } else if (!s) {
+        ret = avformat_open_input(&s, feed->feed_filename,
+                                  av_find_input_format("ffm"), NULL);
+        if (ret < 0) {
+            http_log("Could not open feed file '%s': %s\n",
+                     feed->feed_filename, av_err2str(ret));
+            return ret;
+        }
+        ret = ffio_set_buf_size(s->pb, FFM_PACKET_SIZE);
+        if (ret < 0) {
+            http_log("Failed to set buffer size\n");
+            avformat_close_input(&s);
+            return ret;
+        }
+        s->flags |= AVFMT_FLAG_GENPTS;
+        av_seek_frame(s, -1, av_gettime() - cache->prebuffer, 0);
+        cache->fmt_in = s;
+    }
+
+    ffm_set_write_index(s, feed->feed_write_index,
+                        feed->in_memory ? INT64_MAX : feed->feed_size);
+    while (av_read_frame(s, &pkt) >= 0) {
+        ff_mutex_lock(&cache->lock);
+        ret = feed_cache_add(cache, &pkt, s->streams[pkt.stream_index]);
+        ff_mutex_unlock(&cache->lock);
+        av_packet_unref(&pkt);
+        if (ret < 0)
+            return ret;
+        nb_packets++;
+    }
+    return nb_packets;
+}
+
+/* drop the cached packets when a new feeder connects */
+static void feed_cache_reset(FFServerStream *feed)
+{
+    FFServerFeedCache *cache = feed->cache;
+
+    feed_cache_close_input(cache);
+    cache->last_key_seq = -1;
+    ff_mutex_lock(&cache->lock);
+    for (; cache->first_seq < cache->next_seq; cache->first_seq++)
+        av_packet_unref(&cache->entries[cache->first_seq %
+                                        cache->nb_entries_max].pkt);
+    cache->closed = 0;
+    ff_mutex_unlock(&cache->lock);
+}
+
+static void feed_cache_close(FFServerStream *feed)
+{
+    FFServerFeedCache *cache = feed->cache;
+
+    ff_mutex_lock(&cache->lock);
+    cache->closed = 1;
+    cache->close_count++;
+    ff_mutex_unlock(&cache->lock);
+}
+
+/* start to send the cached packets of the feed from the keyframe preceding
+ * the packets received in the last prebuffer us */
+static int feed_cache_open_connection(HTTPContext *c, int64_t prebuffer)
+{
+    FFServerStream *feed = c->stream->feed;
+    FFServerFeedCache *cache = feed->cache;
+    int64_t seq;
+    int ret;
+
+    if (!feed->in_memory) {
+        /* older data is read from the feed file */
+        if (prebuffer > cache->duration)
+            return AVERROR(ENOSYS);
+        if (!cache->fmt_in && (ret = feed_cache_fill(feed)) < 0)
+            return ret;
+    }
+
+    for (seq = cache->next_seq; seq > cache->first_seq; seq--) {
+        FeedCacheEntry *e = &cache->entries[(seq - 1) % cache->nb_entries_max];
+        if (FFABS(cache->last_dts - e->dts) > prebuffer)
+            break;
+    }
+    if (seq < cache->next_seq) {
+        FeedCacheEntry *e = &cache->entries[seq % cache->nb_entries_max];
+        if (e->key_seq >= cache->first_seq)
+            seq = e->key_seq;
+    }
+    c->feed_cache       = cache;
+    c->feed_seq         = seq;
+    c->feed_close_count = cache->close_count;
+    return 0;
+}
+
+static int feed_cache_read(HTTPContext *c, AVPacket *pkt,
+                           AVRational *time_base, enum AVMediaType *codec_type)
+{
+    FFServerFeedCache *cache = c->feed_cache;
+    int ret;
+
+    ff_mutex_lock(&cache->lock);
+    if (c->feed_seq < cache->first_seq) {
+        /* the connection could not keep up, skip the dropped packets */
+        c->feed_seq = cache->first_seq;
+        c->got_key_frame = 0;
+    }
+    if (c->feed_seq == cache->next_seq) {
+        /* connections opened after the feeder left wait for the next one */
+        ret = cache->closed && c->feed_close_count != cache->close_count ?
+              AVERROR_EOF : AVERROR(EAGAIN);
+    } else {
+        FeedCacheEntry *e = &cache->entries[c->feed_seq % cache->nb_entries_max];
+        av_init_packet(pkt);
+        ret = av_packet_ref(pkt, &e->pkt);
+        if (ret >= 0) {
+            *time_base  = e->time_base;
+            *codec_type = e->codec_type;
+            c->feed_seq++;
+        }
+    }
+    ff_mutex_unlock(&cache->lock);
+    return ret;
+}
+
 static int open_input_stream(HTTPContext *c, const char *info)
 {
     char buf[128];
     char input_filename[1024];
     AVFormatContext *s = NULL;
     int buf_size, i, ret;
-    int64_t stream_pos;
+    int64_t stream_pos, prebuffer;
 
     /* find file name */
     if (c->stream->feed) {
@@ -2162,11 +2888,27 @@ static int open_input_stream(HTTPContext *c, const char *info)
                 http_log("Invalid date specification '%s' for stream\n", buf);
                 return ret;
             }
-        } else if (av_find_info_tag(buf, sizeof(buf), "buffer", info)) {
-            int prebuffer = strtol(buf, 0, 10);
-            stream_pos = av_gettime() - prebuffer * (int64_t)1000000;
-        } else
-            stream_pos = av_gettime() - c->stream->prebuffer * (int64_t)1000;
+        } else {
+            if (av_find_info_tag(buf, sizeof(buf), "buffer", info))
+                prebuffer = strtol(buf, 0, 10) * (int64_t)1000000;
+            else
+                prebuffer = c->stream->prebuffer * (int64_t)1000;
+            stream_pos = av_gettime() - prebuffer;
+
+            /* HTTP connections share the packets read from the feed */
+            if (!c->is_packetized &&
+                feed_cache_open_connection(c, prebuffer) >= 0) {
+                c->start_time = cur_time;
+                c->first_pts = AV_NOPTS_VALUE;
+                return 0;
+            }
+        }
+        if (c->stream->feed->in_memory) {
+            http_log("Feed '%s' is only kept in memory, cannot open it "
+                     "for stream '%s'\n", c->stream->feed->filename,
+                     c->stream->filename);
+            return AVERROR(ENOSYS);
+        }
     } else {
         strcpy(input_filename, c->stream->feed_filename);
         buf_size = 0;
@@ -2271,8 +3013,12 @@ static int http_prepare_data(HTTPContext *c)
             return AVERROR(ENOMEM);
 
         for(i=0;i<c->stream->nb_streams;i++) {
-            AVStream *src;
-            c->fmt_ctx.streams[i] = av_mallocz(sizeof(AVStream));
+            AVStream *src, *st;
+            st = c->fmt_ctx.streams[i] = av_mallocz(sizeof(AVStream));
+            if (!st)
+                return AVERROR(ENOMEM);
+            /* so that close_connection() frees the streams allocated so far */
+            c->fmt_ctx.nb_streams = i + 1;
 
             /* if file or feed, then just take streams from FFServerStream
              * struct */
@@ -2282,14 +3028,20 @@ static int http_prepare_data(HTTPContext *c)
             else
                 src = c->stream->feed->streams[c->stream->feed_streams[i]];
 
-            *(c->fmt_ctx.streams[i]) = *src;
-            c->fmt_ctx.streams[i]->priv_data = 0;
-            /* XXX: should be done in AVStream, not in codec */
-            c->fmt_ctx.streams[i]->codec->frame_number = 0;
+            *st = *src;
+            st->priv_data = 0;
+            st->priv_pts  = NULL;
+            /* the muxing state must not be shared with the other
+             * connections, which may be served by other threads */
+            st->internal = av_mallocz(sizeof(*st->internal));
+            if (!st->internal)
+                return AVERROR(ENOMEM);
+            st->internal->avctx = avcodec_alloc_context3(NULL);
+            if (!st->internal->avctx)
+                return AVERROR(ENOMEM);
         }
         /* set output format parameters */
         c->fmt_ctx.oformat = c->stream->fmt;
-        c->fmt_ctx.nb_streams = c->stream->nb_streams;
 
         c->got_key_frame = 0;
 
@@ -2324,21 +3076,32 @@ static int http_prepare_data(HTTPContext *c)
     case HTTPSTATE_SEND_DATA:
         /* find a new packet */
         /* read a packet from the input stream */
-        if (c->stream->feed)
+        if (c->stream->feed && !c->feed_cache)
             ffm_set_write_index(c->fmt_in,
                                 c->stream->feed->feed_write_index,
                                 c->stream->feed->feed_size);
 
         if (c->stream->max_time &&
-            c->stream->max_time + c->start_time - cur_time < 0)
+            c->stream->max_time + c->start_time - connection_time(c) < 0)
             /* We have timed out */
             c->state = HTTPSTATE_SEND_DATA_TRAILER;
         else {
             AVPacket pkt;
+            AVRational in_tb;
+            enum AVMediaType in_type;
         redo:
-            ret = av_read_frame(c->fmt_in, &pkt);
+            if (c->feed_cache) {
+                ret = feed_cache_read(c, &pkt, &in_tb, &in_type);
+            } else {
+                ret = av_read_frame(c->fmt_in, &pkt);
+                if (ret >= 0) {
+                    in_tb   = c->fmt_in->streams[pkt.stream_index]->time_base;
+                    in_type = c->fmt_in->streams[pkt.stream_index]->codecpar->codec_type;
+                }
+            }
             if (ret < 0) {
-                if (c->stream->feed) {
+                if (c->stream->feed &&
+                    (!c->feed_cache || ret == AVERROR(EAGAIN))) {
                     /* if coming from feed, it means we reached the end of the
                      * ffm file, so must wait for more data */
                     c->state = HTTPSTATE_WAIT_FEED;
@@ -2348,7 +3111,7 @@ static int http_prepare_data(HTTPContext *c)
                     /* input not ready, come back later */
                     return 0;
                 }
-                if (c->stream->loop) {
+                if (c->stream->loop && !c->feed_cache) {
                     avformat_close_input(&c->fmt_in);
                     if (open_input_stream(c, "") < 0)
                         goto no_loop;
@@ -2359,11 +3122,10 @@ static int http_prepare_data(HTTPContext *c)
                         c->state = HTTPSTATE_SEND_DATA_TRAILER;
                 }
             } else {
-                int source_index = pkt.stream_index;
                 /* update first pts if needed */
                 if (c->first_pts == AV_NOPTS_VALUE && pkt.dts != AV_NOPTS_VALUE) {
-                    c->first_pts = av_rescale_q(pkt.dts, c->fmt_in->streams[pkt.stream_index]->time_base, AV_TIME_BASE_Q);
-                    c->start_time = cur_time;
+                    c->first_pts = av_rescale_q(pkt.dts, in_tb, AV_TIME_BASE_Q);
+                    c->start_time = connection_time(c);
                 }
                 /* send it to the appropriate stream */
                 if (c->stream->feed) {
@@ -2380,10 +3142,9 @@ static int http_prepare_data(HTTPContext *c)
                     }
                     for(i=0;i<c->stream->nb_streams;i++) {
                         if (c->stream->feed_streams[i] == pkt.stream_index) {
-                            AVStream *st = c->fmt_in->streams[source_index];
                             pkt.stream_index = i;
                             if (pkt.flags & AV_PKT_FLAG_KEY &&
-                                (st->codec->codec_type == AVMEDIA_TYPE_VIDEO ||
+                                (in_type == AVMEDIA_TYPE_VIDEO ||
                                  c->stream->nb_streams == 1))
                                 c->got_key_frame = 1;
                             if (!c->stream->send_on_key || c->got_key_frame)
@@ -2391,20 +3152,18 @@ static int http_prepare_data(HTTPContext *c)
                         }
                     }
                 } else {
-                    AVCodecContext *codec;
-                    AVStream *ist, *ost;
+                    AVStream *ost;
                 send_it:
-                    ist = c->fmt_in->streams[source_index];
                     /* specific handling for RTP: we use several
                      * output streams (one for each RTP connection).
                      * XXX: need more abstract handling */
                     if (c->is_packetized) {
                         /* compute send time and duration */
                         if (pkt.dts != AV_NOPTS_VALUE) {
-                            c->cur_pts = av_rescale_q(pkt.dts, ist->time_base, AV_TIME_BASE_Q);
+                            c->cur_pts = av_rescale_q(pkt.dts, in_tb, AV_TIME_BASE_Q);
                             c->cur_pts -= c->first_pts;
                         }
-                        c->cur_frame_duration = av_rescale_q(pkt.duration, ist->time_base, AV_TIME_BASE_Q);
+                        c->cur_frame_duration = av_rescale_q(pkt.duration, in_tb, AV_TIME_BASE_Q);
                         /* find RTP context */
                         c->packet_stream_index = pkt.stream_index;
                         ctx = c->rtp_ctx[c->packet_stream_index];
@@ -2412,13 +3171,10 @@ static int http_prepare_data(HTTPContext *c)
                             av_packet_unref(&pkt);
                             break;
                         }
-                        codec = ctx->streams[0]->codec;
                         /* only one stream per RTP connection */
                         pkt.stream_index = 0;
                     } else {
                         ctx = &c->fmt_ctx;
-                        /* Fudge here */
-                        codec = ctx->streams[pkt.stream_index]->codec;
                     }
 
                     if (c->is_packetized) {
@@ -2440,12 +3196,10 @@ static int http_prepare_data(HTTPContext *c)
 
                     ctx->pb->seekable = 0;
                     if (pkt.dts != AV_NOPTS_VALUE)
-                        pkt.dts = av_rescale_q(pkt.dts, ist->time_base,
-                                               ost->time_base);
+                        pkt.dts = av_rescale_q(pkt.dts, in_tb, ost->time_base);
                     if (pkt.pts != AV_NOPTS_VALUE)
-                        pkt.pts = av_rescale_q(pkt.pts, ist->time_base,
-                                               ost->time_base);
-                    pkt.duration = av_rescale_q(pkt.duration, ist->time_base,
+                        pkt.pts = av_rescale_q(pkt.pts, in_tb, ost->time_base);
+                    pkt.duration = av_rescale_q(pkt.duration, in_tb,
                                                 ost->time_base);
                     if ((ret = av_write_frame(ctx, &pkt)) < 0) {
                         http_log("Error writing frame to output for stream '%s': %s\n",
@@ -2460,7 +3214,6 @@ static int http_prepare_data(HTTPContext *c)
                     c->buffer_ptr = c->pb_buffer;
                     c->buffer_end = c->pb_buffer + len;
 
-                    codec->frame_number++;
                     if (len == 0) {
                         av_packet_unref(&pkt);
                         goto redo;
@@ -2531,9 +3284,8 @@ static int http_send_data(HTTPContext *c)
                 }
 
                 c->data_count += len;
-                update_datarate(&c->datarate, c->data_count);
-                if (c->stream)
-                    c->stream->bytes_served += len;
+                update_datarate(&c->datarate, c->data_count, connection_time(c));
+                add_bytes_served(c, len);
 
                 if (c->rtp_protocol == RTSP_LOWER_TRANSPORT_TCP) {
                     /* RTP packets are sent inside the RTSP TCP connection */
@@ -2608,9 +3360,8 @@ static int http_send_data(HTTPContext *c)
                 c->buffer_ptr += len;
 
                 c->data_count += len;
-                update_datarate(&c->datarate, c->data_count);
-                if (c->stream)
-                    c->stream->bytes_served += len;
+                update_datarate(&c->datarate, c->data_count, connection_time(c));
+                add_bytes_served(c, len);
                 break;
             }
         }
@@ -2637,6 +3388,15 @@ static int http_start_receive_data(HTTPContext *c)
         return AVERROR(EINVAL);
     }
 
+    if (c->stream->in_memory) {
+        /* the write index only counts the bytes received */
+        c->feed_fd = -1;
+        c->stream->feed_write_index = 0;
+        c->stream->feed_size = 0;
+        feed_cache_reset(c->stream);
+        goto done;
+    }
+
     /* open feed */
     fd = open(c->stream->feed_filename, O_RDWR);
     if (fd < 0) {
@@ -2671,7 +3431,9 @@ static int http_start_receive_data(HTTPContext *c)
                                         FFM_PACKET_SIZE);
     c->stream->feed_size = lseek(fd, 0, SEEK_END);
     lseek(fd, 0, SEEK_SET);
+    feed_cache_reset(c->stream);
 
+done:
     /* init buffer input */
     c->buffer_ptr = c->buffer;
     c->buffer_end = c->buffer + FFM_PACKET_SIZE;
@@ -2728,7 +3490,7 @@ static int http_receive_data(HTTPContext *c)
             c->chunk_size -= len;
             c->buffer_ptr += len;
             c->data_count += len;
-            update_datarate(&c->datarate, c->data_count);
+            update_datarate(&c->datarate, c->data_count, connection_time(c));
         }
     }
 
@@ -2744,7 +3506,17 @@ static int http_receive_data(HTTPContext *c)
         FFServerStream *feed = c->stream;
         /* a packet has been received : write it in the store, except
          * if header */
-        if (c->data_count > FFM_PACKET_SIZE) {
+        if (c->data_count > FFM_PACKET_SIZE && feed->in_memory) {
+            if (feed_cache_write_input(feed, c->buffer, FFM_PACKET_SIZE) < 0 ||
+                feed_cache_fill(feed) < 0)
+                goto fail;
+            wake_up_workers();
+            for(c1 = first_http_ctx; c1; c1 = c1->next) {
+                if (c1->state == HTTPSTATE_WAIT_FEED &&
+                    c1->stream->feed == c->stream->feed)
+                    c1->state = HTTPSTATE_SEND_DATA;
+            }
+        } else if (c->data_count > FFM_PACKET_SIZE) {
             /* XXX: use llseek or url_seek
              * XXX: Should probably fail? */
             if (lseek(c->feed_fd, feed->feed_write_index, SEEK_SET) == -1)
@@ -2772,7 +3544,9 @@ static int http_receive_data(HTTPContext *c)
                 goto fail;
             }
 
-            /* wake up any waiting connections */
+            /* share the new packets and wake up any waiting connections */
+            if (feed_cache_fill(feed) > 0)
+                wake_up_workers();
             for(c1 = first_http_ctx; c1; c1 = c1->next) {
                 if (c1->state == HTTPSTATE_WAIT_FEED &&
                     c1->stream->feed == c->stream->feed)
@@ -2823,6 +3597,11 @@ static int http_receive_data(HTTPContext *c)
 
             avformat_close_input(&s);
             av_freep(&pb);
+
+            /* the header is also the start of the data of in-memory feeds */
+            if (feed->in_memory &&
+                feed_cache_write_input(feed, c->buffer, FFM_PACKET_SIZE) < 0)
+                goto fail;
         }
         c->buffer_ptr = c->buffer;
     }
@@ -2830,8 +3609,12 @@ static int http_receive_data(HTTPContext *c)
     return 0;
  fail:
     c->stream->feed_opened = 0;
-    close(c->feed_fd);
+    if (c->feed_fd >= 0)
+        close(c->feed_fd);
+    c->feed_fd = -1;
     /* wake up any waiting connections to stop waiting for feed */
+    feed_cache_close(c->stream);
+    wake_up_workers();
     for(c1 = first_http_ctx; c1; c1 = c1->next) {
         if (c1->state == HTTPSTATE_WAIT_FEED &&
             c1->stream->feed == c->stream->feed)
@@ -3366,7 +4149,9 @@ static HTTPContext *rtp_new_connection(struct sockaddr_in *from_addr,
     c->buffer = av_malloc(c->buffer_size);
     if (!c->buffer)
         goto fail;
+    ff_mutex_lock(&stats_lock);
     nb_connections++;
+    ff_mutex_unlock(&stats_lock);
     c->stream = stream;
     av_strlcpy(c->session_id, session_id, sizeof(c->session_id));
     c->state = HTTPSTATE_READY;
@@ -3391,7 +4176,9 @@ static HTTPContext *rtp_new_connection(struct sockaddr_in *from_addr,
     av_strlcpy(c->protocol, "RTP/", sizeof(c->protocol));
     av_strlcat(c->protocol, proto_str, sizeof(c->protocol));
 
+    ff_mutex_lock(&stats_lock);
     current_bandwidth += stream->bandwidth;
+    ff_mutex_unlock(&stats_lock);
 
     c->next = first_http_ctx;
     first_http_ctx = c;
@@ -3772,6 +4559,8 @@ static int build_feed_streams(void)
 
     /* create feed files if needed */
     for(feed = config.first_feed; feed; feed = feed->next_feed) {
+        if (feed->in_memory)
+            continue;
 
         if (avio_check(feed->feed_filename, AVIO_FLAG_READ) > 0) {
             AVFormatContext *s = NULL;
@@ -3923,6 +4712,11 @@ static void compute_bandwidth(void)
     }
 }
 
+static void handle_sigterm(int sig)
+{
+    received_sigterm = sig;
+}
+
 static void handle_child_exit(int sig)
 {
     pid_t pid;
@@ -3977,6 +4771,7 @@ static const OptionDef options[] = {
 int main(int argc, char **argv)
 {
     struct sigaction sigact = { { 0 } };
+    FFServerStream *feed;
     int cfg_parsed;
     int ret = EXIT_FAILURE;
 
@@ -3997,6 +4792,9 @@ int main(int argc, char **argv)
 
     av_lfg_init(&random_state, av_get_random_seed());
 
+    ff_mutex_init(&stats_lock, NULL);
+    ff_mutex_init(&log_lock, NULL);
+
     sigact.sa_handler = handle_child_exit;
     sigact.sa_flags = SA_NOCLDSTOP | SA_RESTART;
     sigaction(SIGCHLD, &sigact, 0);
@@ -4023,10 +4821,19 @@ int main(int argc, char **argv)
         goto bail;
     }
 
+    for (feed = config.first_feed; feed; feed = feed->next_feed) {
+        if (feed_cache_init(feed) < 0) {
+            http_log("Could not allocate feed cache\n");
+            goto bail;
+        }
+    }
+
     compute_bandwidth();
 
     /* signal init */
     signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT,  handle_sigterm);
+    signal(SIGTERM, handle_sigterm);
 
     if (http_server() < 0) {
         http_log("Could not start server\n");
@@ -659,6 +659,11 @@ static int ffserver_parse_config_global(FFServerConfig *config, const char *cmd,
                   "MaxHTTPConnections(%d)\n", config->nb_max_connections,
                   config->nb_max_http_connections);
         }
+    } else if (!av_strcasecmp(cmd, "WorkerThreads")) {
+        ffserver_get_arg(arg, sizeof(arg), p);
+        ffserver_set_int_param(&val, arg, 0, 0, 256, config,
+                "Invalid WorkerThreads: '%s'\n", arg);
+        config->nb_workers = val;
     } else if (!av_strcasecmp(cmd, "MaxBandwidth")) {
         int64_t llval;
         char *tailp;
@@ -759,6 +764,8 @@ static int ffserver_parse_config_feed(FFServerConfig *config, const char *cmd,
                     "Use Truncate alone with no arguments.\n");
             feed->truncate = strtod(arg, NULL);
         }
+    } else if (!av_strcasecmp(cmd, "InMemory")) {
+        feed->in_memory = 1;
     } else if (!av_strcasecmp(cmd, "FileMaxSize")) {
         char *p1;
         double fsize;
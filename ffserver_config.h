@@ -86,11 +86,14 @@ typedef struct FFServerStream {
     int is_feed;                  /* true if it is a feed */
     int readonly;                 /* True if writing is prohibited to the file */
     int truncate;                 /* True if feeder connection truncate the feed file */
+    int in_memory;                /* True if the feed is only kept in memory */
     int conns_served;
     int64_t bytes_served;
     int64_t feed_max_size;        /* maximum storage size, zero means unlimited */
     int64_t feed_write_index;     /* current write position in feed (it wraps around) */
     int64_t feed_size;            /* current size of feed */
+    struct FFServerFeedCache *cache; /* packets read from the feed, shared by
+                                        the connections streaming from it */
     struct FFServerStream *next_feed;
 } FFServerStream;
 
@@ -101,6 +104,7 @@ typedef struct FFServerConfig {
     unsigned int nb_max_http_connections;
     unsigned int nb_max_connections;
     uint64_t max_bandwidth;
+    int nb_workers;               /* number of threads serving the live streams */
     int debug;
     char logfilename[1024];
     struct sockaddr_in http_addr;
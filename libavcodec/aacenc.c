@@ -506,6 +506,120 @@ static void copy_input_samples(AACEncContext *s, const AVFrame *frame)
     }
 }
 
+/**
+ * Run the quantizer and stereo tool search for one channel element.
+ * Each element works in its own context copy, so elements can be searched
+ * concurrently and the result does not depend on the thread count.
+ */
+static int search_element(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    AACEncContext *s = avctx->priv_data;
+    AACEncContext *el = &s->el_ctx[jobnr];
+    ChannelElement *cpe = &s->cpe[jobnr];
+    SingleChannelElement *sce;
+    FFPsyWindowInfo *wi = arg;
+    int i, ch, w, start_ch = 0;
+    int tag   = s->chan_map[jobnr+1];
+    int chans = tag == TYPE_CPE ? 2 : 1;
+
+    for (i = 0; i < jobnr; i++)
+        start_ch += s->chan_map[i+1] == TYPE_CPE ? 2 : 1;
+    wi += start_ch;
+
+    el->is_mode = el->tns_mode = el->pred_mode = 0;
+    cpe->common_window = 0;
+    memset(cpe->is_mask, 0, sizeof(cpe->is_mask));
+    memset(cpe->ms_mask, 0, sizeof(cpe->ms_mask));
+    for (ch = 0; ch < chans; ch++) {
+        sce = &cpe->ch[ch];
+        sce->ics.predictor_present = 0;
+        sce->ics.ltp.present = 0;
+        memset(sce->ics.ltp.used, 0, sizeof(sce->ics.ltp.used));
+        memset(sce->ics.prediction_used, 0, sizeof(sce->ics.prediction_used));
+        memset(&sce->tns, 0, sizeof(TemporalNoiseShaping));
+        for (w = 0; w < 128; w++)
+            if (sce->band_type[w] > RESERVED_BT)
+                sce->band_type[w] = 0;
+    }
+    el->cur_type = tag;
+    for (ch = 0; ch < chans; ch++) {
+        el->cur_channel = start_ch + ch;
+        if (el->options.pns && el->coder->mark_pns)
+            el->coder->mark_pns(el, avctx, &cpe->ch[ch]);
+        el->coder->search_for_quantizers(avctx, el, &cpe->ch[ch], el->lambda);
+    }
+    if (chans > 1
+        && wi[0].window_type[0] == wi[1].window_type[0]
+        && wi[0].window_shape   == wi[1].window_shape) {
+
+        cpe->common_window = 1;
+        for (w = 0; w < wi[0].num_windows; w++) {
+            if (wi[0].grouping[w] != wi[1].grouping[w]) {
+                cpe->common_window = 0;
+                break;
+            }
+        }
+    }
+    for (ch = 0; ch < chans; ch++) { /* TNS and PNS */
+        sce = &cpe->ch[ch];
+        el->cur_channel = start_ch + ch;
+        if (el->options.tns && el->coder->search_for_tns)
+            el->coder->search_for_tns(el, sce);
+        if (el->options.tns && el->coder->apply_tns_filt)
+            el->coder->apply_tns_filt(el, sce);
+        if (sce->tns.present)
+            el->tns_mode = 1;
+        if (el->options.pns && el->coder->search_for_pns)
+            el->coder->search_for_pns(el, avctx, sce);
+    }
+    el->cur_channel = start_ch;
+    if (el->options.intensity_stereo) { /* Intensity Stereo */
+        if (el->coder->search_for_is)
+            el->coder->search_for_is(el, avctx, cpe);
+        if (cpe->is_mode) el->is_mode = 1;
+        apply_intensity_stereo(cpe);
+    }
+    if (el->options.pred) { /* Prediction */
+        for (ch = 0; ch < chans; ch++) {
+            sce = &cpe->ch[ch];
+            el->cur_channel = start_ch + ch;
+            if (el->options.pred && el->coder->search_for_pred)
+                el->coder->search_for_pred(el, sce);
+            if (cpe->ch[ch].ics.predictor_present) el->pred_mode = 1;
+        }
+        if (el->coder->adjust_common_pred)
+            el->coder->adjust_common_pred(el, cpe);
+        for (ch = 0; ch < chans; ch++) {
+            sce = &cpe->ch[ch];
+            el->cur_channel = start_ch + ch;
+            if (el->options.pred && el->coder->apply_main_pred)
+                el->coder->apply_main_pred(el, sce);
+        }
+        el->cur_channel = start_ch;
+    }
+    if (el->options.mid_side) { /* Mid/Side stereo */
+        if (el->options.mid_side == -1 && el->coder->search_for_ms)
+            el->coder->search_for_ms(el, cpe);
+        else if (cpe->common_window)
+            memset(cpe->ms_mask, 1, sizeof(cpe->ms_mask));
+        apply_mid_side_stereo(cpe);
+    }
+    adjust_frame_information(cpe, chans);
+    if (el->options.ltp) { /* LTP */
+        for (ch = 0; ch < chans; ch++) {
+            sce = &cpe->ch[ch];
+            el->cur_channel = start_ch + ch;
+            if (el->coder->search_for_ltp)
+                el->coder->search_for_ltp(el, sce, cpe->common_window);
+            if (sce->ics.ltp.present) el->pred_mode = 1;
+        }
+        el->cur_channel = start_ch;
+        if (el->coder->adjust_common_ltp)
+            el->coder->adjust_common_ltp(el, cpe);
+    }
+    return 0;
+}
+
 static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                             const AVFrame *frame, int *got_packet_ptr)
 {
@@ -644,27 +758,13 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
         memset(chan_el_counter, 0, sizeof(chan_el_counter));
         for (i = 0; i < s->chan_map[0]; i++) {
             FFPsyWindowInfo* wi = windows + start_ch;
+            AACEncContext *el = &s->el_ctx[i];
             const float *coeffs[2];
             tag      = s->chan_map[i+1];
             chans    = tag == TYPE_CPE ? 2 : 1;
             cpe      = &s->cpe[i];
-            cpe->common_window = 0;
-            memset(cpe->is_mask, 0, sizeof(cpe->is_mask));
-            memset(cpe->ms_mask, 0, sizeof(cpe->ms_mask));
-            put_bits(&s->pb, 3, tag);
-            put_bits(&s->pb, 4, chan_el_counter[tag]++);
-            for (ch = 0; ch < chans; ch++) {
-                sce = &cpe->ch[ch];
-                coeffs[ch] = sce->coeffs;
-                sce->ics.predictor_present = 0;
-                sce->ics.ltp.present = 0;
-                memset(sce->ics.ltp.used, 0, sizeof(sce->ics.ltp.used));
-                memset(sce->ics.prediction_used, 0, sizeof(sce->ics.prediction_used));
-                memset(&sce->tns, 0, sizeof(TemporalNoiseShaping));
-                for (w = 0; w < 128; w++)
-                    if (sce->band_type[w] > RESERVED_BT)
-                        sce->band_type[w] = 0;
-            }
+            for (ch = 0; ch < chans; ch++)
+                coeffs[ch] = cpe->ch[ch].coeffs;
             s->psy.bitres.alloc = -1;
             s->psy.bitres.bits = s->last_frame_pb_count / s->channels;
             s->psy.model->analyze(&s->psy, start_ch, coeffs, wi);
@@ -674,82 +774,25 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                     * (s->lambda / (avctx->global_quality ? avctx->global_quality : 120));
                 s->psy.bitres.alloc /= chans;
             }
-            s->cur_type = tag;
-            for (ch = 0; ch < chans; ch++) {
-                s->cur_channel = start_ch + ch;
-                if (s->options.pns && s->coder->mark_pns)
-                    s->coder->mark_pns(s, avctx, &cpe->ch[ch]);
-                s->coder->search_for_quantizers(avctx, s, &cpe->ch[ch], s->lambda);
-            }
-            if (chans > 1
-                && wi[0].window_type[0] == wi[1].window_type[0]
-                && wi[0].window_shape   == wi[1].window_shape) {
-
-                cpe->common_window = 1;
-                for (w = 0; w < wi[0].num_windows; w++) {
-                    if (wi[0].grouping[w] != wi[1].grouping[w]) {
-                        cpe->common_window = 0;
-                        break;
-                    }
-                }
-            }
-            for (ch = 0; ch < chans; ch++) { /* TNS and PNS */
-                sce = &cpe->ch[ch];
-                s->cur_channel = start_ch + ch;
-                if (s->options.tns && s->coder->search_for_tns)
-                    s->coder->search_for_tns(s, sce);
-                if (s->options.tns && s->coder->apply_tns_filt)
-                    s->coder->apply_tns_filt(s, sce);
-                if (sce->tns.present)
-                    tns_mode = 1;
-                if (s->options.pns && s->coder->search_for_pns)
-                    s->coder->search_for_pns(s, avctx, sce);
-            }
-            s->cur_channel = start_ch;
-            if (s->options.intensity_stereo) { /* Intensity Stereo */
-                if (s->coder->search_for_is)
-                    s->coder->search_for_is(s, avctx, cpe);
-                if (cpe->is_mode) is_mode = 1;
-                apply_intensity_stereo(cpe);
-            }
-            if (s->options.pred) { /* Prediction */
-                for (ch = 0; ch < chans; ch++) {
-                    sce = &cpe->ch[ch];
-                    s->cur_channel = start_ch + ch;
-                    if (s->options.pred && s->coder->search_for_pred)
-                        s->coder->search_for_pred(s, sce);
-                    if (cpe->ch[ch].ics.predictor_present) pred_mode = 1;
-                }
-                if (s->coder->adjust_common_pred)
-                    s->coder->adjust_common_pred(s, cpe);
-                for (ch = 0; ch < chans; ch++) {
-                    sce = &cpe->ch[ch];
-                    s->cur_channel = start_ch + ch;
-                    if (s->options.pred && s->coder->apply_main_pred)
-                        s->coder->apply_main_pred(s, sce);
-                }
-                s->cur_channel = start_ch;
-            }
-            if (s->options.mid_side) { /* Mid/Side stereo */
-                if (s->options.mid_side == -1 && s->coder->search_for_ms)
-                    s->coder->search_for_ms(s, cpe);
-                else if (cpe->common_window)
-                    memset(cpe->ms_mask, 1, sizeof(cpe->ms_mask));
-                apply_mid_side_stereo(cpe);
-            }
-            adjust_frame_information(cpe, chans);
-            if (s->options.ltp) { /* LTP */
-                for (ch = 0; ch < chans; ch++) {
-                    sce = &cpe->ch[ch];
-                    s->cur_channel = start_ch + ch;
-                    if (s->coder->search_for_ltp)
-                        s->coder->search_for_ltp(s, sce, cpe->common_window);
-                    if (sce->ics.ltp.present) pred_mode = 1;
-                }
-                s->cur_channel = start_ch;
-                if (s->coder->adjust_common_ltp)
-                    s->coder->adjust_common_ltp(s, cpe);
-            }
+            el->psy.bitres = s->psy.bitres;
+            el->lambda     = s->lambda;
+            start_ch += chans;
+        }
+        /* Once psy has split the bits, the elements are searched independently */
+        avctx->execute2(avctx, search_element, windows, NULL, s->chan_map[0]);
+        /* the bandwidth picked by the coder is used by psy from now on */
+        s->psy.cutoff = s->el_ctx[s->chan_map[0] - 1].psy.cutoff;
+        start_ch = 0;
+        for (i = 0; i < s->chan_map[0]; i++) {
+            AACEncContext *el = &s->el_ctx[i];
+            tag      = s->chan_map[i+1];
+            chans    = tag == TYPE_CPE ? 2 : 1;
+            cpe      = &s->cpe[i];
+            is_mode   |= el->is_mode;
+            tns_mode  |= el->tns_mode;
+            pred_mode |= el->pred_mode;
+            put_bits(&s->pb, 3, tag);
+            put_bits(&s->pb, 4, chan_el_counter[tag]++);
             if (chans == 2) {
                 put_bits(&s->pb, 1, cpe->common_window);
                 if (cpe->common_window) {
@@ -855,6 +898,7 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 static av_cold int aac_encode_end(AVCodecContext *avctx)
 {
     AACEncContext *s = avctx->priv_data;
+    int i;
 
     av_log(avctx, AV_LOG_INFO, "Qavg: %.3f\n", s->lambda_sum / s->lambda_count);
 
@@ -862,6 +906,10 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
     ff_mdct_end(&s->mdct128);
     ff_psy_end(&s->psy);
     ff_lpc_end(&s->lpc);
+    if (s->el_ctx)
+        for (i = 0; i < s->chan_map[0]; i++)
+            ff_lpc_end(&s->el_ctx[i].lpc);
+    av_freep(&s->el_ctx);
     if (s->psypp)
         ff_psy_preprocess_end(s->psypp);
     av_freep(&s->buffer.samples);
@@ -908,6 +956,29 @@ alloc_fail:
     return AVERROR(ENOMEM);
 }
 
+static av_cold int alloc_element_contexts(AVCodecContext *avctx, AACEncContext *s)
+{
+    int i, ret;
+
+    s->el_ctx = av_mallocz_array(s->chan_map[0], sizeof(*s->el_ctx));
+    if (!s->el_ctx)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < s->chan_map[0]; i++) {
+        AACEncContext *el = &s->el_ctx[i];
+        memcpy(el, s, sizeof(*el));
+        el->el_ctx = NULL;
+        /* Give each element its own PNS noise sequence, the first one
+         * keeps the sequence a single element stream always had. */
+        av_lfg_init(&el->lfg, 0x72adca55 + i);
+        if ((ret = ff_lpc_init(&el->lpc, 2*avctx->frame_size, TNS_MAX_ORDER,
+                               FF_LPC_TYPE_LEVINSON)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
 static av_cold void aac_encode_init_tables(void)
 {
     ff_aac_tableinit();
@@ -1041,6 +1112,9 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
 
     ff_af_queue_init(avctx, &s->afq);
 
+    if ((ret = alloc_element_contexts(avctx, s)) < 0)
+        goto fail;
+
     return 0;
 fail:
     aac_encode_end(avctx);
@@ -1086,7 +1160,8 @@ AVCodec ff_aac_encoder = {
     .defaults       = aac_encode_defaults,
     .supported_samplerates = mpeg4audio_sample_rates,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE,
-    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY,
+    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_FLTP,
                                                      AV_SAMPLE_FMT_NONE },
     .priv_class     = &aacenc_class,
@@ -122,6 +122,9 @@ typedef struct AACEncContext {
     int lambda_count;                            ///< count(lambda), for Qvg reporting
     enum RawDataBlockType cur_type;              ///< channel group type cur_channel belongs to
 
+    struct AACEncContext *el_ctx;                ///< per channel element coder contexts, searched in parallel
+    int is_mode, tns_mode, pred_mode;            ///< tools used by the element, merged after the search
+
     AudioFrameQueue afq;
     DECLARE_ALIGNED(16, int,   qcoefs)[96];      ///< quantized coefficients
     DECLARE_ALIGNED(32, float, scoefs)[1024];    ///< scaled coefficients
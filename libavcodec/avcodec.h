@@ -1514,7 +1514,14 @@ enum AVPacketSideDataType {
      * should be associated with a video stream and containts data in the form
      * of the AVMasteringDisplayMetadata struct.
      */
-    AV_PKT_DATA_MASTERING_DISPLAY_METADATA
+    AV_PKT_DATA_MASTERING_DISPLAY_METADATA,
+
+    /**
+     * Timestamps of the processing stages the packet went through, in the
+     * form of the AVLatencyRecord struct defined in libavutil/latency.h.
+     * Decoders copy it to the frames decoded from the packet.
+     */
+    AV_PKT_DATA_LATENCY
 };
 
 #define AV_PKT_DATA_QUALITY_FACTOR AV_PKT_DATA_QUALITY_STATS //DEPRECATED
@@ -2060,11 +2060,77 @@ static void set_filter_mode(DCACoreDecoder *s, int mode)
     }
 }
 
+typedef struct DCAFilterJob {
+    DCACoreDecoder  *s;
+    void            *output_samples[DCA_SPEAKER_COUNT];
+    const void      *filter_coeff;
+    int             spkr[DCA_CHANNELS];
+    int             x96_synth;
+    int             x96_nchannels;
+} DCAFilterJob;
+
+static int map_prm_channels(DCACoreDecoder *s, DCAFilterJob *job)
+{
+    int ch;
+
+    for (ch = 0; ch < s->nchannels; ch++) {
+        // Map this primary channel to speaker
+        if ((job->spkr[ch] = map_prm_ch_to_spkr(s, ch)) < 0)
+            return AVERROR(EINVAL);
+    }
+
+    return 0;
+}
+
+// Primary channels have independent filter history, so filter bank
+// reconstruction can run for each of them in parallel
+static int filter_channel_fixed(AVCodecContext *avctx, void *arg, int ch, int threadnr)
+{
+    DCAFilterJob *job = arg;
+    DCACoreDecoder *s = job->s;
+
+    s->dcadsp->sub_qmf_fixed[job->x96_synth](
+        &s->synth,
+        &s->dcadct,
+        job->output_samples[job->spkr[ch]],
+        s->subband_samples[ch],
+        ch < job->x96_nchannels ? s->x96_subband_samples[ch] : NULL,
+        s->dcadsp_data[ch].u.fix.hist1,
+        &s->dcadsp_data[ch].offset,
+        s->dcadsp_data[ch].u.fix.hist2,
+        job->filter_coeff,
+        s->npcmblocks);
+
+    return 0;
+}
+
+static int filter_channel_float(AVCodecContext *avctx, void *arg, int ch, int threadnr)
+{
+    DCAFilterJob *job = arg;
+    DCACoreDecoder *s = job->s;
+
+    s->dcadsp->sub_qmf_float[job->x96_synth](
+        &s->synth,
+        &s->imdct[job->x96_synth],
+        job->output_samples[job->spkr[ch]],
+        s->subband_samples[ch],
+        ch < job->x96_nchannels ? s->x96_subband_samples[ch] : NULL,
+        s->dcadsp_data[ch].u.flt.hist1,
+        &s->dcadsp_data[ch].offset,
+        s->dcadsp_data[ch].u.flt.hist2,
+        job->filter_coeff,
+        s->npcmblocks,
+        1.0f / (1 << (17 - job->x96_synth)));
+
+    return 0;
+}
+
 int ff_dca_core_filter_fixed(DCACoreDecoder *s, int x96_synth)
 {
-    int n, ch, spkr, nsamples, x96_nchannels = 0;
+    int n, ret, spkr, nsamples, x96_nchannels = 0;
     const int32_t *filter_coeff;
     int32_t *ptr;
+    DCAFilterJob job;
 
     // Externally set x96_synth flag implies that X96 synthesis should be
     // enabled, yet actual X96 subband data should be discarded. This is a
@@ -2108,25 +2174,17 @@ int ff_dca_core_filter_fixed(DCACoreDecoder *s, int x96_synth)
         filter_coeff = ff_dca_fir_32bands_nonperfect_fixed;
 
     // Filter primary channels
-    for (ch = 0; ch < s->nchannels; ch++) {
-        // Map this primary channel to speaker
-        spkr = map_prm_ch_to_spkr(s, ch);
-        if (spkr < 0)
-            return AVERROR(EINVAL);
+    if ((ret = map_prm_channels(s, &job)) < 0)
+        return ret;
 
-        // Filter bank reconstruction
-        s->dcadsp->sub_qmf_fixed[x96_synth](
-            &s->synth,
-            &s->dcadct,
-            s->output_samples[spkr],
-            s->subband_samples[ch],
-            ch < x96_nchannels ? s->x96_subband_samples[ch] : NULL,
-            s->dcadsp_data[ch].u.fix.hist1,
-            &s->dcadsp_data[ch].offset,
-            s->dcadsp_data[ch].u.fix.hist2,
-            filter_coeff,
-            s->npcmblocks);
-    }
+    job.s = s;
+    job.filter_coeff = filter_coeff;
+    job.x96_synth = x96_synth;
+    job.x96_nchannels = x96_nchannels;
+    for (spkr = 0; spkr < DCA_SPEAKER_COUNT; spkr++)
+        job.output_samples[spkr] = s->output_samples[spkr];
+
+    s->avctx->execute2(s->avctx, filter_channel_fixed, &job, NULL, s->nchannels);
 
     // Filter LFE channel
     if (s->lfe_present) {
@@ -2268,6 +2326,7 @@ static int filter_frame_float(DCACoreDecoder *s, AVFrame *frame)
     int i, n, ch, ret, spkr, nsamples, nchannels;
     float *output_samples[DCA_SPEAKER_COUNT] = { NULL }, *ptr;
     const float *filter_coeff;
+    DCAFilterJob job;
 
     if (s->ext_audio_mask & (DCA_CSS_X96 | DCA_EXSS_X96)) {
         x96_nchannels = s->x96_nchannels;
@@ -2317,26 +2376,17 @@ static int filter_frame_float(DCACoreDecoder *s, AVFrame *frame)
         filter_coeff = ff_dca_fir_32bands_nonperfect;
 
     // Filter primary channels
-    for (ch = 0; ch < s->nchannels; ch++) {
-        // Map this primary channel to speaker
-        spkr = map_prm_ch_to_spkr(s, ch);
-        if (spkr < 0)
-            return AVERROR(EINVAL);
+    if ((ret = map_prm_channels(s, &job)) < 0)
+        return ret;
 
-        // Filter bank reconstruction
-        s->dcadsp->sub_qmf_float[x96_synth](
-            &s->synth,
-            &s->imdct[x96_synth],
-            output_samples[spkr],
-            s->subband_samples[ch],
-            ch < x96_nchannels ? s->x96_subband_samples[ch] : NULL,
-            s->dcadsp_data[ch].u.flt.hist1,
-            &s->dcadsp_data[ch].offset,
-            s->dcadsp_data[ch].u.flt.hist2,
-            filter_coeff,
-            s->npcmblocks,
-            1.0f / (1 << (17 - x96_synth)));
-    }
+    job.s = s;
+    job.filter_coeff = filter_coeff;
+    job.x96_synth = x96_synth;
+    job.x96_nchannels = x96_nchannels;
+    for (spkr = 0; spkr < DCA_SPEAKER_COUNT; spkr++)
+        job.output_samples[spkr] = output_samples[spkr];
+
+    avctx->execute2(avctx, filter_channel_float, &job, NULL, s->nchannels);
 
     // Filter LFE channel
     if (s->lfe_present) {
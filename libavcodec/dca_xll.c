@@ -439,17 +439,18 @@ static int chs_alloc_lsb_band_data(DCAXllDecoder *s, DCAXllChSet *c)
     return 0;
 }
 
-static int chs_parse_band_data(DCAXllDecoder *s, DCAXllChSet *c, int band, int seg, int band_data_end)
+static int chs_parse_band_data(DCAXllDecoder *s, DCAXllChSet *c, GetBitContext *gb,
+                               int band, int seg, int band_data_end)
 {
     DCAXllBand *b = &c->bands[band];
     int i, j, k;
 
     // Start unpacking MSB portion of the segment
-    if (!(seg && get_bits1(&s->gb))) {
+    if (!(seg && get_bits1(gb))) {
         // Unpack segment type
         // 0 - distinct coding parameters for each channel
         // 1 - common coding parameters for all channels
-        c->seg_common = get_bits1(&s->gb);
+        c->seg_common = get_bits1(gb);
 
         // Determine number of coding parameters encoded in segment
         k = c->seg_common ? 1 : c->nchannels;
@@ -458,12 +459,12 @@ static int chs_parse_band_data(DCAXllDecoder *s, DCAXllChSet *c, int band, int s
         for (i = 0; i < k; i++) {
             // Unpack Rice coding flag
             // 0 - linear code, 1 - Rice code
-            c->rice_code_flag[i] = get_bits1(&s->gb);
+            c->rice_code_flag[i] = get_bits1(gb);
             // Unpack Hybrid Rice coding flag
             // 0 - Rice code, 1 - Hybrid Rice code
-            if (!c->seg_common && c->rice_code_flag[i] && get_bits1(&s->gb))
+            if (!c->seg_common && c->rice_code_flag[i] && get_bits1(gb))
                 // Unpack binary code length for isolated samples
-                c->bitalloc_hybrid_linear[i] = get_bits(&s->gb, c->nabits) + 1;
+                c->bitalloc_hybrid_linear[i] = get_bits(gb, c->nabits) + 1;
             else
                 // 0 indicates no Hybrid Rice coding
                 c->bitalloc_hybrid_linear[i] = 0;
@@ -473,7 +474,7 @@ static int chs_parse_band_data(DCAXllDecoder *s, DCAXllChSet *c, int band, int s
         for (i = 0; i < k; i++) {
             if (seg == 0) {
                 // Unpack coding parameter for part A of segment 0
-                c->bitalloc_part_a[i] = get_bits(&s->gb, c->nabits);
+                c->bitalloc_part_a[i] = get_bits(gb, c->nabits);
 
                 // Adjust for the linear code
                 if (!c->rice_code_flag[i] && c->bitalloc_part_a[i])
@@ -489,7 +490,7 @@ static int chs_parse_band_data(DCAXllDecoder *s, DCAXllChSet *c, int band, int s
             }
 
             // Unpack coding parameter for part B of segment
-            c->bitalloc_part_b[i] = get_bits(&s->gb, c->nabits);
+            c->bitalloc_part_b[i] = get_bits(gb, c->nabits);
 
             // Adjust for the linear code
             if (!c->rice_code_flag[i] && c->bitalloc_part_b[i])
@@ -510,35 +511,35 @@ static int chs_parse_band_data(DCAXllDecoder *s, DCAXllChSet *c, int band, int s
         part_b = part_a + c->nsamples_part_a[k];
         nsamples_part_b = s->nsegsamples - c->nsamples_part_a[k];
 
-        if (get_bits_left(&s->gb) < 0)
+        if (get_bits_left(gb) < 0)
             return AVERROR_INVALIDDATA;
 
         if (!c->rice_code_flag[k]) {
             // Linear codes
             // Unpack all residuals of part A of segment 0
-            get_linear_array(&s->gb, part_a, c->nsamples_part_a[k],
-                             c->bitalloc_part_a[k]);
+            get_linear_array(gb, part_a, c->nsamples_part_a[k],
+                         c->bitalloc_part_a[k]);
 
             // Unpack all residuals of part B of segment 0 and others
-            get_linear_array(&s->gb, part_b, nsamples_part_b,
-                             c->bitalloc_part_b[k]);
+            get_linear_array(gb, part_b, nsamples_part_b,
+                         c->bitalloc_part_b[k]);
         } else {
             // Rice codes
             // Unpack all residuals of part A of segment 0
-            get_rice_array(&s->gb, part_a, c->nsamples_part_a[k],
-                           c->bitalloc_part_a[k]);
+            get_rice_array(gb, part_a, c->nsamples_part_a[k],
+                       c->bitalloc_part_a[k]);
 
             if (c->bitalloc_hybrid_linear[k]) {
                 // Hybrid Rice codes
                 // Unpack the number of isolated samples
-                int nisosamples = get_bits(&s->gb, s->nsegsamples_log2);
+                int nisosamples = get_bits(gb, s->nsegsamples_log2);
 
                 // Set all locations to 0
                 memset(part_b, 0, sizeof(*part_b) * nsamples_part_b);
 
                 // Extract the locations of isolated samples and flag by -1
                 for (j = 0; j < nisosamples; j++) {
-                    int loc = get_bits(&s->gb, s->nsegsamples_log2);
+                    int loc = get_bits(gb, s->nsegsamples_log2);
                     if (loc >= nsamples_part_b) {
                         av_log(s->avctx, AV_LOG_ERROR, "Invalid isolated sample location\n");
                         return AVERROR_INVALIDDATA;
@@ -549,30 +550,30 @@ static int chs_parse_band_data(DCAXllDecoder *s, DCAXllChSet *c, int band, int s
                 // Unpack all residuals of part B of segment 0 and others
                 for (j = 0; j < nsamples_part_b; j++) {
                     if (part_b[j])
-                        part_b[j] = get_linear(&s->gb, c->bitalloc_hybrid_linear[k]);
+                        part_b[j] = get_linear(gb, c->bitalloc_hybrid_linear[k]);
                     else
-                        part_b[j] = get_rice(&s->gb, c->bitalloc_part_b[k]);
+                        part_b[j] = get_rice(gb, c->bitalloc_part_b[k]);
                 }
             } else {
                 // Rice codes
                 // Unpack all residuals of part B of segment 0 and others
-                get_rice_array(&s->gb, part_b, nsamples_part_b, c->bitalloc_part_b[k]);
+                get_rice_array(gb, part_b, nsamples_part_b, c->bitalloc_part_b[k]);
             }
         }
     }
 
     // Unpack decimator history for frequency band 1
     if (seg == 0 && band == 1) {
-        int nbits = get_bits(&s->gb, 5) + 1;
+        int nbits = get_bits(gb, 5) + 1;
         for (i = 0; i < c->nchannels; i++)
             for (j = 1; j < DCA_XLL_DECI_HISTORY_MAX; j++)
-                c->deci_history[i][j] = get_sbits_long(&s->gb, nbits);
+                c->deci_history[i][j] = get_sbits_long(gb, nbits);
     }
 
     // Start unpacking LSB portion of the segment
     if (b->lsb_section_size) {
         // Skip to the start of LSB portion
-        if (ff_dca_seek_bits(&s->gb, band_data_end - b->lsb_section_size * 8)) {
+        if (ff_dca_seek_bits(gb, band_data_end - b->lsb_section_size * 8)) {
             av_log(s->avctx, AV_LOG_ERROR, "Read past end of XLL band data\n");
             return AVERROR_INVALIDDATA;
         }
@@ -580,7 +581,7 @@ static int chs_parse_band_data(DCAXllDecoder *s, DCAXllChSet *c, int band, int s
         // Unpack all LSB parts of residuals of this segment
         for (i = 0; i < c->nchannels; i++) {
             if (b->nscalablelsbs[i]) {
-                get_array(&s->gb,
+                get_array(gb,
                           b->lsb_sample_buffer[i] + seg * s->nsegsamples,
                           s->nsegsamples, b->nscalablelsbs[i]);
             }
@@ -588,7 +589,7 @@ static int chs_parse_band_data(DCAXllDecoder *s, DCAXllChSet *c, int band, int s
     }
 
     // Skip to the end of band data
-    if (ff_dca_seek_bits(&s->gb, band_data_end)) {
+    if (ff_dca_seek_bits(gb, band_data_end)) {
         av_log(s->avctx, AV_LOG_ERROR, "Read past end of XLL band data\n");
         return AVERROR_INVALIDDATA;
     }
@@ -624,43 +625,47 @@ static av_cold void chs_clear_band_data(DCAXllDecoder *s, DCAXllChSet *c, int ba
     }
 }
 
-static void chs_filter_band_data(DCAXllDecoder *s, DCAXllChSet *c, int band)
+static void chs_inverse_prediction(DCAXllDecoder *s, DCAXllChSet *c, int band, int ch)
 {
     DCAXllBand *b = &c->bands[band];
+    int32_t *buf = b->msb_sample_buffer[ch];
+    int order = b->adapt_pred_order[ch];
     int nsamples = s->nframesamples;
-    int i, j, k;
-
-    // Inverse adaptive or fixed prediction
-    for (i = 0; i < c->nchannels; i++) {
-        int32_t *buf = b->msb_sample_buffer[i];
-        int order = b->adapt_pred_order[i];
-        if (order > 0) {
-            int coeff[DCA_XLL_ADAPT_PRED_ORDER_MAX];
-            // Conversion from reflection coefficients to direct form coefficients
-            for (j = 0; j < order; j++) {
-                int rc = b->adapt_refl_coeff[i][j];
-                for (k = 0; k < (j + 1) / 2; k++) {
-                    int tmp1 = coeff[    k    ];
-                    int tmp2 = coeff[j - k - 1];
-                    coeff[    k    ] = tmp1 + mul16(rc, tmp2);
-                    coeff[j - k - 1] = tmp2 + mul16(rc, tmp1);
-                }
-                coeff[j] = rc;
+    int j, k;
+
+    if (order > 0) {
+        int coeff[DCA_XLL_ADAPT_PRED_ORDER_MAX];
+        // Conversion from reflection coefficients to direct form coefficients
+        for (j = 0; j < order; j++) {
+            int rc = b->adapt_refl_coeff[ch][j];
+            for (k = 0; k < (j + 1) / 2; k++) {
+                int tmp1 = coeff[    k    ];
+                int tmp2 = coeff[j - k - 1];
+                coeff[    k    ] = tmp1 + mul16(rc, tmp2);
+                coeff[j - k - 1] = tmp2 + mul16(rc, tmp1);
             }
-            // Inverse adaptive prediction
-            for (j = 0; j < nsamples - order; j++) {
-                int64_t err = 0;
-                for (k = 0; k < order; k++)
-                    err += (int64_t)buf[j + k] * coeff[order - k - 1];
-                buf[j + k] -= clip23(norm16(err));
-            }
-        } else {
-            // Inverse fixed coefficient prediction
-            for (j = 0; j < b->fixed_pred_order[i]; j++)
-                for (k = 1; k < nsamples; k++)
-                    buf[k] += buf[k - 1];
+            coeff[j] = rc;
+        }
+        // Inverse adaptive prediction
+        for (j = 0; j < nsamples - order; j++) {
+            int64_t err = 0;
+            for (k = 0; k < order; k++)
+                err += (int64_t)buf[j + k] * coeff[order - k - 1];
+            buf[j + k] -= clip23(norm16(err));
         }
+    } else {
+        // Inverse fixed coefficient prediction
+        for (j = 0; j < b->fixed_pred_order[ch]; j++)
+            for (k = 1; k < nsamples; k++)
+                buf[k] += buf[k - 1];
     }
+}
+
+static void chs_filter_band_data(DCAXllDecoder *s, DCAXllChSet *c, int band)
+{
+    DCAXllBand *b = &c->bands[band];
+    int nsamples = s->nframesamples;
+    int i;
 
     // Inverse pairwise channel decorrellation
     if (b->decor_enabled) {
@@ -726,40 +731,37 @@ static void chs_assemble_msbs_lsbs(DCAXllDecoder *s, DCAXllChSet *c, int band)
     }
 }
 
-static int chs_assemble_freq_bands(DCAXllDecoder *s, DCAXllChSet *c)
+static int chs_alloc_freq_band_buffer(DCAXllDecoder *s, DCAXllChSet *c)
 {
-    int ch, nsamples = s->nframesamples;
-    int32_t *ptr;
-
     av_assert1(c->nfreqbands > 1);
 
     // Reallocate frequency band assembly buffer
     av_fast_malloc(&c->sample_buffer[2], &c->sample_size[2],
-                   2 * nsamples * c->nchannels * sizeof(int32_t));
+                   2 * s->nframesamples * c->nchannels * sizeof(int32_t));
     if (!c->sample_buffer[2])
         return AVERROR(ENOMEM);
 
-    // Assemble frequency bands 0 and 1
-    ptr = c->sample_buffer[2];
-    for (ch = 0; ch < c->nchannels; ch++) {
-        int32_t *band0 = c->bands[0].msb_sample_buffer[ch];
-        int32_t *band1 = c->bands[1].msb_sample_buffer[ch];
+    return 0;
+}
 
-        // Copy decimator history
-        memcpy(band0 - DCA_XLL_DECI_HISTORY_MAX,
-               c->deci_history[ch], sizeof(c->deci_history[0]));
+static void chs_assemble_freq_bands(DCAXllDecoder *s, DCAXllChSet *c, int ch)
+{
+    int nsamples = s->nframesamples;
+    int32_t *ptr = c->sample_buffer[2] + ch * nsamples * 2;
+    int32_t *band0 = c->bands[0].msb_sample_buffer[ch];
+    int32_t *band1 = c->bands[1].msb_sample_buffer[ch];
 
-        // Filter
-        s->dcadsp->assemble_freq_bands(ptr, band0, band1,
-                                       ff_dca_xll_band_coeff,
-                                       nsamples);
+    // Copy decimator history
+    memcpy(band0 - DCA_XLL_DECI_HISTORY_MAX,
+           c->deci_history[ch], sizeof(c->deci_history[0]));
 
-        // Remap output channel pointer to assembly buffer
-        s->output_samples[c->ch_remap[ch]] = ptr;
-        ptr += nsamples * 2;
-    }
+    // Filter
+    s->dcadsp->assemble_freq_bands(ptr, band0, band1,
+                                   ff_dca_xll_band_coeff,
+                                   nsamples);
 
-    return 0;
+    // Remap output channel pointer to assembly buffer
+    s->output_samples[c->ch_remap[ch]] = ptr;
 }
 
 static int parse_common_header(DCAXllDecoder *s)
@@ -999,9 +1001,40 @@ static int parse_navi_table(DCAXllDecoder *s)
     return 0;
 }
 
+// Segments of different channel sets are located through the NAVI table and
+// don't share any coding state, so each channel set is unpacked by a separate
+// job with its own bit reader
+static int chs_parse_band_data_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    DCAXllDecoder *s = arg;
+    DCAXllChSet *c = &s->chset[jobnr];
+    GetBitContext gb = s->gb;
+    int ret, chs, seg, band, start, navi_pos = get_bits_count(&s->gb), *navi_ptr = s->navi;
+
+    for (band = 0; band < s->nfreqbands; band++) {
+        for (seg = 0; seg < s->nframesegs; seg++) {
+            for (chs = 0; chs < s->nchsets; chs++) {
+                start     = navi_pos;
+                navi_pos += *navi_ptr++ * 8;
+                if (chs != jobnr || c->nfreqbands <= band)
+                    continue;
+                gb.index = start;
+                if ((ret = chs_parse_band_data(s, c, &gb, band, seg, navi_pos)) < 0) {
+                    if (s->avctx->err_recognition & AV_EF_EXPLODE)
+                        return ret;
+                    chs_clear_band_data(s, c, band, seg);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
 static int parse_band_data(DCAXllDecoder *s)
 {
     int ret, chs, seg, band, navi_pos, *navi_ptr;
+    int job_ret[DCA_XLL_CHSETS_MAX];
     DCAXllChSet *c;
 
     for (chs = 0, c = s->chset; chs < s->nactivechsets; chs++, c++) {
@@ -1011,30 +1044,27 @@ static int parse_band_data(DCAXllDecoder *s)
             return ret;
     }
 
+    // Validate segment positions before unpacking any of them
     navi_pos = get_bits_count(&s->gb);
     navi_ptr = s->navi;
     for (band = 0; band < s->nfreqbands; band++) {
         for (seg = 0; seg < s->nframesegs; seg++) {
-            for (chs = 0, c = s->chset; chs < s->nchsets; chs++, c++) {
-                if (c->nfreqbands > band) {
-                    navi_pos += *navi_ptr * 8;
-                    if (navi_pos > s->gb.size_in_bits) {
-                        av_log(s->avctx, AV_LOG_ERROR, "Invalid NAVI position\n");
-                        return AVERROR_INVALIDDATA;
-                    }
-                    if (chs < s->nactivechsets &&
-                        (ret = chs_parse_band_data(s, c, band, seg, navi_pos)) < 0) {
-                        if (s->avctx->err_recognition & AV_EF_EXPLODE)
-                            return ret;
-                        chs_clear_band_data(s, c, band, seg);
-                    }
-                    s->gb.index = navi_pos;
+            for (chs = 0; chs < s->nchsets; chs++) {
+                navi_pos += *navi_ptr++ * 8;
+                if (navi_pos > s->gb.size_in_bits) {
+                    av_log(s->avctx, AV_LOG_ERROR, "Invalid NAVI position\n");
+                    return AVERROR_INVALIDDATA;
                 }
-                navi_ptr++;
             }
         }
     }
 
+    s->avctx->execute2(s->avctx, chs_parse_band_data_job, s, job_ret, s->nactivechsets);
+    for (chs = 0; chs < s->nactivechsets; chs++)
+        if (job_ret[chs] < 0)
+            return job_ret[chs];
+
+    s->gb.index = navi_pos;
     return 0;
 }
 
@@ -1319,6 +1349,58 @@ static int combine_residual_frame(DCAXllDecoder *s, DCAXllChSet *c)
     return 0;
 }
 
+// Number of per-channel jobs over active channel sets, counting each
+// frequency band separately if all_bands is set
+static int count_channel_jobs(DCAXllDecoder *s, int all_bands)
+{
+    int i, nb_jobs = 0;
+
+    for (i = 0; i < s->nactivechsets; i++)
+        nb_jobs += s->chset[i].nchannels * (all_bands ? s->chset[i].nfreqbands : 1);
+
+    return nb_jobs;
+}
+
+static DCAXllChSet *find_channel_job(DCAXllDecoder *s, int all_bands, int jobnr,
+                                     int *band, int *ch)
+{
+    DCAXllChSet *c;
+    int i;
+
+    for (i = 0, c = s->chset; i < s->nactivechsets; i++, c++) {
+        int nb_jobs = c->nchannels * (all_bands ? c->nfreqbands : 1);
+        if (jobnr < nb_jobs) {
+            *band = jobnr / c->nchannels;
+            *ch   = jobnr % c->nchannels;
+            return c;
+        }
+        jobnr -= nb_jobs;
+    }
+
+    av_assert0(0);
+    return NULL;
+}
+
+static int chs_inverse_prediction_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    DCAXllDecoder *s = arg;
+    int band, ch;
+    DCAXllChSet *c = find_channel_job(s, 1, jobnr, &band, &ch);
+
+    chs_inverse_prediction(s, c, band, ch);
+    return 0;
+}
+
+static int chs_assemble_freq_bands_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    DCAXllDecoder *s = arg;
+    int band, ch;
+    DCAXllChSet *c = find_channel_job(s, 0, jobnr, &band, &ch);
+
+    chs_assemble_freq_bands(s, c, ch);
+    return 0;
+}
+
 int ff_dca_xll_filter_frame(DCAXllDecoder *s, AVFrame *frame)
 {
     AVCodecContext *avctx = s->avctx;
@@ -1343,6 +1425,10 @@ int ff_dca_xll_filter_frame(DCAXllDecoder *s, AVFrame *frame)
         s->fixed_lsb_width = 0;
     }
 
+    // Inverse prediction for all channels of active channel sets
+    s->avctx->execute2(s->avctx, chs_inverse_prediction_job, s, NULL,
+                       count_channel_jobs(s, 1));
+
     // Filter frequency bands for active channel sets
     s->output_mask = 0;
     for (i = 0, c = s->chset; i < s->nactivechsets; i++, c++) {
@@ -1383,8 +1469,10 @@ int ff_dca_xll_filter_frame(DCAXllDecoder *s, AVFrame *frame)
     // Assemble frequency bands for active channel sets
     if (s->nfreqbands > 1) {
         for (i = 0; i < s->nactivechsets; i++)
-            if ((ret = chs_assemble_freq_bands(s, &s->chset[i])) < 0)
+            if ((ret = chs_alloc_freq_band_buffer(s, &s->chset[i])) < 0)
                 return ret;
+        s->avctx->execute2(s->avctx, chs_assemble_freq_bands_job, s, NULL,
+                           count_channel_jobs(s, 0));
     }
 
     // Normalize to regular 5.1 layout if downmixing
@@ -43,6 +43,7 @@
 #include "mjpegdec.h"
 #include "jpeglsdec.h"
 #include "put_bits.h"
+#include "thread.h"
 #include "tiff.h"
 #include "exif.h"
 #include "bytestream.h"
@@ -71,20 +72,60 @@ static int build_vlc(VLC *vlc, const uint8_t *bits_table,
                               huff_code, 2, 2, huff_sym, 2, 2, use_static);
 }
 
+static int build_huffman_vlcs(MJpegDecodeContext *s, int class, int index)
+{
+    const uint8_t *bits_table = s->huff_bits[class][index];
+    const uint8_t *val_table  = s->huff_vals[class][index];
+    int nb_codes = s->huff_nb_codes[class][index];
+    int ret;
+
+    ff_free_vlc(&s->vlcs[class][index]);
+    if (class > 0)
+        ff_free_vlc(&s->vlcs[2][index]);
+    if (!nb_codes)
+        return 0;
+
+    if ((ret = build_vlc(&s->vlcs[class][index], bits_table, val_table,
+                         nb_codes, 0, class > 0)) < 0)
+        return ret;
+
+    if (class > 0) {
+        if ((ret = build_vlc(&s->vlcs[2][index], bits_table, val_table,
+                             nb_codes, 0, 0)) < 0)
+            return ret;
+    }
+    return 0;
+}
+
+static int init_huffman_table(MJpegDecodeContext *s, int class, int index,
+                              const uint8_t *bits_table,
+                              const uint8_t *val_table, int nb_codes)
+{
+    int i, n = 0;
+
+    for (i = 1; i <= 16; i++)
+        n += bits_table[i];
+
+    /* keep the raw table, frame threads rebuild their vlcs from it */
+    memcpy(s->huff_bits[class][index], bits_table, 17);
+    s->huff_bits[class][index][0] = 0;
+    memcpy(s->huff_vals[class][index], val_table, n);
+    memset(s->huff_vals[class][index] + n, 0, 256 - n);
+    s->huff_nb_codes[class][index] = nb_codes;
+
+    return build_huffman_vlcs(s, class, index);
+}
+
 static void build_basic_mjpeg_vlc(MJpegDecodeContext *s)
 {
-    build_vlc(&s->vlcs[0][0], avpriv_mjpeg_bits_dc_luminance,
-              avpriv_mjpeg_val_dc, 12, 0, 0);
-    build_vlc(&s->vlcs[0][1], avpriv_mjpeg_bits_dc_chrominance,
-              avpriv_mjpeg_val_dc, 12, 0, 0);
-    build_vlc(&s->vlcs[1][0], avpriv_mjpeg_bits_ac_luminance,
-              avpriv_mjpeg_val_ac_luminance, 251, 0, 1);
-    build_vlc(&s->vlcs[1][1], avpriv_mjpeg_bits_ac_chrominance,
-              avpriv_mjpeg_val_ac_chrominance, 251, 0, 1);
-    build_vlc(&s->vlcs[2][0], avpriv_mjpeg_bits_ac_luminance,
-              avpriv_mjpeg_val_ac_luminance, 251, 0, 0);
-    build_vlc(&s->vlcs[2][1], avpriv_mjpeg_bits_ac_chrominance,
-              avpriv_mjpeg_val_ac_chrominance, 251, 0, 0);
+    init_huffman_table(s, 0, 0, avpriv_mjpeg_bits_dc_luminance,
+                       avpriv_mjpeg_val_dc, 12);
+    init_huffman_table(s, 0, 1, avpriv_mjpeg_bits_dc_chrominance,
+                       avpriv_mjpeg_val_dc, 12);
+    init_huffman_table(s, 1, 0, avpriv_mjpeg_bits_ac_luminance,
+                       avpriv_mjpeg_val_ac_luminance, 251);
+    init_huffman_table(s, 1, 1, avpriv_mjpeg_bits_ac_chrominance,
+                       avpriv_mjpeg_val_ac_chrominance, 251);
 }
 
 static void parse_avid(MJpegDecodeContext *s, uint8_t *buf, int len)
@@ -243,25 +284,18 @@ int ff_mjpeg_decode_dht(MJpegDecodeContext *s)
         len -= n;
 
         /* build VLC and flush previous vlc if present */
-        ff_free_vlc(&s->vlcs[class][index]);
         av_log(s->avctx, AV_LOG_DEBUG, "class=%d index=%d nb_codes=%d\n",
                class, index, code_max + 1);
-        if ((ret = build_vlc(&s->vlcs[class][index], bits_table, val_table,
-                             code_max + 1, 0, class > 0)) < 0)
+        if ((ret = init_huffman_table(s, class, index, bits_table, val_table,
+                                      code_max + 1)) < 0)
             return ret;
-
-        if (class > 0) {
-            ff_free_vlc(&s->vlcs[2][index]);
-            if ((ret = build_vlc(&s->vlcs[2][index], bits_table, val_table,
-                                 code_max + 1, 0, 0)) < 0)
-                return ret;
-        }
     }
     return 0;
 }
 
 int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
 {
+    ThreadFrame frame = { 0 };
     int len, nb_components, i, width, height, bits, ret;
     unsigned pix_fmt_id;
     int h_count[MAX_COMPONENTS] = { 0 };
@@ -620,8 +654,9 @@ unk_pixfmt:
         return 0;
     }
 
-    av_frame_unref(s->picture_ptr);
-    if (ff_get_buffer(s->avctx, s->picture_ptr, AV_GET_BUFFER_FLAG_REF) < 0)
+    frame.f = s->picture_ptr;
+    ff_thread_release_buffer(s->avctx, &frame);
+    if (ff_thread_get_buffer(s->avctx, &frame, AV_GET_BUFFER_FLAG_REF) < 0)
         return -1;
     s->picture_ptr->pict_type = AV_PICTURE_TYPE_I;
     s->picture_ptr->key_frame = 1;
@@ -1251,7 +1286,8 @@ static void shift_output(MJpegDecodeContext *s, uint8_t *ptr, int linesize)
 static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                              int Al, const uint8_t *mb_bitmask,
                              int mb_bitmask_size,
-                             const AVFrame *reference)
+                             const AVFrame *reference,
+                             int mb_start, int mb_end)
 {
     int i, mb_x, mb_y, chroma_h_shift, chroma_v_shift, chroma_width, chroma_height;
     uint8_t *data[MAX_COMPONENTS];
@@ -1283,8 +1319,9 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
         s->coefs_finished[c] |= 1;
     }
 
-    for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
-        for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
+    mb_x = mb_start % s->mb_width;
+    for (mb_y = mb_start / s->mb_width; mb_y * s->mb_width + mb_x < mb_end; mb_y++, mb_x = 0) {
+        for (; mb_x < s->mb_width && mb_y * s->mb_width + mb_x < mb_end; mb_x++) {
             const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
 
             if (s->restart_interval && !s->restart_count)
@@ -1369,6 +1406,78 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
     return 0;
 }
 
+typedef struct MJpegScanThreadContext {
+    MJpegDecodeContext *s;
+    int nb_components;
+    int Ah, Al;
+    int start;              ///< bit position of the first restart segment
+    const int *pos;         ///< byte positions of the following segments
+    int nb_segments;
+    int nb_jobs;
+    GetBitContext gb;       ///< reader state after the last segment
+} MJpegScanThreadContext;
+
+static int decode_scan_segments(AVCodecContext *avctx, void *arg,
+                                int jobnr, int threadnr)
+{
+    MJpegScanThreadContext *t = arg;
+    /* private bit reader, DC predictors and block */
+    MJpegDecodeContext s = *t->s;
+    const int nb_mbs = s.mb_width * s.mb_height;
+    const int first  = t->nb_segments *  jobnr      / t->nb_jobs;
+    const int last   = t->nb_segments * (jobnr + 1) / t->nb_jobs;
+    int seg, i, err, ret = 0;
+
+    for (seg = first; seg < last; seg++) {
+        int start = seg ? t->pos[seg - 1] * 8 : t->start;
+
+        skip_bits_long(&s.gb, start - get_bits_count(&s.gb));
+        for (i = 0; i < t->nb_components; i++)
+            s.last_dc[i] = (4 << s.bits);
+        err = mjpeg_decode_scan(&s, t->nb_components, t->Ah, t->Al,
+                                NULL, 0, NULL, seg * s.restart_interval,
+                                FFMIN((seg + 1) * s.restart_interval, nb_mbs));
+        if (err < 0)
+            ret = err;
+    }
+    if (last == t->nb_segments)
+        t->gb = s.gb;
+    return ret;
+}
+
+/**
+ * Decode the restart segments of a sequential scan with slice threads.
+ * @return 0 on success, a negative error code on failure, or 1 if the
+ *         restart markers found in the scan do not allow it
+ */
+static int mjpeg_decode_scan_threaded(MJpegDecodeContext *s, int nb_components,
+                                      int Ah, int Al)
+{
+    MJpegScanThreadContext t = { s, nb_components, Ah, Al };
+    const int nb_mbs = s->mb_width * s->mb_height;
+    int ret[32];
+    int i, first = 0;
+
+    t.start       = get_bits_count(&s->gb);
+    t.nb_segments = (nb_mbs + s->restart_interval - 1) / s->restart_interval;
+    while (first < s->nb_restart_pos && s->restart_pos[first] * 8 <= t.start)
+        first++;
+    if (t.nb_segments < 2 || s->nb_restart_pos - first < t.nb_segments - 1)
+        return 1;
+
+    t.pos     = s->restart_pos + first;
+    t.nb_jobs = FFMIN3(t.nb_segments, s->avctx->thread_count, FF_ARRAY_ELEMS(ret));
+    t.gb      = s->gb;
+
+    s->avctx->execute2(s->avctx, decode_scan_segments, &t, ret, t.nb_jobs);
+
+    s->gb = t.gb;
+    for (i = 0; i < t.nb_jobs; i++)
+        if (ret[i] < 0)
+            return ret[i];
+    return 0;
+}
+
 static int mjpeg_decode_scan_progressive_ac(MJpegDecodeContext *s, int ss,
                                             int se, int Ah, int Al)
 {
@@ -1551,6 +1660,15 @@ int ff_mjpeg_decode_sos(MJpegDecodeContext *s, const uint8_t *mb_bitmask,
     for (i = s->mjpb_skiptosod; i > 0; i--)
         skip_bits(&s->gb, 8);
 
+    /* A sequential scan covering all components is the last one of the
+     * picture, nothing decoded after it is needed by the next frame. */
+    if (!s->setup_finished && !s->progressive && !s->lossless &&
+        nb_components == s->nb_components &&
+        (!s->interlaced || s->bottom_field == !s->interlace_polarity)) {
+        s->setup_finished = 1;
+        ff_thread_finish_setup(s->avctx);
+    }
+
 next_field:
     for (i = 0; i < nb_components; i++)
         s->last_dc[i] = (4 << s->bits);
@@ -1583,9 +1701,17 @@ next_field:
                                                         point_transform)) < 0)
                 return ret;
         } else {
-            if ((ret = mjpeg_decode_scan(s, nb_components,
-                                         prev_shift, point_transform,
-                                         mb_bitmask, mb_bitmask_size, reference)) < 0)
+            ret = 1;
+            if (s->restart_interval && !s->progressive && !mb_bitmask &&
+                s->avctx->active_thread_type & FF_THREAD_SLICE)
+                ret = mjpeg_decode_scan_threaded(s, nb_components,
+                                                 prev_shift, point_transform);
+            if (ret > 0)
+                ret = mjpeg_decode_scan(s, nb_components,
+                                        prev_shift, point_transform,
+                                        mb_bitmask, mb_bitmask_size, reference,
+                                        0, s->mb_width * s->mb_height);
+            if (ret < 0)
                 return ret;
         }
     }
@@ -1953,6 +2079,10 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
         const uint8_t *src = *buf_ptr;
         const uint8_t *ptr = src;
         uint8_t *dst = s->buffer;
+        int find_rst = s->restart_interval &&
+                       s->avctx->active_thread_type & FF_THREAD_SLICE;
+
+        s->nb_restart_pos = 0;
 
         #define copy_data_segment(skip) do {       \
             ptrdiff_t length = (ptr - src) - (skip);  \
@@ -1991,6 +2121,17 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                         copy_data_segment(1);
                         if (x)
                             break;
+                    } else if (find_rst) {
+                        int *pos = av_fast_realloc(s->restart_pos, &s->restart_pos_size,
+                                                   (s->nb_restart_pos + 1) * sizeof(*pos));
+                        if (pos) {
+                            /* the segment starts right after the marker */
+                            s->restart_pos = pos;
+                            s->restart_pos[s->nb_restart_pos++] = (dst - s->buffer) + (ptr - src);
+                        } else {
+                            s->nb_restart_pos = 0;
+                            find_rst = 0;
+                        }
                     }
                 }
             }
@@ -2075,6 +2216,7 @@ int ff_mjpeg_decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
     av_dict_free(&s->exif_metadata);
     av_freep(&s->stereo3d);
     s->adobe_transform = -1;
+    s->setup_finished  = 0;
 
     buf_ptr = buf;
     buf_end = buf + buf_size;
@@ -2488,6 +2630,8 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     av_freep(&s->stereo3d);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
+    av_freep(&s->restart_pos);
+    s->restart_pos_size = 0;
 
     for (i = 0; i < 3; i++) {
         for (j = 0; j < 4; j++)
@@ -2507,6 +2651,124 @@ static void decode_flush(AVCodecContext *avctx)
     s->got_picture = 0;
 }
 
+#if HAVE_THREADS
+static av_cold int decode_init_thread_copy(AVCodecContext *avctx)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    int class, index, ret;
+
+    s->avctx             = avctx;
+    s->buffer            = NULL;
+    s->buffer_size       = 0;
+    s->ljpeg_buffer      = NULL;
+    s->ljpeg_buffer_size = 0;
+    s->restart_pos       = NULL;
+    s->restart_pos_size  = 0;
+    s->nb_restart_pos    = 0;
+    s->exif_metadata     = NULL;
+    s->stereo3d          = NULL;
+    memset(s->blocks,   0, sizeof(s->blocks));
+    memset(s->last_nnz, 0, sizeof(s->last_nnz));
+    memset(s->vlcs,     0, sizeof(s->vlcs));
+
+    s->picture = av_frame_alloc();
+    if (!s->picture)
+        return AVERROR(ENOMEM);
+    s->picture_ptr = s->picture;
+
+    for (class = 0; class < 2; class++)
+        for (index = 0; index < 4; index++)
+            if ((ret = build_huffman_vlcs(s, class, index)) < 0)
+                return ret;
+
+    return 0;
+}
+
+static int decode_update_thread_context(AVCodecContext *dst,
+                                        const AVCodecContext *src)
+{
+    MJpegDecodeContext *s = dst->priv_data, *s1 = src->priv_data;
+    ThreadFrame frame = { .f = s->picture_ptr };
+    int class, index, ret;
+
+    if (dst == src)
+        return 0;
+
+    if (s->bits != s1->bits)
+        init_idct(dst);
+
+    memcpy(s->quant_matrixes, s1->quant_matrixes, sizeof(s->quant_matrixes));
+    memcpy(s->qscale,         s1->qscale,         sizeof(s->qscale));
+    for (class = 0; class < 2; class++) {
+        for (index = 0; index < 4; index++) {
+            if (s->huff_nb_codes[class][index] == s1->huff_nb_codes[class][index] &&
+                !memcmp(s->huff_bits[class][index], s1->huff_bits[class][index],
+                        sizeof(s->huff_bits[class][index])) &&
+                !memcmp(s->huff_vals[class][index], s1->huff_vals[class][index],
+                        sizeof(s->huff_vals[class][index])))
+                continue;
+            memcpy(s->huff_bits[class][index], s1->huff_bits[class][index],
+                   sizeof(s->huff_bits[class][index]));
+            memcpy(s->huff_vals[class][index], s1->huff_vals[class][index],
+                   sizeof(s->huff_vals[class][index]));
+            s->huff_nb_codes[class][index] = s1->huff_nb_codes[class][index];
+            if ((ret = build_huffman_vlcs(s, class, index)) < 0)
+                return ret;
+        }
+    }
+
+    s->org_height         = s1->org_height;
+    s->first_picture      = s1->first_picture;
+    s->interlaced         = s1->interlaced;
+    s->interlace_polarity = s1->interlace_polarity;
+    s->lossless           = s1->lossless;
+    s->ls                 = s1->ls;
+    s->progressive        = s1->progressive;
+    s->rgb                = s1->rgb;
+    s->rct                = s1->rct;
+    s->pegasus_rct        = s1->pegasus_rct;
+    s->bits               = s1->bits;
+    s->colr               = s1->colr;
+    s->xfrm               = s1->xfrm;
+    s->maxval             = s1->maxval;
+    s->near               = s1->near;
+    s->t1                 = s1->t1;
+    s->t2                 = s1->t2;
+    s->t3                 = s1->t3;
+    s->reset              = s1->reset;
+    s->palette_index      = s1->palette_index;
+    s->width              = s1->width;
+    s->height             = s1->height;
+    s->nb_components      = s1->nb_components;
+    s->buggy_avid         = s1->buggy_avid;
+    s->cs_itu601          = s1->cs_itu601;
+    s->multiscope         = s1->multiscope;
+    s->flipped            = s1->flipped;
+    s->pix_desc           = s1->pix_desc;
+    memcpy(s->h_count,  s1->h_count,  sizeof(s->h_count));
+    memcpy(s->v_count,  s1->v_count,  sizeof(s->v_count));
+    memcpy(s->linesize, s1->linesize, sizeof(s->linesize));
+    s->cur_scan           = 0;
+
+    ff_thread_release_buffer(dst, &frame);
+    if (s1->setup_finished) {
+        /* the source thread completes its picture, start a new one */
+        s->got_picture  = 0;
+        s->bottom_field = s->interlaced ? s->interlace_polarity : s1->bottom_field;
+    } else {
+        /* the source thread is done, possibly with only the first field
+         * of a picture, which is then completed here */
+        s->got_picture  = s1->got_picture;
+        s->bottom_field = s1->bottom_field;
+        if (s1->got_picture && s1->picture_ptr->buf[0] &&
+            (ret = av_frame_ref(s->picture_ptr, s1->picture_ptr)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+#endif
+
 #if CONFIG_MJPEG_DECODER
 #define OFFSET(x) offsetof(MJpegDecodeContext, x)
 #define VD AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_DECODING_PARAM
@@ -2533,7 +2795,10 @@ AVCodec ff_mjpeg_decoder = {
     .close          = ff_mjpeg_decode_end,
     .decode         = ff_mjpeg_decode_frame,
     .flush          = decode_flush,
-    .capabilities   = AV_CODEC_CAP_DR1,
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(decode_init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(decode_update_thread_context),
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .max_lowres     = 3,
     .priv_class     = &mjpegdec_class,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE |
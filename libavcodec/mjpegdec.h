@@ -52,6 +52,9 @@ typedef struct MJpegDecodeContext {
 
     int16_t quant_matrixes[4][64];
     VLC vlcs[3][4];
+    uint8_t huff_bits[2][4][17];    ///< code length counts of the Huffman tables, kept to rebuild vlcs in other threads
+    uint8_t huff_vals[2][4][256];   ///< symbols of the Huffman tables
+    int huff_nb_codes[2][4];
     int qscale[4];      ///< quantizer scale calculated from quant_matrixes
 
     int org_height;  /* size given at codec init */
@@ -110,6 +113,9 @@ typedef struct MJpegDecodeContext {
 
     int restart_interval;
     int restart_count;
+    int *restart_pos;               ///< byte offsets of the restart segments in the unescaped scan
+    unsigned int restart_pos_size;
+    int nb_restart_pos;
 
     int buggy_avid;
     int cs_itu601;
@@ -130,6 +136,8 @@ typedef struct MJpegDecodeContext {
     AVStereo3D *stereo3d; ///!< stereoscopic information (cached, since it is read before frame allocation)
 
     const AVPixFmtDescriptor *pix_desc;
+
+    int setup_finished;             ///< the picture headers are final, the next frame thread may start
 } MJpegDecodeContext;
 
 int ff_mjpeg_decode_init(AVCodecContext *avctx);
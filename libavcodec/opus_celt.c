@@ -31,6 +31,7 @@
 
 #include "imdct15.h"
 #include "opus.h"
+#include "opusdsp.h"
 
 enum CeltSpread {
     CELT_SPREAD_NONE,
@@ -64,6 +65,7 @@ struct CeltContext {
     AVCodecContext    *avctx;
     IMDCT15Context    *imdct[4];
     AVFloatDSPContext  *dsp;
+    OpusDSP            opusdsp;
     int output_channels;
 
     // values that have inter-frame effect and must be reset on flush
@@ -1730,38 +1732,6 @@ static void celt_postfilter_apply_transition(CeltFrame *frame, float *data)
     }
 }
 
-static void celt_postfilter_apply(CeltFrame *frame,
-                                  float *data, int len)
-{
-    const int T = frame->pf_period;
-    float g0, g1, g2;
-    float x0, x1, x2, x3, x4;
-    int i;
-
-    if (frame->pf_gains[0] == 0.0 || len <= 0)
-        return;
-
-    g0 = frame->pf_gains[0];
-    g1 = frame->pf_gains[1];
-    g2 = frame->pf_gains[2];
-
-    x4 = data[-T - 2];
-    x3 = data[-T - 1];
-    x2 = data[-T];
-    x1 = data[-T + 1];
-
-    for (i = 0; i < len; i++) {
-        x0 = data[i - T + 2];
-        data[i] += g0 * x2        +
-                   g1 * (x1 + x3) +
-                   g2 * (x0 + x4);
-        x4 = x3;
-        x3 = x2;
-        x2 = x1;
-        x1 = x0;
-    }
-}
-
 static void celt_postfilter(CeltContext *s, CeltFrame *frame)
 {
     int len = s->blocksize * s->blocks;
@@ -1776,8 +1746,10 @@ static void celt_postfilter(CeltContext *s, CeltFrame *frame)
 
     if (len > CELT_OVERLAP) {
         celt_postfilter_apply_transition(frame, frame->buf + 1024 + CELT_OVERLAP);
-        celt_postfilter_apply(frame, frame->buf + 1024 + 2 * CELT_OVERLAP,
-                              len - 2 * CELT_OVERLAP);
+        if (frame->pf_gains[0] != 0.0 && len > 2 * CELT_OVERLAP)
+            s->opusdsp.postfilter(frame->buf + 1024 + 2 * CELT_OVERLAP,
+                                  frame->pf_period, frame->pf_gains,
+                                  len - 2 * CELT_OVERLAP);
 
         frame->pf_period_old = frame->pf_period;
         memcpy(frame->pf_gains_old, frame->pf_gains, sizeof(frame->pf_gains));
@@ -2091,7 +2063,6 @@ int ff_celt_decode_frame(CeltContext *s, OpusRangeCoder *rc,
     /* transform and output for each output channel */
     for (i = 0; i < s->output_channels; i++) {
         CeltFrame *frame = &s->frame[i];
-        float m = frame->deemph_coeff;
 
         /* iMDCT and overlap-add */
         for (j = 0; j < s->blocks; j++) {
@@ -2107,12 +2078,9 @@ int ff_celt_decode_frame(CeltContext *s, OpusRangeCoder *rc,
         celt_postfilter(s, frame);
 
         /* deemphasis and output scaling */
-        for (j = 0; j < frame_size; j++) {
-            float tmp = frame->buf[1024 - frame_size + j] + m;
-            m = tmp * CELT_DEEMPH_COEFF;
-            output[i][j] = tmp / 32768.;
-        }
-        frame->deemph_coeff = m;
+        frame->deemph_coeff = s->opusdsp.deemphasis(output[i],
+                                                    frame->buf + 1024 - frame_size,
+                                                    frame->deemph_coeff, frame_size);
     }
 
     if (coded_channels == 1)
@@ -2216,6 +2184,8 @@ int ff_celt_init(AVCodecContext *avctx, CeltContext **ps, int output_channels)
         goto fail;
     }
 
+    ff_opus_dsp_init(&s->opusdsp);
+
     ff_celt_flush(s);
 
     *ps = s;
@@ -27,6 +27,7 @@
 #include <stdint.h>
 
 #include "opus.h"
+#include "opusdsp.h"
 
 typedef struct SilkFrame {
     int coded;
@@ -43,6 +44,7 @@ typedef struct SilkFrame {
 
 struct SilkContext {
     AVCodecContext *avctx;
+    OpusDSP dsp;
     int output_channels;
 
     int midonly;
@@ -1421,23 +1423,13 @@ static void silk_decode_frame(SilkContext *s, OpusRangeCoder *rc,
             }
 
             /* LTP synthesis */
-            for (j = 0; j < s->sflength; j++) {
-                sum = resptr[j];
-                for (k = 0; k < LTP_ORDER; k++)
-                    sum += sf[i].ltptaps[k] * resptr[j - sf[i].pitchlag + LTP_ORDER/2 - k];
-                resptr[j] = sum;
-            }
+            s->dsp.ltp_synthesis(resptr, sf[i].ltptaps, sf[i].pitchlag,
+                                 s->sflength);
         }
 
         /* LPC synthesis */
-        for (j = 0; j < s->sflength; j++) {
-            sum = resptr[j] * sf[i].gain;
-            for (k = 1; k <= order; k++)
-                sum += lpc_coeff[k - 1] * lpc[j - k];
-
-            lpc[j] = sum;
-            dst[j] = av_clipf(sum, -1.0f, 1.0f);
-        }
+        s->dsp.lpc_synthesis(dst, lpc, resptr, sf[i].gain, lpc_coeff, order,
+                             s->sflength);
     }
 
     frame->prev_voiced = voiced;
@@ -1589,6 +1581,8 @@ int ff_silk_init(AVCodecContext *avctx, SilkContext **ps, int output_channels)
     s->avctx           = avctx;
     s->output_channels = output_channels;
 
+    ff_opus_dsp_init(&s->dsp);
+
     ff_silk_flush(s);
 
     *ps = s;
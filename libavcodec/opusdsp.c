@@ -0,0 +1,113 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "opus.h"
+#include "opusdsp.h"
+
+static void postfilter_c(float *data, int period, const float *gains, int len)
+{
+    const float g0 = gains[0];
+    const float g1 = gains[1];
+    const float g2 = gains[2];
+    float x0, x1, x2, x3, x4;
+    int i;
+
+    x4 = data[-period - 2];
+    x3 = data[-period - 1];
+    x2 = data[-period];
+    x1 = data[-period + 1];
+
+    for (i = 0; i < len; i++) {
+        x0 = data[i - period + 2];
+        data[i] += g0 * x2        +
+                   g1 * (x1 + x3) +
+                   g2 * (x0 + x4);
+        x4 = x3;
+        x3 = x2;
+        x2 = x1;
+        x1 = x0;
+    }
+}
+
+static float deemphasis_c(float *out, const float *in, float coeff, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        float tmp = in[i] + coeff;
+        coeff  = tmp * CELT_DEEMPH_COEFF;
+        out[i] = tmp * (1.0f / 32768);
+    }
+
+    return coeff;
+}
+
+static void ltp_synthesis_c(float *buf, const float *taps, int lag, int len)
+{
+    const float *src = buf - lag + 2;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        float sum = buf[i];
+        sum += taps[0] * src[i];
+        sum += taps[1] * src[i - 1];
+        sum += taps[2] * src[i - 2];
+        sum += taps[3] * src[i - 3];
+        sum += taps[4] * src[i - 4];
+        buf[i] = sum;
+    }
+}
+
+static av_always_inline void lpc_synthesis(float *dst, float *lpc,
+                                           const float *res, float gain,
+                                           const float *coeffs, int order,
+                                           int len)
+{
+    int i, k;
+
+    for (i = 0; i < len; i++) {
+        float sum = res[i] * gain;
+        for (k = 1; k <= order; k++)
+            sum += coeffs[k - 1] * lpc[i - k];
+
+        lpc[i] = sum;
+        dst[i] = av_clipf(sum, -1.0f, 1.0f);
+    }
+}
+
+static void lpc_synthesis_c(float *dst, float *lpc, const float *res,
+                            float gain, const float *coeffs, int order, int len)
+{
+    /* let the compiler unroll the filter for the two orders SILK uses */
+    if (order == 10)
+        lpc_synthesis(dst, lpc, res, gain, coeffs, 10, len);
+    else if (order == 16)
+        lpc_synthesis(dst, lpc, res, gain, coeffs, 16, len);
+    else
+        lpc_synthesis(dst, lpc, res, gain, coeffs, order, len);
+}
+
+av_cold void ff_opus_dsp_init(OpusDSP *ctx)
+{
+    ctx->postfilter    = postfilter_c;
+    ctx->deemphasis    = deemphasis_c;
+    ctx->ltp_synthesis = ltp_synthesis_c;
+    ctx->lpc_synthesis = lpc_synthesis_c;
+}
@@ -0,0 +1,59 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_OPUSDSP_H
+#define AVCODEC_OPUSDSP_H
+
+typedef struct OpusDSP {
+    /**
+     * Apply the CELT pitch postfilter with a constant period in place.
+     * @param data   samples to filter, data[-period - 2] to data[-1] must be
+     *               valid
+     * @param period pitch period, at least CELT_POSTFILTER_MINPERIOD
+     * @param gains  tap gains for the center, +-1 and +-2 taps
+     */
+    void (*postfilter)(float *data, int period, const float *gains, int len);
+
+    /**
+     * De-emphasize CELT output and scale it to the [-1, 1] range.
+     * @param coeff filter state carried over from the previous call
+     * @return the filter state for the next call
+     */
+    float (*deemphasis)(float *out, const float *in, float coeff, int len);
+
+    /**
+     * Apply the 5-tap SILK long-term prediction filter in place.
+     * buf[-lag - 2] to buf[-1] must be valid.
+     */
+    void (*ltp_synthesis)(float *buf, const float *taps, int lag, int len);
+
+    /**
+     * SILK LPC synthesis filter.
+     * @param dst    clipped output samples
+     * @param lpc    unclipped output samples, lpc[-order] to lpc[-1] must
+     *               contain the filter history
+     * @param res    excitation, scaled by gain
+     * @param coeffs LPC coefficients, order is 10 or 16
+     */
+    void (*lpc_synthesis)(float *dst, float *lpc, const float *res, float gain,
+                          const float *coeffs, int order, int len);
+} OpusDSP;
+
+void ff_opus_dsp_init(OpusDSP *ctx);
+
+#endif /* AVCODEC_OPUSDSP_H */
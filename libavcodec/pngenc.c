@@ -28,6 +28,7 @@
 
 #include "libavutil/avassert.h"
 #include "libavutil/crc.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/libm.h"
 #include "libavutil/opt.h"
 #include "libavutil/color_utils.h"
@@ -37,6 +38,10 @@
 
 #define IOBUF_SIZE 4096
 
+/* approximate amount of filtered data deflated by one slice job */
+#define SLICE_SIZE (128 * 1024)
+#define DICT_SIZE  32768
+
 typedef struct APNGFctlChunk {
     uint32_t sequence_number;
     uint32_t width, height;
@@ -45,6 +50,14 @@ typedef struct APNGFctlChunk {
     uint8_t dispose_op, blend_op;
 } APNGFctlChunk;
 
+typedef struct PNGEncSlice {
+    uint8_t *buf;                ///< raw deflate output of the slice
+    unsigned int buf_size;
+    int len;
+    uLong adler;                 ///< Adler-32 of the filtered rows of the slice
+    z_off_t in_len;
+} PNGEncSlice;
+
 typedef struct PNGEncContext {
     AVClass *class;
     HuffYUVEncDSPContext hdsp;
@@ -57,6 +70,15 @@ typedef struct PNGEncContext {
 
     z_stream zstream;
     uint8_t buf[IOBUF_SIZE];
+    int compression_level;
+
+    z_stream *thread_zstream;    ///< raw deflate streams of the slice threads
+    int nb_thread_zstream;
+    PNGEncSlice *slices;
+    int *slice_ret;              ///< return values of the slice jobs
+    int nb_slices_allocated;
+    int nb_slices;
+    int slice_rows;
     int dpi;                     ///< Physical pixel density, in dots per inch, if set
     int dpm;                     ///< Physical pixel density, in dots per meter, if set
 
@@ -188,6 +210,38 @@ static void png_filter_row(PNGEncContext *c, uint8_t *dst, int filter_type,
     }
 }
 
+/**
+ * Sum of the absolute values of the signed bytes in buf, 8 bytes at a time.
+ * Returns early once the sum reaches limit.
+ */
+static int png_filter_cost(const uint8_t *buf, int size, int limit)
+{
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t lo16 = 0x00FF00FF00FF00FFULL;
+    const uint64_t lo32 = 0x0000FFFF0000FFFFULL;
+    int i = 0, cost = 0;
+
+    while (i + 8 <= size) {
+        /* 16-bit lanes, 64 words of at most 2 * 128 per lane each */
+        int end = FFMIN(size & ~7, i + 8 * 64);
+        uint64_t acc = 0;
+
+        for (; i < end; i += 8) {
+            uint64_t w    = AV_RN64(buf + i);
+            uint64_t sign = (w >> 7) & ones;
+            uint64_t a    = (w ^ (sign * 0xFF)) + sign;
+            acc += (a & lo16) + ((a >> 8) & lo16);
+        }
+        acc   = (acc & lo32) + ((acc >> 16) & lo32);
+        cost += (acc + (acc >> 32)) & 0xFFFFFFFF;
+        if (cost >= limit)
+            return cost;
+    }
+    for (; i < size; i++)
+        cost += abs((int8_t) buf[i]);
+    return cost;
+}
+
 static uint8_t *png_choose_filter(PNGEncContext *s, uint8_t *dst,
                                   uint8_t *src, uint8_t *top, int size, int bpp)
 {
@@ -196,15 +250,12 @@ static uint8_t *png_choose_filter(PNGEncContext *s, uint8_t *dst,
     if (!top && pred)
         pred = PNG_FILTER_VALUE_SUB;
     if (pred == PNG_FILTER_VALUE_MIXED) {
-        int i;
         int cost, bcost = INT_MAX;
         uint8_t *buf1 = dst, *buf2 = dst + size + 16;
         for (pred = 0; pred < 5; pred++) {
             png_filter_row(s, buf1 + 1, pred, src, top, size, bpp);
             buf1[0] = pred;
-            cost = 0;
-            for (i = 0; i <= size; i++)
-                cost += abs((int8_t) buf1[i]);
+            cost = png_filter_cost(buf1, size + 1, bcost);
             if (cost < bcost) {
                 bcost = cost;
                 FFSWAP(uint8_t *, buf1, buf2);
@@ -425,6 +476,160 @@ static int encode_headers(AVCodecContext *avctx, const AVFrame *pict)
     return 0;
 }
 
+static void png_write_image_bytes(AVCodecContext *avctx, const uint8_t *data,
+                                  int size, int *pos)
+{
+    PNGEncContext *s = avctx->priv_data;
+
+    while (size > 0) {
+        int len = FFMIN(size, IOBUF_SIZE - *pos);
+        memcpy(s->buf + *pos, data, len);
+        *pos += len;
+        data += len;
+        size -= len;
+        if (*pos == IOBUF_SIZE) {
+            if (s->bytestream_end - s->bytestream > IOBUF_SIZE + 100)
+                png_write_image_data(avctx, s->buf, IOBUF_SIZE);
+            *pos = 0;
+        }
+    }
+}
+
+static int deflate_slice(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    PNGEncContext *s   = avctx->priv_data;
+    const AVFrame *p   = arg;
+    PNGEncSlice *slice = &s->slices[jobnr];
+    z_stream *zstream  = &s->thread_zstream[threadnr];
+    const int row_size = (p->width * s->bits_per_pixel + 7) >> 3;
+    const int bpp      = s->bits_per_pixel >> 3;
+    const int y_start  = jobnr * s->slice_rows;
+    const int y_end    = FFMIN(y_start + s->slice_rows, p->height);
+    uint8_t *crow_base, *crow_buf, *crow, *top, *ptr;
+    uLong bound;
+    int y, ret = -1;
+
+    slice->len = 0;
+    crow_base = av_malloc((row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
+    if (!crow_base)
+        return AVERROR(ENOMEM);
+    crow_buf = crow_base + 15;
+
+    /* Prime the window with the filtered rows of the previous slice, as the
+     * serial encoder would have seen them. */
+    if (y_start > 0) {
+        int dict_rows = FFMIN(y_start, (DICT_SIZE + row_size) / (row_size + 1));
+        int dict_len  = dict_rows * (row_size + 1);
+        uint8_t *dict = av_malloc(dict_len);
+
+        if (!dict)
+            goto fail;
+        for (y = y_start - dict_rows; y < y_start; y++) {
+            ptr  = p->data[0] + y * p->linesize[0];
+            top  = y ? ptr - p->linesize[0] : NULL;
+            crow = png_choose_filter(s, crow_buf, ptr, top, row_size, bpp);
+            memcpy(dict + (y - y_start + dict_rows) * (row_size + 1), crow, row_size + 1);
+        }
+        ret = deflateSetDictionary(zstream, dict + FFMAX(dict_len - DICT_SIZE, 0),
+                                   FFMIN(dict_len, DICT_SIZE));
+        av_free(dict);
+        if (ret != Z_OK) {
+            ret = -1;
+            goto fail;
+        }
+    }
+
+    bound = deflateBound(zstream, (uLong)(y_end - y_start) * (row_size + 1)) + 16;
+    av_fast_malloc(&slice->buf, &slice->buf_size, bound);
+    if (!slice->buf) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    zstream->next_out  = slice->buf;
+    zstream->avail_out = bound;
+    slice->adler  = adler32(0L, Z_NULL, 0);
+    slice->in_len = 0;
+
+    for (y = y_start; y < y_end; y++) {
+        ptr  = p->data[0] + y * p->linesize[0];
+        top  = y ? ptr - p->linesize[0] : NULL;
+        crow = png_choose_filter(s, crow_buf, ptr, top, row_size, bpp);
+        slice->adler   = adler32(slice->adler, crow, row_size + 1);
+        slice->in_len += row_size + 1;
+        zstream->next_in  = crow;
+        zstream->avail_in = row_size + 1;
+        if (deflate(zstream, Z_NO_FLUSH) != Z_OK || zstream->avail_in) {
+            ret = -1;
+            goto fail;
+        }
+    }
+    /* byte align with an empty stored block, only the last slice ends the stream */
+    ret = deflate(zstream, y_end == p->height ? Z_FINISH : Z_SYNC_FLUSH);
+    if (ret != (y_end == p->height ? Z_STREAM_END : Z_OK)) {
+        ret = -1;
+        goto fail;
+    }
+    slice->len = bound - zstream->avail_out;
+    ret = 0;
+
+fail:
+    deflateReset(zstream);
+    av_free(crow_base);
+    return ret;
+}
+
+/**
+ * Deflate horizontal slices of the image in parallel and join them into a
+ * single zlib stream. Every slice but the last ends with a sync flush, so
+ * the raw deflate data can simply be concatenated, and the Adler-32 of the
+ * whole stream is combined from the ones of the slices.
+ */
+static int encode_frame_slices(AVCodecContext *avctx, const AVFrame *pict)
+{
+    PNGEncContext *s = avctx->priv_data;
+    int level = s->compression_level == Z_DEFAULT_COMPRESSION ? 6 : s->compression_level;
+    uint8_t header[2], trailer[4];
+    uLong adler;
+    int i, pos = 0, ret;
+
+    if (s->nb_slices > s->nb_slices_allocated) {
+        ret = av_reallocp_array(&s->slice_ret, s->nb_slices, sizeof(*s->slice_ret));
+        if (ret >= 0)
+            ret = av_reallocp_array(&s->slices, s->nb_slices, sizeof(*s->slices));
+        if (ret < 0) {
+            s->nb_slices_allocated = 0;
+            return ret;
+        }
+        memset(s->slices + s->nb_slices_allocated, 0,
+               (s->nb_slices - s->nb_slices_allocated) * sizeof(*s->slices));
+        s->nb_slices_allocated = s->nb_slices;
+    }
+
+    avctx->execute2(avctx, deflate_slice, (void *)pict, s->slice_ret, s->nb_slices);
+    for (i = 0; i < s->nb_slices; i++)
+        if (s->slice_ret[i] < 0)
+            return s->slice_ret[i];
+
+    header[0] = 0x78; /* deflate, 32K window */
+    header[1] = (level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6;
+    header[1] += 31 - ((header[0] << 8) + header[1]) % 31;
+    png_write_image_bytes(avctx, header, 2, &pos);
+
+    adler = s->slices[0].adler;
+    for (i = 0; i < s->nb_slices; i++) {
+        PNGEncSlice *slice = &s->slices[i];
+        if (i)
+            adler = adler32_combine(adler, slice->adler, slice->in_len);
+        png_write_image_bytes(avctx, slice->buf, slice->len, &pos);
+    }
+    AV_WB32(trailer, adler);
+    png_write_image_bytes(avctx, trailer, 4, &pos);
+
+    if (pos > 0 && s->bytestream_end - s->bytestream > pos + 100)
+        png_write_image_data(avctx, s->buf, pos);
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
 {
     PNGEncContext *s       = avctx->priv_data;
@@ -438,6 +643,15 @@ static int encode_frame(AVCodecContext *avctx, const AVFrame *pict)
 
     row_size = (pict->width * s->bits_per_pixel + 7) >> 3;
 
+    if (s->thread_zstream && !s->is_progressive) {
+        /* The slice layout only depends on the image, so the output does
+         * not change with the number of threads. */
+        s->slice_rows = FFMAX(1, (SLICE_SIZE + row_size) / (row_size + 1));
+        s->nb_slices  = (pict->height + s->slice_rows - 1) / s->slice_rows;
+        if (s->nb_slices > 1)
+            return encode_frame_slices(avctx, pict);
+    }
+
     crow_base = av_malloc((row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
     if (!crow_base) {
         ret = AVERROR(ENOMEM);
@@ -1081,6 +1295,24 @@ FF_ENABLE_DEPRECATION_WARNINGS
                       : av_clip(avctx->compression_level, 0, 9);
     if (deflateInit2(&s->zstream, compression_level, Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
         return -1;
+    s->compression_level = compression_level;
+
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1) {
+        int i;
+
+        s->thread_zstream = av_mallocz_array(avctx->thread_count, sizeof(*s->thread_zstream));
+        if (!s->thread_zstream)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < avctx->thread_count; i++) {
+            z_stream *zstream = &s->thread_zstream[i];
+            zstream->zalloc = ff_png_zalloc;
+            zstream->zfree  = ff_png_zfree;
+            zstream->opaque = NULL;
+            if (deflateInit2(zstream, compression_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                return -1;
+            s->nb_thread_zstream++;
+        }
+    }
 
     return 0;
 }
@@ -1089,7 +1321,16 @@ static av_cold int png_enc_close(AVCodecContext *avctx)
 {
     PNGEncContext *s = avctx->priv_data;
 
+    int i;
+
     deflateEnd(&s->zstream);
+    for (i = 0; i < s->nb_thread_zstream; i++)
+        deflateEnd(&s->thread_zstream[i]);
+    av_freep(&s->thread_zstream);
+    for (i = 0; i < s->nb_slices_allocated; i++)
+        av_freep(&s->slices[i].buf);
+    av_freep(&s->slices);
+    av_freep(&s->slice_ret);
     av_frame_free(&s->last_frame);
     av_frame_free(&s->prev_frame);
     av_freep(&s->last_frame_packet);
@@ -1134,7 +1375,8 @@ AVCodec ff_png_encoder = {
     .init           = png_enc_init,
     .close          = png_enc_close,
     .encode2        = encode_png,
-    .capabilities   = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_INTRA_ONLY,
+    .capabilities   = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS |
+                      AV_CODEC_CAP_INTRA_ONLY,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_RGB24, AV_PIX_FMT_RGBA,
         AV_PIX_FMT_RGB48BE, AV_PIX_FMT_RGBA64BE,
@@ -1155,7 +1397,7 @@ AVCodec ff_apng_encoder = {
     .init           = png_enc_init,
     .close          = png_enc_close,
     .encode2        = encode_apng,
-    .capabilities   = CODEC_CAP_DELAY,
+    .capabilities   = CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_RGB24, AV_PIX_FMT_RGBA,
         AV_PIX_FMT_RGB48BE, AV_PIX_FMT_RGBA64BE,
@@ -122,214 +122,169 @@ static int build_huff(const uint8_t *src, VLC *vlc, int *fsym)
                               syms,  sizeof(*syms),  sizeof(*syms), 0);
 }
 
-static int decode_plane10(UtvideoContext *c, int plane_no,
+typedef struct UtvideoFrameContext {
+    AVFrame *frame;
+    const uint8_t *plane_start[5];
+    VLC vlc[4];
+    int fsym[4];
+    int slice_bits_size;         ///< size of the bitstream buffer of each thread
+} UtvideoFrameContext;
+
+static int decode_plane10(UtvideoContext *c, int slice, uint8_t *slice_bits,
+                          VLC *vlc, int fsym,
                           uint16_t *dst, int step, int stride,
                           int width, int height,
-                          const uint8_t *src, const uint8_t *huff,
-                          int use_pred)
+                          const uint8_t *src, int use_pred)
 {
-    int i, j, slice, pix, ret;
+    int i, j, pix;
     int sstart, send;
-    VLC vlc;
     GetBitContext gb;
-    int prev, fsym;
-
-    if ((ret = build_huff10(huff, &vlc, &fsym)) < 0) {
-        av_log(c->avctx, AV_LOG_ERROR, "Cannot build Huffman codes\n");
-        return ret;
-    }
-    if (fsym >= 0) { // build_huff reported a symbol to fill slices with
-        send = 0;
-        for (slice = 0; slice < c->slices; slice++) {
-            uint16_t *dest;
-
-            sstart = send;
-            send   = (height * (slice + 1) / c->slices);
-            dest   = dst + sstart * stride;
-
-            prev = 0x200;
-            for (j = sstart; j < send; j++) {
-                for (i = 0; i < width * step; i += step) {
-                    pix = fsym;
-                    if (use_pred) {
-                        prev += pix;
-                        prev &= 0x3FF;
-                        pix   = prev;
-                    }
-                    dest[i] = pix;
-                }
-                dest += stride;
-            }
-        }
-        return 0;
-    }
-
-    send = 0;
-    for (slice = 0; slice < c->slices; slice++) {
-        uint16_t *dest;
-        int slice_data_start, slice_data_end, slice_size;
-
-        sstart = send;
-        send   = (height * (slice + 1) / c->slices);
-        dest   = dst + sstart * stride;
+    int prev;
+    int slice_data_start, slice_data_end, slice_size;
 
-        // slice offset and size validation was done earlier
-        slice_data_start = slice ? AV_RL32(src + slice * 4 - 4) : 0;
-        slice_data_end   = AV_RL32(src + slice * 4);
-        slice_size       = slice_data_end - slice_data_start;
-
-        if (!slice_size) {
-            av_log(c->avctx, AV_LOG_ERROR, "Plane has more than one symbol "
-                   "yet a slice has a length of zero.\n");
-            goto fail;
-        }
-
-        memcpy(c->slice_bits, src + slice_data_start + c->slices * 4,
-               slice_size);
-        memset(c->slice_bits + slice_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
-        c->bdsp.bswap_buf((uint32_t *) c->slice_bits,
-                          (uint32_t *) c->slice_bits,
-                          (slice_data_end - slice_data_start + 3) >> 2);
-        init_get_bits(&gb, c->slice_bits, slice_size * 8);
+    sstart = (height *  slice)      / c->slices;
+    send   = (height * (slice + 1)) / c->slices;
+    dst   += sstart * stride;
 
+    if (fsym >= 0) { // build_huff reported a symbol to fill slices with
         prev = 0x200;
         for (j = sstart; j < send; j++) {
             for (i = 0; i < width * step; i += step) {
-                if (get_bits_left(&gb) <= 0) {
-                    av_log(c->avctx, AV_LOG_ERROR,
-                           "Slice decoding ran out of bits\n");
-                    goto fail;
-                }
-                pix = get_vlc2(&gb, vlc.table, vlc.bits, 3);
-                if (pix < 0) {
-                    av_log(c->avctx, AV_LOG_ERROR, "Decoding error\n");
-                    goto fail;
-                }
+                pix = fsym;
                 if (use_pred) {
                     prev += pix;
                     prev &= 0x3FF;
                     pix   = prev;
                 }
-                dest[i] = pix;
+                dst[i] = pix;
             }
-            dest += stride;
+            dst += stride;
         }
-        if (get_bits_left(&gb) > 32)
-            av_log(c->avctx, AV_LOG_WARNING,
-                   "%d bits left after decoding slice\n", get_bits_left(&gb));
+        return 0;
+    }
+
+    // slice offset and size validation was done earlier
+    slice_data_start = slice ? AV_RL32(src + slice * 4 - 4) : 0;
+    slice_data_end   = AV_RL32(src + slice * 4);
+    slice_size       = slice_data_end - slice_data_start;
+
+    if (!slice_size) {
+        av_log(c->avctx, AV_LOG_ERROR, "Plane has more than one symbol "
+               "yet a slice has a length of zero.\n");
+        return AVERROR_INVALIDDATA;
     }
 
-    ff_free_vlc(&vlc);
+    memcpy(slice_bits, src + slice_data_start + c->slices * 4, slice_size);
+    memset(slice_bits + slice_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    c->bdsp.bswap_buf((uint32_t *) slice_bits, (uint32_t *) slice_bits,
+                      (slice_data_end - slice_data_start + 3) >> 2);
+    init_get_bits(&gb, slice_bits, slice_size * 8);
+
+    prev = 0x200;
+    for (j = sstart; j < send; j++) {
+        for (i = 0; i < width * step; i += step) {
+            if (get_bits_left(&gb) <= 0) {
+                av_log(c->avctx, AV_LOG_ERROR,
+                       "Slice decoding ran out of bits\n");
+                return AVERROR_INVALIDDATA;
+            }
+            pix = get_vlc2(&gb, vlc->table, vlc->bits, 3);
+            if (pix < 0) {
+                av_log(c->avctx, AV_LOG_ERROR, "Decoding error\n");
+                return AVERROR_INVALIDDATA;
+            }
+            if (use_pred) {
+                prev += pix;
+                prev &= 0x3FF;
+                pix   = prev;
+            }
+            dst[i] = pix;
+        }
+        dst += stride;
+    }
+    if (get_bits_left(&gb) > 32)
+        av_log(c->avctx, AV_LOG_WARNING,
+               "%d bits left after decoding slice\n", get_bits_left(&gb));
 
     return 0;
-fail:
-    ff_free_vlc(&vlc);
-    return AVERROR_INVALIDDATA;
 }
 
-static int decode_plane(UtvideoContext *c, int plane_no,
+static int decode_plane(UtvideoContext *c, int plane_no, int slice,
+                        uint8_t *slice_bits, VLC *vlc, int fsym,
                         uint8_t *dst, int step, int stride,
                         int width, int height,
                         const uint8_t *src, int use_pred)
 {
-    int i, j, slice, pix;
+    int i, j, pix;
     int sstart, send;
-    VLC vlc;
     GetBitContext gb;
-    int prev, fsym;
+    int prev;
+    int slice_data_start, slice_data_end, slice_size;
     const int cmask = ~(!plane_no && c->avctx->pix_fmt == AV_PIX_FMT_YUV420P);
 
-    if (build_huff(src, &vlc, &fsym)) {
-        av_log(c->avctx, AV_LOG_ERROR, "Cannot build Huffman codes\n");
-        return AVERROR_INVALIDDATA;
-    }
+    sstart = ((height *  slice)      / c->slices) & cmask;
+    send   = ((height * (slice + 1)) / c->slices) & cmask;
+    dst   += sstart * stride;
+
     if (fsym >= 0) { // build_huff reported a symbol to fill slices with
-        send = 0;
-        for (slice = 0; slice < c->slices; slice++) {
-            uint8_t *dest;
-
-            sstart = send;
-            send   = (height * (slice + 1) / c->slices) & cmask;
-            dest   = dst + sstart * stride;
-
-            prev = 0x80;
-            for (j = sstart; j < send; j++) {
-                for (i = 0; i < width * step; i += step) {
-                    pix = fsym;
-                    if (use_pred) {
-                        prev += pix;
-                        pix   = prev;
-                    }
-                    dest[i] = pix;
+        prev = 0x80;
+        for (j = sstart; j < send; j++) {
+            for (i = 0; i < width * step; i += step) {
+                pix = fsym;
+                if (use_pred) {
+                    prev += pix;
+                    pix   = prev;
                 }
-                dest += stride;
+                dst[i] = pix;
             }
+            dst += stride;
         }
         return 0;
     }
 
-    src      += 256;
-
-    send = 0;
-    for (slice = 0; slice < c->slices; slice++) {
-        uint8_t *dest;
-        int slice_data_start, slice_data_end, slice_size;
+    // slice offset and size validation was done earlier
+    slice_data_start = slice ? AV_RL32(src + slice * 4 - 4) : 0;
+    slice_data_end   = AV_RL32(src + slice * 4);
+    slice_size       = slice_data_end - slice_data_start;
 
-        sstart = send;
-        send   = (height * (slice + 1) / c->slices) & cmask;
-        dest   = dst + sstart * stride;
-
-        // slice offset and size validation was done earlier
-        slice_data_start = slice ? AV_RL32(src + slice * 4 - 4) : 0;
-        slice_data_end   = AV_RL32(src + slice * 4);
-        slice_size       = slice_data_end - slice_data_start;
-
-        if (!slice_size) {
-            av_log(c->avctx, AV_LOG_ERROR, "Plane has more than one symbol "
-                   "yet a slice has a length of zero.\n");
-            goto fail;
-        }
+    if (!slice_size) {
+        av_log(c->avctx, AV_LOG_ERROR, "Plane has more than one symbol "
+               "yet a slice has a length of zero.\n");
+        return AVERROR_INVALIDDATA;
+    }
 
-        memcpy(c->slice_bits, src + slice_data_start + c->slices * 4,
-               slice_size);
-        memset(c->slice_bits + slice_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
-        c->bdsp.bswap_buf((uint32_t *) c->slice_bits,
-                          (uint32_t *) c->slice_bits,
-                          (slice_data_end - slice_data_start + 3) >> 2);
-        init_get_bits(&gb, c->slice_bits, slice_size * 8);
+    memcpy(slice_bits, src + slice_data_start + c->slices * 4, slice_size);
+    memset(slice_bits + slice_size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    c->bdsp.bswap_buf((uint32_t *) slice_bits, (uint32_t *) slice_bits,
+                      (slice_data_end - slice_data_start + 3) >> 2);
+    init_get_bits(&gb, slice_bits, slice_size * 8);
 
-        prev = 0x80;
-        for (j = sstart; j < send; j++) {
-            for (i = 0; i < width * step; i += step) {
-                if (get_bits_left(&gb) <= 0) {
-                    av_log(c->avctx, AV_LOG_ERROR,
-                           "Slice decoding ran out of bits\n");
-                    goto fail;
-                }
-                pix = get_vlc2(&gb, vlc.table, vlc.bits, 3);
-                if (pix < 0) {
-                    av_log(c->avctx, AV_LOG_ERROR, "Decoding error\n");
-                    goto fail;
-                }
-                if (use_pred) {
-                    prev += pix;
-                    pix   = prev;
-                }
-                dest[i] = pix;
+    prev = 0x80;
+    for (j = sstart; j < send; j++) {
+        for (i = 0; i < width * step; i += step) {
+            if (get_bits_left(&gb) <= 0) {
+                av_log(c->avctx, AV_LOG_ERROR,
+                       "Slice decoding ran out of bits\n");
+                return AVERROR_INVALIDDATA;
+            }
+            pix = get_vlc2(&gb, vlc->table, vlc->bits, 3);
+            if (pix < 0) {
+                av_log(c->avctx, AV_LOG_ERROR, "Decoding error\n");
+                return AVERROR_INVALIDDATA;
+            }
+            if (use_pred) {
+                prev += pix;
+                pix   = prev;
             }
-            dest += stride;
+            dst[i] = pix;
         }
-        if (get_bits_left(&gb) > 32)
-            av_log(c->avctx, AV_LOG_WARNING,
-                   "%d bits left after decoding slice\n", get_bits_left(&gb));
+        dst += stride;
     }
-
-    ff_free_vlc(&vlc);
+    if (get_bits_left(&gb) > 32)
+        av_log(c->avctx, AV_LOG_WARNING,
+               "%d bits left after decoding slice\n", get_bits_left(&gb));
 
     return 0;
-fail:
-    ff_free_vlc(&vlc);
-    return AVERROR_INVALIDDATA;
 }
 
 static void restore_rgb_planes(uint8_t *src, int step, int stride, int width,
@@ -350,15 +305,16 @@ static void restore_rgb_planes(uint8_t *src, int step, int stride, int width,
     }
 }
 
-static void restore_rgb_planes10(AVFrame *frame, int width, int height)
+static void restore_rgb_planes10(AVFrame *frame, int width,
+                                 int y_start, int y_end)
 {
-    uint16_t *src_r = (uint16_t *)frame->data[2];
-    uint16_t *src_g = (uint16_t *)frame->data[0];
-    uint16_t *src_b = (uint16_t *)frame->data[1];
+    uint16_t *src_r = (uint16_t *)frame->data[2] + y_start * (frame->linesize[2] / 2);
+    uint16_t *src_g = (uint16_t *)frame->data[0] + y_start * (frame->linesize[0] / 2);
+    uint16_t *src_b = (uint16_t *)frame->data[1] + y_start * (frame->linesize[1] / 2);
     int r, g, b;
     int i, j;
 
-    for (j = 0; j < height; j++) {
+    for (j = y_start; j < y_end; j++) {
         for (i = 0; i < width; i++) {
             r = src_r[i];
             g = src_g[i];
@@ -372,55 +328,80 @@ static void restore_rgb_planes10(AVFrame *frame, int width, int height)
     }
 }
 
-static void restore_median(uint8_t *src, int step, int stride,
-                           int width, int height, int slices, int rmode)
+/**
+ * Restore median prediction of one line. Planar lines use the
+ * HuffYUV DSP function; it may write up to 15 bytes past the line, which
+ * stays within the frame padding as long as the line start is aligned.
+ */
+static av_always_inline void restore_median_line(UtvideoContext *c,
+                                                 uint8_t *dst, const uint8_t *src_top,
+                                                 int step, int width,
+                                                 int *left, int *topleft)
+{
+    int i, top;
+
+    if (step == 1) {
+        c->hdspdec.add_hfyu_median_pred(dst, src_top, dst, width, left, topleft);
+        return;
+    }
+    for (i = 0; i < width * step; i += step) {
+        top      = src_top[i];
+        dst[i]  += mid_pred(*left, top, (uint8_t)(*left + top - *topleft));
+        *topleft = top;
+        *left    = dst[i];
+    }
+}
+
+static void restore_median(UtvideoContext *c, uint8_t *src, int step,
+                           int stride, int width, int height, int slices,
+                           int slice, int rmode)
 {
-    int i, j, slice;
-    int A, B, C;
+    int i, j;
+    int left, top, topleft;
     uint8_t *bsrc;
     int slice_start, slice_height;
     const int cmask = ~rmode;
-
-    for (slice = 0; slice < slices; slice++) {
-        slice_start  = ((slice * height) / slices) & cmask;
-        slice_height = ((((slice + 1) * height) / slices) & cmask) -
-                       slice_start;
-
-        if (!slice_height)
-            continue;
-        bsrc = src + slice_start * stride;
-
-        // first line - left neighbour prediction
-        bsrc[0] += 0x80;
-        A = bsrc[0];
-        for (i = step; i < width * step; i += step) {
-            bsrc[i] += A;
-            A        = bsrc[i];
-        }
-        bsrc += stride;
-        if (slice_height <= 1)
-            continue;
-        // second line - first element has top prediction, the rest uses median
-        C        = bsrc[-stride];
-        bsrc[0] += C;
-        A        = bsrc[0];
-        for (i = step; i < width * step; i += step) {
-            B        = bsrc[i - stride];
-            bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
-            C        = B;
-            A        = bsrc[i];
-        }
+    /* the first elements of the second line are restored without the DSP
+     * function to keep its start aligned */
+    const int head  = step == 1 ? FFMIN(width, 16) : width;
+
+    slice_start  = ((slice * height) / slices) & cmask;
+    slice_height = ((((slice + 1) * height) / slices) & cmask) -
+                   slice_start;
+
+    if (!slice_height)
+        return;
+    bsrc = src + slice_start * stride;
+
+    // first line - left neighbour prediction
+    bsrc[0] += 0x80;
+    left = bsrc[0];
+    for (i = step; i < width * step; i += step) {
+        bsrc[i] += left;
+        left     = bsrc[i];
+    }
+    bsrc += stride;
+    if (slice_height <= 1)
+        return;
+    // second line - first element has top prediction, the rest uses median
+    topleft  = bsrc[-stride];
+    bsrc[0] += topleft;
+    left     = bsrc[0];
+    for (i = step; i < head * step; i += step) {
+        top      = bsrc[i - stride];
+        bsrc[i] += mid_pred(left, top, (uint8_t)(left + top - topleft));
+        topleft  = top;
+        left     = bsrc[i];
+    }
+    if (width > head)
+        restore_median_line(c, bsrc + head, bsrc + head - stride, step,
+                            width - head, &left, &topleft);
+    bsrc += stride;
+    // the rest of lines use continuous median prediction
+    for (j = 2; j < slice_height; j++) {
+        restore_median_line(c, bsrc, bsrc - stride, step, width,
+                            &left, &topleft);
         bsrc += stride;
-        // the rest of lines use continuous median prediction
-        for (j = 2; j < slice_height; j++) {
-            for (i = 0; i < width * step; i += step) {
-                B        = bsrc[i - stride];
-                bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
-                C        = B;
-                A        = bsrc[i];
-            }
-            bsrc += stride;
-        }
     }
 }
 
@@ -428,74 +409,201 @@ static void restore_median(uint8_t *src, int step, int stride,
  * so restoring function should take care of possible padding between
  * two parts of the same "line".
  */
-static void restore_median_il(uint8_t *src, int step, int stride,
-                              int width, int height, int slices, int rmode)
+static void restore_median_il(UtvideoContext *c, uint8_t *src, int step,
+                              int stride, int width, int height, int slices,
+                              int slice, int rmode)
 {
-    int i, j, slice;
-    int A, B, C;
+    int i, j;
+    int left, top, topleft;
     uint8_t *bsrc;
     int slice_start, slice_height;
     const int cmask   = ~(rmode ? 3 : 1);
     const int stride2 = stride << 1;
+    const int head    = step == 1 ? FFMIN(width, 16) : width;
+
+    slice_start    = ((slice * height) / slices) & cmask;
+    slice_height   = ((((slice + 1) * height) / slices) & cmask) -
+                     slice_start;
+    slice_height >>= 1;
+    if (!slice_height)
+        return;
+
+    bsrc = src + slice_start * stride;
+
+    // first line - left neighbour prediction
+    bsrc[0] += 0x80;
+    left     = bsrc[0];
+    for (i = step; i < width * step; i += step) {
+        bsrc[i] += left;
+        left     = bsrc[i];
+    }
+    for (i = 0; i < width * step; i += step) {
+        bsrc[stride + i] += left;
+        left              = bsrc[stride + i];
+    }
+    bsrc += stride2;
+    if (slice_height <= 1)
+        return;
+    // second line - first element has top prediction, the rest uses median
+    topleft  = bsrc[-stride2];
+    bsrc[0] += topleft;
+    left     = bsrc[0];
+    for (i = step; i < head * step; i += step) {
+        top      = bsrc[i - stride2];
+        bsrc[i] += mid_pred(left, top, (uint8_t)(left + top - topleft));
+        topleft  = top;
+        left     = bsrc[i];
+    }
+    if (width > head)
+        restore_median_line(c, bsrc + head, bsrc + head - stride2, step,
+                            width - head, &left, &topleft);
+    restore_median_line(c, bsrc + stride, bsrc, step, width, &left, &topleft);
+    bsrc += stride2;
+    // the rest of lines use continuous median prediction
+    for (j = 2; j < slice_height; j++) {
+        restore_median_line(c, bsrc, bsrc - stride2, step, width,
+                            &left, &topleft);
+        restore_median_line(c, bsrc + stride, bsrc, step, width,
+                            &left, &topleft);
+        bsrc += stride2;
+    }
+}
+
+/**
+ * Decode one slice of every plane. Slices are coded independently, so
+ * they can be processed in parallel. Median prediction is restored here
+ * too, unless the frame is interlaced: interlaced restoration rounds the
+ * slice boundaries differently and is done by restore_slice_il().
+ */
+static int decode_slice(AVCodecContext *avctx, void *arg, int slice, int threadnr)
+{
+    UtvideoContext *c     = avctx->priv_data;
+    UtvideoFrameContext *f = arg;
+    AVFrame *frame        = f->frame;
+    uint8_t *slice_bits   = c->slice_bits + threadnr * f->slice_bits_size;
+    const int use_pred    = c->frame_pred == PRED_LEFT;
+    const int median      = c->frame_pred == PRED_MEDIAN && !c->interlaced;
+    int i, ret, sstart, send;
 
-    for (slice = 0; slice < slices; slice++) {
-        slice_start    = ((slice * height) / slices) & cmask;
-        slice_height   = ((((slice + 1) * height) / slices) & cmask) -
-                         slice_start;
-        slice_height >>= 1;
-        if (!slice_height)
-            continue;
-
-        bsrc = src + slice_start * stride;
-
-        // first line - left neighbour prediction
-        bsrc[0] += 0x80;
-        A        = bsrc[0];
-        for (i = step; i < width * step; i += step) {
-            bsrc[i] += A;
-            A        = bsrc[i];
+    switch (c->avctx->pix_fmt) {
+    case AV_PIX_FMT_RGB24:
+    case AV_PIX_FMT_RGBA:
+        for (i = 0; i < c->planes; i++) {
+            ret = decode_plane(c, i, slice, slice_bits, &f->vlc[i], f->fsym[i],
+                               frame->data[0] + ff_ut_rgb_order[i],
+                               c->planes, frame->linesize[0], avctx->width,
+                               avctx->height, f->plane_start[i] + 256,
+                               use_pred);
+            if (ret)
+                return ret;
+            if (median)
+                restore_median(c, frame->data[0] + ff_ut_rgb_order[i],
+                               c->planes, frame->linesize[0], avctx->width,
+                               avctx->height, c->slices, slice, 0);
         }
-        for (i = 0; i < width * step; i += step) {
-            bsrc[stride + i] += A;
-            A                 = bsrc[stride + i];
+        if (c->frame_pred != PRED_MEDIAN || !c->interlaced) {
+            sstart = (avctx->height *  slice)      / c->slices;
+            send   = (avctx->height * (slice + 1)) / c->slices;
+            restore_rgb_planes(frame->data[0] + sstart * frame->linesize[0],
+                               c->planes, frame->linesize[0],
+                               avctx->width, send - sstart);
         }
-        bsrc += stride2;
-        if (slice_height <= 1)
-            continue;
-        // second line - first element has top prediction, the rest uses median
-        C        = bsrc[-stride2];
-        bsrc[0] += C;
-        A        = bsrc[0];
-        for (i = step; i < width * step; i += step) {
-            B        = bsrc[i - stride2];
-            bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
-            C        = B;
-            A        = bsrc[i];
+        break;
+    case AV_PIX_FMT_GBRAP10:
+    case AV_PIX_FMT_GBRP10:
+        for (i = 0; i < c->planes; i++) {
+            ret = decode_plane10(c, slice, slice_bits, &f->vlc[i], f->fsym[i],
+                                 (uint16_t *)frame->data[i], 1,
+                                 frame->linesize[i] / 2, avctx->width,
+                                 avctx->height, f->plane_start[i], use_pred);
+            if (ret)
+                return ret;
         }
-        for (i = 0; i < width * step; i += step) {
-            B                 = bsrc[i - stride];
-            bsrc[stride + i] += mid_pred(A, B, (uint8_t)(A + B - C));
-            C                 = B;
-            A                 = bsrc[stride + i];
+        sstart = (avctx->height *  slice)      / c->slices;
+        send   = (avctx->height * (slice + 1)) / c->slices;
+        restore_rgb_planes10(frame, avctx->width, sstart, send);
+        break;
+    case AV_PIX_FMT_YUV420P:
+        for (i = 0; i < 3; i++) {
+            ret = decode_plane(c, i, slice, slice_bits, &f->vlc[i], f->fsym[i],
+                               frame->data[i], 1, frame->linesize[i],
+                               avctx->width >> !!i, avctx->height >> !!i,
+                               f->plane_start[i] + 256, use_pred);
+            if (ret)
+                return ret;
+            if (median)
+                restore_median(c, frame->data[i], 1, frame->linesize[i],
+                               avctx->width >> !!i, avctx->height >> !!i,
+                               c->slices, slice, !i);
         }
-        bsrc += stride2;
-        // the rest of lines use continuous median prediction
-        for (j = 2; j < slice_height; j++) {
-            for (i = 0; i < width * step; i += step) {
-                B        = bsrc[i - stride2];
-                bsrc[i] += mid_pred(A, B, (uint8_t)(A + B - C));
-                C        = B;
-                A        = bsrc[i];
-            }
-            for (i = 0; i < width * step; i += step) {
-                B                 = bsrc[i - stride];
-                bsrc[i + stride] += mid_pred(A, B, (uint8_t)(A + B - C));
-                C                 = B;
-                A                 = bsrc[i + stride];
-            }
-            bsrc += stride2;
+        break;
+    case AV_PIX_FMT_YUV422P:
+        for (i = 0; i < 3; i++) {
+            ret = decode_plane(c, i, slice, slice_bits, &f->vlc[i], f->fsym[i],
+                               frame->data[i], 1, frame->linesize[i],
+                               avctx->width >> !!i, avctx->height,
+                               f->plane_start[i] + 256, use_pred);
+            if (ret)
+                return ret;
+            if (median)
+                restore_median(c, frame->data[i], 1, frame->linesize[i],
+                               avctx->width >> !!i, avctx->height,
+                               c->slices, slice, 0);
+        }
+        break;
+    case AV_PIX_FMT_YUV422P10:
+        for (i = 0; i < 3; i++) {
+            ret = decode_plane10(c, slice, slice_bits, &f->vlc[i], f->fsym[i],
+                                 (uint16_t *)frame->data[i], 1,
+                                 frame->linesize[i] / 2,
+                                 avctx->width >> !!i, avctx->height,
+                                 f->plane_start[i], use_pred);
+            if (ret)
+                return ret;
         }
+        break;
+    }
+
+    return 0;
+}
+
+static int restore_slice_il(AVCodecContext *avctx, void *arg, int slice, int threadnr)
+{
+    UtvideoContext *c     = avctx->priv_data;
+    UtvideoFrameContext *f = arg;
+    AVFrame *frame        = f->frame;
+    int i, sstart, send;
+
+    switch (c->avctx->pix_fmt) {
+    case AV_PIX_FMT_RGB24:
+    case AV_PIX_FMT_RGBA:
+        for (i = 0; i < c->planes; i++)
+            restore_median_il(c, frame->data[0] + ff_ut_rgb_order[i],
+                              c->planes, frame->linesize[0], avctx->width,
+                              avctx->height, c->slices, slice, 0);
+        /* cover the lines restored above, and any odd last line */
+        sstart = ((avctx->height * slice) / c->slices) & ~1;
+        send   = slice == c->slices - 1 ? avctx->height :
+                 ((avctx->height * (slice + 1)) / c->slices) & ~1;
+        restore_rgb_planes(frame->data[0] + sstart * frame->linesize[0],
+                           c->planes, frame->linesize[0],
+                           avctx->width, send - sstart);
+        break;
+    case AV_PIX_FMT_YUV420P:
+        for (i = 0; i < 3; i++)
+            restore_median_il(c, frame->data[i], 1, frame->linesize[i],
+                              avctx->width  >> !!i, avctx->height >> !!i,
+                              c->slices, slice, !i);
+        break;
+    case AV_PIX_FMT_YUV422P:
+        for (i = 0; i < 3; i++)
+            restore_median_il(c, frame->data[i], 1, frame->linesize[i],
+                              avctx->width >> !!i, avctx->height,
+                              c->slices, slice, 0);
+        break;
     }
+
+    return 0;
 }
 
 static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
@@ -504,10 +612,12 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
     const uint8_t *buf = avpkt->data;
     int buf_size = avpkt->size;
     UtvideoContext *c = avctx->priv_data;
+    UtvideoFrameContext f = { .frame = data };
     int i, j;
     const uint8_t *plane_start[5];
     int plane_size, max_slice_size = 0, slice_start, slice_end, slice_size;
-    int ret;
+    int ret, nb_threads;
+    int slice_ret[256];
     GetByteContext gb;
     ThreadFrame frame = { .f = data };
 
@@ -588,105 +698,42 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
         return AVERROR_PATCHWELCOME;
     }
 
+    nb_threads = avctx->active_thread_type & FF_THREAD_SLICE ?
+                 FFMAX(avctx->thread_count, 1) : 1;
+    f.slice_bits_size = FFALIGN(max_slice_size + AV_INPUT_BUFFER_PADDING_SIZE, 16);
+    if (f.slice_bits_size > INT_MAX / nb_threads)
+        return AVERROR(ENOMEM);
     av_fast_malloc(&c->slice_bits, &c->slice_bits_size,
-                   max_slice_size + AV_INPUT_BUFFER_PADDING_SIZE);
+                   f.slice_bits_size * nb_threads);
 
     if (!c->slice_bits) {
         av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer\n");
         return AVERROR(ENOMEM);
     }
 
-    switch (c->avctx->pix_fmt) {
-    case AV_PIX_FMT_RGB24:
-    case AV_PIX_FMT_RGBA:
-        for (i = 0; i < c->planes; i++) {
-            ret = decode_plane(c, i, frame.f->data[0] + ff_ut_rgb_order[i],
-                               c->planes, frame.f->linesize[0], avctx->width,
-                               avctx->height, plane_start[i],
-                               c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
-            if (c->frame_pred == PRED_MEDIAN) {
-                if (!c->interlaced) {
-                    restore_median(frame.f->data[0] + ff_ut_rgb_order[i],
-                                   c->planes, frame.f->linesize[0], avctx->width,
-                                   avctx->height, c->slices, 0);
-                } else {
-                    restore_median_il(frame.f->data[0] + ff_ut_rgb_order[i],
-                                      c->planes, frame.f->linesize[0],
-                                      avctx->width, avctx->height, c->slices,
-                                      0);
-                }
-            }
-        }
-        restore_rgb_planes(frame.f->data[0], c->planes, frame.f->linesize[0],
-                           avctx->width, avctx->height);
-        break;
-    case AV_PIX_FMT_GBRAP10:
-    case AV_PIX_FMT_GBRP10:
-        for (i = 0; i < c->planes; i++) {
-            ret = decode_plane10(c, i, (uint16_t *)frame.f->data[i], 1,
-                                 frame.f->linesize[i] / 2, avctx->width,
-                                 avctx->height, plane_start[i],
-                                 plane_start[i + 1] - 1024,
-                                 c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
+    for (i = 0; i < c->planes; i++) {
+        f.plane_start[i] = plane_start[i];
+        if (avctx->pix_fmt == AV_PIX_FMT_GBRAP10 ||
+            avctx->pix_fmt == AV_PIX_FMT_GBRP10  ||
+            avctx->pix_fmt == AV_PIX_FMT_YUV422P10)
+            ret = build_huff10(plane_start[i + 1] - 1024, &f.vlc[i], &f.fsym[i]);
+        else
+            ret = build_huff(plane_start[i], &f.vlc[i], &f.fsym[i]);
+        if (ret) {
+            av_log(avctx, AV_LOG_ERROR, "Cannot build Huffman codes\n");
+            ret = AVERROR_INVALIDDATA;
+            goto end;
         }
-        restore_rgb_planes10(frame.f, avctx->width, avctx->height);
-        break;
-    case AV_PIX_FMT_YUV420P:
-        for (i = 0; i < 3; i++) {
-            ret = decode_plane(c, i, frame.f->data[i], 1, frame.f->linesize[i],
-                               avctx->width >> !!i, avctx->height >> !!i,
-                               plane_start[i], c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
-            if (c->frame_pred == PRED_MEDIAN) {
-                if (!c->interlaced) {
-                    restore_median(frame.f->data[i], 1, frame.f->linesize[i],
-                                   avctx->width >> !!i, avctx->height >> !!i,
-                                   c->slices, !i);
-                } else {
-                    restore_median_il(frame.f->data[i], 1, frame.f->linesize[i],
-                                      avctx->width  >> !!i,
-                                      avctx->height >> !!i,
-                                      c->slices, !i);
-                }
-            }
-        }
-        break;
-    case AV_PIX_FMT_YUV422P:
-        for (i = 0; i < 3; i++) {
-            ret = decode_plane(c, i, frame.f->data[i], 1, frame.f->linesize[i],
-                               avctx->width >> !!i, avctx->height,
-                               plane_start[i], c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
-            if (c->frame_pred == PRED_MEDIAN) {
-                if (!c->interlaced) {
-                    restore_median(frame.f->data[i], 1, frame.f->linesize[i],
-                                   avctx->width >> !!i, avctx->height,
-                                   c->slices, 0);
-                } else {
-                    restore_median_il(frame.f->data[i], 1, frame.f->linesize[i],
-                                      avctx->width >> !!i, avctx->height,
-                                      c->slices, 0);
-                }
-            }
-        }
-        break;
-    case AV_PIX_FMT_YUV422P10:
-        for (i = 0; i < 3; i++) {
-            ret = decode_plane10(c, i, (uint16_t *)frame.f->data[i], 1, frame.f->linesize[i] / 2,
-                                 avctx->width >> !!i, avctx->height,
-                                 plane_start[i], plane_start[i + 1] - 1024, c->frame_pred == PRED_LEFT);
-            if (ret)
-                return ret;
-        }
-        break;
     }
 
+    avctx->execute2(avctx, decode_slice, &f, slice_ret, c->slices);
+    for (i = 0; i < c->slices; i++) {
+        if ((ret = slice_ret[i]) < 0)
+            goto end;
+    }
+    if (c->frame_pred == PRED_MEDIAN && c->interlaced)
+        avctx->execute2(avctx, restore_slice_il, &f, NULL, c->slices);
+
     frame.f->key_frame = 1;
     frame.f->pict_type = AV_PICTURE_TYPE_I;
     frame.f->interlaced_frame = !!c->interlaced;
@@ -694,7 +741,11 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
     *got_frame = 1;
 
     /* always report that the buffer was completely consumed */
-    return buf_size;
+    ret = buf_size;
+end:
+    for (i = 0; i < c->planes; i++)
+        ff_free_vlc(&f.vlc[i]);
+    return ret;
 }
 
 static av_cold int decode_init(AVCodecContext *avctx)
@@ -704,6 +755,7 @@ static av_cold int decode_init(AVCodecContext *avctx)
     c->avctx = avctx;
 
     ff_bswapdsp_init(&c->bdsp);
+    ff_huffyuvdsp_init(&c->hdspdec);
 
     if (avctx->extradata_size >= 16) {
         av_log(avctx, AV_LOG_DEBUG, "Encoder version %d.%d.%d.%d\n",
@@ -806,5 +858,6 @@ AVCodec ff_utvideo_decoder = {
     .init           = decode_init,
     .close          = decode_end,
     .decode         = decode_frame,
-    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS,
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS,
 };
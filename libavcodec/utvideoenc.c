@@ -289,7 +289,7 @@ static void median_predict(UtvideoContext *c, uint8_t *src, uint8_t *dst, int st
                            int width, int height)
 {
     int i, j;
-    int A, B;
+    int left, left_top;
     uint8_t prev;
 
     /* First line uses left neighbour prediction */
@@ -308,11 +308,11 @@ static void median_predict(UtvideoContext *c, uint8_t *src, uint8_t *dst, int st
      * Second line uses top prediction for the first sample,
      * and median for the rest.
      */
-    A = B = 0;
+    left = left_top = 0;
 
     /* Rest of the coded part uses median prediction */
     for (j = 1; j < height; j++) {
-        c->hdsp.sub_hfyu_median_pred(dst, src - stride, src, width, &A, &B);
+        c->hdsp.sub_hfyu_median_pred(dst, src - stride, src, width, &left, &left_top);
         dst += width;
         src += stride;
     }
@@ -27,6 +27,7 @@
 #include "audio.h"
 #include "avfilter.h"
 #include "internal.h"
+#include "profile.h"
 
 AVFrame *ff_null_get_audio_buffer(AVFilterLink *link, int nb_samples)
 {
@@ -58,6 +59,7 @@ AVFrame *ff_default_get_audio_buffer(AVFilterLink *link, int nb_samples)
     av_samples_set_silence(frame->extended_data, 0, nb_samples, channels,
                            link->format);
 
+    ff_profile_frame_alloc(link->dst->graph, frame);
 
     return frame;
 }
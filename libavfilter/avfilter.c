@@ -29,15 +29,18 @@
 #include "libavutil/hwcontext.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/internal.h"
+#include "libavutil/latency.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
 
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "internal.h"
+#include "profile.h"
 
 #include "libavutil/ffversion.h"
 const char av_filter_ffversion[] = "FFmpeg version " FFMPEG_VERSION;
@@ -383,9 +386,16 @@ int ff_request_frame_to_filter(AVFilterLink *link)
 
     FF_TPRINTF_START(NULL, request_frame_to_filter); ff_tlog_link(NULL, link, 1);
     link->frame_wanted_in = 0;
-    if (link->srcpad->request_frame)
-        ret = link->srcpad->request_frame(link);
-    else if (link->src->inputs[0])
+    if (link->srcpad->request_frame) {
+        if (ff_profile_enabled(link->src)) {
+            FFProfileScope scope;
+            ff_profile_enter(link->src, &scope);
+            ret = link->srcpad->request_frame(link);
+            ff_profile_leave(link->src, &scope, 1);
+        } else {
+            ret = link->srcpad->request_frame(link);
+        }
+    } else if (link->src->inputs[0])
         ret = ff_request_frame(link->src->inputs[0]);
     if (ret == AVERROR_EOF && link->partial_buf) {
         AVFrame *pbuf = link->partial_buf;
@@ -635,7 +645,10 @@ static int default_execute(AVFilterContext *ctx, avfilter_action_func *func, voi
     int i;
 
     for (i = 0; i < nb_jobs; i++) {
+        int64_t start = ff_profile_enabled(ctx) ? av_gettime_relative() : 0;
         int r = func(ctx, arg, i, nb_jobs);
+        if (start)
+            ff_profile_slice_job(ctx, 0, av_gettime_relative() - start);
         if (ret)
             ret[i] = r;
     }
@@ -777,6 +790,7 @@ void avfilter_free(AVFilterContext *filter)
     av_expr_free(filter->enable);
     filter->enable = NULL;
     av_freep(&filter->var_values);
+    ff_profile_free(filter);
     av_freep(&filter->internal);
     av_free(filter);
 }
@@ -1037,6 +1051,16 @@ static int default_filter_frame(AVFilterLink *link, AVFrame *frame)
     return ff_filter_frame(link->dst->outputs[0], frame);
 }
 
+static void latency_mark_filter(AVFrame *frame)
+{
+    AVLatencyRecord *rec;
+
+    if (!frame->nb_side_data || !(rec = av_latency_record_get_writable(frame)))
+        return;
+    if (rec->nb_filters < AV_LATENCY_MAX_FILTERS)
+        rec->filter_in[rec->nb_filters++] = av_gettime_relative();
+}
+
 static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame)
 {
     int (*filter_frame)(AVFilterLink *, AVFrame *);
@@ -1052,6 +1076,8 @@ static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame)
         return link->status;
     }
 
+    latency_mark_filter(frame);
+
     if (!(filter_frame = dst->filter_frame))
         filter_frame = default_filter_frame;
 
@@ -1122,7 +1148,14 @@ static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame)
             (dstctx->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC))
             filter_frame = default_filter_frame;
     }
-    ret = filter_frame(link, out);
+    if (ff_profile_enabled(dstctx)) {
+        FFProfileScope scope;
+        ff_profile_enter(dstctx, &scope);
+        ret = filter_frame(link, out);
+        ff_profile_leave(dstctx, &scope, 0);
+    } else {
+        ret = filter_frame(link, out);
+    }
     link->frame_count++;
     ff_update_link_current_pts(link, pts);
     return ret;
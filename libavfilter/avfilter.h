@@ -831,6 +831,15 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * If set, the time spent in each filter and the buffers it allocates are
+     * recorded, see avfilter_graph_profile_dump(). Must be set before the
+     * graph starts processing frames.
+     *
+     * Access ONLY through AVOptions.
+     */
+    int profile;
+
     /**
      * Private fields
      *
@@ -1090,6 +1099,23 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
  */
 char *avfilter_graph_dump(AVFilterGraph *graph, const char *options);
 
+/**
+ * Dump the profiling data of a graph as a JSON object.
+ *
+ * The object has a "filters" array with one entry per filter, giving the
+ * number of frames and requests processed, the processing rate in frames
+ * per second of filter time, the total, average, 99th percentile and
+ * maximum time in microseconds spent per filter_frame() call, the time
+ * spent in request_frame(), the bytes of frame buffers allocated, and the
+ * number of slice jobs and their time per thread. The time a filter spends
+ * calling into other filters is not accounted to it.
+ *
+ * @param graph  the graph to dump, with profiling enabled
+ * @return  a string, or NULL in case of memory allocation failure;
+ *          the string must be freed using av_free
+ */
+char *avfilter_graph_profile_dump(AVFilterGraph *graph);
+
 /**
  * Request a frame on the oldest sink link.
  *
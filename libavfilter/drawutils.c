@@ -531,9 +531,9 @@ static void blend_pixel16(uint8_t *dst, unsigned src, unsigned alpha,
     AV_WL16(dst, ((0x10001 - alpha) * value + alpha * src) >> 16);
 }
 
-static void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
-                        const uint8_t *mask, int mask_linesize, int l2depth,
-                        unsigned w, unsigned h, unsigned shift, unsigned xm0)
+static av_always_inline void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
+                                        const uint8_t *mask, int mask_linesize, int l2depth,
+                                        unsigned w, unsigned h, unsigned shift, unsigned xm0)
 {
     unsigned xm, x, y, t = 0;
     unsigned xmshf = 3 - l2depth;
@@ -579,11 +579,12 @@ static void blend_line_hv16(uint8_t *dst, int dst_delta,
                       right, hband, hsub + vsub, xm);
 }
 
-static void blend_line_hv(uint8_t *dst, int dst_delta,
-                          unsigned src, unsigned alpha,
-                          const uint8_t *mask, int mask_linesize, int l2depth, int w,
-                          unsigned hsub, unsigned vsub,
-                          int xm, int left, int right, int hband)
+static av_always_inline void blend_line_hv_template(uint8_t *dst, int dst_delta,
+                                                   unsigned src, unsigned alpha,
+                                                   const uint8_t *mask, int mask_linesize,
+                                                   int l2depth, int w,
+                                                   unsigned hsub, unsigned vsub,
+                                                   int xm, int left, int right, int hband)
 {
     int x;
 
@@ -604,6 +605,32 @@ static void blend_line_hv(uint8_t *dst, int dst_delta,
                     right, hband, hsub + vsub, xm);
 }
 
+static void blend_line_hv(uint8_t *dst, int dst_delta,
+                          unsigned src, unsigned alpha,
+                          const uint8_t *mask, int mask_linesize, int l2depth, int w,
+                          unsigned hsub, unsigned vsub,
+                          int xm, int left, int right, int hband)
+{
+    /* specialize for 8 bits masks, the most common case */
+    if (l2depth == 3)
+        blend_line_hv_template(dst, dst_delta, src, alpha, mask, mask_linesize,
+                               3, w, hsub, vsub, xm, left, right, hband);
+    else
+        blend_line_hv_template(dst, dst_delta, src, alpha, mask, mask_linesize,
+                               l2depth, w, hsub, vsub, xm, left, right, hband);
+}
+
+static void blend_row8(uint8_t *dst, const uint8_t *mask, int w,
+                       unsigned src, unsigned alpha)
+{
+    int x;
+
+    for (x = 0; x < w; x++) {
+        unsigned a = mask[x] * alpha;
+        dst[x] = ((0x1010101 - a) * dst[x] + a * src) >> 24;
+    }
+}
+
 void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
                    uint8_t *dst[], int dst_linesize[], int dst_w, int dst_h,
                    const uint8_t *mask,  int mask_linesize, int mask_w, int mask_h,
@@ -660,7 +687,16 @@ void ff_blend_mask(FFDrawContext *draw, FFDrawColor *color,
                 p += dst_linesize[plane];
                 m += top * mask_linesize;
             }
-            if (depth <= 8) {
+            if (depth <= 8 && l2depth == 3 && nb_comp == 1 &&
+                !draw->hsub[plane] && !draw->vsub[plane]) {
+                /* one mask byte per destination byte: no top/bottom bands */
+                for (y = 0; y < h_sub; y++) {
+                    blend_row8(p, m + xm0, w_sub,
+                               color->comp[plane].u8[comp], alpha);
+                    p += dst_linesize[plane];
+                    m += mask_linesize;
+                }
+            } else if (depth <= 8) {
                 for (y = 0; y < h_sub; y++) {
                     blend_line_hv(p, draw->pixelstep[plane],
                                   color->comp[plane].u8[comp], alpha,
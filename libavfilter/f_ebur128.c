@@ -34,10 +34,10 @@
 #include "libavutil/channel_layout.h"
 #include "libavutil/dict.h"
 #include "libavutil/ffmath.h"
+#include "libavutil/internal.h"
 #include "libavutil/xga_font_data.h"
 #include "libavutil/opt.h"
 #include "libavutil/timestamp.h"
-#include "libswresample/swresample.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
@@ -45,6 +45,16 @@
 
 #define MAX_CHANNELS 63
 
+/**
+ * Number of channels of each row of the K-weighting state. The state is
+ * made of 6 rows: X[i-1], X[i-2], Y[i-1], Y[i-2], Z[i-1] and Z[i-2], each
+ * one holding the value of all channels (struct of arrays).
+ */
+#define EBUR128_STATE_STRIDE 64
+
+/** Number of past input samples needed by the true peak interpolator. */
+#define EBUR128_TP_HISTORY 11
+
 /* pre-filter coefficients */
 #define PRE_B0  1.53512485958697
 #define PRE_B1 -2.69169618940638
@@ -59,6 +69,23 @@
 #define RLB_A1 -1.99004745483398
 #define RLB_A2  0.99007225036621
 
+/* true peak interpolator coefficients (ITU-R BS.1770-4 Annex 2), one row per
+ * phase of the 4x upsampling, applied to X[i], X[i-1], ..., X[i-11] */
+static const double tp_coeffs[4][12] = {
+    {  0.0017089843750,  0.0109863281250, -0.0196533203125,  0.0332031250000,
+      -0.0594482421875,  0.1373291015625,  0.9721679687500, -0.1022949218750,
+       0.0476074218750, -0.0266113281250,  0.0148925781250, -0.0083007812500 },
+    { -0.0291748046875,  0.0292968750000, -0.0517578125000,  0.0891113281250,
+      -0.1665039062500,  0.4650878906250,  0.7797851562500, -0.2003173828125,
+       0.1015625000000, -0.0582275390625,  0.0330810546875, -0.0189208984375 },
+    { -0.0189208984375,  0.0330810546875, -0.0582275390625,  0.1015625000000,
+      -0.2003173828125,  0.7797851562500,  0.4650878906250, -0.1665039062500,
+       0.0891113281250, -0.0517578125000,  0.0292968750000, -0.0291748046875 },
+    { -0.0083007812500,  0.0148925781250, -0.0266113281250,  0.0476074218750,
+      -0.1022949218750,  0.9721679687500,  0.1373291015625, -0.0594482421875,
+       0.0332031250000, -0.0196533203125,  0.0109863281250,  0.0017089843750 },
+};
+
 #define ABS_THRES    -70            ///< silence gate: we discard anything below this absolute (LUFS) threshold
 #define ABS_UP_THRES  10            ///< upper loud limit to consider (ABS_THRES being the minimum)
 #define HIST_GRAIN   100            ///< defines histogram precision
@@ -97,12 +124,10 @@ typedef struct {
     int peak_mode;                  ///< enabled peak modes
     double *true_peaks;             ///< true peaks per channel
     double *sample_peaks;           ///< sample peaks per channel
-    double *true_peaks_per_frame;   ///< true peaks in a frame per channel
-#if CONFIG_SWRESAMPLE
-    SwrContext *swr_ctx;            ///< over-sampling context for true peak metering
-    double *swr_buf;                ///< resampled audio data for true peak metering
-    int swr_linesize;
-#endif
+    double *true_peaks_per_frame;   ///< true peaks in the last 100ms per channel
+    double *tp_buf;                 ///< planar copy of the input, preceded by the history, for true peak metering
+    unsigned tp_buf_size;
+    double tp_history[MAX_CHANNELS][EBUR128_TP_HISTORY]; ///< last input samples of each channel
 
     /* video  */
     int do_video;                   ///< 1 if video output enabled, 0 otherwise
@@ -121,11 +146,11 @@ typedef struct {
     double *ch_weighting;           ///< channel weighting mapping
     int sample_count;               ///< sample count used for refresh frequency, reset at refresh
 
-    /* Filter caches.
-     * The mult by 3 in the following is for X[i], X[i-1] and X[i-2] */
-    double x[MAX_CHANNELS * 3];     ///< 3 input samples cache for each channel
-    double y[MAX_CHANNELS * 3];     ///< 3 pre-filter samples cache for each channel
-    double z[MAX_CHANNELS * 3];     ///< 3 RLB-filter samples cache for each channel
+    /* Filter caches: X[i-1], X[i-2], Y[i-1], Y[i-2], Z[i-1] and Z[i-2] rows of
+     * EBUR128_STATE_STRIDE channels, see filter_channels() */
+    double state[6 * EBUR128_STATE_STRIDE];
+    double *bins;                   ///< squared K-weighted samples of the current frame
+    unsigned bins_size;
 
 #define I400_BINS  (48000 * 4 / 10)
 #define I3000_BINS (48000 * 3)
@@ -142,6 +167,7 @@ typedef struct {
     int metadata;                   ///< whether or not to inject loudness results in frames
     int dual_mono;                  ///< whether or not to treat single channel input files as dual-mono
     double pan_law;                 ///< pan law value used to calulate dual-mono measurements
+    int passthrough;                ///< whether or not to forward the input audio frames
 } EBUR128Context;
 
 enum {
@@ -168,6 +194,7 @@ static const AVOption ebur128_options[] = {
         { "true",   "enable true-peak mode",   0, AV_OPT_TYPE_CONST, {.i64 = PEAK_MODE_TRUE_PEAKS},    INT_MIN, INT_MAX, A|F, "mode" },
     { "dualmono", "treat mono input files as dual-mono", OFFSET(dual_mono), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, A|F },
     { "panlaw", "set a specific pan law for dual-mono files", OFFSET(pan_law), AV_OPT_TYPE_DOUBLE, {.dbl = -3.01029995663978}, -10.0, 0.0, A|F },
+    { "passthrough", "forward the input audio frames", OFFSET(passthrough), AV_OPT_TYPE_BOOL, {.i64 = 1}, 0, 1, A|F },
     { NULL },
 };
 
@@ -351,12 +378,8 @@ static int config_audio_input(AVFilterLink *inlink)
     EBUR128Context *ebur128 = ctx->priv;
 
     /* Force 100ms framing in case of metadata injection: the frames must have
-     * a granularity of the window overlap to be accurately exploited.
-     * As for the true peaks mode, it just simplifies the resampling buffer
-     * allocation and the lookup in it (since sample buffers differ in size, it
-     * can be more complex to integrate in the one-sample loop of
-     * filter_frame()). */
-    if (ebur128->metadata || (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS))
+     * a granularity of the window overlap to be accurately exploited. */
+    if (ebur128->metadata)
         inlink->min_samples =
         inlink->max_samples =
         inlink->partial_buf_size = inlink->sample_rate / 10;
@@ -401,31 +424,12 @@ static int config_audio_output(AVFilterLink *outlink)
             return AVERROR(ENOMEM);
     }
 
-#if CONFIG_SWRESAMPLE
     if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
-        int ret;
-
-        ebur128->swr_buf    = av_malloc_array(nb_channels, 19200 * sizeof(double));
         ebur128->true_peaks = av_calloc(nb_channels, sizeof(*ebur128->true_peaks));
         ebur128->true_peaks_per_frame = av_calloc(nb_channels, sizeof(*ebur128->true_peaks_per_frame));
-        ebur128->swr_ctx    = swr_alloc();
-        if (!ebur128->swr_buf || !ebur128->true_peaks ||
-            !ebur128->true_peaks_per_frame || !ebur128->swr_ctx)
+        if (!ebur128->true_peaks || !ebur128->true_peaks_per_frame)
             return AVERROR(ENOMEM);
-
-        av_opt_set_int(ebur128->swr_ctx, "in_channel_layout",    outlink->channel_layout, 0);
-        av_opt_set_int(ebur128->swr_ctx, "in_sample_rate",       outlink->sample_rate, 0);
-        av_opt_set_sample_fmt(ebur128->swr_ctx, "in_sample_fmt", outlink->format, 0);
-
-        av_opt_set_int(ebur128->swr_ctx, "out_channel_layout",    outlink->channel_layout, 0);
-        av_opt_set_int(ebur128->swr_ctx, "out_sample_rate",       192000, 0);
-        av_opt_set_sample_fmt(ebur128->swr_ctx, "out_sample_fmt", outlink->format, 0);
-
-        ret = swr_init(ebur128->swr_ctx);
-        if (ret < 0)
-            return ret;
     }
-#endif
 
     if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS) {
         ebur128->sample_peaks = av_calloc(nb_channels, sizeof(*ebur128->sample_peaks));
@@ -467,9 +471,9 @@ static av_cold int init(AVFilterContext *ctx)
             ebur128->loglevel = AV_LOG_INFO;
     }
 
-    if (!CONFIG_SWRESAMPLE && (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS)) {
+    if (ebur128->metadata && !ebur128->passthrough) {
         av_log(ctx, AV_LOG_ERROR,
-               "True-peak mode requires libswresample to be performed\n");
+               "Metadata injection requires the audio frames to be forwarded\n");
         return AVERROR(EINVAL);
     }
 
@@ -538,103 +542,228 @@ static int gate_update(struct integrator *integ, double power,
     return gate_hist_pos;
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
+/**
+ * Apply the K-weighting (pre-filter then RLB-filter) to the first
+ * nb_channels channels of interleaved samples, and store the squared
+ * filtered samples.
+ *
+ * @param stride  distance in doubles between two samples of a channel,
+ *                in both samples and bins
+ */
+static void filter_channels(const double *samples, ptrdiff_t stride,
+                            double *bins, double *state,
+                            int nb_samples, int nb_channels)
 {
-    int i, ch, idx_insample;
-    AVFilterContext *ctx = inlink->dst;
-    EBUR128Context *ebur128 = ctx->priv;
-    const int nb_channels = ebur128->nb_channels;
-    const int nb_samples  = insamples->nb_samples;
-    const double *samples = (double *)insamples->data[0];
-    AVFrame *pic = ebur128->outpicref;
+    double *x = state;
+    double *y = x + 2 * EBUR128_STATE_STRIDE;
+    double *z = y + 2 * EBUR128_STATE_STRIDE;
+    int i, ch;
+
+#define X1 x[ch]
+#define X2 x[ch + EBUR128_STATE_STRIDE]
+#define Y1 y[ch]
+#define Y2 y[ch + EBUR128_STATE_STRIDE]
+#define Z1 z[ch]
+#define Z2 z[ch + EBUR128_STATE_STRIDE]
+    for (i = 0; i < nb_samples; i++) {
+        for (ch = 0; ch < nb_channels; ch++) {
+            /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
+            const double x0 = samples[ch];
+            const double y0 = x0*PRE_B0 + X1*PRE_B1 + X2*PRE_B2 - Y1*PRE_A1 - Y2*PRE_A2;
+            const double z0 = y0*RLB_B0 + Y1*RLB_B1 + Y2*RLB_B2 - Z1*RLB_A1 - Z2*RLB_A2;
+
+            X2 = X1; X1 = x0;
+            Y2 = Y1; Y1 = y0;
+            Z2 = Z1; Z1 = z0;
+            bins[ch] = z0 * z0;
+        }
+        samples += stride;
+        bins    += stride;
+    }
+#undef X1
+#undef X2
+#undef Y1
+#undef Y2
+#undef Z1
+#undef Z2
+}
 
-#if CONFIG_SWRESAMPLE
-    if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
-        const double *swr_samples = ebur128->swr_buf;
-        int ret = swr_convert(ebur128->swr_ctx, (uint8_t**)&ebur128->swr_buf, 19200,
-                              (const uint8_t **)insamples->data, nb_samples);
-        if (ret < 0)
-            return ret;
-        for (ch = 0; ch < nb_channels; ch++)
-            ebur128->true_peaks_per_frame[ch] = 0.0;
-        for (idx_insample = 0; idx_insample < ret; idx_insample++) {
-            for (ch = 0; ch < nb_channels; ch++) {
-                ebur128->true_peaks[ch] = FFMAX(ebur128->true_peaks[ch], fabs(*swr_samples));
-                ebur128->true_peaks_per_frame[ch] = FFMAX(ebur128->true_peaks_per_frame[ch],
-                                                          fabs(*swr_samples));
-                swr_samples++;
-            }
+/**
+ * Upsample a channel by 4 with the polyphase interpolator of ITU-R
+ * BS.1770-4 Annex 2, and return the largest absolute value.
+ *
+ * @param src  len samples, preceded by EBUR128_TP_HISTORY past samples
+ */
+static double true_peak(const double *src, int len)
+{
+    double peak = 0.0;
+    int i, p, k;
+
+    for (i = 0; i < len; i++) {
+        for (p = 0; p < 4; p++) {
+            double acc = src[i] * tp_coeffs[p][0];
+            for (k = 1; k < 12; k++)
+                acc += src[i - k] * tp_coeffs[p][k];
+            peak = FFMAX(peak, fabs(acc));
         }
     }
-#endif
+    return peak;
+}
 
-    for (idx_insample = 0; idx_insample < nb_samples; idx_insample++) {
-        const int bin_id_400  = ebur128->i400.cache_pos;
-        const int bin_id_3000 = ebur128->i3000.cache_pos;
+/* deinterleave the input into one line per channel, each one preceded by the
+ * last EBUR128_TP_HISTORY samples of the previous frame */
+static int load_true_peak_buffer(EBUR128Context *ebur128, const AVFrame *insamples)
+{
+    const int nb_channels = ebur128->nb_channels;
+    const int nb_samples  = insamples->nb_samples;
+    const int linesize    = EBUR128_TP_HISTORY + nb_samples;
+    const double *samples = (const double *)insamples->data[0];
+    int i, ch;
 
-#define MOVE_TO_NEXT_CACHED_ENTRY(time) do {                \
-    ebur128->i##time.cache_pos++;                           \
-    if (ebur128->i##time.cache_pos == I##time##_BINS) {     \
-        ebur128->i##time.filled    = 1;                     \
-        ebur128->i##time.cache_pos = 0;                     \
-    }                                                       \
-} while (0)
+    av_fast_malloc(&ebur128->tp_buf, &ebur128->tp_buf_size,
+                   nb_channels * linesize * sizeof(*ebur128->tp_buf));
+    if (!ebur128->tp_buf)
+        return AVERROR(ENOMEM);
 
-        MOVE_TO_NEXT_CACHED_ENTRY(400);
-        MOVE_TO_NEXT_CACHED_ENTRY(3000);
+    for (ch = 0; ch < nb_channels; ch++) {
+        double *dst = ebur128->tp_buf + ch * linesize;
 
-        for (ch = 0; ch < nb_channels; ch++) {
-            double bin;
+        memcpy(dst, ebur128->tp_history[ch], sizeof(ebur128->tp_history[ch]));
+        dst += EBUR128_TP_HISTORY;
+        for (i = 0; i < nb_samples; i++)
+            dst[i] = samples[i * nb_channels + ch];
+        memcpy(ebur128->tp_history[ch], dst + nb_samples - EBUR128_TP_HISTORY,
+               sizeof(ebur128->tp_history[ch]));
+    }
+    return 0;
+}
 
-            if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS)
-                ebur128->sample_peaks[ch] = FFMAX(ebur128->sample_peaks[ch], fabs(*samples));
+static void update_true_peaks(EBUR128Context *ebur128, int nb_samples,
+                              int start, int end)
+{
+    const int linesize = EBUR128_TP_HISTORY + nb_samples;
+    int ch;
 
-            ebur128->x[ch * 3] = *samples++; // set X[i]
+    if (end <= start)
+        return;
+    for (ch = 0; ch < ebur128->nb_channels; ch++) {
+        const double *src = ebur128->tp_buf + ch * linesize + EBUR128_TP_HISTORY;
+        const double peak = true_peak(src + start, end - start);
 
-            if (!ebur128->ch_weighting[ch])
-                continue;
+        ebur128->true_peaks[ch] = FFMAX(ebur128->true_peaks[ch], peak);
+        ebur128->true_peaks_per_frame[ch] = FFMAX(ebur128->true_peaks_per_frame[ch], peak);
+    }
+}
 
-            /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
-#define FILTER(Y, X, name) do {                                                 \
-            double *dst = ebur128->Y + ch*3;                                    \
-            double *src = ebur128->X + ch*3;                                    \
-            dst[2] = dst[1];                                                    \
-            dst[1] = dst[0];                                                    \
-            dst[0] = src[0]*name##_B0 + src[1]*name##_B1 + src[2]*name##_B2     \
-                                      - dst[1]*name##_A1 - dst[2]*name##_A2;    \
-} while (0)
+static void integrate_samples(EBUR128Context *ebur128, const double *samples,
+                              const double *bins, int nb_samples)
+{
+    const int nb_channels = ebur128->nb_channels;
+    int i, ch;
+
+    for (ch = 0; ch < nb_channels; ch++) {
+        double *cache_400  = ebur128->i400.cache [ch];
+        double *cache_3000 = ebur128->i3000.cache[ch];
+        double sum_400, sum_3000;
+        int bin_id_400  = ebur128->i400.cache_pos;
+        int bin_id_3000 = ebur128->i3000.cache_pos;
+
+        if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS) {
+            double peak = ebur128->sample_peaks[ch];
+            for (i = 0; i < nb_samples; i++)
+                peak = FFMAX(peak, fabs(samples[i * nb_channels + ch]));
+            ebur128->sample_peaks[ch] = peak;
+        }
 
-            // TODO: merge both filters in one?
-            FILTER(y, x, PRE);  // apply pre-filter
-            ebur128->x[ch * 3 + 2] = ebur128->x[ch * 3 + 1];
-            ebur128->x[ch * 3 + 1] = ebur128->x[ch * 3    ];
-            FILTER(z, y, RLB);  // apply RLB-filter
+        if (!ebur128->ch_weighting[ch])
+            continue;
 
-            bin = ebur128->z[ch * 3] * ebur128->z[ch * 3];
+        sum_400  = ebur128->i400.sum [ch];
+        sum_3000 = ebur128->i3000.sum[ch];
+        for (i = 0; i < nb_samples; i++) {
+            const double bin = bins[i * nb_channels + ch];
 
             /* add the new value, and limit the sum to the cache size (400ms or 3s)
              * by removing the oldest one */
-            ebur128->i400.sum [ch] = ebur128->i400.sum [ch] + bin - ebur128->i400.cache [ch][bin_id_400];
-            ebur128->i3000.sum[ch] = ebur128->i3000.sum[ch] + bin - ebur128->i3000.cache[ch][bin_id_3000];
+            sum_400  = sum_400  + bin - cache_400 [bin_id_400];
+            sum_3000 = sum_3000 + bin - cache_3000[bin_id_3000];
 
             /* override old cache entry with the new value */
-            ebur128->i400.cache [ch][bin_id_400 ] = bin;
-            ebur128->i3000.cache[ch][bin_id_3000] = bin;
+            cache_400 [bin_id_400 ] = bin;
+            cache_3000[bin_id_3000] = bin;
+
+            if (++bin_id_400  == I400_BINS)
+                bin_id_400  = 0;
+            if (++bin_id_3000 == I3000_BINS)
+                bin_id_3000 = 0;
         }
+        ebur128->i400.sum [ch] = sum_400;
+        ebur128->i3000.sum[ch] = sum_3000;
+    }
+
+#define MOVE_CACHE_POS(time) do {                           \
+    ebur128->i##time.cache_pos += nb_samples;               \
+    if (ebur128->i##time.cache_pos >= I##time##_BINS) {     \
+        ebur128->i##time.filled     = 1;                    \
+        ebur128->i##time.cache_pos -= I##time##_BINS;       \
+    }                                                       \
+} while (0)
+
+    MOVE_CACHE_POS(400);
+    MOVE_CACHE_POS(3000);
+}
 
+static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
+{
+    int i, ch, idx_insample, nb, ret;
+    AVFilterContext *ctx = inlink->dst;
+    EBUR128Context *ebur128 = ctx->priv;
+    const int nb_channels = ebur128->nb_channels;
+    const int nb_samples  = insamples->nb_samples;
+    const double *samples = (double *)insamples->data[0];
+    int tp_start = 0;
+    AVFrame *pic = ebur128->outpicref;
+
+    if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
+        ret = load_true_peak_buffer(ebur128, insamples);
+        if (ret < 0)
+            goto fail;
+    }
+
+    av_fast_malloc(&ebur128->bins, &ebur128->bins_size,
+                   nb_samples * nb_channels * sizeof(*ebur128->bins));
+    if (!ebur128->bins) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    filter_channels(samples, nb_channels, ebur128->bins,
+                    ebur128->state, nb_samples, nb_channels);
+
+    for (idx_insample = 0; idx_insample < nb_samples; idx_insample += nb) {
         /* For integrated loudness, gating blocks are 400ms long with 75%
          * overlap (see BS.1770-2 p5), so a re-computation is needed each 100ms
          * (4800 samples at 48kHz). */
-        if (++ebur128->sample_count == 4800) {
+        nb = FFMIN(nb_samples - idx_insample, 4800 - ebur128->sample_count);
+        integrate_samples(ebur128, samples + idx_insample * nb_channels,
+                          ebur128->bins + idx_insample * nb_channels, nb);
+
+        ebur128->sample_count += nb;
+        if (ebur128->sample_count == 4800) {
+            const int last_sample = idx_insample + nb - 1;
             double loudness_400, loudness_3000;
             double power_400 = 1e-12, power_3000 = 1e-12;
             AVFilterLink *outlink = ctx->outputs[0];
             const int64_t pts = insamples->pts +
-                av_rescale_q(idx_insample, (AVRational){ 1, inlink->sample_rate },
+                av_rescale_q(last_sample, (AVRational){ 1, inlink->sample_rate },
                              outlink->time_base);
 
             ebur128->sample_count = 0;
 
+            if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
+                update_true_peaks(ebur128, nb_samples, tp_start, last_sample + 1);
+                tp_start = last_sample + 1;
+            }
+
 #define COMPUTE_LOUDNESS(m, time) do {                                              \
     if (ebur128->i##time.filled) {                                                  \
         /* weighting sum of the last <time> ms */                                   \
@@ -727,7 +856,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
 
             /* push one video frame */
             if (ebur128->do_video) {
-                int x, y, ret;
+                int x, y;
                 uint8_t *p;
 
                 const int y_loudness_lu_graph = lu_to_y(ebur128, loudness_3000 + 23);
@@ -763,7 +892,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
                 pic->pts = pts;
                 ret = ff_filter_frame(outlink, av_frame_clone(pic));
                 if (ret < 0)
-                    return ret;
+                    goto fail;
             }
 
             if (ebur128->metadata) { /* happens only once per filter_frame call */
@@ -815,10 +944,24 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
             PRINT_PEAKS("FTPK", ebur128->true_peaks_per_frame, TRUE);
             PRINT_PEAKS("TPK", ebur128->true_peaks,   TRUE);
             av_log(ctx, ebur128->loglevel, "\n");
+
+            if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS)
+                memset(ebur128->true_peaks_per_frame, 0,
+                       nb_channels * sizeof(*ebur128->true_peaks_per_frame));
         }
     }
 
+    if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS)
+        update_true_peaks(ebur128, nb_samples, tp_start, nb_samples);
+
+    if (!ebur128->passthrough) {
+        av_frame_free(&insamples);
+        return 0;
+    }
     return ff_filter_frame(ctx->outputs[ebur128->do_video], insamples);
+fail:
+    av_frame_free(&insamples);
+    return ret;
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -920,10 +1063,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     for (i = 0; i < ctx->nb_outputs; i++)
         av_freep(&ctx->output_pads[i].name);
     av_frame_free(&ebur128->outpicref);
-#if CONFIG_SWRESAMPLE
-    av_freep(&ebur128->swr_buf);
-    swr_free(&ebur128->swr_ctx);
-#endif
+    av_freep(&ebur128->tp_buf);
+    av_freep(&ebur128->bins);
 }
 
 static const AVFilterPad ebur128_inputs[] = {
@@ -28,11 +28,12 @@
 #include "libavutil/fifo.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
-#include "libavutil/pixelutils.h"
+#include "libavutil/scene_score.h"
 #include "avfilter.h"
 #include "audio.h"
 #include "formats.h"
 #include "internal.h"
+#include "scenedetect.h"
 #include "video.h"
 
 static const char *const var_names[] = {
@@ -145,9 +146,7 @@ typedef struct SelectContext {
     AVExpr *expr;
     double var_values[VAR_VARS_NB];
     int do_scene_detect;            ///< 1 if the expression requires scene detection variables, 0 otherwise
-    av_pixelutils_sad_fn sad;       ///< Sum of the absolute difference function (scene detect only)
-    double prev_mafd;               ///< previous MAFD                           (scene detect only)
-    AVFrame *prev_picref;           ///< previous frame                          (scene detect only)
+    FFSceneDetectContext sd;        ///< scene change detection                  (scene detect only)
     double select;
     int select_out;                 ///< mark the selected output pad index
     int nb_outputs;
@@ -199,6 +198,7 @@ static av_cold int init(AVFilterContext *ctx)
 static int config_input(AVFilterLink *inlink)
 {
     SelectContext *select = inlink->dst->priv;
+    int ret;
 
     select->var_values[VAR_N]          = 0.0;
     select->var_values[VAR_SELECTED_N] = 0.0;
@@ -239,47 +239,25 @@ static int config_input(AVFilterLink *inlink)
         inlink->type == AVMEDIA_TYPE_AUDIO ? inlink->sample_rate : NAN;
 
     if (select->do_scene_detect) {
-        select->sad = av_pixelutils_get_sad_fn(3, 3, 2, select); // 8x8 both sources aligned
-        if (!select->sad)
-            return AVERROR(EINVAL);
+        ret = ff_scene_detect_init(&select->sd, inlink->dst, inlink->format,
+                                   inlink->w, inlink->h, 0);
+        if (ret < 0)
+            return ret;
     }
     return 0;
 }
 
 static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
 {
-    double ret = 0;
     SelectContext *select = ctx->priv;
-    AVFrame *prev_picref = select->prev_picref;
-
-    if (prev_picref &&
-        frame->height == prev_picref->height &&
-        frame->width  == prev_picref->width) {
-        int x, y, nb_sad = 0;
-        int64_t sad = 0;
-        double mafd, diff;
-        uint8_t *p1 =      frame->data[0];
-        uint8_t *p2 = prev_picref->data[0];
-        const int p1_linesize =       frame->linesize[0];
-        const int p2_linesize = prev_picref->linesize[0];
-
-        for (y = 0; y < frame->height - 7; y += 8) {
-            for (x = 0; x < frame->width*3 - 7; x += 8) {
-                sad += select->sad(p1 + x, p1_linesize, p2 + x, p2_linesize);
-                nb_sad += 8 * 8;
-            }
-            p1 += 8 * p1_linesize;
-            p2 += 8 * p2_linesize;
-        }
-        emms_c();
-        mafd = nb_sad ? (double)sad / nb_sad : 0;
-        diff = fabs(mafd - select->prev_mafd);
-        ret  = av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
-        select->prev_mafd = mafd;
-        av_frame_free(&prev_picref);
-    }
-    select->prev_picref = av_frame_clone(frame);
-    return ret;
+    AVSceneScore score = { 0 };
+
+    /* A score attached by a previous filter is not reused: it may have been
+     * computed with other settings, or against a frame that was dropped
+     * before reaching this filter. */
+    if (ff_scene_detect_frame(&select->sd, frame, &score) < 0)
+        return 0;
+    return score.score;
 }
 
 static double get_concatdec_select(AVFrame *frame, int64_t pts)
@@ -422,9 +400,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     for (i = 0; i < ctx->nb_outputs; i++)
         av_freep(&ctx->output_pads[i].name);
 
-    if (select->do_scene_detect) {
-        av_frame_free(&select->prev_picref);
-    }
+    if (select->do_scene_detect)
+        ff_scene_detect_uninit(&select->sd);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -527,6 +504,6 @@ AVFilter ff_vf_select = {
     .priv_size     = sizeof(SelectContext),
     .priv_class    = &select_class,
     .inputs        = avfilter_vf_select_inputs,
-    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif /* CONFIG_SELECT_FILTER */
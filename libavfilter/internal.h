@@ -147,10 +147,16 @@ struct AVFilterPad {
 struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
+
+    /* filter callback currently being profiled, and the time spent in the
+     * callbacks it called into */
+    AVFilterContext *profile_current;
+    int64_t profile_child_time;
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+    struct FFFilterProfile *profile;
 };
 
 /**
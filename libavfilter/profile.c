@@ -0,0 +1,198 @@
+/*
+ * Filter graph profiling
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/bprint.h"
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "avfilter.h"
+#include "internal.h"
+#include "profile.h"
+
+static FFFilterProfile *get_profile(AVFilterContext *ctx)
+{
+    FFFilterProfile *p = ctx->internal->profile;
+    int nb_threads;
+
+    if (p)
+        return p;
+
+    nb_threads = FFMAX(ctx->graph->nb_threads, 1);
+    p = av_mallocz(sizeof(*p));
+    if (!p)
+        return NULL;
+    p->thread_time = av_mallocz_array(nb_threads, sizeof(*p->thread_time));
+    p->thread_jobs = av_mallocz_array(nb_threads, sizeof(*p->thread_jobs));
+    if (!p->thread_time || !p->thread_jobs) {
+        av_freep(&p->thread_time);
+        av_freep(&p->thread_jobs);
+        av_freep(&p);
+        return NULL;
+    }
+    p->nb_threads = nb_threads;
+
+    return ctx->internal->profile = p;
+}
+
+void ff_profile_enter(AVFilterContext *ctx, FFProfileScope *scope)
+{
+    AVFilterGraphInternal *gi = ctx->graph->internal;
+
+    /* allocated here so that slice jobs never have to */
+    get_profile(ctx);
+
+    scope->prev       = gi->profile_current;
+    scope->child_time = gi->profile_child_time;
+    gi->profile_current    = ctx;
+    gi->profile_child_time = 0;
+    scope->start = av_gettime_relative();
+}
+
+void ff_profile_leave(AVFilterContext *ctx, FFProfileScope *scope, int request)
+{
+    AVFilterGraphInternal *gi = ctx->graph->internal;
+    FFFilterProfile *p = ctx->internal->profile;
+    int64_t elapsed = av_gettime_relative() - scope->start;
+    int64_t self    = elapsed - gi->profile_child_time;
+
+    gi->profile_current    = scope->prev;
+    gi->profile_child_time = scope->child_time + elapsed;
+
+    if (!p)
+        return;
+    if (request) {
+        p->nb_requests++;
+        p->request_time += self;
+    } else {
+        p->nb_frames++;
+        p->frame_time    += self;
+        ff_log_hist_add(&p->frame_hist, self);
+    }
+}
+
+void ff_profile_slice_job(AVFilterContext *ctx, int thread, int64_t time)
+{
+    FFFilterProfile *p = ctx->internal->profile;
+
+    if (!p || thread >= p->nb_threads)
+        return;
+    p->thread_time[thread] += time;
+    p->thread_jobs[thread]++;
+}
+
+void ff_profile_frame_alloc(AVFilterGraph *graph, const AVFrame *frame)
+{
+    AVFilterContext *ctx;
+    int i;
+
+    if (!graph || !graph->profile || !frame ||
+        !(ctx = graph->internal->profile_current) || !ctx->internal->profile)
+        return;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(frame->buf) && frame->buf[i]; i++)
+        ctx->internal->profile->bytes_allocated += frame->buf[i]->size;
+    for (i = 0; i < frame->nb_extended_buf; i++)
+        ctx->internal->profile->bytes_allocated += frame->extended_buf[i]->size;
+}
+
+void ff_profile_free(AVFilterContext *ctx)
+{
+    FFFilterProfile *p = ctx->internal->profile;
+
+    if (!p)
+        return;
+    av_freep(&p->thread_time);
+    av_freep(&p->thread_jobs);
+    av_freep(&ctx->internal->profile);
+}
+
+static void print_json_string(AVBPrint *buf, const char *str)
+{
+    av_bprint_chars(buf, '"', 1);
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            av_bprintf(buf, "\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            av_bprintf(buf, "\\u%04x", *str);
+        else
+            av_bprint_chars(buf, *str, 1);
+    }
+    av_bprint_chars(buf, '"', 1);
+}
+
+static void print_filter_profile(AVBPrint *buf, AVFilterContext *ctx)
+{
+    const FFFilterProfile *p = ctx->internal->profile;
+    static const FFFilterProfile empty = { 0 };
+    int i;
+
+    if (!p)
+        p = &empty;
+
+    av_bprintf(buf, "{\"name\":");
+    print_json_string(buf, ctx->name ? ctx->name : "");
+    av_bprintf(buf, ",\"filter\":");
+    print_json_string(buf, ctx->filter->name);
+    av_bprintf(buf, ",\"frames\":%"PRIu64",\"requests\":%"PRIu64,
+               p->nb_frames, p->nb_requests);
+    av_bprintf(buf, ",\"frames_per_second\":%.1f",
+               p->frame_time ? p->nb_frames * 1000000.0 / p->frame_time : 0.0);
+    av_bprintf(buf, ",\"filter_frame_us\":{\"total\":%"PRId64",\"avg\":%.1f,"
+               "\"p99\":%"PRId64",\"max\":%"PRId64"}",
+               p->frame_time,
+               p->nb_frames ? (double)p->frame_time / p->nb_frames : 0.0,
+               ff_log_hist_percentile(&p->frame_hist, 0.99),
+               p->frame_hist.max);
+    av_bprintf(buf, ",\"request_frame_us\":{\"total\":%"PRId64",\"avg\":%.1f}",
+               p->request_time,
+               p->nb_requests ? (double)p->request_time / p->nb_requests : 0.0);
+    av_bprintf(buf, ",\"bytes_allocated\":%"PRIu64, p->bytes_allocated);
+
+    av_bprintf(buf, ",\"slice_jobs\":[");
+    for (i = 0; i < p->nb_threads; i++)
+        av_bprintf(buf, "%s%"PRIu64, i ? "," : "", p->thread_jobs[i]);
+    av_bprintf(buf, "],\"slice_us\":[");
+    for (i = 0; i < p->nb_threads; i++)
+        av_bprintf(buf, "%s%"PRId64, i ? "," : "", p->thread_time[i]);
+    av_bprintf(buf, "]}");
+}
+
+char *avfilter_graph_profile_dump(AVFilterGraph *graph)
+{
+    AVBPrint buf;
+    char *dump;
+    unsigned i;
+
+    av_bprint_init(&buf, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprintf(&buf, "{\"filters\":[");
+    for (i = 0; i < graph->nb_filters; i++) {
+        if (i)
+            av_bprint_chars(&buf, ',', 1);
+        print_filter_profile(&buf, graph->filters[i]);
+    }
+    av_bprintf(&buf, "]}");
+
+    if (!av_bprint_is_complete(&buf)) {
+        av_bprint_finalize(&buf, NULL);
+        return NULL;
+    }
+    av_bprint_finalize(&buf, &dump);
+    return dump;
+}
@@ -0,0 +1,81 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_PROFILE_H
+#define AVFILTER_PROFILE_H
+
+#include <stdint.h>
+
+#include "libavutil/log_hist.h"
+#include "avfilter.h"
+
+typedef struct FFFilterProfile {
+    uint64_t nb_frames;
+    uint64_t nb_requests;
+    int64_t  frame_time;            ///< time spent in filter_frame(), excluding other filters
+    FFLogHistogram frame_hist;      ///< per-call filter_frame() times
+    int64_t  request_time;          ///< time spent in request_frame(), excluding other filters
+    uint64_t bytes_allocated;       ///< size of the frame buffers obtained by the filter
+
+    int       nb_threads;
+    int64_t  *thread_time;          ///< time spent in slice jobs, per thread
+    uint64_t *thread_jobs;          ///< number of slice jobs, per thread
+} FFFilterProfile;
+
+/**
+ * State saved while a filter callback runs, so that the time spent in the
+ * filters it calls into is not accounted to it.
+ */
+typedef struct FFProfileScope {
+    AVFilterContext *prev;
+    int64_t start;
+    int64_t child_time;
+} FFProfileScope;
+
+static inline int ff_profile_enabled(AVFilterContext *ctx)
+{
+    return ctx->graph && ctx->graph->profile;
+}
+
+/**
+ * Start timing a filter_frame() or request_frame() call of ctx.
+ */
+void ff_profile_enter(AVFilterContext *ctx, FFProfileScope *scope);
+
+/**
+ * Stop timing the call started by ff_profile_enter() and account it.
+ *
+ * @param request 1 for a request_frame() call, 0 for filter_frame()
+ */
+void ff_profile_leave(AVFilterContext *ctx, FFProfileScope *scope, int request);
+
+/**
+ * Account a slice job of ctx that ran on the given thread.
+ * Only one thread may use a given thread index at a time.
+ */
+void ff_profile_slice_job(AVFilterContext *ctx, int thread, int64_t time);
+
+/**
+ * Account the buffers of a newly allocated frame to the filter currently
+ * running in the graph.
+ */
+void ff_profile_frame_alloc(AVFilterGraph *graph, const AVFrame *frame);
+
+void ff_profile_free(AVFilterContext *ctx);
+
+#endif /* AVFILTER_PROFILE_H */
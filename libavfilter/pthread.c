@@ -27,9 +27,11 @@
 #include "libavutil/cpu.h"
 #include "libavutil/mem.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
 
 #include "avfilter.h"
 #include "internal.h"
+#include "profile.h"
 #include "thread.h"
 
 typedef struct ThreadContext {
@@ -81,7 +83,13 @@ static void* attribute_align_arg worker(void *v)
         }
         pthread_mutex_unlock(&c->current_job_lock);
 
-        c->rets[our_job % c->nb_rets] = c->func(c->ctx, c->arg, our_job, c->nb_jobs);
+        if (ff_profile_enabled(c->ctx)) {
+            int64_t start = av_gettime_relative();
+            c->rets[our_job % c->nb_rets] = c->func(c->ctx, c->arg, our_job, c->nb_jobs);
+            ff_profile_slice_job(c->ctx, self_id, av_gettime_relative() - start);
+        } else {
+            c->rets[our_job % c->nb_rets] = c->func(c->ctx, c->arg, our_job, c->nb_jobs);
+        }
 
         pthread_mutex_lock(&c->current_job_lock);
         our_job = c->current_job++;
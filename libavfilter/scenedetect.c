@@ -0,0 +1,246 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Scene change detection shared by the filters.
+ */
+
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+
+#include "internal.h"
+#include "scenedetect.h"
+
+typedef struct ThreadData {
+    FFSceneDetectContext *s;
+    const uint8_t *src;
+    int src_linesize;
+    uint8_t *cur;
+    int cur_linesize;
+    const uint8_t *prev;
+} ThreadData;
+
+int ff_scene_detect_init(FFSceneDetectContext *s, AVFilterContext *ctx,
+                         enum AVPixelFormat pix_fmt, int width, int height,
+                         int downscale)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(pix_fmt);
+    int i;
+
+    if (!desc || desc->comp[0].depth != 8 ||
+        desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM |
+                       AV_PIX_FMT_FLAG_HWACCEL)) {
+        av_log(ctx, AV_LOG_ERROR, "Unsupported pixel format for scene detection.\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->ctx        = ctx;
+    s->downscale  = downscale;
+    s->step       = desc->comp[0].step;
+    s->in_width   = width;
+    s->in_height  = height;
+    s->width      = width  >> downscale;
+    s->height     = height >> downscale;
+    s->nb_threads = FFMAX(1, ctx->graph->nb_threads);
+    s->prev_mafd  = 0;
+
+    if (s->width <= 0 || s->height <= 0) {
+        av_log(ctx, AV_LOG_ERROR, "Frame size %dx%d too small for a downscale of %d.\n",
+               width, height, downscale);
+        return AVERROR(EINVAL);
+    }
+
+    s->slice_sad  = av_calloc(s->nb_threads, sizeof(*s->slice_sad));
+    s->slice_hist = av_calloc(s->nb_threads, 256 * sizeof(*s->slice_hist));
+    if (!s->slice_sad || !s->slice_hist)
+        return AVERROR(ENOMEM);
+
+    if (downscale) {
+        s->linesize = FFALIGN(s->width * s->step, 32);
+        for (i = 0; i < 2; i++) {
+            s->buf[i] = av_malloc_array(s->linesize, s->height);
+            if (!s->buf[i])
+                return AVERROR(ENOMEM);
+        }
+    }
+
+    s->sad = av_pixelutils_get_sad_fn(3, 3, 2, ctx); // 8x8 both sources aligned
+    if (!s->sad)
+        return AVERROR(EINVAL);
+
+    return 0;
+}
+
+static void downscale_rows(FFSceneDetectContext *s, uint8_t *dst, int dst_linesize,
+                           const uint8_t *src, int src_linesize, int y0, int y1)
+{
+    const int f = 1 << s->downscale;
+    const int shift = 2 * s->downscale;
+    const int step = s->step;
+    int x, y, i, j, k;
+
+    for (y = y0; y < y1; y++) {
+        const uint8_t *srow = src + y * f * src_linesize;
+        uint8_t *drow = dst + y * dst_linesize;
+
+        for (x = 0; x < s->width; x++) {
+            for (k = 0; k < step; k++) {
+                unsigned sum = 0;
+
+                for (i = 0; i < f; i++)
+                    for (j = 0; j < f; j++)
+                        sum += srow[i * src_linesize + (x * f + j) * step + k];
+                drow[x * step + k] = (sum + (1 << shift >> 1)) >> shift;
+            }
+        }
+    }
+}
+
+static int scene_detect_slice(AVFilterContext *ctx, void *arg,
+                              int jobnr, int nb_jobs)
+{
+    ThreadData *td = arg;
+    FFSceneDetectContext *s = td->s;
+    /* slices start on a row of 8x8 blocks, the last one ends with the plane */
+    const int nb_rows     = s->height >> 3;
+    const int slice_start = 8 * ((nb_rows *  jobnr   ) / nb_jobs);
+    const int slice_end   = jobnr == nb_jobs - 1 ? s->height :
+                            8 * ((nb_rows * (jobnr+1)) / nb_jobs);
+    const int width = s->width * s->step;
+    uint32_t *hist = s->slice_hist + 256 * jobnr;
+    const uint8_t *line;
+    int x, y;
+
+    if (s->downscale)
+        downscale_rows(s, td->cur, td->cur_linesize,
+                       td->src, td->src_linesize, slice_start, slice_end);
+
+    memset(hist, 0, 256 * sizeof(*hist));
+    line = td->cur + slice_start * td->cur_linesize;
+    for (y = slice_start; y < slice_end; y++) {
+        for (x = 0; x < width; x++)
+            hist[line[x]]++;
+        line += td->cur_linesize;
+    }
+
+    s->slice_sad[jobnr] = 0;
+    if (td->prev) {
+        const uint8_t *p1 = td->cur  + slice_start * td->cur_linesize;
+        const uint8_t *p2 = td->prev + slice_start * s->prev_linesize;
+        uint64_t sad = 0;
+
+        /* the SAD covers the whole 8x8 blocks only, as the select filter did */
+        for (y = slice_start; y + 8 <= slice_end; y += 8) {
+            for (x = 0; x + 8 <= width; x += 8)
+                sad += s->sad(p1 + x, td->cur_linesize, p2 + x, s->prev_linesize);
+            p1 += 8 * td->cur_linesize;
+            p2 += 8 * s->prev_linesize;
+        }
+        emms_c();
+        s->slice_sad[jobnr] = sad;
+    }
+
+    return 0;
+}
+
+int ff_scene_detect_frame(FFSceneDetectContext *s, const AVFrame *frame,
+                          AVSceneScore *score)
+{
+    uint32_t *hist = s->hist[s->cur];
+    const uint32_t *prev_hist = s->hist[!s->cur];
+    ThreadData td;
+    uint64_t sad = 0;
+    int i, j, nb_jobs;
+
+    memset(score, 0, sizeof(*score));
+
+    if (frame->width != s->in_width || frame->height != s->in_height) {
+        av_frame_free(&s->prev_frame);
+        s->prev_data = NULL;
+        return 0;
+    }
+
+    td.s            = s;
+    td.src          = frame->data[0];
+    td.src_linesize = frame->linesize[0];
+    td.prev         = s->prev_data;
+    if (s->downscale) {
+        td.cur          = s->buf[s->cur];
+        td.cur_linesize = s->linesize;
+    } else {
+        td.cur          = frame->data[0];
+        td.cur_linesize = frame->linesize[0];
+    }
+
+    nb_jobs = av_clip(s->height >> 3, 1, s->nb_threads);
+    s->ctx->internal->execute(s->ctx, scene_detect_slice, &td, NULL, nb_jobs);
+
+    memset(hist, 0, sizeof(s->hist[0]));
+    for (j = 0; j < nb_jobs; j++) {
+        for (i = 0; i < 256; i++)
+            hist[i] += s->slice_hist[256 * j + i];
+        sad += s->slice_sad[j];
+    }
+
+    if (s->prev_data) {
+        const uint64_t nb_sad = (uint64_t)((s->width * s->step) & ~7) * (s->height & ~7);
+        uint64_t hist_diff = 0;
+        double mafd, diff;
+
+        mafd = nb_sad ? (double)sad / nb_sad : 0;
+        diff = fabs(mafd - s->prev_mafd);
+        score->score = av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
+        score->mafd  = mafd;
+        s->prev_mafd = mafd;
+
+        for (i = 0; i < 256; i++)
+            hist_diff += FFABS((int64_t)hist[i] - prev_hist[i]);
+        score->hist_diff = hist_diff / (2.0 * s->width * s->step * s->height);
+    }
+
+    if (s->downscale) {
+        s->prev_data     = td.cur;
+        s->prev_linesize = td.cur_linesize;
+    } else {
+        av_frame_free(&s->prev_frame);
+        s->prev_frame = av_frame_clone(frame);
+        if (!s->prev_frame) {
+            s->prev_data = NULL;
+            return AVERROR(ENOMEM);
+        }
+        s->prev_data     = s->prev_frame->data[0];
+        s->prev_linesize = s->prev_frame->linesize[0];
+    }
+    s->cur ^= 1;
+
+    return 0;
+}
+
+void ff_scene_detect_uninit(FFSceneDetectContext *s)
+{
+    av_frame_free(&s->prev_frame);
+    av_freep(&s->buf[0]);
+    av_freep(&s->buf[1]);
+    av_freep(&s->slice_sad);
+    av_freep(&s->slice_hist);
+}
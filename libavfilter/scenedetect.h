@@ -0,0 +1,84 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_SCENEDETECT_H
+#define AVFILTER_SCENEDETECT_H
+
+#include <stdint.h>
+
+#include "libavutil/frame.h"
+#include "libavutil/pixelutils.h"
+#include "libavutil/pixfmt.h"
+#include "libavutil/scene_score.h"
+
+#include "avfilter.h"
+
+/**
+ * Scene change detection shared by the filters.
+ *
+ * The first plane of each frame is optionally downscaled, then compared
+ * with the one of the previous frame by the sum of absolute differences
+ * and by its histogram. The work is split in slices run by the filter's
+ * slice threads, so the filter using it should have the
+ * AVFILTER_FLAG_SLICE_THREADS flag.
+ */
+typedef struct FFSceneDetectContext {
+    AVFilterContext *ctx;
+    av_pixelutils_sad_fn sad;   ///< 8x8 sum of absolute differences
+
+    int downscale;              ///< log2 of the downscaling factor
+    int step;                   ///< number of bytes per pixel of the plane
+    int in_width, in_height;    ///< size of the frames
+    int width, height;          ///< size of the analysed plane in pixels
+    int nb_threads;
+
+    uint8_t *buf[2];            ///< downscaled planes, if downscale > 0
+    int linesize;
+    AVFrame *prev_frame;        ///< previous frame, if downscale == 0
+    const uint8_t *prev_data;
+    int prev_linesize;
+    int cur;
+    double prev_mafd;
+
+    uint64_t *slice_sad;        ///< [nb_threads]
+    uint32_t *slice_hist;       ///< [nb_threads][256]
+    uint32_t hist[2][256];
+} FFSceneDetectContext;
+
+/**
+ * Prepare the analysis of the frames of a link.
+ *
+ * @param pix_fmt   8-bit planar YUV or gray, or packed RGB24/BGR24
+ * @param downscale log2 of the factor by which the frames are shrunk before
+ *                  being analysed; with 0 the score is the one of the legacy
+ *                  select filter scene detection
+ */
+int ff_scene_detect_init(FFSceneDetectContext *s, AVFilterContext *ctx,
+                         enum AVPixelFormat pix_fmt, int width, int height,
+                         int downscale);
+
+/**
+ * Analyse a frame against the previous one. The score of the first frame
+ * is 0.
+ */
+int ff_scene_detect_frame(FFSceneDetectContext *s, const AVFrame *frame,
+                          AVSceneScore *score);
+
+void ff_scene_detect_uninit(FFSceneDetectContext *s);
+
+#endif /* AVFILTER_SCENEDETECT_H */
@@ -31,6 +31,24 @@ typedef struct SSIMDSPContext {
     float (*ssim_end_line)(const int (*sum0)[4], const int (*sum1)[4], int w);
 } SSIMDSPContext;
 
+void ff_ssim_init(SSIMDSPContext *dsp);
 void ff_ssim_init_x86(SSIMDSPContext *dsp);
 
+/**
+ * Compute the SSIM of the rows y0 to y1 - 1 of 4x4 blocks of a plane,
+ * with 1 <= y0 <= y1 <= height / 4, and store the one of row y in
+ * row_ssim[y - 1]. temp must have room for 2 * width + 12 ints.
+ */
+void ff_ssim_plane_rows(SSIMDSPContext *dsp,
+                        uint8_t *main, int main_stride,
+                        uint8_t *ref, int ref_stride,
+                        int width, int y0, int y1,
+                        float *row_ssim, void *temp);
+
+/**
+ * Return the SSIM of a width x height plane from its rows computed by
+ * ff_ssim_plane_rows().
+ */
+float ff_ssim_plane_sum(const float *row_ssim, int width, int height);
+
 #endif /* AVFILTER_SSIM_H */
@@ -134,6 +134,37 @@ enum expansion_mode {
     EXP_STRFTIME,
 };
 
+/**
+ * Coverage masks of all the cached glyphs, unpacked to 8 bits and stored
+ * one after the other in a single buffer, addressed by offset.
+ */
+typedef struct GlyphAtlas {
+    uint8_t *data;
+    unsigned int size;              ///< allocated size of data
+    unsigned int used;              ///< bytes of data holding glyphs
+} GlyphAtlas;
+
+/** A glyph of the laid out text, at its position relative to the text origin. */
+typedef struct StripGlyph {
+    const struct Glyph *glyph;
+    int x, y;
+} StripGlyph;
+
+/**
+ * All the glyphs of a laid out text, pre-rendered into a single 8 bits
+ * coverage mask, so that a layer is blended with one ff_blend_mask() call.
+ */
+typedef struct TextStrip {
+    uint8_t *data;
+    unsigned int size;              ///< allocated size of data
+    int x, y;                       ///< position relative to the text origin
+    int w, h;                       ///< dimensions, also the line size
+    int valid;                      ///< data matches the cached layout
+    StripGlyph *glyphs;             ///< glyphs data was rendered from
+    unsigned int glyphs_size;       ///< allocated size of glyphs
+    int nb_glyphs;
+} TextStrip;
+
 typedef struct DrawTextContext {
     const AVClass *class;
     int exp_mode;                   ///< expansion mode to use for the text
@@ -149,6 +180,12 @@ typedef struct DrawTextContext {
     int ft_load_flags;              ///< flags used for loading fonts, see FT_LOAD_*
     FT_Vector *positions;           ///< positions for each element in the text
     size_t nb_positions;            ///< number of elements of positions array
+    char *layout_text;              ///< expanded text positions were computed for
+    StripGlyph *layout_glyphs;      ///< drawn glyphs of layout_text, in text order
+    unsigned int layout_glyphs_size; ///< allocated size of layout_glyphs
+    int nb_layout_glyphs;
+    GlyphAtlas atlas;               ///< coverage masks of the cached glyphs
+    TextStrip strips[2];            ///< pre-rendered glyphs, without and with border
     char *textfile;                 ///< file with text to be drawn
     int x;                          ///< x position to start drawing text
     int y;                          ///< y position to start drawing text
@@ -286,6 +323,7 @@ typedef struct Glyph {
     int advance;
     int bitmap_left;
     int bitmap_top;
+    unsigned int atlas_offset[2]; ///< coverage of the glyph and of its border in the atlas
 } Glyph;
 
 static int glyph_cmp(const void *key, const void *b)
@@ -298,6 +336,48 @@ static int glyph_cmp(const void *key, const void *b)
 /**
  * Load glyphs corresponding to the UTF-32 codepoint code.
  */
+/**
+ * Store the coverage of a bitmap in the atlas, with one byte per pixel.
+ * Bitmaps in other pixel modes than mono and gray are not stored, they are
+ * rejected when the text is laid out.
+ */
+static int atlas_add_bitmap(GlyphAtlas *atlas, const FT_Bitmap *bitmap,
+                            unsigned int *offset)
+{
+    unsigned int len = bitmap->width * bitmap->rows;
+    uint8_t *data, *dst;
+    int x, y;
+
+    *offset = atlas->used;
+    if (bitmap->pixel_mode != FT_PIXEL_MODE_MONO &&
+        bitmap->pixel_mode != FT_PIXEL_MODE_GRAY)
+        return 0;
+    if (bitmap->width && len / bitmap->width != bitmap->rows ||
+        len > UINT_MAX - atlas->used)
+        return AVERROR(ENOMEM);
+
+    data = av_fast_realloc(atlas->data, &atlas->size, atlas->used + len);
+    if (!data)
+        return AVERROR(ENOMEM);
+    atlas->data = data;
+
+    dst = data + atlas->used;
+    for (y = 0; y < bitmap->rows; y++) {
+        const uint8_t *src = bitmap->buffer + y * bitmap->pitch;
+
+        if (bitmap->pixel_mode == FT_PIXEL_MODE_MONO) {
+            for (x = 0; x < bitmap->width; x++)
+                dst[x] = (src[x >> 3] >> (~x & 7) & 1) * 255;
+        } else {
+            memcpy(dst, src, bitmap->width);
+        }
+        dst += bitmap->width;
+    }
+    atlas->used += len;
+
+    return 0;
+}
+
 static int load_glyph(AVFilterContext *ctx, Glyph **glyph_ptr, uint32_t code)
 {
     DrawTextContext *s = ctx->priv;
@@ -345,6 +425,10 @@ static int load_glyph(AVFilterContext *ctx, Glyph **glyph_ptr, uint32_t code)
     /* measure text height to calculate text_height (or the maximum text height) */
     FT_Glyph_Get_CBox(glyph->glyph, ft_glyph_bbox_pixels, &glyph->bbox);
 
+    if ((ret = atlas_add_bitmap(&s->atlas, &glyph->bitmap, &glyph->atlas_offset[0])) < 0 ||
+        (ret = atlas_add_bitmap(&s->atlas, &glyph->border_bitmap, &glyph->atlas_offset[1])) < 0)
+        goto error;
+
     /* cache the newly created glyph */
     if (!(node = av_tree_node_alloc())) {
         ret = AVERROR(ENOMEM);
@@ -704,13 +788,28 @@ static int glyph_enu_free(void *opaque, void *elem)
 static av_cold void uninit(AVFilterContext *ctx)
 {
     DrawTextContext *s = ctx->priv;
+    int i;
 
     av_expr_free(s->x_pexpr);
     av_expr_free(s->y_pexpr);
     s->x_pexpr = s->y_pexpr = NULL;
     av_freep(&s->positions);
     s->nb_positions = 0;
-
+    av_freep(&s->layout_text);
+    av_freep(&s->layout_glyphs);
+    s->layout_glyphs_size = 0;
+    s->nb_layout_glyphs   = 0;
+    for (i = 0; i < FF_ARRAY_ELEMS(s->strips); i++) {
+        av_freep(&s->strips[i].data);
+        av_freep(&s->strips[i].glyphs);
+        s->strips[i].size        = 0;
+        s->strips[i].glyphs_size = 0;
+        s->strips[i].nb_glyphs   = 0;
+        s->strips[i].w = s->strips[i].h = 0;
+        s->strips[i].valid       = 0;
+    }
+    av_freep(&s->atlas.data);
+    s->atlas.size = s->atlas.used = 0;
 
     av_tree_enumerate(s->glyphs, NULL, NULL, glyph_enu_free);
     av_tree_destroy(s->glyphs);
@@ -1070,45 +1169,175 @@ static int expand_text(AVFilterContext *ctx, char *text, AVBPrint *bp)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       int width, int height,
-                       FFDrawColor *color,
-                       int x, int y, int borderw)
+/**
+ * Composite the part of a glyph's coverage within the clip rectangle
+ * [cx0, cx1) x [cy0, cy1) into the strip, at (x0, y0) in strip coordinates.
+ */
+static void strip_add_glyph(TextStrip *st, const uint8_t *src, int w, int h,
+                            int x0, int y0, int cx0, int cy0, int cx1, int cy1)
 {
-    char *text = s->expanded_text.str;
-    uint32_t code = 0;
-    int i, x1, y1;
-    uint8_t *p;
-    Glyph *glyph = NULL;
+    int xs = FFMAX(x0, cx0), xe = FFMIN(x0 + w, cx1);
+    int ys = FFMAX(y0, cy0), ye = FFMIN(y0 + h, cy1);
+    int x, y;
+
+    for (y = ys; y < ye; y++) {
+        const uint8_t *line = src + (y - y0) * w - x0;
+        uint8_t *dst = st->data + y * st->w;
+
+        for (x = xs; x < xe; x++) {
+            unsigned a = dst[x], b = line[x];
+            /* overlapping glyphs: coverage is 1 - (1 - a) * (1 - b) */
+            dst[x] = a + b - (a * b + 127) / 255;
+        }
+    }
+}
 
-    for (i = 0, p = text; *p; i++) {
-        FT_Bitmap bitmap;
-        Glyph dummy = { 0 };
-        GET_UTF8(code, *p++, continue;);
+#define GLYPH_W(g, borderw) ((borderw) ? (g)->border_bitmap.width : (g)->bitmap.width)
+#define GLYPH_H(g, borderw) ((borderw) ? (g)->border_bitmap.rows  : (g)->bitmap.rows)
+#define SAME_GLYPH(a, b) ((a)->glyph == (b)->glyph && (a)->x == (b)->x && (a)->y == (b)->y)
 
-        /* skip new line chars, just go to new line */
-        if (code == '\n' || code == '\r' || code == '\t')
+/**
+ * Clear the rectangle [x0, x1) x [y0, y1) of the strip, in strip
+ * coordinates, and draw again the parts of the laid out glyphs within it.
+ */
+static void strip_redraw_rect(DrawTextContext *s, TextStrip *st, int borderw,
+                              int x0, int y0, int x1, int y1)
+{
+    int i, y;
+
+    x0 = FFMAX(x0, 0);
+    y0 = FFMAX(y0, 0);
+    x1 = FFMIN(x1, st->w);
+    y1 = FFMIN(y1, st->h);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    for (y = y0; y < y1; y++)
+        memset(st->data + y * st->w + x0, 0, x1 - x0);
+
+    for (i = 0; i < s->nb_layout_glyphs; i++) {
+        const StripGlyph *sg = &s->layout_glyphs[i];
+        const Glyph *g = sg->glyph;
+        int w = GLYPH_W(g, borderw), h = GLYPH_H(g, borderw);
+
+        if (w && h)
+            strip_add_glyph(st, s->atlas.data + g->atlas_offset[!!borderw], w, h,
+                            sg->x - borderw - st->x, sg->y - borderw - st->y,
+                            x0, y0, x1, y1);
+    }
+}
+
+static int render_strip(DrawTextContext *s, TextStrip *st, int borderw)
+{
+    int i, x1 = INT_MAX, y1 = INT_MAX, x2 = INT_MIN, y2 = INT_MIN;
+    int64_t dirty = 0;
+
+    for (i = 0; i < s->nb_layout_glyphs; i++) {
+        const StripGlyph *sg = &s->layout_glyphs[i];
+        int w = GLYPH_W(sg->glyph, borderw), h = GLYPH_H(sg->glyph, borderw);
+
+        if (!w || !h)
             continue;
+        x1 = FFMIN(x1, sg->x - borderw);
+        y1 = FFMIN(y1, sg->y - borderw);
+        x2 = FFMAX(x2, sg->x - borderw + w);
+        y2 = FFMAX(y2, sg->y - borderw + h);
+    }
 
-        dummy.code = code;
-        glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
+    if (x1 >= x2 || y1 >= y2) {
+        st->w = st->h = 0;
+        st->nb_glyphs = 0;
+        st->valid = 1;
+        return 0;
+    }
 
-        bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
+    /* When the text changes, only redraw the glyphs which differ from the
+     * ones the strip holds, as long as the new text fits in the strip and
+     * most of it is unchanged, e.g. for counters and timecodes. */
+    if (st->w && st->h &&
+        x1 >= st->x && y1 >= st->y && x2 <= st->x + st->w && y2 <= st->y + st->h &&
+        (int64_t)(x2 - x1) * (y2 - y1) * 2 > (int64_t)st->w * st->h) {
+        int n = FFMAX(st->nb_glyphs, s->nb_layout_glyphs);
+
+        for (i = 0; i < n; i++) {
+            const StripGlyph *o = i < st->nb_glyphs        ? &st->glyphs[i]        : NULL;
+            const StripGlyph *c = i < s->nb_layout_glyphs ? &s->layout_glyphs[i] : NULL;
+
+            if (o && c && SAME_GLYPH(o, c))
+                continue;
+            if (o)
+                dirty += (int64_t)GLYPH_W(o->glyph, borderw) * GLYPH_H(o->glyph, borderw);
+            if (c)
+                dirty += (int64_t)GLYPH_W(c->glyph, borderw) * GLYPH_H(c->glyph, borderw);
+        }
 
-        if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
-            glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
-            return AVERROR(EINVAL);
+        if (dirty * 2 <= (int64_t)st->w * st->h) {
+            for (i = 0; i < n; i++) {
+                const StripGlyph *o = i < st->nb_glyphs        ? &st->glyphs[i]        : NULL;
+                const StripGlyph *c = i < s->nb_layout_glyphs ? &s->layout_glyphs[i] : NULL;
+                int j;
+
+                if (o && c && SAME_GLYPH(o, c))
+                    continue;
+                for (j = 0; j < 2; j++) {
+                    const StripGlyph *sg = j ? c : o;
+                    int x, y;
+
+                    if (!sg)
+                        continue;
+                    x = sg->x - borderw - st->x;
+                    y = sg->y - borderw - st->y;
+                    strip_redraw_rect(s, st, borderw, x, y,
+                                      x + GLYPH_W(sg->glyph, borderw),
+                                      y + GLYPH_H(sg->glyph, borderw));
+                }
+            }
+            goto done;
+        }
+    }
 
-        x1 = s->positions[i].x+s->x+x - borderw;
-        y1 = s->positions[i].y+s->y+y - borderw;
+    st->x = x1;
+    st->y = y1;
+    st->w = x2 - x1;
+    st->h = y2 - y1;
+    if (st->w > INT_MAX / st->h)
+        return AVERROR(ENOMEM);
+    av_fast_malloc(&st->data, &st->size, st->w * st->h);
+    if (!st->data) {
+        st->w = st->h = 0;
+        return AVERROR(ENOMEM);
+    }
+    strip_redraw_rect(s, st, borderw, 0, 0, st->w, st->h);
 
+done:
+    av_fast_malloc(&st->glyphs, &st->glyphs_size,
+                   s->nb_layout_glyphs * sizeof(*st->glyphs));
+    if (!st->glyphs) {
+        st->w = st->h = st->nb_glyphs = 0;
+        return AVERROR(ENOMEM);
+    }
+    memcpy(st->glyphs, s->layout_glyphs, s->nb_layout_glyphs * sizeof(*st->glyphs));
+    st->nb_glyphs = s->nb_layout_glyphs;
+    st->valid = 1;
+    return 0;
+}
+
+static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
+                       int width, int height,
+                       FFDrawColor *color,
+                       int x, int y, int borderw)
+{
+    TextStrip *st = &s->strips[!!borderw];
+    int ret;
+
+    if (!st->valid && (ret = render_strip(s, st, borderw)) < 0)
+        return ret;
+
+    if (st->w && st->h)
         ff_blend_mask(&s->dc, color,
                       frame->data, frame->linesize, width, height,
-                      bitmap.buffer, bitmap.pitch,
-                      bitmap.width, bitmap.rows,
-                      bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
-                      0, x1, y1);
-    }
+                      st->data, st->w, st->w, st->h, 3, 0,
+                      s->x + x + st->x, s->y + y + st->y);
 
     return 0;
 }
@@ -1136,17 +1365,17 @@ static void update_alpha(DrawTextContext *s)
         s->alpha = 256 * alpha;
 }
 
-static int draw_text(AVFilterContext *ctx, AVFrame *frame,
-                     int width, int height)
+/**
+ * Load the glyphs of the expanded text, compute their positions and the
+ * text metrics, and remember the text they were computed for.
+ */
+static int layout_text(AVFilterContext *ctx)
 {
     DrawTextContext *s = ctx->priv;
-    AVFilterLink *inlink = ctx->inputs[0];
-
+    char *text = s->expanded_text.str;
     uint32_t code = 0, prev_code = 0;
     int x = 0, y = 0, i = 0, ret;
     int max_text_line_w = 0, len;
-    int box_w, box_h;
-    char *text;
     uint8_t *p;
     int y_min = 32000, y_max = -32000;
     int x_min = 32000, x_max = -32000;
@@ -1154,44 +1383,9 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     Glyph *glyph = NULL, *prev_glyph = NULL;
     Glyph dummy = { 0 };
 
-    time_t now = time(0);
-    struct tm ltime;
-    AVBPrint *bp = &s->expanded_text;
-
-    FFDrawColor fontcolor;
-    FFDrawColor shadowcolor;
-    FFDrawColor bordercolor;
-    FFDrawColor boxcolor;
-
-    av_bprint_clear(bp);
-
-    if(s->basetime != AV_NOPTS_VALUE)
-        now= frame->pts*av_q2d(ctx->inputs[0]->time_base) + s->basetime/1000000;
-
-    switch (s->exp_mode) {
-    case EXP_NONE:
-        av_bprintf(bp, "%s", s->text);
-        break;
-    case EXP_NORMAL:
-        if ((ret = expand_text(ctx, s->text, &s->expanded_text)) < 0)
-            return ret;
-        break;
-    case EXP_STRFTIME:
-        localtime_r(&now, &ltime);
-        av_bprint_strftime(bp, s->text, &ltime);
-        break;
-    }
-
-    if (s->tc_opt_string) {
-        char tcbuf[AV_TIMECODE_STR_SIZE];
-        av_timecode_make_string(&s->tc, tcbuf, inlink->frame_count);
-        av_bprint_clear(bp);
-        av_bprintf(bp, "%s%s", s->text, tcbuf);
-    }
+    av_freep(&s->layout_text);
+    s->strips[0].valid = s->strips[1].valid = 0;
 
-    if (!av_bprint_is_complete(bp))
-        return AVERROR(ENOMEM);
-    text = s->expanded_text.str;
     if ((len = s->expanded_text.len) > s->nb_positions) {
         if (!(s->positions =
               av_realloc(s->positions, len*sizeof(*s->positions))))
@@ -1199,23 +1393,6 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         s->nb_positions = len;
     }
 
-    if (s->fontcolor_expr[0]) {
-        /* If expression is set, evaluate and replace the static value */
-        av_bprint_clear(&s->expanded_fontcolor);
-        if ((ret = expand_text(ctx, s->fontcolor_expr, &s->expanded_fontcolor)) < 0)
-            return ret;
-        if (!av_bprint_is_complete(&s->expanded_fontcolor))
-            return AVERROR(ENOMEM);
-        av_log(s, AV_LOG_DEBUG, "Evaluated fontcolor is '%s'\n", s->expanded_fontcolor.str);
-        ret = av_parse_color(s->fontcolor.rgba, s->expanded_fontcolor.str, -1, s);
-        if (ret)
-            return ret;
-        ff_draw_color(&s->dc, &s->fontcolor, s->fontcolor.rgba);
-    }
-
-    x = 0;
-    y = 0;
-
     /* load and cache glyphs */
     for (i = 0, p = text; *p; i++) {
         GET_UTF8(code, *p++, continue;);
@@ -1286,6 +1463,106 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
 
     s->var_values[VAR_LINE_H] = s->var_values[VAR_LH] = s->max_glyph_h;
 
+    /* list the glyphs to draw, the strips are updated from it */
+    s->nb_layout_glyphs = 0;
+    av_fast_malloc(&s->layout_glyphs, &s->layout_glyphs_size,
+                   len * sizeof(*s->layout_glyphs));
+    if (!s->layout_glyphs)
+        return AVERROR(ENOMEM);
+    for (i = 0, p = text; *p; i++) {
+        StripGlyph *sg;
+        GET_UTF8(code, *p++, continue;);
+
+        /* skip new line chars, just go to new line */
+        if (code == '\n' || code == '\r' || code == '\t')
+            continue;
+
+        dummy.code = code;
+        glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
+        if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
+            glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
+            return AVERROR(EINVAL);
+
+        sg = &s->layout_glyphs[s->nb_layout_glyphs++];
+        sg->glyph = glyph;
+        sg->x     = s->positions[i].x;
+        sg->y     = s->positions[i].y;
+    }
+
+    if (!(s->layout_text = av_strdup(text)))
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+static int draw_text(AVFilterContext *ctx, AVFrame *frame,
+                     int width, int height)
+{
+    DrawTextContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+
+    int ret;
+    int box_w, box_h;
+    char *text;
+
+    time_t now = time(0);
+    struct tm ltime;
+    AVBPrint *bp = &s->expanded_text;
+
+    FFDrawColor fontcolor;
+    FFDrawColor shadowcolor;
+    FFDrawColor bordercolor;
+    FFDrawColor boxcolor;
+
+    av_bprint_clear(bp);
+
+    if(s->basetime != AV_NOPTS_VALUE)
+        now= frame->pts*av_q2d(ctx->inputs[0]->time_base) + s->basetime/1000000;
+
+    switch (s->exp_mode) {
+    case EXP_NONE:
+        av_bprintf(bp, "%s", s->text);
+        break;
+    case EXP_NORMAL:
+        if ((ret = expand_text(ctx, s->text, &s->expanded_text)) < 0)
+            return ret;
+        break;
+    case EXP_STRFTIME:
+        localtime_r(&now, &ltime);
+        av_bprint_strftime(bp, s->text, &ltime);
+        break;
+    }
+
+    if (s->tc_opt_string) {
+        char tcbuf[AV_TIMECODE_STR_SIZE];
+        av_timecode_make_string(&s->tc, tcbuf, inlink->frame_count);
+        av_bprint_clear(bp);
+        av_bprintf(bp, "%s%s", s->text, tcbuf);
+    }
+
+    if (!av_bprint_is_complete(bp))
+        return AVERROR(ENOMEM);
+    text = s->expanded_text.str;
+
+    if (s->fontcolor_expr[0]) {
+        /* If expression is set, evaluate and replace the static value */
+        av_bprint_clear(&s->expanded_fontcolor);
+        if ((ret = expand_text(ctx, s->fontcolor_expr, &s->expanded_fontcolor)) < 0)
+            return ret;
+        if (!av_bprint_is_complete(&s->expanded_fontcolor))
+            return AVERROR(ENOMEM);
+        av_log(s, AV_LOG_DEBUG, "Evaluated fontcolor is '%s'\n", s->expanded_fontcolor.str);
+        ret = av_parse_color(s->fontcolor.rgba, s->expanded_fontcolor.str, -1, s);
+        if (ret)
+            return ret;
+        ff_draw_color(&s->dc, &s->fontcolor, s->fontcolor.rgba);
+    }
+
+    if (!s->layout_text || strcmp(text, s->layout_text)) {
+        if ((ret = layout_text(ctx)) < 0)
+            return ret;
+    }
+
     s->x = s->var_values[VAR_X] = av_expr_eval(s->x_pexpr, s->var_values, &s->prng);
     s->y = s->var_values[VAR_Y] = av_expr_eval(s->y_pexpr, s->var_values, &s->prng);
     s->x = s->var_values[VAR_X] = av_expr_eval(s->x_pexpr, s->var_values, &s->prng);
@@ -1296,8 +1573,8 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     update_color_with_alpha(s, &bordercolor, s->bordercolor);
     update_color_with_alpha(s, &boxcolor   , s->boxcolor   );
 
-    box_w = FFMIN(width - 1 , max_text_line_w);
-    box_h = FFMIN(height - 1, y + s->max_glyph_h);
+    box_w = FFMIN(width - 1 , s->var_values[VAR_TEXT_W]);
+    box_h = FFMIN(height - 1, s->var_values[VAR_TEXT_H]);
 
     /* draw box */
     if (s->draw_box)
@@ -0,0 +1,473 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Compute the PSNR and SSIM of several input videos against one reference.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "avfilter.h"
+#include "drawutils.h"
+#include "formats.h"
+#include "framesync.h"
+#include "internal.h"
+#include "psnr.h"
+#include "ssim.h"
+#include "video.h"
+
+typedef struct MetricsContext {
+    const AVClass *class;
+    FFFrameSync fs;
+    AVFrame **frames;
+    int nb_inputs;
+    int do_psnr;
+    int do_ssim;
+    FILE *stats_file;
+    char *stats_file_str;
+
+    int is_rgb;
+    uint8_t rgba_map[4];
+    char comps[4];
+    int nb_components;
+    int planewidth[4];
+    int planeheight[4];
+    double planeweight[4];
+    int max[4], average_max;
+    int nb_threads;
+
+    PSNRDSPContext psnr_dsp;
+    SSIMDSPContext ssim_dsp;
+    uint64_t *sse;          ///< [nb_inputs][nb_threads][4] per job squared errors
+    float *row_ssim;        ///< [nb_inputs][4][row_ssim_size] per row SSIM
+    int row_ssim_size;
+    int *ssim_temp;         ///< [nb_threads][ssim_temp_size]
+    int ssim_temp_size;
+
+    uint64_t nb_frames;
+    double *mse;            ///< per input sum of the frame MSEs
+    double *ssim;           ///< per input sum of the frame SSIMs
+} MetricsContext;
+
+#define OFFSET(x) offsetof(MetricsContext, x)
+#define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
+
+static const AVOption metrics_options[] = {
+    { "inputs",     "set number of distorted inputs", OFFSET(nb_inputs), AV_OPT_TYPE_INT, {.i64=1}, 1, INT_MAX, FLAGS },
+    { "psnr",       "compute the PSNR", OFFSET(do_psnr), AV_OPT_TYPE_BOOL, {.i64=1}, 0, 1, FLAGS },
+    { "ssim",       "compute the SSIM", OFFSET(do_ssim), AV_OPT_TYPE_BOOL, {.i64=1}, 0, 1, FLAGS },
+    { "stats_file", "set file where to store per-frame metrics", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { "f",          "set file where to store per-frame metrics", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(metrics);
+
+static double get_psnr(double mse, uint64_t nb_frames, int max)
+{
+    return 10.0 * log10((double)max * max / (mse / nb_frames));
+}
+
+static double ssim_db(double ssim, double weight)
+{
+    return 10 * log10(weight / (weight - ssim));
+}
+
+static void set_meta(AVDictionary **metadata, int input, const char *key,
+                     char comp, double d)
+{
+    char key2[128], value[128];
+
+    snprintf(value, sizeof(value), "%0.2f", d);
+    if (comp)
+        snprintf(key2, sizeof(key2), "lavfi.metrics.%d.%s%c", input, key, comp);
+    else
+        snprintf(key2, sizeof(key2), "lavfi.metrics.%d.%s", input, key);
+    av_dict_set(metadata, key2, value, 0);
+}
+
+typedef struct ThreadData {
+    AVFrame *ref;
+    AVFrame **in;
+} ThreadData;
+
+static int compute_metrics(AVFilterContext *ctx, void *arg,
+                           int jobnr, int nb_jobs)
+{
+    MetricsContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const AVFrame *ref = td->ref;
+    int i, c, y;
+
+    for (i = 0; i < s->nb_inputs; i++) {
+        const AVFrame *main = td->in[i];
+
+        for (c = 0; c < s->nb_components; c++) {
+            if (s->do_psnr) {
+                const int slice_start = (s->planeheight[c] *  jobnr   ) / nb_jobs;
+                const int slice_end   = (s->planeheight[c] * (jobnr+1)) / nb_jobs;
+                const uint8_t *main_line = main->data[c] + main->linesize[c] * slice_start;
+                const uint8_t *ref_line  = ref->data[c]  + ref->linesize[c]  * slice_start;
+                uint64_t m = 0;
+
+                for (y = slice_start; y < slice_end; y++) {
+                    m += s->psnr_dsp.sse_line(main_line, ref_line, s->planewidth[c]);
+                    main_line += main->linesize[c];
+                    ref_line  += ref->linesize[c];
+                }
+                s->sse[(i * s->nb_threads + jobnr) * 4 + c] = m;
+            }
+
+            if (s->do_ssim) {
+                const int rows = (s->planeheight[c] >> 2) - 1;
+                const int slice_start = 1 + (rows *  jobnr   ) / nb_jobs;
+                const int slice_end   = 1 + (rows * (jobnr+1)) / nb_jobs;
+
+                ff_ssim_plane_rows(&s->ssim_dsp, main->data[c], main->linesize[c],
+                                   ref->data[c], ref->linesize[c],
+                                   s->planewidth[c], slice_start, slice_end,
+                                   s->row_ssim + (i * 4 + c) * s->row_ssim_size,
+                                   s->ssim_temp + jobnr * s->ssim_temp_size);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int process_frame(FFFrameSync *fs)
+{
+    AVFilterContext *ctx = fs->parent;
+    AVFilterLink *outlink = ctx->outputs[0];
+    MetricsContext *s = fs->opaque;
+    AVFrame *ref, *out, **in = s->frames;
+    AVDictionary **metadata;
+    ThreadData td;
+    int i, j, c, nb_jobs, ret;
+
+    if ((ret = ff_framesync_get_frame(&s->fs, 0, &ref, 0)) < 0)
+        return ret;
+    for (i = 0; i < s->nb_inputs; i++) {
+        if ((ret = ff_framesync_get_frame(&s->fs, i + 1, &in[i], 0)) < 0)
+            return ret;
+        if (!in[i])
+            return 0;
+    }
+    if (!ref)
+        return 0;
+
+    out = av_frame_clone(ref);
+    if (!out)
+        return AVERROR(ENOMEM);
+    out->pts = av_rescale_q(s->fs.pts, s->fs.time_base, outlink->time_base);
+    metadata = avpriv_frame_get_metadatap(out);
+
+    td.ref = ref;
+    td.in  = in;
+    nb_jobs = av_clip(s->do_ssim ? s->planeheight[1] >> 2 : s->planeheight[1],
+                      1, s->nb_threads);
+    ctx->internal->execute(ctx, compute_metrics, &td, NULL, nb_jobs);
+
+    s->nb_frames++;
+
+    for (i = 0; i < s->nb_inputs; i++) {
+        double comp_mse[4], mse = 0;
+        float comp_ssim[4], ssimv = 0.0;
+
+        if (s->stats_file)
+            fprintf(s->stats_file, "n:%"PRId64" input:%d ", s->nb_frames, i + 1);
+
+        if (s->do_psnr) {
+            for (c = 0; c < s->nb_components; c++) {
+                uint64_t m = 0;
+                for (j = 0; j < nb_jobs; j++)
+                    m += s->sse[(i * s->nb_threads + j) * 4 + c];
+                comp_mse[c] = m / (double)(s->planewidth[c] * s->planeheight[c]);
+                mse += comp_mse[c] * s->planeweight[c];
+            }
+            s->mse[i] += mse;
+
+            for (j = 0; j < s->nb_components; j++) {
+                c = s->is_rgb ? s->rgba_map[j] : j;
+                set_meta(metadata, i + 1, "psnr.mse.", s->comps[j], comp_mse[c]);
+                set_meta(metadata, i + 1, "psnr.psnr.", s->comps[j], get_psnr(comp_mse[c], 1, s->max[c]));
+            }
+            set_meta(metadata, i + 1, "psnr.mse_avg", 0, mse);
+            set_meta(metadata, i + 1, "psnr.psnr_avg", 0, get_psnr(mse, 1, s->average_max));
+
+            if (s->stats_file)
+                fprintf(s->stats_file, "mse_avg:%0.2f psnr_avg:%0.2f ",
+                        mse, get_psnr(mse, 1, s->average_max));
+        }
+
+        if (s->do_ssim) {
+            for (c = 0; c < s->nb_components; c++) {
+                comp_ssim[c] = ff_ssim_plane_sum(s->row_ssim + (i * 4 + c) * s->row_ssim_size,
+                                                 s->planewidth[c], s->planeheight[c]);
+                ssimv += s->planeweight[c] * comp_ssim[c];
+            }
+            s->ssim[i] += ssimv;
+
+            for (j = 0; j < s->nb_components; j++) {
+                c = s->is_rgb ? s->rgba_map[j] : j;
+                set_meta(metadata, i + 1, "ssim.", av_toupper(s->comps[j]), comp_ssim[c]);
+            }
+            set_meta(metadata, i + 1, "ssim.All", 0, ssimv);
+            set_meta(metadata, i + 1, "ssim.dB", 0, ssim_db(ssimv, 1.0));
+
+            if (s->stats_file)
+                fprintf(s->stats_file, "ssim_All:%f ssim_dB:%f ",
+                        ssimv, ssim_db(ssimv, 1.0));
+        }
+
+        if (s->stats_file)
+            fprintf(s->stats_file, "\n");
+    }
+
+    return ff_filter_frame(outlink, out);
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    MetricsContext *s = inlink->dst->priv;
+    return ff_framesync_filter_frame(&s->fs, inlink, in);
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    MetricsContext *s = ctx->priv;
+    int i, ret;
+
+    if (!s->do_psnr && !s->do_ssim) {
+        av_log(ctx, AV_LOG_ERROR, "No metric enabled.\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (s->stats_file_str) {
+        if (!strcmp(s->stats_file_str, "-")) {
+            s->stats_file = stdout;
+        } else {
+            s->stats_file = fopen(s->stats_file_str, "w");
+            if (!s->stats_file) {
+                int err = AVERROR(errno);
+                char buf[128];
+                av_strerror(err, buf, sizeof(buf));
+                av_log(ctx, AV_LOG_ERROR, "Could not open stats file %s: %s\n",
+                       s->stats_file_str, buf);
+                return err;
+            }
+        }
+    }
+
+    s->frames = av_calloc(s->nb_inputs, sizeof(*s->frames));
+    s->mse    = av_calloc(s->nb_inputs, sizeof(*s->mse));
+    s->ssim   = av_calloc(s->nb_inputs, sizeof(*s->ssim));
+    if (!s->frames || !s->mse || !s->ssim)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i <= s->nb_inputs; i++) {
+        AVFilterPad pad = { 0 };
+
+        pad.type = AVMEDIA_TYPE_VIDEO;
+        pad.name = i ? av_asprintf("input%d", i) : av_strdup("reference");
+        if (!pad.name)
+            return AVERROR(ENOMEM);
+        pad.filter_frame = filter_frame;
+
+        if ((ret = ff_insert_inpad(ctx, i, &pad)) < 0) {
+            av_freep(&pad.name);
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    MetricsContext *s = ctx->priv;
+    static const enum AVPixelFormat pix_fmts_8bit[] = {
+        AV_PIX_FMT_GRAY8,
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P,
+        AV_PIX_FMT_YUV440P, AV_PIX_FMT_YUV411P, AV_PIX_FMT_YUV410P,
+        AV_PIX_FMT_YUVJ411P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ422P,
+        AV_PIX_FMT_YUVJ440P, AV_PIX_FMT_YUVJ444P,
+        AV_PIX_FMT_GBRP,
+        AV_PIX_FMT_NONE
+    };
+    static const enum AVPixelFormat pix_fmts[] = {
+        AV_PIX_FMT_GRAY8, AV_PIX_FMT_GRAY16,
+#define PF_NOALPHA(suf) AV_PIX_FMT_YUV420##suf,  AV_PIX_FMT_YUV422##suf,  AV_PIX_FMT_YUV444##suf
+#define PF_ALPHA(suf)   AV_PIX_FMT_YUVA420##suf, AV_PIX_FMT_YUVA422##suf, AV_PIX_FMT_YUVA444##suf
+#define PF(suf)         PF_NOALPHA(suf), PF_ALPHA(suf)
+        PF(P), PF(P9), PF(P10), PF_NOALPHA(P12), PF_NOALPHA(P14), PF(P16),
+        AV_PIX_FMT_YUV440P, AV_PIX_FMT_YUV411P, AV_PIX_FMT_YUV410P,
+        AV_PIX_FMT_YUVJ411P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ422P,
+        AV_PIX_FMT_YUVJ440P, AV_PIX_FMT_YUVJ444P,
+        AV_PIX_FMT_GBRP, AV_PIX_FMT_GBRP9, AV_PIX_FMT_GBRP10,
+        AV_PIX_FMT_GBRP12, AV_PIX_FMT_GBRP14, AV_PIX_FMT_GBRP16,
+        AV_PIX_FMT_GBRAP, AV_PIX_FMT_GBRAP16,
+        AV_PIX_FMT_NONE
+    };
+
+    /* the SSIM code only handles 8 bits per component */
+    AVFilterFormats *fmts_list = ff_make_format_list(s->do_ssim ? pix_fmts_8bit : pix_fmts);
+    if (!fmts_list)
+        return AVERROR(ENOMEM);
+    return ff_set_common_formats(ctx, fmts_list);
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    MetricsContext *s = ctx->priv;
+    AVFilterLink *reflink = ctx->inputs[0];
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(reflink->format);
+    FFFrameSyncIn *in;
+    int i, j, sum = 0, ret;
+
+    for (i = 1; i <= s->nb_inputs; i++) {
+        if (ctx->inputs[i]->w != reflink->w ||
+            ctx->inputs[i]->h != reflink->h) {
+            av_log(ctx, AV_LOG_ERROR, "Input %d size %dx%d does not match the reference size %dx%d.\n",
+                   i, ctx->inputs[i]->w, ctx->inputs[i]->h, reflink->w, reflink->h);
+            return AVERROR(EINVAL);
+        }
+    }
+
+    s->nb_components = desc->nb_components;
+    s->is_rgb = ff_fill_rgba_map(s->rgba_map, reflink->format) >= 0;
+    s->comps[0] = s->is_rgb ? 'r' : 'y';
+    s->comps[1] = s->is_rgb ? 'g' : 'u';
+    s->comps[2] = s->is_rgb ? 'b' : 'v';
+    s->comps[3] = 'a';
+
+    s->planeheight[1] = s->planeheight[2] = AV_CEIL_RSHIFT(reflink->h, desc->log2_chroma_h);
+    s->planeheight[0] = s->planeheight[3] = reflink->h;
+    s->planewidth[1]  = s->planewidth[2]  = AV_CEIL_RSHIFT(reflink->w, desc->log2_chroma_w);
+    s->planewidth[0]  = s->planewidth[3]  = reflink->w;
+    for (j = 0; j < s->nb_components; j++)
+        sum += s->planeheight[j] * s->planewidth[j];
+    for (j = 0; j < s->nb_components; j++) {
+        s->planeweight[j] = (double) s->planeheight[j] * s->planewidth[j] / sum;
+        s->max[j] = (1 << desc->comp[j].depth) - 1;
+        s->average_max += s->max[j] * s->planeweight[j];
+    }
+
+    s->nb_threads = FFMAX(1, ctx->graph->nb_threads);
+    if (s->do_psnr) {
+        ff_psnr_init(&s->psnr_dsp, desc->comp[0].depth);
+        s->sse = av_calloc(s->nb_inputs * s->nb_threads, 4 * sizeof(*s->sse));
+        if (!s->sse)
+            return AVERROR(ENOMEM);
+    }
+    if (s->do_ssim) {
+        ff_ssim_init(&s->ssim_dsp);
+        s->row_ssim_size  = (reflink->h >> 2) + 1;
+        s->ssim_temp_size = 2 * reflink->w + 12;
+        s->row_ssim  = av_calloc(s->nb_inputs * 4, s->row_ssim_size * sizeof(*s->row_ssim));
+        s->ssim_temp = av_malloc_array(s->nb_threads, s->ssim_temp_size * sizeof(*s->ssim_temp));
+        if (!s->row_ssim || !s->ssim_temp)
+            return AVERROR(ENOMEM);
+    }
+
+    outlink->w                   = reflink->w;
+    outlink->h                   = reflink->h;
+    outlink->time_base           = reflink->time_base;
+    outlink->sample_aspect_ratio = reflink->sample_aspect_ratio;
+    outlink->frame_rate          = reflink->frame_rate;
+
+    if ((ret = ff_framesync_init(&s->fs, ctx, s->nb_inputs + 1)) < 0)
+        return ret;
+
+    in = s->fs.in;
+    s->fs.opaque = s;
+    s->fs.on_event = process_frame;
+
+    for (i = 0; i <= s->nb_inputs; i++) {
+        in[i].time_base = ctx->inputs[i]->time_base;
+        in[i].sync   = 1;
+        in[i].before = EXT_STOP;
+        in[i].after  = EXT_STOP;
+    }
+
+    return ff_framesync_configure(&s->fs);
+}
+
+static int request_frame(AVFilterLink *outlink)
+{
+    MetricsContext *s = outlink->src->priv;
+    return ff_framesync_request_frame(&s->fs, outlink);
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    MetricsContext *s = ctx->priv;
+    int i;
+
+    for (i = 0; s->nb_frames > 0 && i < s->nb_inputs; i++) {
+        char buf[256] = { 0 };
+
+        if (s->do_psnr)
+            av_strlcatf(buf, sizeof(buf), " PSNR average:%0.2f",
+                        get_psnr(s->mse[i], s->nb_frames, s->average_max));
+        if (s->do_ssim)
+            av_strlcatf(buf, sizeof(buf), " SSIM All:%f (%f)",
+                        s->ssim[i] / s->nb_frames,
+                        ssim_db(s->ssim[i], s->nb_frames));
+        av_log(ctx, AV_LOG_INFO, "input%d%s\n", i + 1, buf);
+    }
+
+    ff_framesync_uninit(&s->fs);
+    av_freep(&s->frames);
+    av_freep(&s->sse);
+    av_freep(&s->row_ssim);
+    av_freep(&s->ssim_temp);
+    av_freep(&s->mse);
+    av_freep(&s->ssim);
+
+    if (s->stats_file && s->stats_file != stdout)
+        fclose(s->stats_file);
+
+    for (i = 0; i < ctx->nb_inputs; i++)
+        av_freep(&ctx->input_pads[i].name);
+}
+
+static const AVFilterPad metrics_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_VIDEO,
+        .config_props  = config_output,
+        .request_frame = request_frame,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_metrics = {
+    .name          = "metrics",
+    .description   = NULL_IF_CONFIG_SMALL("Calculate the PSNR and SSIM of several videos against a reference."),
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .priv_size     = sizeof(MetricsContext),
+    .priv_class    = &metrics_class,
+    .outputs       = metrics_outputs,
+    .flags         = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
+};
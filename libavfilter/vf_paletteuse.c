@@ -29,6 +29,7 @@
 #include "libavutil/qsort.h"
 #include "dualinput.h"
 #include "avfilter.h"
+#include "internal.h"
 
 enum dithering_mode {
     DITHERING_NONE,
@@ -63,6 +64,8 @@ struct color_node {
 #define NBITS 5
 #define CACHE_SIZE (1<<(3*NBITS))
 
+#define LUT_AMBIGUOUS 0xffff
+
 struct cached_color {
     uint32_t color;
     uint8_t pal_entry;
@@ -75,14 +78,20 @@ struct cache_node {
 
 struct PaletteUseContext;
 
-typedef int (*set_frame_func)(struct PaletteUseContext *s, AVFrame *out, AVFrame *in,
+typedef int (*set_frame_func)(struct PaletteUseContext *s, struct cache_node *cache,
+                              AVFrame *out, AVFrame *in,
                               int x_start, int y_start, int width, int height);
 
 typedef struct PaletteUseContext {
     const AVClass *class;
     FFDualInputContext dinput;
-    struct cache_node cache[CACHE_SIZE];    /* lookup cache */
+    struct cache_node *caches;              /* lookup caches, one per slice job */
+    int nb_caches;
+    int *job_rets;
     struct color_node map[AVPALETTE_COUNT]; /* 3D-Tree (KD-Tree with K=3) for reverse colormap */
+    int nb_map_nodes;
+    int lut_bits;
+    uint16_t *lut;                          /* palette entry for each color cell, or LUT_AMBIGUOUS */
     uint32_t palette[AVPALETTE_COUNT];
     int palette_loaded;
     int dither;
@@ -113,6 +122,7 @@ static const AVOption paletteuse_options[] = {
     { "bayer_scale", "set scale for bayer dithering", OFFSET(bayer_scale), AV_OPT_TYPE_INT, {.i64=2}, 0, 5, FLAGS },
     { "diff_mode",   "set frame difference mode",     OFFSET(diff_mode),   AV_OPT_TYPE_INT, {.i64=DIFF_MODE_NONE}, 0, NB_DIFF_MODE-1, FLAGS, "diff_mode" },
         { "rectangle", "process smallest different rectangle", 0, AV_OPT_TYPE_CONST, {.i64=DIFF_MODE_RECTANGLE}, INT_MIN, INT_MAX, FLAGS, "diff_mode" },
+    { "lut_bits",    "set bits per component of the color lookup table (0 to disable)", OFFSET(lut_bits), AV_OPT_TYPE_INT, {.i64=0}, 0, 6, FLAGS },
 
     /* following are the debug options, not part of the official API */
     { "debug_kdtree", "save Graphviz graph of the kdtree in specified file", OFFSET(dot_filename), AV_OPT_TYPE_STRING, {.str=NULL}, CHAR_MIN, CHAR_MAX, FLAGS },
@@ -349,16 +359,36 @@ static av_always_inline int color_get(struct cache_node *cache, uint32_t color,
     return e->pal_entry;
 }
 
-static av_always_inline int get_dst_color_err(struct cache_node *cache,
-                                              uint32_t c, const struct color_node *map,
-                                              const uint32_t *palette,
+/**
+ * Look the color up in the color cells table first, and only search it when
+ * its cell is close to several palette entries.
+ */
+static av_always_inline int color_lookup(const PaletteUseContext *s,
+                                         struct cache_node *cache, uint32_t color,
+                                         uint8_t r, uint8_t g, uint8_t b,
+                                         const enum color_search_method search_method)
+{
+    if (s->lut) {
+        const int bits  = s->lut_bits;
+        const int shift = 8 - bits;
+        const int idx   = s->lut[((r >> shift) << bits | g >> shift) << bits | b >> shift];
+
+        if (idx != LUT_AMBIGUOUS)
+            return idx;
+    }
+    return color_get(cache, color, r, g, b, s->map, s->palette, search_method);
+}
+
+static av_always_inline int get_dst_color_err(const PaletteUseContext *s,
+                                              struct cache_node *cache,
+                                              uint32_t c, const uint32_t *palette,
                                               int *er, int *eg, int *eb,
                                               const enum color_search_method search_method)
 {
     const uint8_t r = c >> 16 & 0xff;
     const uint8_t g = c >>  8 & 0xff;
     const uint8_t b = c       & 0xff;
-    const int dstx = color_get(cache, c, r, g, b, map, palette, search_method);
+    const int dstx = color_lookup(s, cache, c, r, g, b, search_method);
     const uint32_t dstc = palette[dstx];
     *er = r - (dstc >> 16 & 0xff);
     *eg = g - (dstc >>  8 & 0xff);
@@ -366,14 +396,13 @@ static av_always_inline int get_dst_color_err(struct cache_node *cache,
     return dstx;
 }
 
-static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFrame *in,
+static av_always_inline int set_frame(PaletteUseContext *s, struct cache_node *cache,
+                                      AVFrame *out, AVFrame *in,
                                       int x_start, int y_start, int w, int h,
                                       enum dithering_mode dither,
                                       const enum color_search_method search_method)
 {
     int x, y;
-    const struct color_node *map = s->map;
-    struct cache_node *cache = s->cache;
     const uint32_t *palette = s->palette;
     const int src_linesize = in ->linesize[0] >> 2;
     const int dst_linesize = out->linesize[0];
@@ -396,7 +425,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t g = av_clip_uint8(g8 + d);
                 const uint8_t b = av_clip_uint8(b8 + d);
                 const uint32_t c = r<<16 | g<<8 | b;
-                const int color = color_get(cache, c, r, g, b, map, palette, search_method);
+                const int color = color_lookup(s, cache, c, r, g, b, search_method);
 
                 if (color < 0)
                     return color;
@@ -404,7 +433,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_HECKBERT) {
                 const int right = x < w - 1, down = y < h - 1;
-                const int color = get_dst_color_err(cache, src[x], map, palette, &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], palette, &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -416,7 +445,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_FLOYD_STEINBERG) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(cache, src[x], map, palette, &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], palette, &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -430,7 +459,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_SIERRA2) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(cache, src[x], map, palette, &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], palette, &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -449,7 +478,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_SIERRA2_4A) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(cache, src[x], map, palette, &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], palette, &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -463,7 +492,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t r = src[x] >> 16 & 0xff;
                 const uint8_t g = src[x] >>  8 & 0xff;
                 const uint8_t b = src[x]       & 0xff;
-                const int color = color_get(cache, src[x] & 0xffffff, r, g, b, map, palette, search_method);
+                const int color = color_lookup(s, cache, src[x] & 0xffffff, r, g, b, search_method);
 
                 if (color < 0)
                     return color;
@@ -722,6 +751,7 @@ static void load_colormap(PaletteUseContext *s)
     box.max[0] = box.max[1] = box.max[2] = 0xff;
 
     colormap_insert(s->map, color_used, &nb_used, s->palette, &box);
+    s->nb_map_nodes = nb_used;
 
     if (s->dot_filename)
         disp_tree(s->map, s->dot_filename);
@@ -732,6 +762,60 @@ static void load_colormap(PaletteUseContext *s)
     }
 }
 
+/**
+ * Fill the color cells table. A cell is resolved to a palette entry only if
+ * that entry is strictly the nearest for every color of the cell: this is
+ * the case if no other entry can get closer to the cell than the farthest
+ * point of the cell is to that entry. Other cells are searched per color.
+ */
+static int build_lut_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    const int bits    = s->lut_bits;
+    const int size    = 1 << bits;
+    const int cell    = 1 << (8 - bits);
+    const int r_start = (size *  jobnr   ) / nb_jobs;
+    const int r_end   = (size * (jobnr+1)) / nb_jobs;
+    int r, g, b, i, k;
+
+    for (r = r_start; r < r_end; r++) {
+        for (g = 0; g < size; g++) {
+            for (b = 0; b < size; b++) {
+                const int lo[3] = { r * cell, g * cell, b * cell };
+                int min_far = INT_MAX, nb_near = 0, near_id = 0;
+
+                for (i = 0; i < s->nb_map_nodes; i++) {
+                    const uint8_t *val = s->map[i].val;
+                    int far = 0;
+
+                    for (k = 0; k < 3; k++) {
+                        const int d = FFMAX(val[k] - lo[k], lo[k] + cell - 1 - val[k]);
+                        far += d * d;
+                    }
+                    min_far = FFMIN(min_far, far);
+                }
+                for (i = 0; i < s->nb_map_nodes && nb_near < 2; i++) {
+                    const uint8_t *val = s->map[i].val;
+                    int near = 0;
+
+                    for (k = 0; k < 3; k++) {
+                        const int d = val[k] < lo[k]            ? lo[k] - val[k] :
+                                      val[k] > lo[k] + cell - 1 ? val[k] - (lo[k] + cell - 1) : 0;
+                        near += d * d;
+                    }
+                    if (near <= min_far) {
+                        near_id = i;
+                        nb_near++;
+                    }
+                }
+                s->lut[(r << bits | g) << bits | b] =
+                    nb_near == 1 ? s->map[near_id].palette_id : LUT_AMBIGUOUS;
+            }
+        }
+    }
+    return 0;
+}
+
 static void debug_mean_error(PaletteUseContext *s, const AVFrame *in1,
                              const AVFrame *in2, int frame_count)
 {
@@ -851,9 +935,25 @@ static void set_processing_window(enum diff_mode diff_mode,
     *hp = height;
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int x, y, w, h;
+} ThreadData;
+
+static int set_frame_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int slice_start = td->y + (td->h *  jobnr   ) / nb_jobs;
+    const int slice_end   = td->y + (td->h * (jobnr+1)) / nb_jobs;
+
+    return s->set_frame(s, s->caches + jobnr * CACHE_SIZE, td->out, td->in,
+                        td->x, slice_start, td->w, slice_end - slice_start);
+}
+
 static AVFrame *apply_palette(AVFilterLink *inlink, AVFrame *in)
 {
-    int x, y, w, h;
+    int x, y, w, h, i, ret;
     AVFilterContext *ctx = inlink->dst;
     PaletteUseContext *s = ctx->priv;
     AVFilterLink *outlink = inlink->dst->outputs[0];
@@ -881,7 +981,19 @@ static AVFrame *apply_palette(AVFilterLink *inlink, AVFrame *in)
     ff_dlog(ctx, "%dx%d rect: (%d;%d) -> (%d,%d) [area:%dx%d]\n",
             w, h, x, y, x+w, y+h, in->width, in->height);
 
-    if (s->set_frame(s, out, in, x, y, w, h) < 0) {
+    if (s->nb_caches > 1) {
+        /* no error diffusion: the lines can be processed independently */
+        ThreadData td = { .in = in, .out = out, .x = x, .y = y, .w = w, .h = h };
+        const int nb_jobs = FFMIN(h, s->nb_caches);
+
+        ret = ctx->internal->execute(ctx, set_frame_slice, &td, s->job_rets, nb_jobs);
+        for (i = 0; i < nb_jobs && ret >= 0; i++)
+            ret = s->job_rets[i];
+    } else {
+        ret = s->set_frame(s, s->caches, out, in, x, y, w, h);
+    }
+    if (ret < 0) {
+        av_frame_free(&in);
         av_frame_free(&out);
         return NULL;
     }
@@ -904,6 +1016,16 @@ static int config_output(AVFilterLink *outlink)
     outlink->time_base = ctx->inputs[0]->time_base;
     if ((ret = ff_dualinput_init(ctx, &s->dinput)) < 0)
         return ret;
+
+    if (!s->caches) {
+        /* error diffusion is sequential, other modes use one cache per job */
+        s->nb_caches = s->dither == DITHERING_NONE || s->dither == DITHERING_BAYER ?
+                       FFMAX(1, ctx->graph->nb_threads) : 1;
+        s->caches   = av_calloc(s->nb_caches * CACHE_SIZE, sizeof(*s->caches));
+        s->job_rets = av_calloc(s->nb_caches, sizeof(*s->job_rets));
+        if (!s->caches || !s->job_rets)
+            return AVERROR(ENOMEM);
+    }
     return 0;
 }
 
@@ -922,8 +1044,9 @@ static int config_input_palette(AVFilterLink *inlink)
     return 0;
 }
 
-static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
+static void load_palette(AVFilterContext *ctx, const AVFrame *palette_frame)
 {
+    PaletteUseContext *s = ctx->priv;
     int i, x, y;
     const uint32_t *p = (const uint32_t *)palette_frame->data[0];
     const int p_linesize = palette_frame->linesize[0] >> 2;
@@ -937,6 +1060,10 @@ static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
 
     load_colormap(s);
 
+    if (s->lut && s->nb_map_nodes)
+        ctx->internal->execute(ctx, build_lut_slice, NULL, NULL,
+                               FFMIN(1 << s->lut_bits, FFMAX(1, ctx->graph->nb_threads)));
+
     s->palette_loaded = 1;
 }
 
@@ -946,7 +1073,7 @@ static AVFrame *load_apply_palette(AVFilterContext *ctx, AVFrame *main,
     AVFilterLink *inlink = ctx->inputs[0];
     PaletteUseContext *s = ctx->priv;
     if (!s->palette_loaded) {
-        load_palette(s, second);
+        load_palette(ctx, second);
     }
     return apply_palette(inlink, main);
 }
@@ -958,10 +1085,12 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
 }
 
 #define DEFINE_SET_FRAME(color_search, name, value)                             \
-static int set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,    \
+static int set_frame_##name(PaletteUseContext *s, struct cache_node *cache,     \
+                            AVFrame *out, AVFrame *in,                          \
                             int x_start, int y_start, int w, int h)             \
 {                                                                               \
-    return set_frame(s, out, in, x_start, y_start, w, h, value, color_search);  \
+    return set_frame(s, cache, out, in, x_start, y_start, w, h,                 \
+                     value, color_search);                                      \
 }
 
 #define DEFINE_SET_FRAME_COLOR_SEARCH(color_search, color_search_macro)                                 \
@@ -1015,6 +1144,12 @@ static av_cold int init(AVFilterContext *ctx)
             s->ordered_dither[i] = (dither_value(i) >> s->bayer_scale) - delta;
     }
 
+    if (s->lut_bits) {
+        s->lut = av_malloc_array(1 << (3 * s->lut_bits), sizeof(*s->lut));
+        if (!s->lut)
+            return AVERROR(ENOMEM);
+    }
+
     return 0;
 }
 
@@ -1030,8 +1165,11 @@ static av_cold void uninit(AVFilterContext *ctx)
     PaletteUseContext *s = ctx->priv;
 
     ff_dualinput_uninit(&s->dinput);
-    for (i = 0; i < CACHE_SIZE; i++)
-        av_freep(&s->cache[i].entries);
+    for (i = 0; i < s->nb_caches * CACHE_SIZE; i++)
+        av_freep(&s->caches[i].entries);
+    av_freep(&s->caches);
+    av_freep(&s->job_rets);
+    av_freep(&s->lut);
     av_frame_free(&s->last_in);
     av_frame_free(&s->last_out);
 }
@@ -1071,4 +1209,5 @@ AVFilter ff_vf_paletteuse = {
     .inputs        = paletteuse_inputs,
     .outputs       = paletteuse_outputs,
     .priv_class    = &paletteuse_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -0,0 +1,161 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Detect scene changes and export their score.
+ */
+
+#include "libavutil/opt.h"
+#include "libavutil/scene_score.h"
+#include "libavutil/timestamp.h"
+#include "avfilter.h"
+#include "formats.h"
+#include "internal.h"
+#include "scenedetect.h"
+#include "video.h"
+
+typedef struct SCDetContext {
+    const AVClass *class;
+    FFSceneDetectContext sd;
+    double threshold;
+    int downscale;
+    int sc_pass;
+} SCDetContext;
+
+#define OFFSET(x) offsetof(SCDetContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption scdet_options[] = {
+    { "threshold", "set the scene change threshold", OFFSET(threshold), AV_OPT_TYPE_DOUBLE, {.dbl=0.4}, 0, 1, FLAGS },
+    { "t",         "set the scene change threshold", OFFSET(threshold), AV_OPT_TYPE_DOUBLE, {.dbl=0.4}, 0, 1, FLAGS },
+    { "downscale", "set the log2 of the downscaling factor", OFFSET(downscale), AV_OPT_TYPE_INT, {.i64=1}, 0, 4, FLAGS },
+    { "sc_pass",   "only pass the frames starting a new scene", OFFSET(sc_pass), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS },
+    { "s",         "only pass the frames starting a new scene", OFFSET(sc_pass), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(scdet);
+
+static int query_formats(AVFilterContext *ctx)
+{
+    static const enum AVPixelFormat pix_fmts[] = {
+        AV_PIX_FMT_GRAY8,
+        AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUV444P,
+        AV_PIX_FMT_YUV440P, AV_PIX_FMT_YUV411P, AV_PIX_FMT_YUV410P,
+        AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVJ422P, AV_PIX_FMT_YUVJ444P,
+        AV_PIX_FMT_YUVJ440P, AV_PIX_FMT_YUVJ411P,
+        AV_PIX_FMT_YUVA420P, AV_PIX_FMT_YUVA422P, AV_PIX_FMT_YUVA444P,
+        AV_PIX_FMT_NV12, AV_PIX_FMT_NV21,
+        AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24,
+        AV_PIX_FMT_NONE
+    };
+
+    AVFilterFormats *fmts_list = ff_make_format_list(pix_fmts);
+    if (!fmts_list)
+        return AVERROR(ENOMEM);
+    return ff_set_common_formats(ctx, fmts_list);
+}
+
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    SCDetContext *s = ctx->priv;
+
+    return ff_scene_detect_init(&s->sd, ctx, inlink->format,
+                                inlink->w, inlink->h, s->downscale);
+}
+
+static void set_meta(AVFrame *frame, const char *key, double d)
+{
+    char buf[64];
+
+    snprintf(buf, sizeof(buf), "%f", d);
+    av_dict_set(avpriv_frame_get_metadatap(frame), key, buf, 0);
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
+{
+    AVFilterContext *ctx = inlink->dst;
+    SCDetContext *s = ctx->priv;
+    AVSceneScore *score;
+    int ret;
+
+    score = av_scene_score_create_side_data(frame);
+    if (!score) {
+        av_frame_free(&frame);
+        return AVERROR(ENOMEM);
+    }
+    if ((ret = ff_scene_detect_frame(&s->sd, frame, score)) < 0) {
+        av_frame_free(&frame);
+        return ret;
+    }
+
+    set_meta(frame, "lavfi.scd.score", score->score);
+    set_meta(frame, "lavfi.scd.mafd",  score->mafd);
+    set_meta(frame, "lavfi.scd.hist",  score->hist_diff);
+
+    if (score->score >= s->threshold) {
+        av_dict_set(avpriv_frame_get_metadatap(frame), "lavfi.scd.time",
+                    av_ts2timestr(frame->pts, &inlink->time_base), 0);
+        av_log(ctx, AV_LOG_VERBOSE, "scene change at pts_time:%s score:%f\n",
+               av_ts2timestr(frame->pts, &inlink->time_base), score->score);
+    } else if (s->sc_pass) {
+        av_frame_free(&frame);
+        return 0;
+    }
+
+    return ff_filter_frame(ctx->outputs[0], frame);
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    SCDetContext *s = ctx->priv;
+
+    ff_scene_detect_uninit(&s->sd);
+}
+
+static const AVFilterPad scdet_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input,
+        .filter_frame = filter_frame,
+    },
+    { NULL }
+};
+
+static const AVFilterPad scdet_outputs[] = {
+    {
+        .name = "default",
+        .type = AVMEDIA_TYPE_VIDEO,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_scdet = {
+    .name          = "scdet",
+    .description   = NULL_IF_CONFIG_SMALL("Detect video scene changes."),
+    .priv_size     = sizeof(SCDetContext),
+    .priv_class    = &scdet_class,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .inputs        = scdet_inputs,
+    .outputs       = scdet_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
+};
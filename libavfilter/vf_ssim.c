@@ -59,6 +59,9 @@ typedef struct SSIMContext {
     int planewidth[4];
     int planeheight[4];
     int *temp;
+    int temp_size;
+    float *row_ssim[4];
+    int nb_threads;
     int is_rgb;
     SSIMDSPContext dsp;
 } SSIMContext;
@@ -147,20 +150,27 @@ static float ssim_endn(const int (*sum0)[4], const int (*sum1)[4], int width)
     return ssim;
 }
 
-static float ssim_plane(SSIMDSPContext *dsp,
+void ff_ssim_init(SSIMDSPContext *dsp)
+{
+    dsp->ssim_4x4_line = ssim_4x4xn;
+    dsp->ssim_end_line = ssim_endn;
+    if (ARCH_X86)
+        ff_ssim_init_x86(dsp);
+}
+
+void ff_ssim_plane_rows(SSIMDSPContext *dsp,
                         uint8_t *main, int main_stride,
                         uint8_t *ref, int ref_stride,
-                        int width, int height, void *temp)
+                        int width, int y0, int y1,
+                        float *row_ssim, void *temp)
 {
-    int z = 0, y;
-    float ssim = 0.0;
+    int z = y0 - 1, y;
     int (*sum0)[4] = temp;
     int (*sum1)[4] = sum0 + (width >> 2) + 3;
 
     width >>= 2;
-    height >>= 2;
 
-    for (y = 1; y < height; y++) {
+    for (y = y0; y < y1; y++) {
         for (; z <= y; z++) {
             FFSWAP(void*, sum0, sum1);
             dsp->ssim_4x4_line(&main[4 * z * main_stride], main_stride,
@@ -168,12 +178,54 @@ static float ssim_plane(SSIMDSPContext *dsp,
                                sum0, width);
         }
 
-        ssim += dsp->ssim_end_line((const int (*)[4])sum0, (const int (*)[4])sum1, width - 1);
+        row_ssim[y - 1] = dsp->ssim_end_line((const int (*)[4])sum0, (const int (*)[4])sum1, width - 1);
     }
+}
+
+float ff_ssim_plane_sum(const float *row_ssim, int width, int height)
+{
+    float ssim = 0.0;
+    int y;
+
+    width  >>= 2;
+    height >>= 2;
+
+    /* summed in row order, so that the result does not depend on the
+     * number of slices the rows were computed in */
+    for (y = 1; y < height; y++)
+        ssim += row_ssim[y - 1];
 
     return ssim / ((height - 1) * (width - 1));
 }
 
+typedef struct ThreadData {
+    uint8_t *main_data[4];
+    uint8_t *ref_data[4];
+    int main_linesize[4];
+    int ref_linesize[4];
+} ThreadData;
+
+static int ssim_plane_slice(AVFilterContext *ctx, void *arg,
+                            int jobnr, int nb_jobs)
+{
+    SSIMContext *s = ctx->priv;
+    ThreadData *td = arg;
+    int c;
+
+    for (c = 0; c < s->nb_components; c++) {
+        const int rows = (s->planeheight[c] >> 2) - 1;
+        const int slice_start = 1 + (rows *  jobnr   ) / nb_jobs;
+        const int slice_end   = 1 + (rows * (jobnr+1)) / nb_jobs;
+
+        ff_ssim_plane_rows(&s->dsp, td->main_data[c], td->main_linesize[c],
+                           td->ref_data[c], td->ref_linesize[c],
+                           s->planewidth[c], slice_start, slice_end,
+                           s->row_ssim[c], s->temp + jobnr * s->temp_size);
+    }
+
+    return 0;
+}
+
 static double ssim_db(double ssim, double weight)
 {
     return 10 * log10(weight / (weight - ssim));
@@ -185,14 +237,22 @@ static AVFrame *do_ssim(AVFilterContext *ctx, AVFrame *main,
     AVDictionary **metadata = avpriv_frame_get_metadatap(main);
     SSIMContext *s = ctx->priv;
     float c[4], ssimv = 0.0;
+    ThreadData td;
     int i;
 
     s->nb_frames++;
 
     for (i = 0; i < s->nb_components; i++) {
-        c[i] = ssim_plane(&s->dsp, main->data[i], main->linesize[i],
-                          ref->data[i], ref->linesize[i],
-                          s->planewidth[i], s->planeheight[i], s->temp);
+        td.main_data[i]     = main->data[i];
+        td.ref_data[i]      = ref->data[i];
+        td.main_linesize[i] = main->linesize[i];
+        td.ref_linesize[i]  = ref->linesize[i];
+    }
+    ctx->internal->execute(ctx, ssim_plane_slice, &td, NULL,
+                           av_clip(s->planeheight[1] >> 2, 1, s->nb_threads));
+
+    for (i = 0; i < s->nb_components; i++) {
+        c[i] = ff_ssim_plane_sum(s->row_ssim[i], s->planewidth[i], s->planeheight[i]);
         ssimv += s->coefs[i] * c[i];
         s->ssim[i] += c[i];
     }
@@ -297,14 +357,18 @@ static int config_input_ref(AVFilterLink *inlink)
     for (i = 0; i < s->nb_components; i++)
         s->coefs[i] = (double) s->planeheight[i] * s->planewidth[i] / sum;
 
-    s->temp = av_malloc((2 * inlink->w + 12) * sizeof(*s->temp));
+    s->nb_threads = FFMAX(1, ctx->graph->nb_threads);
+    s->temp_size  = 2 * inlink->w + 12;
+    s->temp = av_malloc_array(s->nb_threads, s->temp_size * sizeof(*s->temp));
     if (!s->temp)
         return AVERROR(ENOMEM);
+    for (i = 0; i < s->nb_components; i++) {
+        s->row_ssim[i] = av_malloc_array((s->planeheight[i] >> 2) + 1, sizeof(*s->row_ssim[i]));
+        if (!s->row_ssim[i])
+            return AVERROR(ENOMEM);
+    }
 
-    s->dsp.ssim_4x4_line = ssim_4x4xn;
-    s->dsp.ssim_end_line = ssim_endn;
-    if (ARCH_X86)
-        ff_ssim_init_x86(&s->dsp);
+    ff_ssim_init(&s->dsp);
 
     return 0;
 }
@@ -343,10 +407,10 @@ static int request_frame(AVFilterLink *outlink)
 static av_cold void uninit(AVFilterContext *ctx)
 {
     SSIMContext *s = ctx->priv;
+    int i;
 
     if (s->nb_frames > 0) {
         char buf[256];
-        int i;
         buf[0] = 0;
         for (i = 0; i < s->nb_components; i++) {
             int c = s->is_rgb ? s->rgba_map[i] : i;
@@ -363,6 +427,8 @@ static av_cold void uninit(AVFilterContext *ctx)
         fclose(s->stats_file);
 
     av_freep(&s->temp);
+    for (i = 0; i < 4; i++)
+        av_freep(&s->row_ssim[i]);
 }
 
 static const AVFilterPad ssim_inputs[] = {
@@ -399,4 +465,5 @@ AVFilter ff_vf_ssim = {
     .priv_class    = &ssim_class,
     .inputs        = ssim_inputs,
     .outputs       = ssim_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -30,6 +30,7 @@
 
 #include "avfilter.h"
 #include "internal.h"
+#include "profile.h"
 #include "video.h"
 
 #define BUFFER_ALIGN 32
@@ -42,6 +43,7 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h)
 
 AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
 {
+    AVFrame *frame;
     int pool_width = 0;
     int pool_height = 0;
     int pool_align = 0;
@@ -70,7 +72,10 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
         }
     }
 
-    return ff_video_frame_pool_get(link->video_frame_pool);
+    frame = ff_video_frame_pool_get(link->video_frame_pool);
+    ff_profile_frame_alloc(link->dst->graph, frame);
+
+    return frame;
 }
 
 AVFrame *ff_get_video_buffer(AVFilterLink *link, int w, int h)
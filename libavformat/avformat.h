@@ -1884,6 +1884,26 @@ typedef struct AVFormatContext {
      * - decoding: set by user through AVOptions (NO direct access)
      */
     char *protocol_blacklist;
+
+    /**
+     * Maximum number of packets queued for the background muxing thread.
+     * If non-zero, packets passed to av_interleaved_write_frame() are
+     * interleaved and written by a dedicated thread, so that a slow muxer
+     * or output does not block the caller. 0 disables asynchronous muxing.
+     * - muxing: set by user through AVOptions (NO direct access)
+     * - demuxing: unused
+     */
+    int async_mux_queue_size;
+
+    /**
+     * What to do when the asynchronous muxing queue is full, one of
+     * AVFMT_ASYNC_MUX_*.
+     * - muxing: set by user through AVOptions (NO direct access)
+     * - demuxing: unused
+     */
+    int async_mux_policy;
+#define AVFMT_ASYNC_MUX_BLOCK 0 ///< wait until the queue has room
+#define AVFMT_ASYNC_MUX_DROP  1 ///< drop packets until the next keyframe of the stream
 } AVFormatContext;
 
 int av_format_get_probe_score(const AVFormatContext *s);
@@ -2550,6 +2570,21 @@ enum AVCodecID av_guess_codec(AVOutputFormat *fmt, const char *short_name,
 int av_get_output_timestamp(struct AVFormatContext *s, int stream,
                             int64_t *dts, int64_t *wall);
 
+/**
+ * Get statistics of the asynchronous muxing queue.
+ *
+ * @param s         media file handle
+ * @param depth     if not NULL, set to the number of packets currently queued
+ * @param max_depth if not NULL, set to the highest number of packets queued
+ * @param dropped   if not NULL, set to the number of packets dropped because
+ *                  the queue was full
+ * @return 0 on success, AVERROR(ENOSYS) if asynchronous muxing is not
+ *         active for s
+ * @see AVFormatContext.async_mux_queue_size
+ */
+int av_get_async_mux_stats(AVFormatContext *s, int *depth, int *max_depth,
+                           int64_t *dropped);
+
 
 /**
  * @}
@@ -28,6 +28,7 @@
 
 #include <stdint.h>
 
+#include "libavutil/buffer.h"
 #include "libavutil/common.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
@@ -259,6 +260,16 @@ typedef struct AVIOContext {
      * ',' separated list of disallowed protocols.
      */
     const char *protocol_blacklist;
+
+    /**
+     * Pool of refcounted buffer chunks and the chunk currently backing
+     * buffer, when reading into refcounted buffers (AVIO_FLAG_REFBUF).
+     * buffer_ref is NULL while buffer is a plain allocation.
+     * These fields are internal to libavformat and access from outside is not allowed.
+     */
+    AVBufferPool *buffer_pool;
+    AVBufferRef *buffer_ref;
+    int buffer_pool_size;
 } AVIOContext;
 
 /* unbuffered I/O */
@@ -556,7 +567,9 @@ int avio_get_str16be(AVIOContext *pb, int maxlen, char *buf, int buflen);
  * context. Connecting a protocol will always block if necessary (e.g. on
  * network protocols) but never hang (e.g. on busy devices).
  * Warning: non-blocking protocols is work-in-progress; this flag may be
- * silently ignored.
+ * silently ignored. The buffered write functions of AVIOContext do not
+ * retry a write which returned AVERROR(EAGAIN), it is kept as the error
+ * of the context, so non-blocking writes cannot be used through them.
  */
 #define AVIO_FLAG_NONBLOCK 8
 
@@ -568,6 +581,17 @@ int avio_get_str16be(AVIOContext *pb, int maxlen, char *buf, int buflen);
  */
 #define AVIO_FLAG_DIRECT 0x8000
 
+/**
+ * Read into a pool of refcounted buffer chunks.
+ * Demuxers supporting it return packets that lie entirely inside one chunk
+ * as references to the chunk instead of copying them out of the I/O buffer.
+ * The padding of such packets is not necessarily zeroed, it may contain the
+ * data following the packet in the stream. It is not modified while the
+ * packet is referenced.
+ * Only has an effect on contexts opened for reading.
+ */
+#define AVIO_FLAG_REFBUF 0x10000
+
 /**
  * Create and initialize a AVIOContext for accessing the
  * resource indicated by url.
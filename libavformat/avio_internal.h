@@ -53,6 +53,19 @@ int ffio_init_context(AVIOContext *s,
  */
 int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data);
 
+/**
+ * Read size bytes from AVIOContext as a reference to the I/O buffer.
+ * This only succeeds if the context reads into refcounted buffers
+ * (AVIO_FLAG_REFBUF) and the data lies entirely inside one buffer chunk.
+ * The referenced data must not be modified.
+ * @param buf set to a new reference to the chunk containing the data
+ * @param data set to the start of the data
+ * @return size on success, 0 if the data could not be referenced, in which
+ *         case nothing was consumed and it has to be read with avio_read(),
+ *         or a negative AVERROR code
+ */
+int ffio_read_refcounted(AVIOContext *s, AVBufferRef **buf, uint8_t **data, int size);
+
 /**
  * Read size bytes from AVIOContext into buf.
  * This reads at most 1 packet. If that is not enough fewer bytes will be
@@ -138,6 +151,15 @@ int ffio_open_dyn_packet_buf(AVIOContext **s, int max_packet_size);
  */
 int ffio_fdopen(AVIOContext **s, URLContext *h);
 
+/**
+ * Return the URLContext associated with the AVIOContext
+ *
+ * @param s IO context
+ * @return pointer to URLContext or NULL, if s was not created by
+ *         ffio_fdopen()
+ */
+URLContext *ffio_geturlcontext(AVIOContext *s);
+
 /**
  * Open a write-only fake memory stream. The written data is not stored
  * anywhere - this is only used for measuring the amount of data
@@ -35,6 +35,12 @@
 
 #define IO_BUFFER_SIZE 32768
 
+/**
+ * Size of the buffer chunks used with AVIO_FLAG_REFBUF. Packets up to this
+ * size can be returned as references to the chunk they were read into.
+ */
+#define IO_REFBUF_SIZE (1 << 20)
+
 /**
  * Do seeks within this distance ahead of the current buffer by skipping
  * data instead of calling the protocol seek function, for seekable
@@ -452,6 +458,14 @@ void avio_wb24(AVIOContext *s, unsigned int val)
 
 /* Input stream */
 
+static void free_buffer(AVIOContext *s)
+{
+    if (s->buffer_ref)
+        av_buffer_unref(&s->buffer_ref);
+    else
+        av_free(s->buffer);
+}
+
 static void fill_buffer(AVIOContext *s)
 {
     int max_buffer_size = s->max_packet_size ?
@@ -488,6 +502,21 @@ static void fill_buffer(AVIOContext *s)
         len = s->orig_buffer_size;
     }
 
+    /* do not overwrite a chunk that packets still reference */
+    if (dst == s->buffer && s->buffer_pool && s->buffer_size == s->buffer_pool_size &&
+        (!s->buffer_ref || !av_buffer_is_writable(s->buffer_ref))) {
+        AVBufferRef *ref = av_buffer_pool_get(s->buffer_pool);
+        if (!ref) {
+            s->eof_reached = 1;
+            s->error       = AVERROR(ENOMEM);
+            return;
+        }
+        free_buffer(s);
+        s->buffer_ref   = ref;
+        s->buffer       = ref->data;
+        s->checksum_ptr = s->buf_ptr = s->buf_end = dst = s->buffer;
+    }
+
     if (s->read_packet)
         len = s->read_packet(s->opaque, dst, len);
     else
@@ -616,6 +645,42 @@ int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsig
     }
 }
 
+int ffio_read_refcounted(AVIOContext *s, AVBufferRef **buf, uint8_t **data, int size)
+{
+    AVBufferRef *ref;
+
+    if (!s->buffer_pool || s->write_flag || s->direct ||
+        size <= 0 || size > s->buffer_pool_size)
+        return 0;
+
+    if (s->buf_ptr >= s->buf_end) {
+        /* start over at the beginning of a chunk if the data would not fit
+         * in the space left after what was already read */
+        if (s->buffer + s->buffer_size - s->buf_end < size) {
+            if (s->update_checksum && s->buf_end > s->checksum_ptr)
+                s->checksum = s->update_checksum(s->checksum, s->checksum_ptr,
+                                                 s->buf_end - s->checksum_ptr);
+            s->checksum_ptr = s->buf_end = s->buf_ptr = s->buffer;
+        }
+        fill_buffer(s);
+    }
+    /* later reads may append to the chunk after buf_end, the padding of the
+     * packet must lie before it unless the chunk is full */
+    if (!s->buffer_ref || s->buf_end - s->buf_ptr < size ||
+        (s->buf_end - s->buf_ptr < size + AV_INPUT_BUFFER_PADDING_SIZE &&
+         s->buf_end != s->buffer + s->buffer_size))
+        return 0;
+
+    ref = av_buffer_ref(s->buffer_ref);
+    if (!ref)
+        return AVERROR(ENOMEM);
+
+    *buf  = ref;
+    *data = s->buf_ptr;
+    s->buf_ptr += size;
+    return size;
+}
+
 int ffio_read_partial(AVIOContext *s, unsigned char *buf, int size)
 {
     int len;
@@ -823,12 +888,16 @@ static int64_t io_read_seek(void *opaque, int stream_index, int64_t timestamp, i
 int ffio_fdopen(AVIOContext **s, URLContext *h)
 {
     AVIOInternal *internal = NULL;
+    AVBufferPool *pool = NULL;
     uint8_t *buffer = NULL;
     int buffer_size, max_packet_size;
+    int refbuf = (h->flags & AVIO_FLAG_REFBUF) && !(h->flags & AVIO_FLAG_WRITE);
 
     max_packet_size = h->max_packet_size;
     if (max_packet_size) {
         buffer_size = max_packet_size; /* no need to bufferize more than one packet */
+    } else if (refbuf) {
+        buffer_size = IO_REFBUF_SIZE;
     } else {
         buffer_size = IO_BUFFER_SIZE;
     }
@@ -836,6 +905,13 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
     if (!buffer)
         return AVERROR(ENOMEM);
 
+    if (refbuf) {
+        pool = av_buffer_pool_init(buffer_size + AV_INPUT_BUFFER_PADDING_SIZE,
+                                   av_buffer_allocz);
+        if (!pool)
+            goto fail;
+    }
+
     internal = av_mallocz(sizeof(*internal));
     if (!internal)
         goto fail;
@@ -866,13 +942,29 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
         (*s)->read_seek  = io_read_seek;
     }
     (*s)->av_class = &ff_avio_class;
+    (*s)->buffer_pool      = pool;
+    (*s)->buffer_pool_size = buffer_size;
     return 0;
 fail:
+    av_buffer_pool_uninit(&pool);
     av_freep(&internal);
     av_freep(&buffer);
     return AVERROR(ENOMEM);
 }
 
+URLContext *ffio_geturlcontext(AVIOContext *s)
+{
+    AVIOInternal *internal;
+    if (!s)
+        return NULL;
+
+    internal = s->opaque;
+    if (internal && s->read_packet == io_read_packet)
+        return internal->h;
+    else
+        return NULL;
+}
+
 int ffio_ensure_seekback(AVIOContext *s, int64_t buf_size)
 {
     uint8_t *buffer;
@@ -892,7 +984,7 @@ int ffio_ensure_seekback(AVIOContext *s, int64_t buf_size)
         return AVERROR(ENOMEM);
 
     memcpy(buffer, s->buffer, filled);
-    av_free(s->buffer);
+    free_buffer(s);
     s->buf_ptr = buffer + (s->buf_ptr - s->buffer);
     s->buf_end = buffer + (s->buf_end - s->buffer);
     s->buffer = buffer;
@@ -909,7 +1001,7 @@ int ffio_set_buf_size(AVIOContext *s, int buf_size)
     if (!buffer)
         return AVERROR(ENOMEM);
 
-    av_free(s->buffer);
+    free_buffer(s);
     s->buffer = buffer;
     s->orig_buffer_size =
     s->buffer_size = buf_size;
@@ -965,7 +1057,7 @@ int ffio_rewind_with_probe_data(AVIOContext *s, unsigned char **bufp, int buf_si
         buf_size = new_size;
     }
 
-    av_free(s->buffer);
+    free_buffer(s);
     s->buf_ptr = s->buffer = buf;
     s->buffer_size = alloc_size;
     s->pos = buf_size;
@@ -1025,7 +1117,9 @@ int avio_close(AVIOContext *s)
     h        = internal->h;
 
     av_freep(&s->opaque);
-    av_freep(&s->buffer);
+    free_buffer(s);
+    s->buffer = NULL;
+    av_buffer_pool_uninit(&s->buffer_pool);
     if (s->write_flag)
         av_log(s, AV_LOG_DEBUG, "Statistics: %d seeks, %d writeouts\n", s->seek_count, s->writeout_count);
     else
@@ -68,6 +68,7 @@ typedef struct OutputStream {
     char initfile[1024];
     int64_t init_start_pos;
     int init_range_length;
+    int64_t segment_start_pos;
     int nb_segments, segments_size, segment_index;
     Segment **segments;
     int64_t first_pts, start_pts, max_pts;
@@ -76,6 +77,7 @@ typedef struct OutputStream {
     char bandwidth_str[64];
 
     char codec_str[100];
+    char temp_path[1024];   ///< segment waiting to be renamed after a barrier
 } OutputStream;
 
 typedef struct DASHContext {
@@ -96,6 +98,9 @@ typedef struct DASHContext {
     const char *single_file_name;
     const char *init_seg_name;
     const char *media_seg_name;
+    int streaming;
+    int async_write;
+    FFFileCloseGroup *close_group; ///< segments being closed by their writer
     AVRational min_frame_rate, max_frame_rate;
     int ambiguous_frame_rate;
 } DASHContext;
@@ -193,6 +198,9 @@ static void dash_free(AVFormatContext *s)
             av_free(os->segments[j]);
         av_free(os->segments);
     }
+#if CONFIG_FILE_PROTOCOL
+    ff_file_close_group_free(&c->close_group);
+#endif
     av_freep(&c->streams);
 }
 
@@ -438,6 +446,56 @@ static void format_date_now(char *buf, int size)
     }
 }
 
+/**
+ * Open a segment file, for asynchronous writing if requested. Not used for
+ * single_file, which is read back by find_index_range().
+ */
+static int dash_io_open_segment(AVFormatContext *s, AVIOContext **pb, const char *url)
+{
+    DASHContext *c = s->priv_data;
+    AVDictionary *opts = NULL;
+    int ret;
+
+    if (c->close_group)
+        av_dict_set(&opts, "async_write", "1", 0);
+    ret = s->io_open(s, pb, url, AVIO_FLAG_WRITE, &opts);
+    av_dict_free(&opts);
+#if CONFIG_FILE_PROTOCOL
+    if (ret >= 0 && c->close_group)
+        ff_file_set_close_group(*pb, c->close_group);
+#endif
+    return ret;
+}
+
+/**
+ * Wait until the segments closed so far are complete on storage, then
+ * give the segments written to temporary files their final names.
+ */
+static int dash_async_barrier(AVFormatContext *s)
+{
+    DASHContext *c = s->priv_data;
+    int i, ret = 0;
+
+#if CONFIG_FILE_PROTOCOL
+    if (c->close_group)
+        ret = ff_file_close_group_wait(c->close_group);
+#endif
+    for (i = 0; i < s->nb_streams; i++) {
+        OutputStream *os = &c->streams[i];
+        char full_path[1024];
+        int err;
+
+        if (!os->temp_path[0])
+            continue;
+        av_strlcpy(full_path, os->temp_path, sizeof(full_path));
+        full_path[strlen(full_path) - 4] = '\0'; /* strip ".tmp" */
+        if (ret >= 0 && (err = avpriv_io_move(os->temp_path, full_path)) < 0)
+            ret = err;
+        os->temp_path[0] = '\0';
+    }
+    return ret;
+}
+
 static int write_manifest(AVFormatContext *s, int final)
 {
     DASHContext *c = s->priv_data;
@@ -446,6 +504,11 @@ static int write_manifest(AVFormatContext *s, int final)
     int ret, i;
     AVDictionaryEntry *title = av_dict_get(s->metadata, "title", NULL, 0);
 
+    if (c->async_write && (ret = dash_async_barrier(s)) < 0) {
+        av_log(s, AV_LOG_ERROR, "Unable to write out the segments\n");
+        return ret;
+    }
+
     snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", s->filename);
     ret = s->io_open(s, &out, temp_filename, AVIO_FLAG_WRITE, NULL);
     if (ret < 0) {
@@ -591,6 +654,13 @@ static int dash_write_header(AVFormatContext *s)
         goto fail;
     }
 
+#if CONFIG_FILE_PROTOCOL
+    if (c->async_write && !(c->close_group = ff_file_close_group_alloc())) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+#endif
+
     for (i = 0; i < s->nb_streams; i++) {
         OutputStream *os = &c->streams[i];
         AVFormatContext *ctx;
@@ -649,12 +719,16 @@ static int dash_write_header(AVFormatContext *s)
             dash_fill_tmpl_params(os->initfile, sizeof(os->initfile), c->init_seg_name, i, 0, os->bit_rate, 0);
         }
         snprintf(filename, sizeof(filename), "%s%s", c->dirname, os->initfile);
-        ret = s->io_open(s, &os->out, filename, AVIO_FLAG_WRITE, NULL);
+        if (c->single_file)
+            ret = s->io_open(s, &os->out, filename, AVIO_FLAG_WRITE, NULL);
+        else
+            ret = dash_io_open_segment(s, &os->out, filename);
         if (ret < 0)
             goto fail;
         os->init_start_pos = 0;
 
-        av_dict_set(&opts, "movflags", "frag_custom+dash+delay_moov", 0);
+        av_dict_set(&opts, "movflags", c->streaming ? "frag_custom+dash+delay_moov+frag_every_frame" :
+                                                      "frag_custom+dash+delay_moov", 0);
         if ((ret = avformat_write_header(ctx, &opts)) < 0) {
              goto fail;
         }
@@ -795,6 +869,63 @@ static int update_stream_extradata(AVFormatContext *s, OutputStream *os,
     return 0;
 }
 
+/**
+ * In streaming mode, the mp4 muxer writes out every frame as soon as it gets
+ * it, so the media segment has to be open before the packets of a segment are
+ * passed on. The first segment is opened only once the init segment is
+ * complete, see dash_write_streaming_init().
+ */
+static int dash_start_streaming_segment(AVFormatContext *s, OutputStream *os, int stream)
+{
+    DASHContext *c = s->priv_data;
+    char filename[1024], full_path[1024];
+    int ret;
+
+    if (!os->init_range_length)
+        return 0;
+
+    os->segment_start_pos = avio_tell(os->ctx->pb);
+    if (!c->single_file) {
+        // Segments are written directly under their final name, so that
+        // clients can fetch them while they are being written.
+        dash_fill_tmpl_params(filename, sizeof(filename), c->media_seg_name, stream, os->segment_index, os->bit_rate, os->start_pts);
+        snprintf(full_path, sizeof(full_path), "%s%s", c->dirname, filename);
+        if ((ret = dash_io_open_segment(s, &os->out, full_path)) < 0)
+            return ret;
+        write_styp(os->ctx->pb);
+        avio_flush(os->ctx->pb);
+    }
+
+    // Announce the segment while it is being written.
+    return write_manifest(s, 0);
+}
+
+/**
+ * With delay_moov, the mp4 muxer writes the moov only once it has the first
+ * packet, so that the edit list accounts for its timestamps (e.g. the encoder
+ * delay of AAC), and keeps that packet until the next flush. Close the init
+ * segment as soon as the moov is out, then write the held back packet into
+ * the first media segment.
+ */
+static int dash_write_streaming_init(AVFormatContext *s, OutputStream *os, int stream)
+{
+    DASHContext *c = s->priv_data;
+    int ret;
+
+    if (os->init_range_length || !avio_tell(os->ctx->pb))
+        return 0;
+
+    os->init_range_length = avio_tell(os->ctx->pb);
+    if (!c->single_file)
+        ff_format_io_close(s, &os->out);
+
+    if ((ret = dash_start_streaming_segment(s, os, stream)) < 0)
+        return ret;
+    av_write_frame(os->ctx, NULL);
+    avio_flush(os->ctx->pb);
+    return 0;
+}
+
 static int dash_flush(AVFormatContext *s, int final, int stream)
 {
     DASHContext *c = s->priv_data;
@@ -831,16 +962,18 @@ static int dash_flush(AVFormatContext *s, int final, int stream)
                 ff_format_io_close(s, &os->out);
         }
 
-        start_pos = avio_tell(os->ctx->pb);
+        start_pos = c->streaming ? os->segment_start_pos : avio_tell(os->ctx->pb);
 
         if (!c->single_file) {
             dash_fill_tmpl_params(filename, sizeof(filename), c->media_seg_name, i, os->segment_index, os->bit_rate, os->start_pts);
             snprintf(full_path, sizeof(full_path), "%s%s", c->dirname, filename);
-            snprintf(temp_path, sizeof(temp_path), "%s.tmp", full_path);
-            ret = s->io_open(s, &os->out, temp_path, AVIO_FLAG_WRITE, NULL);
-            if (ret < 0)
-                break;
-            write_styp(os->ctx->pb);
+            if (!c->streaming) {
+                snprintf(temp_path, sizeof(temp_path), "%s.tmp", full_path);
+                ret = dash_io_open_segment(s, &os->out, temp_path);
+                if (ret < 0)
+                    break;
+                write_styp(os->ctx->pb);
+            }
         } else {
             snprintf(full_path, sizeof(full_path), "%s%s", c->dirname, os->initfile);
         }
@@ -854,9 +987,16 @@ static int dash_flush(AVFormatContext *s, int final, int stream)
             find_index_range(s, full_path, start_pos, &index_length);
         } else {
             ff_format_io_close(s, &os->out);
-            ret = avpriv_io_move(temp_path, full_path);
-            if (ret < 0)
-                break;
+            if (!c->streaming) {
+                // Rename only once the segment is complete on storage,
+                // see dash_async_barrier().
+                if (c->async_write)
+                    av_strlcpy(os->temp_path, temp_path, sizeof(os->temp_path));
+                else
+                    ret = avpriv_io_move(temp_path, full_path);
+                if (ret < 0)
+                    break;
+            }
         }
         add_segment(os, filename, os->start_pts, os->max_pts - os->start_pts, start_pos, range_length, index_length);
         av_log(s, AV_LOG_VERBOSE, "Representation %d media segment %d written to: %s\n", i, os->segment_index, full_path);
@@ -884,6 +1024,8 @@ static int dash_flush(AVFormatContext *s, int final, int stream)
 
     if (ret >= 0)
         ret = write_manifest(s, final);
+    else if (c->async_write)
+        dash_async_barrier(s);
     return ret;
 }
 
@@ -954,13 +1096,22 @@ static int dash_write_packet(AVFormatContext *s, AVPacket *pkt)
             os->start_pts = os->max_pts;
         else
             os->start_pts = pkt->pts;
+
+        if (c->streaming &&
+            (ret = dash_start_streaming_segment(s, os, pkt->stream_index)) < 0)
+            return ret;
     }
     if (os->max_pts == AV_NOPTS_VALUE)
         os->max_pts = pkt->pts + pkt->duration;
     else
         os->max_pts = FFMAX(os->max_pts, pkt->pts + pkt->duration);
     os->packets_written++;
-    return ff_write_chained(os->ctx, 0, pkt, s, 0);
+    if ((ret = ff_write_chained(os->ctx, 0, pkt, s, 0)) < 0)
+        return ret;
+
+    if (c->streaming)
+        return dash_write_streaming_init(s, os, pkt->stream_index);
+    return 0;
 }
 
 static int dash_write_trailer(AVFormatContext *s)
@@ -1009,6 +1160,8 @@ static const AVOption options[] = {
     { "single_file_name", "DASH-templated name to be used for baseURL. Implies storing all segments in one file, accessed using byte ranges", OFFSET(single_file_name), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { "init_seg_name", "DASH-templated name to used for the initialization segment", OFFSET(init_seg_name), AV_OPT_TYPE_STRING, {.str = "init-stream$RepresentationID$.m4s"}, 0, 0, E },
     { "media_seg_name", "DASH-templated name to used for the media segments", OFFSET(media_seg_name), AV_OPT_TYPE_STRING, {.str = "chunk-stream$RepresentationID$-$Number%05d$.m4s"}, 0, 0, E },
+    { "streaming", "Write every frame as a separate chunk into segments opened under their final name", OFFSET(streaming), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
+    { "async_write", "Write and close segment files from a background thread", OFFSET(async_write), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
     { NULL },
 };
 
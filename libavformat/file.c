@@ -20,8 +20,10 @@
  */
 
 #include "libavutil/avstring.h"
+#include "libavutil/fifo.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "avformat.h"
 #if HAVE_DIRENT_H
 #include <dirent.h>
@@ -35,6 +37,8 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#include "avio_internal.h"
+#include "internal.h"
 #include "os_support.h"
 #include "url.h"
 
@@ -73,15 +77,23 @@ typedef struct FileContext {
     int trunc;
     int blocksize;
     int follow;
+    int async_write;
+    int async_queue_size;
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
+#if HAVE_THREADS
+    struct FileWriter *writer;  ///< set while async_write is active
+    FFFileCloseGroup  *close_group;
+#endif
 } FileContext;
 
 static const AVOption file_options[] = {
     { "truncate", "truncate existing files on write", offsetof(FileContext, trunc), AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { "async_write", "perform writes and close from a background thread", offsetof(FileContext, async_write), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
+    { "async_queue_size", "set maximum amount of data queued for background writing", offsetof(FileContext, async_queue_size), AV_OPT_TYPE_INT, { .i64 = 4 * 1024 * 1024 }, 4096, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { NULL }
 };
 
@@ -115,10 +127,351 @@ static int file_read(URLContext *h, unsigned char *buf, int size)
     return (ret == -1) ? AVERROR(errno) : ret;
 }
 
+/**
+ * Files whose close has been left to their writer thread, see
+ * ff_file_set_close_group().
+ */
+struct FFFileCloseGroup {
+    struct FileWriter *writers;
+    int                nb_closing;
+#if HAVE_THREADS
+    pthread_mutex_t    mutex;
+    pthread_cond_t     cond;
+#endif
+};
+
+#if HAVE_THREADS
+/**
+ * Background writer of a file opened with async_write. It is allocated
+ * apart from the URLContext so that, in a close group, the queued data and
+ * the close can be left to the thread after the URLContext is gone.
+ */
+typedef struct FileWriter {
+    int             fd;
+    int             blocksize;
+    AVFifoBuffer   *fifo;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond_wakeup_main;
+    pthread_cond_t  cond_wakeup_background;
+    pthread_t       thread;
+    int             busy;
+    int             close_request;
+    int             io_error;
+    FFFileCloseGroup  *group;
+    struct FileWriter *next;
+} FileWriter;
+
+static void *file_write_task(void *arg)
+{
+    FileWriter *w = arg;
+    uint8_t buf[32768];
+    int close_request;
+
+    pthread_mutex_lock(&w->mutex);
+    while (1) {
+        int size = av_fifo_size(w->fifo);
+        int pos  = 0;
+
+        if (!size) {
+            if (w->close_request)
+                break;
+            pthread_cond_signal(&w->cond_wakeup_main);
+            pthread_cond_wait(&w->cond_wakeup_background, &w->mutex);
+            continue;
+        }
+
+        size = FFMIN(size, sizeof(buf));
+        av_fifo_generic_read(w->fifo, buf, size, NULL);
+        w->busy = 1;
+        /* the queue now has room again, let a blocked writer continue */
+        pthread_cond_signal(&w->cond_wakeup_main);
+        pthread_mutex_unlock(&w->mutex);
+
+        while (pos < size) {
+            int ret = write(w->fd, buf + pos, FFMIN(size - pos, w->blocksize));
+            if (ret < 0) {
+                if (errno == EINTR)
+                    continue;
+                ret = AVERROR(errno);
+                pthread_mutex_lock(&w->mutex);
+                if (!w->io_error)
+                    w->io_error = ret;
+                pthread_mutex_unlock(&w->mutex);
+                break;
+            }
+            pos += ret;
+        }
+
+        pthread_mutex_lock(&w->mutex);
+        w->busy = 0;
+        if (w->io_error)
+            av_fifo_reset(w->fifo);
+    }
+    close_request = w->close_request;
+    pthread_cond_signal(&w->cond_wakeup_main);
+    pthread_mutex_unlock(&w->mutex);
+
+    /* 2 means file_close() left the close to this thread, and nothing
+     * but ff_file_close_group_wait() touches the writer any more */
+    if (close_request == 2) {
+        FFFileCloseGroup *g = w->group;
+        int ret = w->io_error;
+        if (close(w->fd) < 0 && !ret)
+            ret = AVERROR(errno);
+
+        pthread_mutex_lock(&g->mutex);
+        w->io_error = ret;
+        g->nb_closing--;
+        pthread_cond_broadcast(&g->cond);
+        pthread_mutex_unlock(&g->mutex);
+    }
+
+    return NULL;
+}
+
+static int file_async_write(URLContext *h, const unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+    FileWriter  *w = c->writer;
+    int written = 0;
+    int ret = 0;
+
+    pthread_mutex_lock(&w->mutex);
+    while (written < size) {
+        int space;
+
+        if (w->io_error) {
+            ret = w->io_error;
+            break;
+        }
+        if (ff_check_interrupt(&h->interrupt_callback)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        space = av_fifo_space(w->fifo);
+        if (!space) {
+            pthread_cond_signal(&w->cond_wakeup_background);
+            pthread_cond_wait(&w->cond_wakeup_main, &w->mutex);
+            continue;
+        }
+        space = FFMIN(space, size - written);
+        av_fifo_generic_write(w->fifo, (void *)(buf + written), space, NULL);
+        written += space;
+    }
+    pthread_cond_signal(&w->cond_wakeup_background);
+    pthread_mutex_unlock(&w->mutex);
+
+    return written ? written : ret;
+}
+
+/**
+ * Wait until all queued data has been handed to the operating system.
+ * Used before any operation that depends on the file position or size.
+ */
+static int file_async_drain(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    FileWriter  *w = c->writer;
+    int ret;
+
+    pthread_mutex_lock(&w->mutex);
+    while ((av_fifo_size(w->fifo) || w->busy) && !w->io_error) {
+        pthread_cond_signal(&w->cond_wakeup_background);
+        pthread_cond_wait(&w->cond_wakeup_main, &w->mutex);
+    }
+    ret = w->io_error;
+    pthread_mutex_unlock(&w->mutex);
+
+    return ret;
+}
+
+static void file_writer_free(FileWriter *w)
+{
+    pthread_cond_destroy(&w->cond_wakeup_background);
+    pthread_cond_destroy(&w->cond_wakeup_main);
+    pthread_mutex_destroy(&w->mutex);
+    av_fifo_freep(&w->fifo);
+    av_free(w);
+}
+
+static int file_async_init(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    FileWriter  *w;
+    int ret;
+
+    w = av_mallocz(sizeof(*w));
+    if (!w)
+        return AVERROR(ENOMEM);
+    w->fd        = c->fd;
+    w->blocksize = c->blocksize;
+
+    w->fifo = av_fifo_alloc(c->async_queue_size);
+    if (!w->fifo) {
+        ret = AVERROR(ENOMEM);
+        goto fifo_fail;
+    }
+    if ((ret = pthread_mutex_init(&w->mutex, NULL))) {
+        ret = AVERROR(ret);
+        goto mutex_fail;
+    }
+    if ((ret = pthread_cond_init(&w->cond_wakeup_main, NULL))) {
+        ret = AVERROR(ret);
+        goto cond_wakeup_main_fail;
+    }
+    if ((ret = pthread_cond_init(&w->cond_wakeup_background, NULL))) {
+        ret = AVERROR(ret);
+        goto cond_wakeup_background_fail;
+    }
+    if ((ret = pthread_create(&w->thread, NULL, file_write_task, w))) {
+        av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(AVERROR(ret)));
+        ret = AVERROR(ret);
+        goto thread_fail;
+    }
+    c->writer = w;
+
+    return 0;
+
+thread_fail:
+    pthread_cond_destroy(&w->cond_wakeup_background);
+cond_wakeup_background_fail:
+    pthread_cond_destroy(&w->cond_wakeup_main);
+cond_wakeup_main_fail:
+    pthread_mutex_destroy(&w->mutex);
+mutex_fail:
+    av_fifo_freep(&w->fifo);
+fifo_fail:
+    av_free(w);
+    return ret;
+}
+
+/**
+ * Stop the writer of a file being closed. In a close group the thread is
+ * left to write out the queue and close the file descriptor, and only the
+ * errors seen so far are returned; otherwise wait for it and close here.
+ */
+static int file_async_uninit(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    FileWriter  *w = c->writer;
+    FFFileCloseGroup *g = c->close_group;
+    int ret;
+
+    c->writer      = NULL;
+    c->close_group = NULL;
+
+    if (g) {
+        w->group = g;
+        pthread_mutex_lock(&g->mutex);
+        w->next     = g->writers;
+        g->writers  = w;
+        g->nb_closing++;
+        pthread_mutex_unlock(&g->mutex);
+
+        pthread_mutex_lock(&w->mutex);
+        w->close_request = 2;
+        ret = w->io_error;
+        pthread_cond_signal(&w->cond_wakeup_background);
+        pthread_mutex_unlock(&w->mutex);
+        return ret;
+    }
+
+    pthread_mutex_lock(&w->mutex);
+    w->close_request = 1;
+    pthread_cond_signal(&w->cond_wakeup_background);
+    pthread_mutex_unlock(&w->mutex);
+
+    pthread_join(w->thread, NULL);
+    ret = w->io_error;
+    if (close(w->fd) < 0 && !ret)
+        ret = AVERROR(errno);
+    file_writer_free(w);
+
+    return ret;
+}
+#endif /* HAVE_THREADS */
+
+FFFileCloseGroup *ff_file_close_group_alloc(void)
+{
+    FFFileCloseGroup *g = av_mallocz(sizeof(*g));
+
+    if (!g)
+        return NULL;
+#if HAVE_THREADS
+    if (pthread_mutex_init(&g->mutex, NULL)) {
+        av_free(g);
+        return NULL;
+    }
+    if (pthread_cond_init(&g->cond, NULL)) {
+        pthread_mutex_destroy(&g->mutex);
+        av_free(g);
+        return NULL;
+    }
+#endif
+    return g;
+}
+
+void ff_file_set_close_group(AVIOContext *pb, FFFileCloseGroup *g)
+{
+#if HAVE_THREADS
+    URLContext *h = pb ? ffio_geturlcontext(pb) : NULL;
+    FileContext *c;
+
+    if (!h || h->prot->priv_data_class != &file_class)
+        return;
+    c = h->priv_data;
+    if (c->writer)
+        c->close_group = g;
+#endif
+}
+
+int ff_file_close_group_wait(FFFileCloseGroup *g)
+{
+    int ret = 0;
+#if HAVE_THREADS
+    FileWriter *w;
+
+    pthread_mutex_lock(&g->mutex);
+    while (g->nb_closing)
+        pthread_cond_wait(&g->cond, &g->mutex);
+    w = g->writers;
+    g->writers = NULL;
+    pthread_mutex_unlock(&g->mutex);
+
+    while (w) {
+        FileWriter *next = w->next;
+        pthread_join(w->thread, NULL);
+        if (w->io_error < 0 && !ret)
+            ret = w->io_error;
+        file_writer_free(w);
+        w = next;
+    }
+#endif
+    return ret;
+}
+
+void ff_file_close_group_free(FFFileCloseGroup **pg)
+{
+    FFFileCloseGroup *g = *pg;
+
+    if (!g)
+        return;
+    ff_file_close_group_wait(g);
+#if HAVE_THREADS
+    pthread_cond_destroy(&g->cond);
+    pthread_mutex_destroy(&g->mutex);
+#endif
+    av_freep(pg);
+}
+
 static int file_write(URLContext *h, const unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
+#if HAVE_THREADS
+    if (c->writer)
+        return file_async_write(h, buf, size);
+#endif
     size = FFMIN(size, c->blocksize);
     ret = write(c->fd, buf, size);
     return (ret == -1) ? AVERROR(errno) : ret;
@@ -227,6 +580,19 @@ static int file_open(URLContext *h, const char *filename, int flags)
 
     h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
 
+    if (c->async_write && (flags & AVIO_FLAG_READ_WRITE) == AVIO_FLAG_WRITE) {
+#if HAVE_THREADS
+        int ret = file_async_init(h);
+        if (ret < 0) {
+            close(fd);
+            return ret;
+        }
+#else
+        av_log(h, AV_LOG_WARNING, "async_write requires threading support, "
+               "writing synchronously\n");
+#endif
+    }
+
     return 0;
 }
 
@@ -236,6 +602,11 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     FileContext *c = h->priv_data;
     int64_t ret;
 
+#if HAVE_THREADS
+    if (c->writer && (ret = file_async_drain(h)) < 0)
+        return ret;
+#endif
+
     if (whence == AVSEEK_SIZE) {
         struct stat st;
         ret = fstat(c->fd, &st);
@@ -250,7 +621,14 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    return close(c->fd);
+    int ret = 0;
+#if HAVE_THREADS
+    if (c->writer)
+        return file_async_uninit(h);
+#endif
+    if (close(c->fd) < 0)
+        ret = AVERROR(errno);
+    return ret;
 }
 
 static int file_open_dir(URLContext *h)
@@ -124,6 +124,8 @@ typedef struct HLSContext {
     AVDictionary *vtt_format_options;
 
     char *method;
+    int async_write;
+    FFFileCloseGroup *close_group; ///< segments being closed by their writer
 
 } HLSContext;
 
@@ -405,6 +407,13 @@ static void set_http_options(AVDictionary **options, HLSContext *c)
         av_dict_set(options, "method", c->method, 0);
 }
 
+static void set_segment_options(AVDictionary **options, HLSContext *c)
+{
+    set_http_options(options, c);
+    if (c->close_group)
+        av_dict_set(options, "async_write", "1", 0);
+}
+
 static int hls_window(AVFormatContext *s, int last)
 {
     HLSContext *hls = s->priv_data;
@@ -426,6 +435,12 @@ static int hls_window(AVFormatContext *s, int last)
     if (!use_rename && !warned_non_file++)
         av_log(s, AV_LOG_ERROR, "Cannot use rename on non file protocol, this may lead to races and temporarly partial files\n");
 
+#if CONFIG_FILE_PROTOCOL
+    /* make sure every listed segment is complete on storage */
+    if (hls->close_group && (ret = ff_file_close_group_wait(hls->close_group)) < 0)
+        goto fail;
+#endif
+
     set_http_options(&options, hls);
     snprintf(temp_filename, sizeof(temp_filename), use_rename ? "%s.tmp" : "%s", s->filename);
     if ((ret = s->io_open(s, &out, temp_filename, AVIO_FLAG_WRITE, &options)) < 0)
@@ -575,7 +590,7 @@ static int hls_start(AVFormatContext *s)
     }
     c->number++;
 
-    set_http_options(&options, c);
+    set_segment_options(&options, c);
 
     if (c->key_info_file) {
         if ((err = hls_encryption_start(s)) < 0)
@@ -603,11 +618,18 @@ static int hls_start(AVFormatContext *s)
         if ((err = s->io_open(s, &oc->pb, oc->filename, AVIO_FLAG_WRITE, &options)) < 0)
             goto fail;
     if (c->vtt_basename) {
-        set_http_options(&options, c);
+        set_segment_options(&options, c);
         if ((err = s->io_open(s, &vtt_oc->pb, vtt_oc->filename, AVIO_FLAG_WRITE, &options)) < 0)
             goto fail;
     }
     av_dict_free(&options);
+#if CONFIG_FILE_PROTOCOL
+    if (c->close_group) {
+        ff_file_set_close_group(oc->pb, c->close_group);
+        if (c->vtt_basename)
+            ff_file_set_close_group(vtt_oc->pb, c->close_group);
+    }
+#endif
 
     /* We only require one PAT/PMT per segment. */
     if (oc->oformat->priv_class && oc->priv_data) {
@@ -657,6 +679,14 @@ static int hls_write_header(AVFormatContext *s)
         }
     }
 
+#if CONFIG_FILE_PROTOCOL
+    if (hls->async_write && !(hls->flags & HLS_SINGLE_FILE) &&
+        !(hls->close_group = ff_file_close_group_alloc())) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+#endif
+
     for (i = 0; i < s->nb_streams; i++) {
         hls->has_video +=
             s->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO;
@@ -903,6 +933,14 @@ static int hls_write_trailer(struct AVFormatContext *s)
     return 0;
 }
 
+static void hls_deinit(AVFormatContext *s)
+{
+#if CONFIG_FILE_PROTOCOL
+    HLSContext *hls = s->priv_data;
+    ff_file_close_group_free(&hls->close_group);
+#endif
+}
+
 #define OFFSET(x) offsetof(HLSContext, x)
 #define E AV_OPT_FLAG_ENCODING_PARAM
 static const AVOption options[] = {
@@ -929,6 +967,7 @@ static const AVOption options[] = {
     {"event", "EVENT playlist", 0, AV_OPT_TYPE_CONST, {.i64 = PLAYLIST_TYPE_EVENT }, INT_MIN, INT_MAX, E, "pl_type" },
     {"vod", "VOD playlist", 0, AV_OPT_TYPE_CONST, {.i64 = PLAYLIST_TYPE_VOD }, INT_MIN, INT_MAX, E, "pl_type" },
     {"method", "set the HTTP method", OFFSET(method), AV_OPT_TYPE_STRING, {.str = NULL},  0, 0,    E},
+    {"hls_async_write", "write and close segment files from a background thread", OFFSET(async_write), AV_OPT_TYPE_BOOL, {.i64 = 0 }, 0, 1, E },
 
     { NULL },
 };
@@ -953,5 +992,6 @@ AVOutputFormat ff_hls_muxer = {
     .write_header   = hls_write_header,
     .write_packet   = hls_write_packet,
     .write_trailer  = hls_write_trailer,
+    .deinit         = hls_deinit,
     .priv_class     = &hls_class,
 };
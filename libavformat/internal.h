@@ -124,6 +124,13 @@ struct AVFormatInternal {
      * Whether or not a header has already been written
      */
     int header_written;
+
+    /**
+     * Background muxing thread state, allocated when the first packet is
+     * queued with AVFormatContext.async_mux_queue_size set.
+     * Muxing only.
+     */
+    struct MuxThreadContext *mux_thread;
 };
 
 struct AVStreamInternal {
@@ -567,6 +574,45 @@ int ffio_open2_wrapper(struct AVFormatContext *s, AVIOContext **pb, const char *
  */
 void ff_format_io_close(AVFormatContext *s, AVIOContext **pb);
 
+/**
+ * Write out all packets queued for the background muxing thread and stop
+ * the thread. Does nothing if asynchronous muxing is not active.
+ *
+ * @return the first error returned by the background thread, or 0
+ */
+int ff_mux_thread_stop(AVFormatContext *s);
+
+typedef struct FFFileCloseGroup FFFileCloseGroup;
+
+/**
+ * Allocate a group of files whose close is left to their background writer.
+ *
+ * @return the group, or NULL on allocation failure
+ */
+FFFileCloseGroup *ff_file_close_group_alloc(void);
+
+/**
+ * Make the close of a file opened with the file protocol async_write option
+ * return without waiting for the queued data to be written; the file then
+ * is only known to be complete after ff_file_close_group_wait() on g.
+ * Does nothing if pb is not such a file, which is then closed synchronously.
+ */
+void ff_file_set_close_group(AVIOContext *pb, FFFileCloseGroup *g);
+
+/**
+ * Wait until every file closed in the group has been completely written
+ * and closed, e.g. before writing a playlist that references them.
+ *
+ * @return the first error seen while writing or closing those files since
+ *         the previous call, or 0
+ */
+int ff_file_close_group_wait(FFFileCloseGroup *g);
+
+/**
+ * Wait for the files closed in the group, then free it and set *g to NULL.
+ */
+void ff_file_close_group_free(FFFileCloseGroup **g);
+
 /**
  * Parse creation_time in AVFormatContext metadata if exists and warn if the
  * parsing fails.
@@ -619,4 +665,12 @@ int ff_get_packet_palette(AVFormatContext *s, AVPacket *pkt, int ret, uint32_t *
  */
 int ff_bprint_to_codecpar_extradata(AVCodecParameters *par, struct AVBPrint *buf);
 
+/**
+ * Like av_get_packet(), but if the AVIOContext reads into refcounted buffers
+ * (AVIO_FLAG_REFBUF) and the packet lies entirely inside the current buffer
+ * chunk, make the packet reference the chunk instead of copying the data.
+ * The demuxer must not modify the packet data in place.
+ */
+int ff_get_packet_ref(AVIOContext *s, AVPacket *pkt, int size);
+
 #endif /* AVFORMAT_INTERNAL_H */
@@ -87,6 +87,7 @@ typedef struct MOVFragment {
     unsigned size;
     unsigned flags;
     int64_t time;
+    int has_tfdt;       ///< a 'tfdt' atom was found in the current 'moof'
 } MOVFragment;
 
 typedef struct MOVTrackExt {
@@ -112,6 +113,7 @@ typedef struct MOVFragmentIndex {
     unsigned track_id;
     unsigned item_count;
     unsigned current_item;
+    int seek_only;      ///< only used to locate fragments, times come from 'tfdt'
     MOVFragmentIndexItem *items;
 } MOVFragmentIndex;
 
@@ -209,12 +211,14 @@ typedef struct MOVContext {
     int ignore_chapters;
     int seek_individually;
     int64_t next_root_atom; ///< offset of the next root atom
+    int64_t fragment_duration; ///< duration of all fragments from 'mehd', in AV_TIME_BASE
     int export_all;
     int export_xmp;
     int *bitrates;          ///< bitrates read before streams creation
     int bitrates_count;
     int moov_retry;
     int use_mfra_for;
+    int use_mfra_index;
     int has_looked_for_mfra;
     MOVFragmentIndex** fragment_index_data;
     unsigned fragment_index_count;
@@ -102,6 +102,7 @@ typedef struct EbmlList {
 
 typedef struct EbmlBin {
     int      size;
+    AVBufferRef *buf;   ///< if set, data points into it and is not freed separately
     uint8_t *data;
     int64_t  pos;
 } EbmlBin;
@@ -949,6 +950,43 @@ static int ebml_read_binary(AVIOContext *pb, int length, EbmlBin *bin)
     return 0;
 }
 
+/*
+ * Read the data of a (Simple)Block into a refcounted buffer, which the
+ * frames in it can reference instead of being copied again.
+ * 0 is success, < 0 is failure.
+ */
+static int ebml_read_block(AVIOContext *pb, int length, EbmlBin *bin)
+{
+    int ret;
+
+    if (bin->buf)
+        av_buffer_unref(&bin->buf);
+    else
+        av_freep(&bin->data);
+    bin->data = NULL;
+    bin->size = 0;
+    bin->pos  = avio_tell(pb);
+
+    ret = ffio_read_refcounted(pb, &bin->buf, &bin->data, length);
+    if (ret < 0)
+        return ret;
+    if (!ret) {
+        bin->buf = av_buffer_alloc(length + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!bin->buf)
+            return AVERROR(ENOMEM);
+        bin->data = bin->buf->data;
+        memset(bin->data + length, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+        if (avio_read(pb, bin->data, length) != length) {
+            av_buffer_unref(&bin->buf);
+            bin->data = NULL;
+            return AVERROR(EIO);
+        }
+    }
+    bin->size = length;
+
+    return 0;
+}
+
 /*
  * Read the next element, but only the header. The contents
  * are supposed to be sub-elements which can be read separately.
@@ -1177,7 +1215,10 @@ static int ebml_parse_elem(MatroskaDemuxContext *matroska,
         res = ebml_read_ascii(pb, length, data);
         break;
     case EBML_BIN:
-        res = ebml_read_binary(pb, length, data);
+        if (id == MATROSKA_ID_BLOCK || id == MATROSKA_ID_SIMPLEBLOCK)
+            res = ebml_read_block(pb, length, data);
+        else
+            res = ebml_read_binary(pb, length, data);
         break;
     case EBML_LEVEL1:
     case EBML_NEST:
@@ -1220,9 +1261,15 @@ static void ebml_free(EbmlSyntax *syntax, void *data)
         case EBML_UTF8:
             av_freep(data_off);
             break;
-        case EBML_BIN:
-            av_freep(&((EbmlBin *) data_off)->data);
+        case EBML_BIN: {
+            EbmlBin *bin = data_off;
+            if (bin->buf)
+                av_buffer_unref(&bin->buf);
+            else
+                av_freep(&bin->data);
+            bin->data = NULL;
             break;
+        }
         case EBML_LEVEL1:
         case EBML_NEST:
             if (syntax[i].list_elem_size) {
@@ -2975,7 +3022,7 @@ static int matroska_parse_webvtt(MatroskaDemuxContext *matroska,
 
 static int matroska_parse_frame(MatroskaDemuxContext *matroska,
                                 MatroskaTrack *track, AVStream *st,
-                                uint8_t *data, int pkt_size,
+                                AVBufferRef *buf, uint8_t *data, int pkt_size,
                                 uint64_t timecode, uint64_t lace_duration,
                                 int64_t pos, int is_keyframe,
                                 uint8_t *additional, uint64_t additional_id, int additional_size,
@@ -3015,23 +3062,34 @@ static int matroska_parse_frame(MatroskaDemuxContext *matroska,
             av_freep(&pkt_data);
         return AVERROR(ENOMEM);
     }
-    /* XXX: prevent data copy... */
-    if (av_new_packet(pkt, pkt_size + offset) < 0) {
-        av_free(pkt);
-        res = AVERROR(ENOMEM);
-        goto fail;
-    }
+    if (buf && pkt_data == data && !offset) {
+        /* the frame is used unchanged, reference the block instead of copying */
+        av_init_packet(pkt);
+        pkt->buf = av_buffer_ref(buf);
+        if (!pkt->buf) {
+            av_free(pkt);
+            return AVERROR(ENOMEM);
+        }
+        pkt->data = data;
+        pkt->size = pkt_size;
+    } else {
+        if (av_new_packet(pkt, pkt_size + offset) < 0) {
+            av_free(pkt);
+            res = AVERROR(ENOMEM);
+            goto fail;
+        }
 
-    if (st->codecpar->codec_id == AV_CODEC_ID_PRORES && offset == 8) {
-        uint8_t *buf = pkt->data;
-        bytestream_put_be32(&buf, pkt_size);
-        bytestream_put_be32(&buf, MKBETAG('i', 'c', 'p', 'f'));
-    }
+        if (st->codecpar->codec_id == AV_CODEC_ID_PRORES && offset == 8) {
+            uint8_t *hdr = pkt->data;
+            bytestream_put_be32(&hdr, pkt_size);
+            bytestream_put_be32(&hdr, MKBETAG('i', 'c', 'p', 'f'));
+        }
 
-    memcpy(pkt->data + offset, pkt_data, pkt_size);
+        memcpy(pkt->data + offset, pkt_data, pkt_size);
 
-    if (pkt_data != data)
-        av_freep(&pkt_data);
+        if (pkt_data != data)
+            av_freep(&pkt_data);
+    }
 
     pkt->flags        = is_keyframe;
     pkt->stream_index = st->index;
@@ -3090,8 +3148,8 @@ fail:
     return res;
 }
 
-static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
-                                int size, int64_t pos, uint64_t cluster_time,
+static int matroska_parse_block(MatroskaDemuxContext *matroska, AVBufferRef *buf,
+                                uint8_t *data, int size, int64_t pos, uint64_t cluster_time,
                                 uint64_t block_duration, int is_keyframe,
                                 uint8_t *additional, uint64_t additional_id, int additional_size,
                                 int64_t cluster_pos, int64_t discard_padding)
@@ -3203,7 +3261,11 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
             if (res)
                 goto end;
         } else {
-            res = matroska_parse_frame(matroska, track, st, data, lace_size[n],
+            /* only the last frame of a block is followed by the zeroed
+             * padding of the block buffer, the others are copied */
+            res = matroska_parse_frame(matroska, track, st,
+                                       n == laces - 1 ? buf : NULL,
+                                       data, lace_size[n],
                                        timecode, lace_duration, pos,
                                        !n ? is_keyframe : 0,
                                        additional, additional_id, additional_size,
@@ -3267,7 +3329,7 @@ static int matroska_parse_cluster_incremental(MatroskaDemuxContext *matroska)
                                     blocks[i].additional.data : NULL;
             if (!blocks[i].non_simple)
                 blocks[i].duration = 0;
-            res = matroska_parse_block(matroska, blocks[i].bin.data,
+            res = matroska_parse_block(matroska, blocks[i].bin.buf, blocks[i].bin.data,
                                        blocks[i].bin.size, blocks[i].bin.pos,
                                        matroska->current_cluster.timecode,
                                        blocks[i].duration, is_keyframe,
@@ -3301,7 +3363,7 @@ static int matroska_parse_cluster(MatroskaDemuxContext *matroska)
     for (i = 0; i < blocks_list->nb_elem; i++)
         if (blocks[i].bin.size > 0 && blocks[i].bin.data) {
             int is_keyframe = blocks[i].non_simple ? !blocks[i].reference : -1;
-            res = matroska_parse_block(matroska, blocks[i].bin.data,
+            res = matroska_parse_block(matroska, blocks[i].bin.buf, blocks[i].bin.data,
                                        blocks[i].bin.size, blocks[i].bin.pos,
                                        cluster.timecode, blocks[i].duration,
                                        is_keyframe, NULL, 0, 0, pos,
@@ -1097,8 +1097,119 @@ static int mov_read_moov(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return 0; /* now go for mdat */
 }
 
+/**
+ * Get the end time of a track from the headers of one of its fragments,
+ * without adding the fragment samples to the index.
+ *
+ * @param time start time of the fragment, used if it has no 'tfdt'
+ * @return end time in the track timescale, or AV_NOPTS_VALUE
+ */
+static int64_t mov_read_fragment_end(MOVContext *c, AVIOContext *pb,
+                                     int64_t moof_offset, unsigned track_id,
+                                     int64_t time)
+{
+    int64_t moof_end, end = AV_NOPTS_VALUE;
+    unsigned default_duration = 0;
+    int i;
+
+    for (i = 0; i < c->trex_count; i++)
+        if (c->trex_data[i].track_id == track_id)
+            default_duration = c->trex_data[i].duration;
+
+    if (avio_seek(pb, moof_offset, SEEK_SET) < 0)
+        return AV_NOPTS_VALUE;
+    moof_end = moof_offset + avio_rb32(pb);
+    if (avio_rl32(pb) != MKTAG('m','o','o','f'))
+        return AV_NOPTS_VALUE;
+
+    while (avio_tell(pb) + 8 <= moof_end && !pb->eof_reached) {
+        int64_t traf_pos = avio_tell(pb);
+        int64_t traf_end = traf_pos + avio_rb32(pb);
+        int found = 0;
+
+        if (traf_end <= traf_pos + 8 || traf_end > moof_end)
+            break;
+        if (avio_rl32(pb) == MKTAG('t','r','a','f')) {
+            while (avio_tell(pb) + 8 <= traf_end && !pb->eof_reached) {
+                int64_t pos  = avio_tell(pb);
+                int64_t size = avio_rb32(pb);
+                uint32_t type = avio_rl32(pb);
+                int version, flags;
+
+                if (size < 8 || pos + size > traf_end)
+                    break;
+                version = avio_r8(pb);
+                flags   = avio_rb24(pb);
+                if (type == MKTAG('t','f','h','d')) {
+                    if (avio_rb32(pb) != track_id)
+                        break;
+                    found = 1;
+                    if (flags & MOV_TFHD_BASE_DATA_OFFSET) avio_skip(pb, 8);
+                    if (flags & MOV_TFHD_STSD_ID)          avio_skip(pb, 4);
+                    if (flags & MOV_TFHD_DEFAULT_DURATION)
+                        default_duration = avio_rb32(pb);
+                    if (end == AV_NOPTS_VALUE)
+                        end = time;
+                } else if (type == MKTAG('t','f','d','t') && found) {
+                    end = version ? avio_rb64(pb) : avio_rb32(pb);
+                } else if (type == MKTAG('t','r','u','n') && found) {
+                    unsigned entries = avio_rb32(pb);
+                    if (flags & MOV_TRUN_DATA_OFFSET)        avio_skip(pb, 4);
+                    if (flags & MOV_TRUN_FIRST_SAMPLE_FLAGS) avio_skip(pb, 4);
+                    for (i = 0; i < entries && avio_tell(pb) < pos + size; i++) {
+                        end += flags & MOV_TRUN_SAMPLE_DURATION ?
+                               avio_rb32(pb) : default_duration;
+                        if (flags & MOV_TRUN_SAMPLE_SIZE)  avio_skip(pb, 4);
+                        if (flags & MOV_TRUN_SAMPLE_FLAGS) avio_skip(pb, 4);
+                        if (flags & MOV_TRUN_SAMPLE_CTS)   avio_skip(pb, 4);
+                    }
+                    if (!(flags & MOV_TRUN_SAMPLE_DURATION))
+                        end += (int64_t)(entries - i) * default_duration;
+                }
+                if (avio_seek(pb, pos + size, SEEK_SET) < 0)
+                    return AV_NOPTS_VALUE;
+            }
+        }
+        if (avio_seek(pb, traf_end, SEEK_SET) < 0)
+            return AV_NOPTS_VALUE;
+    }
+
+    return end;
+}
+
+/**
+ * Set the stream durations from the last fragment listed in the mfra, for
+ * files read on demand that do not signal their duration in 'mehd'.
+ */
+static void mov_read_fragment_durations(MOVContext *c, AVIOContext *pb,
+                                        unsigned first_index)
+{
+    int64_t pos = avio_tell(pb);
+    int i, j;
+
+    for (i = 0; i < c->fc->nb_streams; i++) {
+        AVStream *st = c->fc->streams[i];
+        for (j = first_index; j < c->fragment_index_count; j++) {
+            MOVFragmentIndex *index = c->fragment_index_data[j];
+            MOVFragmentIndexItem *last;
+            int64_t end;
+
+            if (index->track_id != st->id || !index->item_count)
+                continue;
+            last = &index->items[index->item_count - 1];
+            end  = mov_read_fragment_end(c, pb, last->moof_offset, st->id, last->time);
+            if (end != AV_NOPTS_VALUE &&
+                (st->duration == AV_NOPTS_VALUE || st->duration < end))
+                st->duration = end;
+        }
+    }
+    avio_seek(pb, pos, SEEK_SET);
+}
+
 static int mov_read_moof(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
+    int i, j, ret;
+
     if (!c->has_looked_for_mfra && c->use_mfra_for > 0) {
         c->has_looked_for_mfra = 1;
         if (pb->seekable) {
@@ -1115,8 +1226,45 @@ static int mov_read_moof(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         }
     }
     c->fragment.moof_offset = c->fragment.implicit_offset = avio_tell(pb) - 8;
+    c->fragment.has_tfdt = 0;
     av_log(c->fc, AV_LOG_TRACE, "moof offset %"PRIx64"\n", c->fragment.moof_offset);
-    return mov_read_default(c, pb, atom);
+    ret = mov_read_default(c, pb, atom);
+    if (ret < 0)
+        return ret;
+
+    /* Without a complete sidx, every moof would have to be parsed at open
+     * time. If the fragments carry their own decode times, the mfra is
+     * enough to locate them, so they can be loaded only when needed. */
+    if (!c->has_looked_for_mfra && c->use_mfra_index &&
+        c->use_mfra_for == FF_MOV_FLAG_MFRA_AUTO &&
+        !c->fragment_index_complete && c->fragment.has_tfdt &&
+        pb->seekable && !(c->fc->flags & AVFMT_FLAG_IGNIDX)) {
+        unsigned first_index = c->fragment_index_count;
+        c->has_looked_for_mfra = 1;
+        if (mov_read_mfra(c, pb) >= 0 && c->fragment_index_count > first_index) {
+            int covered = 0;
+            for (i = first_index; i < c->fragment_index_count; i++) {
+                MOVFragmentIndex *index = c->fragment_index_data[i];
+                index->seek_only = 1;
+                for (j = 0; j < index->item_count; j++)
+                    if (index->items[j].moof_offset == c->fragment.moof_offset)
+                        index->items[j].headers_read = 1;
+            }
+            for (i = 0; i < c->fc->nb_streams; i++) {
+                for (j = first_index; j < c->fragment_index_count; j++)
+                    if (c->fragment_index_data[j]->track_id == c->fc->streams[i]->id)
+                        break;
+                covered += j < c->fragment_index_count;
+            }
+            if (covered == c->fc->nb_streams) {
+                av_log(c->fc, AV_LOG_VERBOSE, "using mfra to read fragments on demand\n");
+                c->fragment_index_complete = 1;
+                if (c->fragment_duration <= 0)
+                    mov_read_fragment_durations(c, pb, first_index);
+            }
+        }
+    }
+    return 0;
 }
 
 static void mov_metadata_creation_time(AVDictionary **metadata, int64_t time)
@@ -3456,7 +3604,7 @@ static int mov_read_tfhd(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     for (i = 0; i < c->fragment_index_count; i++) {
         int j;
         MOVFragmentIndex* candidate = c->fragment_index_data[i];
-        if (candidate->track_id == frag->track_id) {
+        if (candidate->track_id == frag->track_id && !candidate->seek_only) {
             av_log(c->fc, AV_LOG_DEBUG,
                    "found fragment index for track %u\n", frag->track_id);
             index = candidate;
@@ -3490,6 +3638,18 @@ static int mov_read_chap(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return 0;
 }
 
+static int mov_read_mehd(MOVContext *c, AVIOContext *pb, MOVAtom atom)
+{
+    int64_t duration;
+    int version = avio_r8(pb);
+    avio_rb24(pb); /* flags */
+
+    duration = version ? avio_rb64(pb) : avio_rb32(pb);
+    if (duration > 0 && c->time_scale > 0)
+        c->fragment_duration = av_rescale(duration, AV_TIME_BASE, c->time_scale);
+    return 0;
+}
+
 static int mov_read_trex(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
     MOVTrackExt *trex;
@@ -3503,7 +3663,8 @@ static int mov_read_trex(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return err;
     }
 
-    c->fc->duration = AV_NOPTS_VALUE; // the duration from mvhd is not representing the whole file when fragments are used.
+    // the duration from mvhd is not representing the whole file when fragments are used, mehd does
+    c->fc->duration = c->fragment_duration > 0 ? c->fragment_duration : AV_NOPTS_VALUE;
 
     trex = &c->trex_data[c->trex_count++];
     avio_r8(pb); /* version */
@@ -3536,6 +3697,7 @@ static int mov_read_tfdt(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id + 1 != frag->stsd_id)
         return 0;
+    frag->has_tfdt = 1;
     version = avio_r8(pb);
     avio_rb24(pb); /* flags */
     if (version) {
@@ -3546,6 +3708,59 @@ static int mov_read_tfdt(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return 0;
 }
 
+/**
+ * Set the ctts index to the entry of the current sample.
+ */
+static void mov_update_ctts_index(MOVStreamContext *sc)
+{
+    int i, time_sample = 0;
+
+    if (!sc->ctts_data)
+        return;
+    for (i = 0; i < sc->ctts_count; i++) {
+        int next = time_sample + sc->ctts_data[i].count;
+        if (next > sc->current_sample) {
+            sc->ctts_index = i;
+            sc->ctts_sample = sc->current_sample - time_sample;
+            break;
+        }
+        time_sample = next;
+    }
+}
+
+/**
+ * Move the ctts entry appended last, which has a count of 1, to the position
+ * of its sample in the index. This is needed when a fragment is read out of
+ * order, e.g. on a seek using a sidx or mfra index, and its samples are
+ * indexed before samples which were read earlier.
+ * The ctts table must have room for one more entry.
+ */
+static void mov_ctts_move_last(MOVStreamContext *sc, int sample)
+{
+    MOVStts last = sc->ctts_data[--sc->ctts_count];
+    int i, pos = 0;
+
+    for (i = 0; i < sc->ctts_count; i++) {
+        if (pos + sc->ctts_data[i].count > sample)
+            break;
+        pos += sc->ctts_data[i].count;
+    }
+    if (i < sc->ctts_count && pos < sample) {
+        /* split the entry the sample falls into */
+        memmove(&sc->ctts_data[i + 2], &sc->ctts_data[i],
+                (sc->ctts_count - i) * sizeof(*sc->ctts_data));
+        sc->ctts_data[i].count      = sample - pos;
+        sc->ctts_data[i + 2].count -= sample - pos;
+        sc->ctts_count += 2;
+        i++;
+    } else {
+        memmove(&sc->ctts_data[i + 1], &sc->ctts_data[i],
+                (sc->ctts_count - i) * sizeof(*sc->ctts_data));
+        sc->ctts_count++;
+    }
+    sc->ctts_data[i] = last;
+}
+
 static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
     MOVFragment *frag = &c->fragment;
@@ -3556,7 +3771,7 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     int64_t dts;
     int data_offset = 0;
     unsigned entries, first_sample_flags = frag->flags;
-    int flags, distance, i, err;
+    int flags, distance, i, err, nb_index_entries;
 
     for (i = 0; i < c->fc->nb_streams; i++) {
         if (c->fc->streams[i]->id == frag->track_id) {
@@ -3592,9 +3807,10 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         sc->ctts_data[sc->ctts_count].duration = 0;
         sc->ctts_count++;
     }
-    if ((uint64_t)entries+sc->ctts_count >= UINT_MAX/sizeof(*sc->ctts_data))
+    /* 2 entries per sample: see mov_ctts_move_last() */
+    if ((uint64_t)2 * entries + sc->ctts_count >= UINT_MAX / sizeof(*sc->ctts_data))
         return AVERROR_INVALIDDATA;
-    if ((err = av_reallocp_array(&sc->ctts_data, entries + sc->ctts_count,
+    if ((err = av_reallocp_array(&sc->ctts_data, 2 * entries + sc->ctts_count,
                                  sizeof(*sc->ctts_data))) < 0) {
         sc->ctts_count = 0;
         return err;
@@ -3649,10 +3865,19 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
                                   MOV_FRAG_SAMPLE_FLAG_DEPENDS_YES));
         if (keyframe)
             distance = 0;
+        nb_index_entries = st->nb_index_entries;
         err = av_add_index_entry(st, offset, dts, sample_size, distance,
                                  keyframe ? AVINDEX_KEYFRAME : 0);
         if (err < 0) {
             av_log(c->fc, AV_LOG_ERROR, "Failed to add index entry\n");
+        } else if (st->nb_index_entries == nb_index_entries) {
+            sc->ctts_count--; /* sample already indexed */
+        } else if (err < st->nb_index_entries - 1) {
+            mov_ctts_move_last(sc, err);
+            /* keep reading from the same sample */
+            if (err <= sc->current_sample)
+                sc->current_sample++;
+            mov_update_ctts_index(sc);
         }
         av_log(c->fc, AV_LOG_TRACE, "AVIndex stream %d, sample %d, offset %"PRIx64", dts %"PRId64", "
                 "size %d, distance %d, keyframe %d\n", st->index, sc->sample_count+i,
@@ -3747,7 +3972,7 @@ static int mov_read_sidx(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         }
         avio_rb32(pb); // sap_flags
         index->items[i].moof_offset = offset;
-        index->items[i].time = av_rescale_q(pts, st->time_base, timescale);
+        index->items[i].time = av_rescale_q(pts, timescale, st->time_base);
         offset += size;
         pts += duration;
     }
@@ -4316,6 +4541,7 @@ static const MOVParseTableEntry mov_default_parse_table[] = {
 { MKTAG('t','r','e','f'), mov_read_default },
 { MKTAG('t','m','c','d'), mov_read_tmcd },
 { MKTAG('c','h','a','p'), mov_read_chap },
+{ MKTAG('m','e','h','d'), mov_read_mehd },
 { MKTAG('t','r','e','x'), mov_read_trex },
 { MKTAG('t','r','u','n'), mov_read_trun },
 { MKTAG('u','d','t','a'), mov_read_default },
@@ -5145,7 +5371,12 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
             sc->current_sample -= should_retry(sc->pb, ret64);
             return AVERROR_INVALIDDATA;
         }
-        ret = av_get_packet(sc->pb, pkt, sample->size);
+        /* the decryption filters work in place and the DV path frees the
+         * packet data itself, so those need a packet of their own */
+        if (mov->aax_mode || sc->cenc.aes_ctr || (mov->dv_demux && sc->dv_audio_container))
+            ret = av_get_packet(sc->pb, pkt, sample->size);
+        else
+            ret = ff_get_packet_ref(sc->pb, pkt, sample->size);
         if (ret < 0) {
             sc->current_sample -= should_retry(sc->pb, ret);
             return ret;
@@ -5213,7 +5444,7 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 static int mov_seek_fragment(AVFormatContext *s, AVStream *st, int64_t timestamp)
 {
     MOVContext *mov = s->priv_data;
-    int i, j;
+    int i, j, last, ret;
 
     if (!mov->fragment_index_complete)
         return 0;
@@ -5221,14 +5452,18 @@ static int mov_seek_fragment(AVFormatContext *s, AVStream *st, int64_t timestamp
     for (i = 0; i < mov->fragment_index_count; i++) {
         if (mov->fragment_index_data[i]->track_id == st->id) {
             MOVFragmentIndex *index = mov->fragment_index_data[i];
-            for (j = index->item_count - 1; j >= 0; j--) {
-                if (index->items[j].time <= timestamp) {
-                    if (index->items[j].headers_read)
-                        return 0;
-
-                    return mov_switch_root(s, index->items[j].moof_offset);
-                }
-            }
+            for (j = index->item_count - 1; j >= 0; j--)
+                if (index->items[j].time <= timestamp)
+                    break;
+            /* The index has presentation times, so the first samples of the
+             * next fragment may be decoded before timestamp too. Switch to
+             * fragments already read as well, so that reading continues
+             * after them. */
+            last = FFMIN(j + 1, index->item_count - 1);
+            for (j = FFMAX(j, 0); j <= last; j++)
+                if ((ret = mov_switch_root(s, index->items[j].moof_offset)) < 0)
+                    return ret;
+            return 0;
         }
     }
 
@@ -5238,8 +5473,7 @@ static int mov_seek_fragment(AVFormatContext *s, AVStream *st, int64_t timestamp
 static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp, int flags)
 {
     MOVStreamContext *sc = st->priv_data;
-    int sample, time_sample;
-    int i;
+    int sample;
 
     int ret = mov_seek_fragment(s, st, timestamp);
     if (ret < 0)
@@ -5253,19 +5487,7 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
         return AVERROR_INVALIDDATA;
     sc->current_sample = sample;
     av_log(s, AV_LOG_TRACE, "stream %d, found sample %d\n", st->index, sc->current_sample);
-    /* adjust ctts index */
-    if (sc->ctts_data) {
-        time_sample = 0;
-        for (i = 0; i < sc->ctts_count; i++) {
-            int next = time_sample + sc->ctts_data[i].count;
-            if (next > sc->current_sample) {
-                sc->ctts_index = i;
-                sc->ctts_sample = sc->current_sample - time_sample;
-                break;
-            }
-            time_sample = next;
-        }
-    }
+    mov_update_ctts_index(sc);
 
     ret = mov_seek_auxiliary_info(s, sc);
     if (ret < 0) {
@@ -5353,6 +5575,10 @@ static const AVOption mov_options[] = {
         FLAGS, "use_mfra_for" },
     {"pts", "pts", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_MFRA_PTS}, 0, 0,
         FLAGS, "use_mfra_for" },
+    {"use_mfra_index",
+        "use mfra to read fragments on demand when there is no complete sidx",
+        OFFSET(use_mfra_index), AV_OPT_TYPE_BOOL, {.i64 = 1},
+        0, 1, FLAGS},
     { "export_all", "Export unrecognized metadata entries", OFFSET(export_all),
         AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, .flags = FLAGS },
     { "export_xmp", "Export full XMP metadata", OFFSET(export_xmp),
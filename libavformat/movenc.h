@@ -133,6 +133,7 @@ typedef struct MOVTrack {
     int64_t     data_offset;
     int64_t     frag_start;
     int         frag_discont;
+    int64_t     prev_dts;     ///< dts of the previous sample, used to guess missing durations with frag_every_frame
     int         entries_flushed;
 
     int         nb_frag_info;
@@ -206,6 +207,7 @@ typedef struct MOVMuxContext {
 
     int frag_interleave;
     int missing_duration_warned;
+    int chunk_track;        ///< track whose samples end a fragment with frag_every_frame, -1 for all tracks
 
     char *encryption_scheme_str;
     MOVEncryptionScheme encryption_scheme;
@@ -233,6 +235,7 @@ typedef struct MOVMuxContext {
 #define FF_MOV_FLAG_GLOBAL_SIDX           (1 << 14)
 #define FF_MOV_FLAG_WRITE_COLR            (1 << 15)
 #define FF_MOV_FLAG_WRITE_GAMA            (1 << 16)
+#define FF_MOV_FLAG_FRAG_EVERY_FRAME      (1 << 17)
 
 int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt);
 
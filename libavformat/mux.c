@@ -35,7 +35,10 @@
 #include "libavutil/internal.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
+#include "libavutil/threadmessage.h"
 #include "libavutil/time.h"
+#include "libavutil/atomic.h"
 #include "riff.h"
 #include "audiointerleave.h"
 #include "url.h"
@@ -820,6 +823,10 @@ int av_write_frame(AVFormatContext *s, AVPacket *pkt)
     if (ret < 0)
         return ret;
 
+    /* packets written directly must not overtake queued ones */
+    if ((ret = ff_mux_thread_stop(s)) < 0)
+        return ret;
+
     if (!pkt) {
         if (s->oformat->flags & AVFMT_ALLOW_FLUSH) {
             ret = s->oformat->write_packet(s, NULL);
@@ -1051,7 +1058,37 @@ static int interleave_packet(AVFormatContext *s, AVPacket *out, AVPacket *in, in
         return ff_interleave_packet_per_dts(s, out, in, flush);
 }
 
-int av_interleaved_write_frame(AVFormatContext *s, AVPacket *pkt)
+/**
+ * Interleave a packet and write out all packets which are ready.
+ * Takes ownership of pkt.
+ */
+static int interleaved_write_packet(AVFormatContext *s, AVPacket *pkt, int flush)
+{
+    for (;; ) {
+        AVPacket opkt;
+        int ret = interleave_packet(s, &opkt, pkt, flush);
+        if (pkt) {
+            memset(pkt, 0, sizeof(*pkt));
+            av_init_packet(pkt);
+            pkt = NULL;
+        }
+        if (ret <= 0) //FIXME cleanup needed for ret<0 ?
+            return ret;
+
+        ret = write_packet(s, &opkt);
+        if (ret >= 0)
+            s->streams[opkt.stream_index]->nb_frames++;
+
+        av_packet_unref(&opkt);
+
+        if (ret < 0)
+            return ret;
+        if(s->pb && s->pb->error)
+            return s->pb->error;
+    }
+}
+
+static int interleaved_write_frame_internal(AVFormatContext *s, AVPacket *pkt)
 {
     int ret, flush = 0;
 
@@ -1100,37 +1137,241 @@ int av_interleaved_write_frame(AVFormatContext *s, AVPacket *pkt)
         flush = 1;
     }
 
-    for (;; ) {
-        AVPacket opkt;
-        int ret = interleave_packet(s, &opkt, pkt, flush);
-        if (pkt) {
-            memset(pkt, 0, sizeof(*pkt));
-            av_init_packet(pkt);
-            pkt = NULL;
+    return interleaved_write_packet(s, pkt, flush);
+fail:
+    av_packet_unref(pkt);
+    return ret;
+}
+
+#if HAVE_THREADS
+/*
+ * While the muxing thread is running it owns the muxer: the AVStream and
+ * AVStreamInternal state, the bitstream filters, the interleaving queue and
+ * the output. The calling thread only validates the stream index, queues the
+ * packet and maintains the drop state below, which the muxing thread never
+ * touches. Anything else that needs the muxer first stops the thread with
+ * ff_mux_thread_stop().
+ */
+typedef struct MuxThreadContext {
+    AVThreadMessageQueue *queue;
+    pthread_t thread;
+    volatile int ret;     ///< first error returned by the muxing thread
+    volatile int depth;   ///< number of packets currently queued
+
+    /* only accessed by the calling thread */
+    uint8_t *drop_until_key; ///< per stream, set after a packet was dropped
+    int nb_streams;
+    int max_depth;
+    int64_t dropped;
+} MuxThreadContext;
+
+static void free_queued_packet(void *msg)
+{
+    av_packet_unref(msg);
+}
+
+static void *mux_thread(void *arg)
+{
+    AVFormatContext *s   = arg;
+    MuxThreadContext *mt = s->internal->mux_thread;
+    AVPacket pkt;
+    int ret;
+
+    while (av_thread_message_queue_recv(mt->queue, &pkt, 0) >= 0) {
+        avpriv_atomic_int_add_and_fetch(&mt->depth, -1);
+        ret = interleaved_write_frame_internal(s, &pkt);
+        if (ret < 0) {
+            avpriv_atomic_int_set(&mt->ret, ret);
+            /* wake up a caller blocked on a full queue and fail all
+             * further sends; queued packets are freed with the queue */
+            av_thread_message_queue_set_err_send(mt->queue, ret);
+            break;
         }
-        if (ret <= 0) //FIXME cleanup needed for ret<0 ?
-            return ret;
+    }
 
-        ret = write_packet(s, &opkt);
-        if (ret >= 0)
-            s->streams[opkt.stream_index]->nb_frames++;
+    return NULL;
+}
 
-        av_packet_unref(&opkt);
+static int mux_thread_start(AVFormatContext *s)
+{
+    MuxThreadContext *mt = s->internal->mux_thread;
+    int ret;
 
-        if (ret < 0)
-            return ret;
-        if(s->pb && s->pb->error)
-            return s->pb->error;
+    if (mt && mt->queue)
+        return 0;
+
+    if (!mt) {
+        mt = av_mallocz(sizeof(*mt));
+        if (!mt)
+            return AVERROR(ENOMEM);
+        s->internal->mux_thread = mt;
     }
+
+    mt->drop_until_key = av_mallocz(s->nb_streams);
+    if (!mt->drop_until_key)
+        return AVERROR(ENOMEM);
+    mt->nb_streams = s->nb_streams;
+
+    ret = av_thread_message_queue_alloc(&mt->queue, s->async_mux_queue_size,
+                                        sizeof(AVPacket));
+    if (ret < 0)
+        goto fail;
+    av_thread_message_queue_set_free_func(mt->queue, free_queued_packet);
+
+    ret = pthread_create(&mt->thread, NULL, mux_thread, s);
+    if (ret) {
+        av_log(s, AV_LOG_ERROR, "pthread_create failed: %s\n", av_err2str(AVERROR(ret)));
+        av_thread_message_queue_free(&mt->queue);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+
+    return 0;
+fail:
+    av_freep(&mt->drop_until_key);
+    return ret;
+}
+
+/**
+ * Hand a packet over to the muxing thread. Takes ownership of pkt.
+ */
+static int mux_thread_queue_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    MuxThreadContext *mt;
+    AVPacket qpkt;
+    int ret, depth, stream_index = pkt->stream_index;
+    int drop = s->async_mux_policy == AVFMT_ASYNC_MUX_DROP;
+
+    if ((ret = mux_thread_start(s)) < 0)
+        goto fail;
+    mt = s->internal->mux_thread;
+
+    if ((ret = avpriv_atomic_int_get(&mt->ret)) < 0)
+        goto fail;
+
+    if (stream_index >= mt->nb_streams) {
+        av_log(s, AV_LOG_ERROR, "Stream %d added while the muxing thread is running\n",
+               stream_index);
+        ret = AVERROR(EINVAL);
+        goto fail;
+    }
+
+    if (drop && mt->drop_until_key[stream_index] && !(pkt->flags & AV_PKT_FLAG_KEY)) {
+        mt->dropped++;
+        av_packet_unref(pkt);
+        return 0;
+    }
+    mt->drop_until_key[stream_index] = 0;
+
+    /* the queued packet must own its data */
+    av_init_packet(&qpkt);
+    qpkt.data = NULL;
+    qpkt.size = 0;
+    if ((ret = av_packet_ref(&qpkt, pkt)) < 0)
+        goto fail;
+    av_packet_unref(pkt);
+
+    depth = avpriv_atomic_int_add_and_fetch(&mt->depth, 1);
+    ret = av_thread_message_queue_send(mt->queue, &qpkt,
+                                       drop ? AV_THREAD_MESSAGE_NONBLOCK : 0);
+    if (ret < 0) {
+        avpriv_atomic_int_add_and_fetch(&mt->depth, -1);
+        av_packet_unref(&qpkt);
+        if (drop && ret == AVERROR(EAGAIN)) {
+            av_log(s, AV_LOG_DEBUG, "Muxing queue full, dropping packets "
+                   "of stream %d until the next keyframe\n", stream_index);
+            mt->drop_until_key[stream_index] = 1;
+            mt->dropped++;
+            return 0;
+        }
+        return ret;
+    }
+    mt->max_depth = FFMAX(mt->max_depth, depth);
+
+    return 0;
 fail:
     av_packet_unref(pkt);
     return ret;
 }
+#endif /* HAVE_THREADS */
+
+int ff_mux_thread_stop(AVFormatContext *s)
+{
+#if HAVE_THREADS
+    MuxThreadContext *mt = s->internal ? s->internal->mux_thread : NULL;
+    int ret;
+
+    if (!mt || !mt->queue)
+        return 0;
+
+    /* the thread writes out everything still queued before it sees EOF */
+    av_thread_message_queue_set_err_recv(mt->queue, AVERROR_EOF);
+    pthread_join(mt->thread, NULL);
+    av_thread_message_queue_free(&mt->queue);
+    av_freep(&mt->drop_until_key);
+    mt->depth = 0;
+
+    av_log(s, AV_LOG_VERBOSE, "Muxing queue: max depth %d of %d, %"PRId64" packets dropped\n",
+           mt->max_depth, s->async_mux_queue_size, mt->dropped);
+
+    ret     = mt->ret;
+    mt->ret = 0;
+    return ret;
+#else
+    return 0;
+#endif
+}
+
+int av_get_async_mux_stats(AVFormatContext *s, int *depth, int *max_depth,
+                           int64_t *dropped)
+{
+#if HAVE_THREADS
+    MuxThreadContext *mt = s->internal->mux_thread;
+
+    if (!mt)
+        return AVERROR(ENOSYS);
+
+    if (depth)
+        *depth = avpriv_atomic_int_get(&mt->depth);
+    if (max_depth)
+        *max_depth = mt->max_depth;
+    if (dropped)
+        *dropped = mt->dropped;
+    return 0;
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
+int av_interleaved_write_frame(AVFormatContext *s, AVPacket *pkt)
+{
+    int ret;
+
+#if HAVE_THREADS
+    if (s->async_mux_queue_size && pkt && !(pkt->flags & AV_PKT_FLAG_UNCODED_FRAME)) {
+        if ((ret = check_packet(s, pkt)) < 0) {
+            av_packet_unref(pkt);
+            return ret;
+        }
+        return mux_thread_queue_packet(s, pkt);
+    }
+#endif
+    if ((ret = ff_mux_thread_stop(s)) < 0) {
+        if (pkt)
+            av_packet_unref(pkt);
+        return ret;
+    }
+
+    return interleaved_write_frame_internal(s, pkt);
+}
 
 int av_write_trailer(AVFormatContext *s)
 {
     int ret, i;
 
+    if ((ret = ff_mux_thread_stop(s)) < 0)
+        goto fail;
+
     for (;; ) {
         AVPacket pkt;
         ret = interleave_packet(s, &pkt, NULL, 1);
@@ -598,6 +598,11 @@ static int write_index(NUTContext *nut, AVIOContext *bc) {
 
     for (i=0; i<nut->sp_count; i++) {
         av_tree_find(nut->syncpoints, &dummy, ff_nut_sp_pos_cmp, (void**)next_node);
+        if (!next_node[1]) {
+            av_log(nut->avf, AV_LOG_ERROR,
+                   "Syncpoint positions are not increasing, cannot write the index\n");
+            return AVERROR(EINVAL);
+        }
         ff_put_v(bc, (next_node[1]->pos >> 4) - (dummy.pos>>4));
         dummy.pos = next_node[1]->pos;
     }
@@ -1183,7 +1188,7 @@ fail:
 static int nut_write_trailer(AVFormatContext *s)
 {
     NUTContext *nut = s->priv_data;
-    AVIOContext *bc = s->pb, *dyn_bc;
+    AVIOContext *bc = s->pb, *dyn_bc = NULL;
     int ret;
 
     while (nut->header_count < 3)
@@ -1192,11 +1197,14 @@ static int nut_write_trailer(AVFormatContext *s)
     ret = avio_open_dyn_buf(&dyn_bc);
     if (ret >= 0 && nut->sp_count) {
         av_assert1(nut->write_index);
-        write_index(nut, dyn_bc);
-        put_packet(nut, bc, dyn_bc, 1, INDEX_STARTCODE);
+        if ((ret = write_index(nut, dyn_bc)) >= 0) {
+            put_packet(nut, bc, dyn_bc, 1, INDEX_STARTCODE);
+            return 0;
+        }
     }
+    ffio_free_dyn_buf(&dyn_bc);
 
-    return 0;
+    return ret < 0 ? ret : 0;
 }
 
 static void nut_write_deinit(AVFormatContext *s)
@@ -36,6 +36,7 @@
 static const AVOption avformat_options[] = {
 {"avioflags", NULL, OFFSET(avio_flags), AV_OPT_TYPE_FLAGS, {.i64 = DEFAULT }, INT_MIN, INT_MAX, D|E, "avioflags"},
 {"direct", "reduce buffering", 0, AV_OPT_TYPE_CONST, {.i64 = AVIO_FLAG_DIRECT }, INT_MIN, INT_MAX, D|E, "avioflags"},
+{"refbuf", "return packets referencing refcounted read buffers", 0, AV_OPT_TYPE_CONST, {.i64 = AVIO_FLAG_REFBUF }, INT_MIN, INT_MAX, D, "avioflags"},
 {"probesize", "set probing size", OFFSET(probesize), AV_OPT_TYPE_INT64, {.i64 = 5000000 }, 32, INT64_MAX, D},
 {"formatprobesize", "number of bytes to probe file format", OFFSET(format_probesize), AV_OPT_TYPE_INT, {.i64 = PROBE_BUF_MAX}, 0, INT_MAX-1, D},
 {"packetsize", "set packet size", OFFSET(packet_size), AV_OPT_TYPE_INT, {.i64 = DEFAULT }, 0, INT_MAX, E},
@@ -103,6 +104,10 @@ static const AVOption avformat_options[] = {
 {"format_whitelist", "List of demuxers that are allowed to be used", OFFSET(format_whitelist), AV_OPT_TYPE_STRING, { .str = NULL },  CHAR_MIN, CHAR_MAX, D },
 {"protocol_whitelist", "List of protocols that are allowed to be used", OFFSET(protocol_whitelist), AV_OPT_TYPE_STRING, { .str = NULL },  CHAR_MIN, CHAR_MAX, D },
 {"protocol_blacklist", "List of protocols that are not allowed to be used", OFFSET(protocol_blacklist), AV_OPT_TYPE_STRING, { .str = NULL },  CHAR_MIN, CHAR_MAX, D },
+{"async_mux_queue_size", "number of packets queued for a background muxing thread, 0 to mux on the caller thread", OFFSET(async_mux_queue_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, E},
+{"async_mux_policy", "set what to do when the asynchronous muxing queue is full", OFFSET(async_mux_policy), AV_OPT_TYPE_INT, {.i64 = AVFMT_ASYNC_MUX_BLOCK}, AVFMT_ASYNC_MUX_BLOCK, AVFMT_ASYNC_MUX_DROP, E, "async_mux_policy"},
+{"block", "wait until the queue has room", 0, AV_OPT_TYPE_CONST, {.i64 = AVFMT_ASYNC_MUX_BLOCK}, INT_MIN, INT_MAX, E, "async_mux_policy"},
+{"drop",  "drop packets until the next keyframe", 0, AV_OPT_TYPE_CONST, {.i64 = AVFMT_ASYNC_MUX_DROP}, INT_MIN, INT_MAX, E, "async_mux_policy"},
 {NULL},
 };
 
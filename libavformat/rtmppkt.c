@@ -302,14 +302,12 @@ int ff_rtmp_packet_read_internal(URLContext *h, RTMPPacket *p, int chunk_size,
     }
 }
 
-int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
-                         int chunk_size, RTMPPacket **prev_pkt_ptr,
-                         int *nb_prev_pkt)
+int ff_rtmp_packet_write_header(RTMPPacket *pkt, RTMPPacket **prev_pkt_ptr,
+                                int *nb_prev_pkt, uint8_t *hdr,
+                                uint8_t *chunk_hdr, int *chunk_hdr_size)
 {
-    uint8_t pkt_hdr[16], *p = pkt_hdr;
+    uint8_t *p = hdr, *q = chunk_hdr;
     int mode = RTMP_PS_TWELVEBYTES;
-    int off = 0;
-    int written = 0;
     int ret;
     RTMPPacket *prev_pkt;
     int use_delta; // flag if using timestamp delta, not RTMP_PS_TWELVEBYTES
@@ -374,29 +372,48 @@ int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
     prev_pkt[pkt->channel_id].ts_field   = pkt->ts_field;
     prev_pkt[pkt->channel_id].extra      = pkt->extra;
 
-    if ((ret = ffurl_write(h, pkt_hdr, p - pkt_hdr)) < 0)
-        return ret;
-    written = p - pkt_hdr + pkt->size;
+    // the following chunks only repeat the channel and extended timestamp
+    bytestream_put_byte(&q, 0xC0 | pkt->channel_id);
+    if (pkt->ts_field == 0xFFFFFF)
+        bytestream_put_be32(&q, timestamp);
+    *chunk_hdr_size = q - chunk_hdr;
+
+    return p - hdr;
+}
+
+int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
+                         int chunk_size, RTMPPacket **prev_pkt_ptr,
+                         int *nb_prev_pkt)
+{
+    uint8_t chunk_hdr[RTMP_MAX_CHUNK_HEADER_SIZE];
+    uint8_t *buf, *p;
+    int chunk_hdr_size, nb_chunks, off = 0;
+    int ret;
+
+    /* the packet is divided into chunks in a buffer sent with one write */
+    nb_chunks = FFMAX((pkt->size + chunk_size - 1) / chunk_size, 1);
+    buf = av_malloc(RTMP_MAX_HEADER_SIZE + pkt->size +
+                    (nb_chunks - 1) * RTMP_MAX_CHUNK_HEADER_SIZE);
+    if (!buf)
+        return AVERROR(ENOMEM);
+
+    if ((ret = ff_rtmp_packet_write_header(pkt, prev_pkt_ptr, nb_prev_pkt,
+                                           buf, chunk_hdr,
+                                           &chunk_hdr_size)) < 0)
+        goto fail;
+    p = buf + ret;
     while (off < pkt->size) {
         int towrite = FFMIN(chunk_size, pkt->size - off);
-        if ((ret = ffurl_write(h, pkt->data + off, towrite)) < 0)
-            return ret;
+        if (off)
+            bytestream_put_buffer(&p, chunk_hdr, chunk_hdr_size);
+        bytestream_put_buffer(&p, pkt->data + off, towrite);
         off += towrite;
-        if (off < pkt->size) {
-            uint8_t marker = 0xC0 | pkt->channel_id;
-            if ((ret = ffurl_write(h, &marker, 1)) < 0)
-                return ret;
-            written++;
-            if (pkt->ts_field == 0xFFFFFF) {
-                uint8_t ts_header[4];
-                AV_WB32(ts_header, timestamp);
-                if ((ret = ffurl_write(h, ts_header, 4)) < 0)
-                    return ret;
-                written += 4;
-            }
-        }
     }
-    return written;
+    if ((ret = ffurl_write(h, buf, p - buf)) >= 0)
+        ret = p - buf;
+fail:
+    av_free(buf);
+    return ret;
 }
 
 int ff_rtmp_packet_create(RTMPPacket *pkt, int channel_id, RTMPPacketType type,
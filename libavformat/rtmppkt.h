@@ -29,6 +29,12 @@
 /** maximum possible number of different RTMP channels */
 #define RTMP_CHANNELS 65599
 
+/** maximum size of the header of the first chunk of an RTMP packet */
+#define RTMP_MAX_HEADER_SIZE 18
+
+/** maximum size of the header of the other chunks of an RTMP packet */
+#define RTMP_MAX_CHUNK_HEADER_SIZE 5
+
 /**
  * channels used to for RTMP packets with different purposes (i.e. data, network
  * control, remote procedure calls, etc.)
@@ -151,6 +157,25 @@ int ff_rtmp_packet_write(URLContext *h, RTMPPacket *p,
                          int chunk_size, RTMPPacket **prev_pkt,
                          int *nb_prev_pkt);
 
+/**
+ * Write the chunk headers of an RTMP packet into buffers and update the
+ * history of the sent packets, so that the packet can be sent by the caller.
+ *
+ * @param p              packet to send
+ * @param prev_pkt       previously sent packet headers for all channels
+ *                       (may be used for packet header compressing)
+ * @param nb_prev_pkt    number of allocated elements in prev_pkt
+ * @param hdr            buffer of RTMP_MAX_HEADER_SIZE bytes receiving the
+ *                       header of the first chunk
+ * @param chunk_hdr      buffer of RTMP_MAX_CHUNK_HEADER_SIZE bytes receiving
+ *                       the header of the following chunks
+ * @param chunk_hdr_size set to the size of chunk_hdr
+ * @return size of the header of the first chunk, negative value on error
+ */
+int ff_rtmp_packet_write_header(RTMPPacket *p, RTMPPacket **prev_pkt,
+                                int *nb_prev_pkt, uint8_t *hdr,
+                                uint8_t *chunk_hdr, int *chunk_hdr_size);
+
 /**
  * Print information and contents of RTMP packet.
  *
@@ -93,6 +93,12 @@ typedef struct RTMPContext {
     int           flv_off;                    ///< number of bytes read from current buffer
     int           flv_nb_packets;             ///< number of flv packets published
     RTMPPacket    out_pkt;                    ///< rtmp packet, created from flv a/v or metadata (for output)
+    uint8_t       *out_buf;                   ///< buffer holding the data of out_pkt after room for its header
+    unsigned int  out_buf_size;               ///< allocated size of out_buf
+    uint8_t       *send_queue;                ///< data not sent yet by non-blocking writes
+    unsigned int  send_queue_size;            ///< allocated size of send_queue
+    int           send_queue_len;             ///< number of bytes in send_queue
+    int           tcp;                        ///< the connection is a plain TCP one, non-blocking writes are possible
     uint32_t      client_report_size;         ///< number of bytes after which client should report to server
     uint32_t      bytes_read;                 ///< number of bytes read from server
     uint32_t      last_bytes_read;            ///< number of bytes read last reported to server
@@ -117,6 +123,7 @@ typedef struct RTMPContext {
     int           server_bw;                  ///< server bandwidth
     int           client_buffer_time;         ///< client buffer time in ms
     int           flush_interval;             ///< number of packets flushed in the same request (RTMPT only)
+    int           chunk_size;                 ///< size of the outgoing chunks requested by the user (for output)
     int           encrypted;                  ///< use an encrypted connection (RTMPE only)
     TrackedMethod*tracked_methods;            ///< tracked methods buffer
     int           nb_tracked_methods;         ///< number of tracked methods
@@ -223,6 +230,128 @@ static void free_tracked_methods(RTMPContext *rt)
     rt->nb_tracked_methods   = 0;
 }
 
+/**
+ * Send the data queued by non-blocking writes.
+ *
+ * @param nonblock only write what can be written without blocking
+ * @return 0 once the queue is empty, AVERROR(EAGAIN) if it could not be
+ *         emptied without blocking, another negative value on error
+ */
+static int rtmp_send_queued(RTMPContext *rt, int nonblock)
+{
+    int ret;
+
+    while (rt->send_queue_len) {
+        if (nonblock)
+            rt->stream->flags |= AVIO_FLAG_NONBLOCK;
+        ret = ffurl_write(rt->stream, rt->send_queue, rt->send_queue_len);
+        rt->stream->flags &= ~AVIO_FLAG_NONBLOCK;
+        if (ret < 0)
+            return ret;
+        if (!ret)
+            return AVERROR(EAGAIN);
+        rt->send_queue_len -= ret;
+        memmove(rt->send_queue, rt->send_queue + ret, rt->send_queue_len);
+    }
+    return 0;
+}
+
+/**
+ * Send data to the server, after the data queued before. In non-blocking
+ * mode, what cannot be written right away is queued.
+ *
+ * Non-blocking mode is only usable when the rtmp URLContext is written
+ * directly with ffurl_write(): an AVIOContext on top of it keeps the
+ * AVERROR(EAGAIN) of a write as a permanent error, see writeout().
+ */
+static int rtmp_send(URLContext *s, const uint8_t *buf, int size)
+{
+    RTMPContext *rt = s->priv_data;
+    uint8_t *queue;
+    int ret;
+
+    if (!(s->flags & AVIO_FLAG_NONBLOCK) || !rt->tcp) {
+        if ((ret = rtmp_send_queued(rt, 0)) < 0)
+            return ret;
+        return ffurl_write(rt->stream, buf, size);
+    }
+
+    if (!rt->send_queue_len) {
+        rt->stream->flags |= AVIO_FLAG_NONBLOCK;
+        ret = ffurl_write(rt->stream, buf, size);
+        rt->stream->flags &= ~AVIO_FLAG_NONBLOCK;
+        if (ret < 0 && ret != AVERROR(EAGAIN))
+            return ret;
+        if (ret > 0) {
+            buf  += ret;
+            size -= ret;
+        }
+        if (!size)
+            return 0;
+    }
+
+    queue = av_fast_realloc(rt->send_queue, &rt->send_queue_size,
+                            rt->send_queue_len + size);
+    if (!queue)
+        return AVERROR(ENOMEM);
+    rt->send_queue = queue;
+    memcpy(rt->send_queue + rt->send_queue_len, buf, size);
+    rt->send_queue_len += size;
+    return 0;
+}
+
+/**
+ * Send a packet right away, after the data queued before it.
+ */
+static int rtmp_write_packet(RTMPContext *rt, RTMPPacket *pkt)
+{
+    int ret;
+
+    if ((ret = rtmp_send_queued(rt, 0)) < 0)
+        return ret;
+    return ff_rtmp_packet_write(rt->stream, pkt, rt->out_chunk_size,
+                                &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
+}
+
+/**
+ * Send the packet built from an FLV tag. Each chunk is sent along with its
+ * header in a single write, without copying the packet data: the header of
+ * the first chunk is put in the room left before the data, and the ones of
+ * the following chunks over the end of the previous chunk, already sent.
+ */
+static int rtmp_send_flv_packet(URLContext *s)
+{
+    RTMPContext *rt = s->priv_data;
+    RTMPPacket *pkt = &rt->out_pkt;
+    uint8_t hdr[RTMP_MAX_HEADER_SIZE], chunk_hdr[RTMP_MAX_CHUNK_HEADER_SIZE];
+    int hdr_size, chunk_hdr_size, off = 0;
+    int ret;
+
+    hdr_size = ff_rtmp_packet_write_header(pkt, &rt->prev_pkt[1],
+                                           &rt->nb_prev_pkt[1], hdr,
+                                           chunk_hdr, &chunk_hdr_size);
+    if (hdr_size < 0)
+        return hdr_size;
+
+    do {
+        int towrite = FFMIN(rt->out_chunk_size, pkt->size - off);
+        uint8_t *p;
+
+        if (!off) {
+            p = pkt->data - hdr_size;
+            memcpy(p, hdr, hdr_size);
+        } else {
+            p = pkt->data + off - chunk_hdr_size;
+            memcpy(p, chunk_hdr, chunk_hdr_size);
+        }
+        if ((ret = rtmp_send(s, p, pkt->data + off + towrite - p)) < 0)
+            return ret;
+        off += towrite;
+    } while (off < pkt->size);
+
+    return 0;
+}
+
 static int rtmp_send_packet(RTMPContext *rt, RTMPPacket *pkt, int track)
 {
     int ret;
@@ -244,8 +373,7 @@ static int rtmp_send_packet(RTMPContext *rt, RTMPPacket *pkt, int track)
             goto fail;
     }
 
-    ret = ff_rtmp_packet_write(rt->stream, pkt, rt->out_chunk_size,
-                               &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
+    ret = rtmp_write_packet(rt, pkt);
 fail:
     ff_rtmp_packet_destroy(pkt);
     return ret;
@@ -458,8 +586,7 @@ static int read_connect(URLContext *s, RTMPContext *rt)
     p = pkt.data;
     bytestream_put_be32(&p, rt->server_bw);
     pkt.size = p - pkt.data;
-    ret = ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size,
-                               &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
+    ret = rtmp_write_packet(rt, &pkt);
     ff_rtmp_packet_destroy(&pkt);
     if (ret < 0)
         return ret;
@@ -471,8 +598,7 @@ static int read_connect(URLContext *s, RTMPContext *rt)
     bytestream_put_be32(&p, rt->server_bw);
     bytestream_put_byte(&p, 2); // dynamic
     pkt.size = p - pkt.data;
-    ret = ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size,
-                               &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
+    ret = rtmp_write_packet(rt, &pkt);
     ff_rtmp_packet_destroy(&pkt);
     if (ret < 0)
         return ret;
@@ -485,8 +611,7 @@ static int read_connect(URLContext *s, RTMPContext *rt)
     p = pkt.data;
     bytestream_put_be16(&p, 0); // 0 -> Stream Begin
     bytestream_put_be32(&p, 0);
-    ret = ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size,
-                               &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
+    ret = rtmp_write_packet(rt, &pkt);
     ff_rtmp_packet_destroy(&pkt);
     if (ret < 0)
         return ret;
@@ -498,8 +623,7 @@ static int read_connect(URLContext *s, RTMPContext *rt)
 
     p = pkt.data;
     bytestream_put_be32(&p, rt->out_chunk_size);
-    ret = ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size,
-                               &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
+    ret = rtmp_write_packet(rt, &pkt);
     ff_rtmp_packet_destroy(&pkt);
     if (ret < 0)
         return ret;
@@ -533,8 +657,7 @@ static int read_connect(URLContext *s, RTMPContext *rt)
     ff_amf_write_object_end(&p);
 
     pkt.size = p - pkt.data;
-    ret = ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size,
-                               &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
+    ret = rtmp_write_packet(rt, &pkt);
     ff_rtmp_packet_destroy(&pkt);
     if (ret < 0)
         return ret;
@@ -548,13 +671,37 @@ static int read_connect(URLContext *s, RTMPContext *rt)
     ff_amf_write_null(&p);
     ff_amf_write_number(&p, 8192);
     pkt.size = p - pkt.data;
-    ret = ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size,
-                               &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
+    ret = rtmp_write_packet(rt, &pkt);
     ff_rtmp_packet_destroy(&pkt);
 
     return ret;
 }
 
+/**
+ * Generate a chunk size change and send it to the server, the following
+ * packets are sent in chunks of this size.
+ */
+static int gen_chunk_size(URLContext *s, RTMPContext *rt, int chunk_size)
+{
+    RTMPPacket pkt;
+    uint8_t *p;
+    int ret;
+
+    if ((ret = ff_rtmp_packet_create(&pkt, RTMP_SYSTEM_CHANNEL,
+                                     RTMP_PT_CHUNK_SIZE, 0, 4)) < 0)
+        return ret;
+
+    p = pkt.data;
+    bytestream_put_be32(&p, chunk_size);
+    if ((ret = rtmp_send_packet(rt, &pkt, 0)) < 0)
+        return ret;
+
+    rt->out_chunk_size = chunk_size;
+    av_log(s, AV_LOG_DEBUG, "New outgoing chunk size = %d\n", chunk_size);
+
+    return 0;
+}
+
 /**
  * Generate 'releaseStream' call and send it to the server. It should make
  * the server release some channel for media streams.
@@ -1499,11 +1646,10 @@ static int handle_chunk_size(URLContext *s, RTMPPacket *pkt)
         return AVERROR_INVALIDDATA;
     }
 
-    if (!rt->is_input) {
+    if (!rt->is_input && !rt->chunk_size) {
         /* Send the same chunk size change packet back to the server,
          * setting the outgoing chunk size to the same as the incoming one. */
-        if ((ret = ff_rtmp_packet_write(rt->stream, pkt, rt->out_chunk_size,
-                                        &rt->prev_pkt[1], &rt->nb_prev_pkt[1])) < 0)
+        if ((ret = rtmp_write_packet(rt, pkt)) < 0)
             return ret;
         rt->out_chunk_size = AV_RB32(pkt->data);
     }
@@ -1839,8 +1985,7 @@ static int write_begin(URLContext *s)
     bytestream2_put_be16(&pbc, 0);          // 0 -> Stream Begin
     bytestream2_put_be32(&pbc, rt->nb_streamid);
 
-    ret = ff_rtmp_packet_write(rt->stream, &spkt, rt->out_chunk_size,
-                               &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
+    ret = rtmp_write_packet(rt, &spkt);
 
     ff_rtmp_packet_destroy(&spkt);
 
@@ -1886,8 +2031,7 @@ static int write_status(URLContext *s, RTMPPacket *pkt,
     ff_amf_write_object_end(&pp);
 
     spkt.size = pp - spkt.data;
-    ret = ff_rtmp_packet_write(rt->stream, &spkt, rt->out_chunk_size,
-                               &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
+    ret = rtmp_write_packet(rt, &spkt);
     ff_rtmp_packet_destroy(&spkt);
 
     return ret;
@@ -1987,8 +2131,7 @@ static int send_invoke_response(URLContext *s, RTMPPacket *pkt)
         }
     }
     spkt.size = pp - spkt.data;
-    ret = ff_rtmp_packet_write(rt->stream, &spkt, rt->out_chunk_size,
-                               &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
+    ret = rtmp_write_packet(rt, &spkt);
     ff_rtmp_packet_destroy(&spkt);
     return ret;
 }
@@ -2483,8 +2626,7 @@ static int rtmp_close(URLContext *h)
 
     if (!rt->is_input) {
         rt->flv_data = NULL;
-        if (rt->out_pkt.size)
-            ff_rtmp_packet_destroy(&rt->out_pkt);
+        av_freep(&rt->out_buf);
         if (rt->state > STATE_FCPUBLISH)
             ret = gen_fcunpublish_stream(h, rt);
     }
@@ -2498,6 +2640,7 @@ static int rtmp_close(URLContext *h)
 
     free_tracked_methods(rt);
     av_freep(&rt->flv_data);
+    av_freep(&rt->send_queue);
     ffurl_close(rt->stream);
     return ret;
 }
@@ -2645,6 +2788,7 @@ static int rtmp_open(URLContext *s, const char *uri, int flags)
                         rt->listen_timeout * 1000);
         else
             ff_url_join(buf, sizeof(buf), "tcp", NULL, hostname, port, NULL);
+        rt->tcp = 1;
     }
 
 reconnect:
@@ -2796,7 +2940,13 @@ reconnect:
     if (!rt->listen) {
         if ((ret = gen_connect(s, rt)) < 0)
             goto fail;
+        if (!rt->is_input && rt->chunk_size &&
+            (ret = gen_chunk_size(s, rt, rt->chunk_size)) < 0)
+            goto fail;
     } else {
+        // the chunk size is announced to the client by read_connect()
+        if (!rt->is_input && rt->chunk_size)
+            rt->out_chunk_size = rt->chunk_size;
         if ((ret = read_connect(s, s->priv_data)) < 0)
             goto fail;
     }
@@ -2943,6 +3093,11 @@ static int rtmp_write(URLContext *s, const uint8_t *buf, int size)
     uint8_t c;
     int ret;
 
+    /* in non-blocking mode, take no more data while some is still queued;
+     * the caller must retry the same buffer, as with any URLContext */
+    if ((ret = rtmp_send_queued(rt, s->flags & AVIO_FLAG_NONBLOCK)) < 0)
+        return ret;
+
     do {
         if (rt->skip_bytes) {
             int skip = FFMIN(rt->skip_bytes, size_temp);
@@ -2985,11 +3140,18 @@ static int rtmp_write(URLContext *s, const uint8_t *buf, int size)
                 rt->prev_pkt[1][channel].channel_id = 0;
             }
 
-            //this can be a big packet, it's better to send it right here
+            // leave room for the chunk header and @setDataFrame (see below)
+            av_fast_malloc(&rt->out_buf, &rt->out_buf_size,
+                           RTMP_MAX_HEADER_SIZE + 16 + pktsize);
+            if (!rt->out_buf)
+                return AVERROR(ENOMEM);
             if ((ret = ff_rtmp_packet_create(&rt->out_pkt, channel,
-                                             pkttype, ts, pktsize)) < 0)
+                                             pkttype, ts, 0)) < 0)
                 return ret;
 
+            //this can be a big packet, it's better to send it right here
+            rt->out_pkt.data  = rt->out_buf + RTMP_MAX_HEADER_SIZE;
+            rt->out_pkt.size  = pktsize;
             rt->out_pkt.extra = rt->stream_id;
             rt->flv_data = rt->out_pkt.data;
         }
@@ -3017,10 +3179,6 @@ static int rtmp_write(URLContext *s, const uint8_t *buf, int size)
                     if (!strcmp(commandbuffer, "onMetaData") ||
                         !strcmp(commandbuffer, "|RtmpSampleAccess")) {
                         uint8_t *ptr;
-                        if ((ret = av_reallocp(&rt->out_pkt.data, rt->out_pkt.size + 16)) < 0) {
-                            rt->flv_size = rt->flv_off = rt->flv_header_bytes = 0;
-                            return ret;
-                        }
                         memmove(rt->out_pkt.data + 16, rt->out_pkt.data, rt->out_pkt.size);
                         rt->out_pkt.size += 16;
                         ptr = rt->out_pkt.data;
@@ -3029,7 +3187,7 @@ static int rtmp_write(URLContext *s, const uint8_t *buf, int size)
                 }
             }
 
-            if ((ret = rtmp_send_packet(rt, &rt->out_pkt, 0)) < 0)
+            if ((ret = rtmp_send_flv_packet(s)) < 0)
                 return ret;
             rt->flv_size = 0;
             rt->flv_off = 0;
@@ -3081,6 +3239,7 @@ static int rtmp_write(URLContext *s, const uint8_t *buf, int size)
 static const AVOption rtmp_options[] = {
     {"rtmp_app", "Name of application to connect to on the RTMP server", OFFSET(app), AV_OPT_TYPE_STRING, {.str = NULL }, 0, 0, DEC|ENC},
     {"rtmp_buffer", "Set buffer time in milliseconds. The default is 3000.", OFFSET(client_buffer_time), AV_OPT_TYPE_INT, {.i64 = 3000}, 0, INT_MAX, DEC|ENC},
+    {"rtmp_chunk_size", "Size of the chunks outgoing packets are divided into. 0 follows the chunk size of the server.", OFFSET(chunk_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 0xFFFFFF, ENC},
     {"rtmp_conn", "Append arbitrary AMF data to the Connect message", OFFSET(conn), AV_OPT_TYPE_STRING, {.str = NULL }, 0, 0, DEC|ENC},
     {"rtmp_flashver", "Version of the Flash plugin used to run the SWF player.", OFFSET(flashver), AV_OPT_TYPE_STRING, {.str = NULL }, 0, 0, DEC|ENC},
     {"rtmp_flush_interval", "Number of packets flushed in the same request (RTMPT only).", OFFSET(flush_interval), AV_OPT_TYPE_INT, {.i64 = 10}, 0, INT_MAX, ENC},
@@ -97,6 +97,8 @@ typedef struct SegmentContext {
     int64_t time;          ///< segment duration
     int use_strftime;      ///< flag to expand filename with strftime
     int increment_tc;      ///< flag to increment timecode if found
+    int async_write;       ///< write and close segments from a background thread
+    FFFileCloseGroup *close_group; ///< segments being closed by their writer
 
     char *times_str;       ///< segment times specification string
     int64_t *times;        ///< list of segment interval specification
@@ -226,6 +228,23 @@ static int set_segment_filename(AVFormatContext *s)
     return 0;
 }
 
+static int segment_io_open(AVFormatContext *s, AVIOContext **pb, const char *url)
+{
+    SegmentContext *seg = s->priv_data;
+    AVDictionary *options = NULL;
+    int ret;
+
+    if (seg->async_write)
+        av_dict_set(&options, "async_write", "1", 0);
+    ret = s->io_open(s, pb, url, AVIO_FLAG_WRITE, &options);
+    av_dict_free(&options);
+#if CONFIG_FILE_PROTOCOL
+    if (ret >= 0 && seg->close_group)
+        ff_file_set_close_group(*pb, seg->close_group);
+#endif
+    return ret;
+}
+
 static int segment_start(AVFormatContext *s, int write_header)
 {
     SegmentContext *seg = s->priv_data;
@@ -247,7 +266,7 @@ static int segment_start(AVFormatContext *s, int write_header)
     if ((err = set_segment_filename(s)) < 0)
         return err;
 
-    if ((err = s->io_open(s, &oc->pb, oc->filename, AVIO_FLAG_WRITE, NULL)) < 0) {
+    if ((err = segment_io_open(s, &oc->pb, oc->filename)) < 0) {
         av_log(s, AV_LOG_ERROR, "Failed to open segment '%s'\n", oc->filename);
         return err;
     }
@@ -360,6 +379,20 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
         av_log(s, AV_LOG_ERROR, "Failure occurred when ending segment '%s'\n",
                oc->filename);
 
+    /* close the segment before it is listed */
+    ff_format_io_close(oc, &oc->pb);
+
+#if CONFIG_FILE_PROTOCOL
+    if (seg->close_group && (seg->list || is_last)) {
+        err = ff_file_close_group_wait(seg->close_group);
+        if (err < 0) {
+            av_log(s, AV_LOG_ERROR, "Failure occurred when writing segments\n");
+            /* do not list a segment which may be incomplete */
+            return ret < 0 ? ret : err;
+        }
+    }
+#endif
+
     if (seg->list) {
         if (seg->list_size || seg->list_type == LIST_TYPE_M3U8) {
             SegmentListEntry *entry = av_mallocz(sizeof(*entry));
@@ -658,6 +691,11 @@ static int seg_init(AVFormatContext *s)
         return AVERROR(EINVAL);
     }
 
+#if CONFIG_FILE_PROTOCOL
+    if (seg->async_write && !(seg->close_group = ff_file_close_group_alloc()))
+        return AVERROR(ENOMEM);
+#endif
+
     if (seg->times_str) {
         if ((ret = parse_times(s, &seg->times, &seg->nb_times, seg->times_str)) < 0)
             return ret;
@@ -739,9 +777,8 @@ static int seg_init(AVFormatContext *s)
     oc = seg->avf;
 
     if (seg->write_header_trailer) {
-        if ((ret = s->io_open(s, &oc->pb,
-                              seg->header_filename ? seg->header_filename : oc->filename,
-                              AVIO_FLAG_WRITE, NULL)) < 0) {
+        if ((ret = segment_io_open(s, &oc->pb,
+                                   seg->header_filename ? seg->header_filename : oc->filename)) < 0) {
             av_log(s, AV_LOG_ERROR, "Failed to open segment '%s'\n", oc->filename);
             goto fail;
         }
@@ -784,7 +821,7 @@ static int seg_init(AVFormatContext *s)
         } else {
             close_null_ctxp(&oc->pb);
         }
-        if ((ret = oc->io_open(oc, &oc->pb, oc->filename, AVIO_FLAG_WRITE, NULL)) < 0)
+        if ((ret = segment_io_open(s, &oc->pb, oc->filename)) < 0)
             goto fail;
         if (!seg->individual_header_trailer)
             oc->pb->seekable = 0;
@@ -957,6 +994,14 @@ fail:
     return ret;
 }
 
+static void seg_deinit(AVFormatContext *s)
+{
+#if CONFIG_FILE_PROTOCOL
+    SegmentContext *seg = s->priv_data;
+    ff_file_close_group_free(&seg->close_group);
+#endif
+}
+
 static int seg_check_bitstream(struct AVFormatContext *s, const AVPacket *pkt)
 {
     SegmentContext *seg = s->priv_data;
@@ -1017,6 +1062,7 @@ static const AVOption options[] = {
     { "reset_timestamps", "reset timestamps at the begin of each segment", OFFSET(reset_timestamps), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E },
     { "initial_offset", "set initial timestamp offset", OFFSET(initial_offset), AV_OPT_TYPE_DURATION, {.i64 = 0}, -INT64_MAX, INT64_MAX, E },
     { "write_empty_segments", "allow writing empty 'filler' segments", OFFSET(write_empty), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E },
+    { "segment_async_write", "write and close segment files from a background thread", OFFSET(async_write), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E },
     { NULL },
 };
 
@@ -1035,6 +1081,7 @@ AVOutputFormat ff_segment_muxer = {
     .init           = seg_init,
     .write_packet   = seg_write_packet,
     .write_trailer  = seg_write_trailer,
+    .deinit         = seg_deinit,
     .check_bitstream = seg_check_bitstream,
     .priv_class     = &seg_class,
 };
@@ -1054,6 +1101,7 @@ AVOutputFormat ff_stream_segment_muxer = {
     .init           = seg_init,
     .write_packet   = seg_write_packet,
     .write_trailer  = seg_write_trailer,
+    .deinit         = seg_deinit,
     .check_bitstream = seg_check_bitstream,
     .priv_class     = &sseg_class,
 };
@@ -274,6 +274,21 @@ int av_append_packet(AVIOContext *s, AVPacket *pkt, int size)
     return append_packet_chunked(s, pkt, size);
 }
 
+int ff_get_packet_ref(AVIOContext *s, AVPacket *pkt, int size)
+{
+    int64_t pos = avio_tell(s);
+    int ret;
+
+    av_init_packet(pkt);
+    ret = ffio_read_refcounted(s, &pkt->buf, &pkt->data, size);
+    if (ret <= 0)
+        return ret < 0 ? ret : av_get_packet(s, pkt, size);
+
+    pkt->size = size;
+    pkt->pos  = pos;
+    return size;
+}
+
 int av_filename_number_test(const char *filename)
 {
     char buf[1024];
@@ -1404,6 +1419,19 @@ static int parse_packet(AVFormatContext *s, AVPacket *pkt, int stream_index)
 
         compute_pkt_fields(s, st, st->parser, &out_pkt, next_dts, next_pts);
 
+        /* reference the input instead of copying it when the parser output
+         * the end of it, so that the padding is the one of the input,
+         * out_pkt.data may point to the parser's own buffer otherwise */
+        if (pkt->buf && out_pkt.data >= pkt->data &&
+            out_pkt.data + out_pkt.size == pkt->data + pkt->size) {
+            out_pkt.buf = av_buffer_ref(pkt->buf);
+            if (!out_pkt.buf) {
+                av_packet_unref(&out_pkt);
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+        }
+
         ret = add_to_pktbuf(&s->internal->parse_queue, &out_pkt,
                             &s->internal->parse_queue_end, 1);
         av_packet_unref(&out_pkt);
@@ -3999,6 +4027,11 @@ void avformat_free_context(AVFormatContext *s)
     if (!s)
         return;
 
+    if (s->internal) {
+        ff_mux_thread_stop(s);
+        av_freep(&s->internal->mux_thread);
+    }
+
     av_opt_free(s);
     if (s->iformat && s->iformat->priv_class && s->priv_data)
         av_opt_free(s->priv_data);
@@ -750,6 +750,8 @@ const char *av_frame_side_data_name(enum AVFrameSideDataType type)
     case AV_FRAME_DATA_AUDIO_SERVICE_TYPE:          return "Audio service type";
     case AV_FRAME_DATA_MASTERING_DISPLAY_METADATA:  return "Mastering display metadata";
     case AV_FRAME_DATA_GOP_TIMECODE:                return "GOP timecode";
+    case AV_FRAME_DATA_LATENCY:                     return "Latency record";
+    case AV_FRAME_DATA_SCENE_SCORE:                 return "Scene score";
     }
     return NULL;
 }
@@ -120,7 +120,18 @@ enum AVFrameSideDataType {
      * The GOP timecode in 25 bit timecode format. Data format is 64-bit integer.
      * This is set on the first frame of a GOP that has a temporal reference of 0.
      */
-    AV_FRAME_DATA_GOP_TIMECODE
+    AV_FRAME_DATA_GOP_TIMECODE,
+    /**
+     * Timestamps of the processing stages the frame went through. The payload
+     * is an AVLatencyRecord, see libavutil/latency.h.
+     */
+    AV_FRAME_DATA_LATENCY,
+
+    /**
+     * Scene change score of the frame against the previous frame. The payload
+     * is an AVSceneScore, see libavutil/scene_score.h.
+     */
+    AV_FRAME_DATA_SCENE_SCORE,
 };
 
 enum AVActiveFormatDescription {
@@ -0,0 +1,62 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "frame.h"
+#include "latency.h"
+#include "mem.h"
+
+AVLatencyRecord *av_latency_record_alloc(size_t *size)
+{
+    AVLatencyRecord *rec = av_mallocz(sizeof(AVLatencyRecord));
+
+    if (rec && size)
+        *size = sizeof(*rec);
+
+    return rec;
+}
+
+AVLatencyRecord *av_latency_record_create_side_data(AVFrame *frame)
+{
+    AVFrameSideData *side_data = av_frame_new_side_data(frame,
+                                                        AV_FRAME_DATA_LATENCY,
+                                                        sizeof(AVLatencyRecord));
+    if (!side_data)
+        return NULL;
+
+    memset(side_data->data, 0, sizeof(AVLatencyRecord));
+
+    return (AVLatencyRecord *)side_data->data;
+}
+
+AVLatencyRecord *av_latency_record_get_writable(AVFrame *frame)
+{
+    AVFrameSideData *side_data = av_frame_get_side_data(frame, AV_FRAME_DATA_LATENCY);
+
+    if (!side_data || side_data->size < sizeof(AVLatencyRecord))
+        return NULL;
+
+    if (av_buffer_make_writable(&side_data->buf) < 0)
+        return NULL;
+    side_data->data = side_data->buf->data;
+
+    return (AVLatencyRecord *)side_data->data;
+}
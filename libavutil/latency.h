@@ -0,0 +1,108 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_LATENCY_H
+#define AVUTIL_LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame.h"
+
+/**
+ * Maximum number of filters a latency record can track.
+ */
+#define AV_LATENCY_MAX_FILTERS 16
+
+/**
+ * Processing stages recorded in an AVLatencyRecord.
+ */
+enum AVLatencyStage {
+    AV_LATENCY_STAGE_DEMUX,         ///< packet returned by the demuxer
+    AV_LATENCY_STAGE_DECODER_IN,    ///< packet sent to the decoder
+    AV_LATENCY_STAGE_DECODER_OUT,   ///< frame returned by the decoder
+    AV_LATENCY_STAGE_ENCODER_IN,    ///< frame sent to the encoder
+    AV_LATENCY_STAGE_ENCODER_OUT,   ///< packet returned by the encoder
+    AV_LATENCY_STAGE_MUX,           ///< packet sent to the muxer
+    AV_LATENCY_STAGE_NB
+};
+
+/**
+ * Monotonic timestamps of the processing stages a packet or frame went
+ * through, used to measure queueing and processing latency of a pipeline.
+ *
+ * All times are in microseconds as returned by av_gettime_relative(), a
+ * value of 0 means the stage was not reached. The record is carried from
+ * packets to frames and back by the libraries and the caller, and
+ * libavfilter appends an entry to filter_in every time the frame enters a
+ * filter.
+ *
+ * To be used as payload of a AVFrameSideData or AVPacketSideData with the
+ * appropriate type.
+ *
+ * @note The struct should be allocated with av_latency_record_alloc()
+ *       and its size is not a part of the public ABI.
+ */
+typedef struct AVLatencyRecord {
+    /**
+     * Time each stage was reached.
+     */
+    int64_t stage[AV_LATENCY_STAGE_NB];
+
+    /**
+     * Time the frame entered each filter, in the order the filters were
+     * traversed. A filter has finished with the frame when the next entry
+     * was recorded.
+     */
+    int64_t filter_in[AV_LATENCY_MAX_FILTERS];
+
+    /**
+     * Number of valid entries in filter_in.
+     */
+    int nb_filters;
+} AVLatencyRecord;
+
+/**
+ * Allocate an AVLatencyRecord with all stages unset.
+ *
+ * @param size if non-NULL, the size of the allocated struct is stored here
+ *
+ * @return the newly allocated struct, to be freed with av_freep(), or NULL
+ *         on failure
+ */
+AVLatencyRecord *av_latency_record_alloc(size_t *size);
+
+/**
+ * Allocate an AVLatencyRecord with all stages unset and add it to the frame.
+ *
+ * @param frame The frame which side data is added to.
+ *
+ * @return The AVLatencyRecord structure to be filled by caller.
+ */
+AVLatencyRecord *av_latency_record_create_side_data(AVFrame *frame);
+
+/**
+ * Get the latency record of a frame, so that it can be updated without
+ * affecting other references to the same side data.
+ *
+ * @return the record, or NULL if the frame does not carry one or on
+ *         allocation failure
+ */
+AVLatencyRecord *av_latency_record_get_writable(AVFrame *frame);
+
+#endif /* AVUTIL_LATENCY_H */
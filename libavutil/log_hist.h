@@ -0,0 +1,93 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Fixed size histogram of durations, with one bin per value below 8 and
+ * 4 logarithmic bins per octave above, so that percentiles are accurate to
+ * 25% whatever the range of the values.
+ */
+
+#ifndef AVUTIL_LOG_HIST_H
+#define AVUTIL_LOG_HIST_H
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "common.h"
+
+#define FF_LOG_HIST_BINS 120
+
+typedef struct FFLogHistogram {
+    uint64_t count;
+    int64_t  max;
+    uint64_t bins[FF_LOG_HIST_BINS];
+} FFLogHistogram;
+
+/**
+ * Count a value, negative values are counted as 0.
+ */
+static inline void ff_log_hist_add(FFLogHistogram *h, int64_t v)
+{
+    int bin;
+
+    v = av_clip64(v, 0, INT_MAX);
+    if (v < 8) {
+        bin = v;
+    } else {
+        int l = av_log2(v);
+        bin = FFMIN(8 + (l - 3) * 4 + ((v >> (l - 2)) & 3), FF_LOG_HIST_BINS - 1);
+    }
+    h->bins[bin]++;
+    h->count++;
+    h->max = FFMAX(h->max, v);
+}
+
+/**
+ * @return the largest value counted in the bin
+ */
+static inline int64_t ff_log_hist_bin_value(int bin)
+{
+    int l;
+
+    if (bin < 8)
+        return bin;
+    l = (bin - 8) / 4 + 3;
+    return ((int64_t)(5 + ((bin - 8) & 3)) << (l - 2)) - 1;
+}
+
+/**
+ * @param p fraction of the values, between 0 and 1
+ * @return an upper bound of the p-quantile of the counted values, never
+ *         more than the maximum value, 0 for an empty histogram
+ */
+static inline int64_t ff_log_hist_percentile(const FFLogHistogram *h, double p)
+{
+    uint64_t target = FFMAX(ceil(h->count * p), 1), acc = 0;
+    int i;
+
+    for (i = 0; i < FF_LOG_HIST_BINS; i++) {
+        acc += h->bins[i];
+        if (acc >= target)
+            return FFMIN(ff_log_hist_bin_value(i), h->max);
+    }
+    return h->max;
+}
+
+#endif /* AVUTIL_LOG_HIST_H */
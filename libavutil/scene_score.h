@@ -0,0 +1,65 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_SCENE_SCORE_H
+#define AVUTIL_SCENE_SCORE_H
+
+#include "frame.h"
+
+/**
+ * Scene change analysis of a video frame against the previous frame of the
+ * same stream, as computed by the scdet filter.
+ *
+ * To be used as payload of a AVFrameSideData with type
+ * AV_FRAME_DATA_SCENE_SCORE.
+ *
+ * @note The struct should be allocated with
+ *       av_scene_score_create_side_data() and its size is not a part of
+ *       the public ABI.
+ */
+typedef struct AVSceneScore {
+    /**
+     * Scene change score, between 0 (same scene) and 1 (new scene).
+     * This is the value of the scene variable of the select filter.
+     */
+    double score;
+
+    /**
+     * Mean absolute difference of the pixels of the analysed plane
+     * with the previous frame.
+     */
+    double mafd;
+
+    /**
+     * Difference of the histograms of the analysed plane with the previous
+     * frame, between 0 (same histograms) and 1 (disjoint histograms).
+     */
+    double hist_diff;
+} AVSceneScore;
+
+/**
+ * Allocate an AVSceneScore with all fields set to 0 and add it to the frame.
+ * An existing scene score of the frame is replaced.
+ *
+ * @param frame The frame which side data is added to.
+ *
+ * @return The AVSceneScore structure to be filled by caller.
+ */
+AVSceneScore *av_scene_score_create_side_data(AVFrame *frame);
+
+#endif /* AVUTIL_SCENE_SCORE_H */
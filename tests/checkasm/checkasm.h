@@ -38,7 +38,12 @@ void checkasm_check_flacdsp(void);
 void checkasm_check_fmtconvert(void);
 void checkasm_check_h264pred(void);
 void checkasm_check_h264qpel(void);
+void checkasm_check_hevc_add_res(void);
+void checkasm_check_hevc_idct(void);
+void checkasm_check_hevc_pel(void);
+void checkasm_check_hevc_sao(void);
 void checkasm_check_jpeg2000dsp(void);
+void checkasm_check_opusdsp(void);
 void checkasm_check_pixblockdsp(void);
 void checkasm_check_synth_filter(void);
 void checkasm_check_v210enc(void);
@@ -0,0 +1,262 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/intreadwrite.h"
+#include "libavutil/internal.h"
+#include "libavcodec/hevcdsp.h"
+
+#include "checkasm.h"
+
+static const uint32_t pixel_mask[3] = { 0xffffffff, 0x03ff03ff, 0x0fff0fff };
+static const int sizes[10] = { 2, 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+static const char *const pel_names[2][2] = { { "pixels", "h" }, { "v", "hv" } };
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define SRC_STRIDE (2 * MAX_PB_SIZE + 64)                       // bytes, room for the 8-tap filter borders
+#define SRC_OFFSET (3 * SRC_STRIDE + 32)                        // 3 rows and more than 3 pixels of top/left border
+#define SRC_BUF_SIZE (SRC_STRIDE * (MAX_PB_SIZE + 8))
+#define DST_STRIDE (2 * MAX_PB_SIZE)                            // bytes, enough for 64 pixels at 16 bits
+#define DST_BUF_SIZE (DST_STRIDE * MAX_PB_SIZE)
+
+#define randomize_pixels(buf, size)                       \
+    do {                                                  \
+        uint32_t mask = pixel_mask[(bit_depth - 8) >> 1]; \
+        int k;                                            \
+        for (k = 0; k < size; k += 4) {                   \
+            uint32_t r = rnd() & mask;                    \
+            AV_WN32A(buf + k, r);                         \
+        }                                                 \
+    } while (0)
+
+/* intermediate samples have 14-bit precision */
+#define randomize_intermediate(buf, size)                 \
+    do {                                                  \
+        int k;                                            \
+        for (k = 0; k < size; k++) {                      \
+            int16_t r = rnd();                            \
+            buf[k] = r >> 2;                              \
+        }                                                 \
+    } while (0)
+
+static int check_rows(const uint8_t *dst0, const uint8_t *dst1, ptrdiff_t stride,
+                      int row_size, int height)
+{
+    int y;
+
+    for (y = 0; y < height; y++)
+        if (memcmp(dst0 + y * stride, dst1 + y * stride, row_size))
+            return 1;
+    return 0;
+}
+
+static void get_mv(int type, int my, int mx, intptr_t *mvy, intptr_t *mvx)
+{
+    /* qpel has 3 fractional positions, epel 7 */
+    int max = type ? 7 : 3;
+
+    *mvx = mx ? 1 + rnd() % max : 0;
+    *mvy = my ? 1 + rnd() % max : 0;
+}
+
+#define PEL_LOOP(table_name)                                                        \
+    for (type = 0; type < 2; type++)                                                \
+        for (i = 0; i < 10; i++)                                                    \
+            for (j = 0; j < 2; j++)                                                 \
+                for (k = 0; k < 2; k++)                                             \
+                    if (check_func(type ? h->put_hevc_epel##table_name[i][j][k]     \
+                                        : h->put_hevc_qpel##table_name[i][j][k],    \
+                                   "put_hevc_%s%s_%s%d_%d", type ? "epel" : "qpel", \
+                                   #table_name, pel_names[j][k], sizes[i], bit_depth))
+
+static void check_put_hevc_pel(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, src, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, dst0, [MAX_PB_SIZE * MAX_PB_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, dst1, [MAX_PB_SIZE * MAX_PB_SIZE]);
+    int type, i, j, k;
+
+    declare_func(void, int16_t *dst, uint8_t *src, ptrdiff_t srcstride,
+                 int height, intptr_t mx, intptr_t my, int width);
+
+    PEL_LOOP() {
+        int size = sizes[i];
+        intptr_t mx, my;
+
+        get_mv(type, j, k, &my, &mx);
+        randomize_pixels(src, SRC_BUF_SIZE);
+        memset(dst0, 0, MAX_PB_SIZE * MAX_PB_SIZE * sizeof(*dst0));
+        memset(dst1, 0, MAX_PB_SIZE * MAX_PB_SIZE * sizeof(*dst1));
+
+        call_ref(dst0, src + SRC_OFFSET, SRC_STRIDE, size, mx, my, size);
+        call_new(dst1, src + SRC_OFFSET, SRC_STRIDE, size, mx, my, size);
+        if (check_rows((uint8_t *)dst0, (uint8_t *)dst1, MAX_PB_SIZE * sizeof(*dst0),
+                       size * sizeof(*dst0), size))
+            fail();
+        bench_new(dst1, src + SRC_OFFSET, SRC_STRIDE, size, mx, my, size);
+    }
+}
+
+static void check_put_hevc_pel_uni(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, src, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    int type, i, j, k;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dststride, uint8_t *src, ptrdiff_t srcstride,
+                 int height, intptr_t mx, intptr_t my, int width);
+
+    PEL_LOOP(_uni) {
+        int size = sizes[i];
+        intptr_t mx, my;
+
+        get_mv(type, j, k, &my, &mx);
+        randomize_pixels(src, SRC_BUF_SIZE);
+        memset(dst0, 0, DST_BUF_SIZE);
+        memset(dst1, 0, DST_BUF_SIZE);
+
+        call_ref(dst0, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, size, mx, my, size);
+        call_new(dst1, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, size, mx, my, size);
+        if (check_rows(dst0, dst1, DST_STRIDE, size * SIZEOF_PIXEL, size))
+            fail();
+        bench_new(dst1, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, size, mx, my, size);
+    }
+}
+
+static void check_put_hevc_pel_uni_w(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, src, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    int type, i, j, k;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dststride, uint8_t *src, ptrdiff_t srcstride,
+                 int height, int denom, int wx, int ox, intptr_t mx, intptr_t my, int width);
+
+    PEL_LOOP(_uni_w) {
+        int size  = sizes[i];
+        int denom = rnd() % 8;
+        int wx    = (1 << denom) + (int)(rnd() % 256) - 128;
+        int ox    = (int)(rnd() % 256) - 128;
+        intptr_t mx, my;
+
+        get_mv(type, j, k, &my, &mx);
+        randomize_pixels(src, SRC_BUF_SIZE);
+        memset(dst0, 0, DST_BUF_SIZE);
+        memset(dst1, 0, DST_BUF_SIZE);
+
+        call_ref(dst0, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, size, denom, wx, ox, mx, my, size);
+        call_new(dst1, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, size, denom, wx, ox, mx, my, size);
+        if (check_rows(dst0, dst1, DST_STRIDE, size * SIZEOF_PIXEL, size))
+            fail();
+        bench_new(dst1, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, size, denom, wx, ox, mx, my, size);
+    }
+}
+
+static void check_put_hevc_pel_bi(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, src, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, src2, [MAX_PB_SIZE * MAX_PB_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    int type, i, j, k;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dststride, uint8_t *src, ptrdiff_t srcstride,
+                 int16_t *src2, int height, intptr_t mx, intptr_t my, int width);
+
+    PEL_LOOP(_bi) {
+        int size = sizes[i];
+        intptr_t mx, my;
+
+        get_mv(type, j, k, &my, &mx);
+        randomize_pixels(src, SRC_BUF_SIZE);
+        randomize_intermediate(src2, MAX_PB_SIZE * MAX_PB_SIZE);
+        memset(dst0, 0, DST_BUF_SIZE);
+        memset(dst1, 0, DST_BUF_SIZE);
+
+        call_ref(dst0, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, src2, size, mx, my, size);
+        call_new(dst1, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, src2, size, mx, my, size);
+        if (check_rows(dst0, dst1, DST_STRIDE, size * SIZEOF_PIXEL, size))
+            fail();
+        bench_new(dst1, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, src2, size, mx, my, size);
+    }
+}
+
+static void check_put_hevc_pel_bi_w(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, src, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, src2, [MAX_PB_SIZE * MAX_PB_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    int type, i, j, k;
+
+    /* the epel and qpel variants differ only in the order of the weight and
+     * offset arguments, the types are the same */
+    declare_func(void, uint8_t *dst, ptrdiff_t dststride, uint8_t *src, ptrdiff_t srcstride,
+                 int16_t *src2, int height, int denom, int w0, int w1, int o0, int o1,
+                 intptr_t mx, intptr_t my, int width);
+
+    PEL_LOOP(_bi_w) {
+        int size  = sizes[i];
+        int denom = rnd() % 8;
+        int wx0   = (1 << denom) + (int)(rnd() % 256) - 128;
+        int wx1   = (1 << denom) + (int)(rnd() % 256) - 128;
+        int ox0   = (int)(rnd() % 256) - 128;
+        int ox1   = (int)(rnd() % 256) - 128;
+        int w1    = type ? ox0 : wx1;
+        int o0    = type ? wx1 : ox0;
+        intptr_t mx, my;
+
+        get_mv(type, j, k, &my, &mx);
+        randomize_pixels(src, SRC_BUF_SIZE);
+        randomize_intermediate(src2, MAX_PB_SIZE * MAX_PB_SIZE);
+        memset(dst0, 0, DST_BUF_SIZE);
+        memset(dst1, 0, DST_BUF_SIZE);
+
+        call_ref(dst0, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, src2, size,
+                 denom, wx0, w1, o0, ox1, mx, my, size);
+        call_new(dst1, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, src2, size,
+                 denom, wx0, w1, o0, ox1, mx, my, size);
+        if (check_rows(dst0, dst1, DST_STRIDE, size * SIZEOF_PIXEL, size))
+            fail();
+        bench_new(dst1, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, src2, size,
+                  denom, wx0, w1, o0, ox1, mx, my, size);
+    }
+}
+
+void checkasm_check_hevc_pel(void)
+{
+    static void (*const tests[])(HEVCDSPContext *h, int bit_depth) = {
+        check_put_hevc_pel, check_put_hevc_pel_uni, check_put_hevc_pel_uni_w,
+        check_put_hevc_pel_bi, check_put_hevc_pel_bi_w,
+    };
+    static const char *const names[] = { "pel", "pel_uni", "pel_uni_w", "pel_bi", "pel_bi_w" };
+    int bit_depth, t;
+
+    for (t = 0; t < FF_ARRAY_ELEMS(tests); t++) {
+        for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+            HEVCDSPContext h;
+
+            ff_hevc_dsp_init(&h, bit_depth);
+            tests[t](&h, bit_depth);
+        }
+        report("%s", names[t]);
+    }
+}
@@ -0,0 +1,225 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+#include "libavcodec/opusdsp.h"
+
+#include "checkasm.h"
+
+#define HISTORY 1040
+#define BUF_SIZE 960
+
+#define randomize_float(buf, len)                               \
+    do {                                                        \
+        int i;                                                  \
+        for (i = 0; i < len; i++) {                             \
+            float f = (float)rnd() / (UINT_MAX >> 1) - 1.0f;    \
+            buf[i] = f;                                         \
+        }                                                       \
+    } while (0)
+
+/* the SIMD versions may sum in a different order, allow an error relative
+ * to the peak level of the output */
+#define EPS 1e-5f
+
+static float peak_level(const float *a, int len)
+{
+    float peak = 0.0f;
+    int i;
+
+    for (i = 0; i < len; i++)
+        peak = FFMAX(peak, fabsf(a[i]));
+    return peak;
+}
+
+static int float_near_rel_array(const float *a, const float *b, float eps,
+                                int len)
+{
+    float peak = peak_level(a, len);
+    int i;
+
+    for (i = 0; i < len; i++)
+        if (fabsf(a[i] - b[i]) > eps * peak)
+            return 0;
+    return 1;
+}
+
+static void check_postfilter(void)
+{
+    LOCAL_ALIGNED(32, float, data0, [HISTORY + BUF_SIZE]);
+    LOCAL_ALIGNED(32, float, data1, [HISTORY + BUF_SIZE]);
+    /* the CELT gain tapsets, see parse_postfilter() */
+    static const float taps[3][3] = {
+        { 0.3066406250f, 0.2170410156f, 0.1296386719f },
+        { 0.4638671875f, 0.2680664062f, 0.0           },
+        { 0.7998046875f, 0.1000976562f, 0.0           }
+    };
+    OpusDSP odsp;
+    float gains[3];
+
+    declare_func(void, float *data, int period, const float *gains, int len);
+
+    ff_opus_dsp_init(&odsp);
+
+    if (check_func(odsp.postfilter, "postfilter")) {
+        /* periods of 15 to 1022, as coded in the bitstream */
+        int period = 15 + rnd() % (1022 - 15 + 1);
+        int len    = 4 * (1 + rnd() % (BUF_SIZE / 4));
+        int tapset = rnd() % 3;
+        float gain = 0.09375f * (1 + rnd() % 8);
+        int i;
+
+        randomize_float(data0, HISTORY + BUF_SIZE);
+        memcpy(data1, data0, (HISTORY + BUF_SIZE) * sizeof(float));
+        for (i = 0; i < 3; i++)
+            gains[i] = gain * taps[tapset][i];
+
+        call_ref(data0 + HISTORY, period, gains, len);
+        call_new(data1 + HISTORY, period, gains, len);
+
+        if (!float_near_rel_array(data0 + HISTORY, data1 + HISTORY, EPS, len))
+            fail();
+        bench_new(data1 + HISTORY, period, gains, BUF_SIZE);
+    }
+
+    report("postfilter");
+}
+
+static void check_deemphasis(void)
+{
+    LOCAL_ALIGNED(32, float, src,  [BUF_SIZE]);
+    LOCAL_ALIGNED(32, float, dst0, [BUF_SIZE]);
+    LOCAL_ALIGNED(32, float, dst1, [BUF_SIZE]);
+    OpusDSP odsp;
+    float coeff0, coeff1;
+
+    declare_func(float, float *out, const float *in, float coeff, int len);
+
+    ff_opus_dsp_init(&odsp);
+
+    if (check_func(odsp.deemphasis, "deemphasis")) {
+        /* the input is not yet scaled to [-1, 1] */
+        float coeff = ((float)rnd() / (UINT_MAX >> 1) - 1.0f) * 32768;
+        int i;
+
+        randomize_float(src, BUF_SIZE);
+        for (i = 0; i < BUF_SIZE; i++)
+            src[i] *= 32768;
+
+        coeff0 = call_ref(dst0, src, coeff, BUF_SIZE);
+        coeff1 = call_new(dst1, src, coeff, BUF_SIZE);
+
+        /* the returned state is on the scale of the input */
+        if (!float_near_abs_eps(coeff0, coeff1, EPS * 32768 * peak_level(dst0, BUF_SIZE)) ||
+            !float_near_rel_array(dst0, dst1, EPS, BUF_SIZE))
+            fail();
+        bench_new(dst1, src, coeff, BUF_SIZE);
+    }
+
+    report("deemphasis");
+}
+
+#define SILK_HISTORY 322
+#define SILK_SF_SIZE 80
+
+static void check_ltp_synthesis(void)
+{
+    LOCAL_ALIGNED(32, float, buf0, [SILK_HISTORY + SILK_SF_SIZE]);
+    LOCAL_ALIGNED(32, float, buf1, [SILK_HISTORY + SILK_SF_SIZE]);
+    OpusDSP odsp;
+    float taps[5];
+
+    declare_func(void, float *buf, const float *taps, int lag, int len);
+
+    ff_opus_dsp_init(&odsp);
+
+    if (check_func(odsp.ltp_synthesis, "silk_ltp_synthesis")) {
+        /* pitch lags of 2 to 18 ms, at 8 to 16 kHz */
+        int lag = 16 + rnd() % (SILK_HISTORY - 2 - 16);
+
+        randomize_float(buf0, SILK_HISTORY + SILK_SF_SIZE);
+        memcpy(buf1, buf0, (SILK_HISTORY + SILK_SF_SIZE) * sizeof(float));
+        randomize_float(taps, 5);
+
+        call_ref(buf0 + SILK_HISTORY, taps, lag, SILK_SF_SIZE);
+        call_new(buf1 + SILK_HISTORY, taps, lag, SILK_SF_SIZE);
+
+        if (!float_near_rel_array(buf0 + SILK_HISTORY, buf1 + SILK_HISTORY,
+                                  EPS, SILK_SF_SIZE))
+            fail();
+        bench_new(buf1 + SILK_HISTORY, taps, lag, SILK_SF_SIZE);
+    }
+
+    report("silk_ltp_synthesis");
+}
+
+static void check_lpc_synthesis(void)
+{
+    LOCAL_ALIGNED(32, float, lpc0, [16 + SILK_SF_SIZE]);
+    LOCAL_ALIGNED(32, float, lpc1, [16 + SILK_SF_SIZE]);
+    LOCAL_ALIGNED(32, float, dst0, [SILK_SF_SIZE]);
+    LOCAL_ALIGNED(32, float, dst1, [SILK_SF_SIZE]);
+    LOCAL_ALIGNED(32, float, res,  [SILK_SF_SIZE]);
+    OpusDSP odsp;
+    float coeffs[16];
+    static const int orders[2] = { 10, 16 };
+    int i, j;
+
+    declare_func(void, float *dst, float *lpc, const float *res, float gain,
+                 const float *coeffs, int order, int len);
+
+    ff_opus_dsp_init(&odsp);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(orders); i++) {
+        int order = orders[i];
+
+        if (check_func(odsp.lpc_synthesis, "silk_lpc_synthesis_%d", order)) {
+            float gain = (float)rnd() / UINT_MAX;
+
+            randomize_float(lpc0, 16 + SILK_SF_SIZE);
+            memcpy(lpc1, lpc0, (16 + SILK_SF_SIZE) * sizeof(float));
+            randomize_float(res, SILK_SF_SIZE);
+            /* keep the filter stable */
+            for (j = 0; j < order; j++)
+                coeffs[j] = ((float)rnd() / (UINT_MAX >> 1) - 1.0f) / order;
+
+            call_ref(dst0, lpc0 + 16, res, gain, coeffs, order, SILK_SF_SIZE);
+            call_new(dst1, lpc1 + 16, res, gain, coeffs, order, SILK_SF_SIZE);
+
+            if (!float_near_rel_array(dst0, dst1, EPS, SILK_SF_SIZE) ||
+                !float_near_rel_array(lpc0 + 16, lpc1 + 16, EPS, SILK_SF_SIZE))
+                fail();
+            bench_new(dst1, lpc1 + 16, res, gain, coeffs, order, SILK_SF_SIZE);
+        }
+    }
+
+    report("silk_lpc_synthesis");
+}
+
+void checkasm_check_opusdsp(void)
+{
+    check_postfilter();
+    check_deemphasis();
+    check_ltp_synthesis();
+    check_lpc_synthesis();
+}
@@ -92,6 +92,10 @@ runlocal(){
     ${base}/"$@" ${base}
 }
 
+probebatch(){
+    printf '%s\n' "$@" | run ffprobe${PROGSUF} -batch - -batch_threads 2 -show_streams -show_format -bitexact -v 0
+}
+
 probeframes(){
     run ffprobe${PROGSUF} -show_frames -v 0 "$@"
 }
@@ -125,6 +129,18 @@ ffmpeg(){
     run ffmpeg${PROGSUF} ${ffmpeg_args}
 }
 
+filterprofile(){
+    prof="${outdir}/${test}.json"
+    cleanfiles="$cleanfiles $prof"
+    ffmpeg "$@" -filter_profile "$prof" -f null - || return
+    # timings, buffer sizes and slice jobs depend on the machine
+    sed -e 's/"time":[0-9.]*/"time":T/' -e 's/"frames_per_second":[0-9.]*/"frames_per_second":T/g' \
+        -e 's/"total":[0-9]*/"total":T/g' -e 's/"avg":[0-9.]*/"avg":T/g' \
+        -e 's/"p99":[0-9]*/"p99":T/g' -e 's/"max":[0-9]*/"max":T/g' \
+        -e 's/"bytes_allocated":[0-9]*/"bytes_allocated":B/g' \
+        -e 's/"slice_jobs":\[[0-9,]*\]/"slice_jobs":[J]/g' -e 's/"slice_us":\[[0-9,]*\]/"slice_us":[T]/g' "$prof"
+}
+
 framecrc(){
     ffmpeg "$@" -flags +bitexact -fflags +bitexact -f framecrc -
 }
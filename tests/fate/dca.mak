@@ -57,6 +57,20 @@ fate-dca-xch_61_24_48_768-dmix_6: CMD = ffmpeg -request_channel_layout 0x60f -i
 fate-dca-xch_61_24_48_768-dmix_6: REF = $(SAMPLES)/dts/dcadec-suite/xch_61_24_48_768-dmix_6.f32
 
 $(FATE_DCADEC_LOSSY): CMP = oneoff
+# streams with several XLL channel sets, whose segments are unpacked by
+# separate slice threading jobs
+DCADEC_SUITE_LOSSLESS_CHSETS = xll_71_24_48_768_0   \
+                               xll_71_24_48_768_1   \
+                               xll_xch_61_24_48_768 \
+
+define FATE_DCADEC_LOSSLESS_SLICE
+FATE_DCADEC_LOSSLESS += fate-dca-$(1)-slice
+fate-dca-$(1)-slice: CMD = framemd5 -threads 4 -thread_type slice -i $(TARGET_SAMPLES)/dts/dcadec-suite/$(1).dtshd -c:a pcm_s24le
+fate-dca-$(1)-slice: REF = $(SRC_PATH)/tests/ref/fate/dca-$(1)
+endef
+
+$(foreach N,$(DCADEC_SUITE_LOSSLESS_CHSETS),$(eval $(call FATE_DCADEC_LOSSLESS_SLICE,$(N))))
+
 $(FATE_DCADEC_LOSSY): CMP_UNIT = f32
 $(FATE_DCADEC_LOSSY): FUZZ = 9
 
@@ -70,6 +84,10 @@ fate-dca-core: REF = $(SAMPLES)/dts/dts.pcm
 FATE_DCA-$(call DEMDEC, DTS, DCA) += fate-dca-xll
 fate-dca-xll: CMD = md5 -i $(TARGET_SAMPLES)/dts/master_audio_7.1_24bit.dts -f s24le
 
+FATE_DCA-$(call DEMDEC, DTS, DCA) += fate-dca-xll-slice
+fate-dca-xll-slice: CMD = md5 -threads 4 -thread_type slice -i $(TARGET_SAMPLES)/dts/master_audio_7.1_24bit.dts -f s24le
+fate-dca-xll-slice: REF = $(SRC_PATH)/tests/ref/fate/dca-xll
+
 FATE_DCA-$(call DEMDEC, DTS, DCA) += fate-dts_es
 fate-dts_es: CMD = pcm -i $(TARGET_SAMPLES)/dts/dts_es.dts
 fate-dts_es: CMP = oneoff
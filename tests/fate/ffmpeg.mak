@@ -25,6 +25,9 @@ fate-ffmpeg-filter_colorkey: CMD = framecrc -idct simple -fflags +bitexact -flag
 FATE_FFMPEG-$(CONFIG_COLOR_FILTER) += fate-ffmpeg-lavfi
 fate-ffmpeg-lavfi: CMD = framecrc -lavfi color=d=1:r=5 -fflags +bitexact
 
+FATE_FFMPEG-$(call ALLYES, TESTSRC_FILTER HFLIP_FILTER NULL_MUXER) += fate-ffmpeg-filter_profile
+fate-ffmpeg-filter_profile: CMD = filterprofile -lavfi testsrc=d=1:r=5:s=64x48,hflip -fflags +bitexact
+
 FATE_SAMPLES_FFMPEG-$(CONFIG_RAWVIDEO_DEMUXER) += fate-force_key_frames
 fate-force_key_frames: tests/data/vsynth_lena.yuv
 fate-force_key_frames: CMD = enc_dec \
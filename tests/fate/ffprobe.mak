@@ -29,6 +29,10 @@ FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_xml
 fate-ffprobe_xml: $(FFPROBE_TEST_FILE)
 fate-ffprobe_xml: CMD = run $(FFPROBE_COMMAND) -of xml
 
+FATE_FFPROBE-$(CONFIG_AVDEVICE) += fate-ffprobe_batch
+fate-ffprobe_batch: $(FFPROBE_TEST_FILE)
+fate-ffprobe_batch: CMD = probebatch $(FFPROBE_TEST_FILE) $(FFPROBE_TEST_FILE) $(FFPROBE_TEST_FILE)
+
 FATE_FFPROBE += $(FATE_FFPROBE-yes)
 
 fate-ffprobe: $(FATE_FFPROBE)
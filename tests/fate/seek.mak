@@ -249,12 +249,25 @@ fate-seek-extra-mp3:  CMD = run libavformat/seek-test$(EXESUF) $(TARGET_SAMPLES)
 fate-seek-cache-pipe: CMD = cat $(TARGET_SAMPLES)/gapless/gapless.mp3 | run libavformat/seek-test$(EXESUF) cache:pipe:0 -read_ahead_limit -1
 FATE_SEEK_EXTRA += $(FATE_SEEK_EXTRA-yes)
 
+# fragmented mp4 read on demand through its mfra index
+tests/data/mov-frag-mfra.mp4: TAG = GEN
+tests/data/mov-frag-mfra.mp4: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< \
+        -f lavfi -i testsrc=d=8:r=25 -f lavfi -i "aevalsrc=sin(2*PI*440*t):d=8" -map 0 -map 1 \
+        -flags +bitexact -fflags +bitexact -c:v mpeg4 -bf 2 -g 25 -c:a mp2fixed \
+        -movflags frag_keyframe -y $(TARGET_PATH)/$@ 2>/dev/null
 
-$(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA): libavformat/seek-test$(EXESUF)
+FATE_SEEK_MFRA-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER AEVALSRC_FILTER MPEG4_ENCODER MP2FIXED_ENCODER MOV_MUXER MOV_DEMUXER) += fate-seek-mov-frag-mfra
+fate-seek-mov-frag-mfra: tests/data/mov-frag-mfra.mp4
+fate-seek-mov-frag-mfra: CMD = run libavformat/seek-test$(EXESUF) $(TARGET_PATH)/tests/data/mov-frag-mfra.mp4
+FATE_SEEK_MFRA += $(FATE_SEEK_MFRA-yes)
+
+
+$(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA) $(FATE_SEEK_MFRA): libavformat/seek-test$(EXESUF)
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): CMD = run libavformat/seek-test$(EXESUF) $(TARGET_PATH)/tests/data/$(SRC)
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): fate-seek-%: fate-%
 fate-seek-%: REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%=%)
 
-FATE_AVCONV += $(FATE_SEEK)
+FATE_AVCONV += $(FATE_SEEK) $(FATE_SEEK_MFRA)
 FATE_SAMPLES_AVCONV += $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
-fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
+fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA) $(FATE_SEEK_MFRA)